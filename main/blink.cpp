@@ -0,0 +1,70 @@
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "gpio.h"
+#include "driver/hw_timer.h"
+
+#include "blink.hpp"
+
+// Blinking runs off the FRC1 hardware timer: its interrupt toggles the pins
+// directly, without waking up any task or going through the FSM.
+
+#define BLINK_HALF_PERIOD_US 1000000
+
+static const char *TAG = "blink";
+
+static volatile uint32_t blink_mask = 0;
+static volatile bool blink_is_on = false;
+static volatile uint32_t blink_wakeups = 0;
+
+static void IRAM_ATTR blink_timer_callback(void *arg)
+{
+    blink_wakeups++;
+    blink_is_on = !blink_is_on;
+
+    uint32_t mask = blink_mask;
+    for (int pin = 0; mask != 0; pin++, mask >>= 1)
+    {
+        if (mask & 1)
+        {
+            gpio_set_level((gpio_num_t)pin, blink_is_on ? 0 : 1);
+        }
+    }
+}
+
+esp_err_t blink_setup(void)
+{
+    return hw_timer_init(blink_timer_callback, nullptr);
+}
+
+void blink_set(uint32_t pin_mask)
+{
+    if (pin_mask == blink_mask)
+    {
+        return;
+    }
+
+    hw_timer_disarm();
+
+    blink_mask = pin_mask;
+    blink_is_on = true;
+    for (int pin = 0; pin_mask != 0; pin++, pin_mask >>= 1)
+    {
+        if (pin_mask & 1)
+        {
+            gpio_set_level((gpio_num_t)pin, 0);
+        }
+    }
+
+    if (blink_mask != 0)
+    {
+        hw_timer_alarm_us(BLINK_HALF_PERIOD_US, true);
+    }
+
+    ESP_LOGD(TAG, "blinking pins 0x%05x", blink_mask);
+}
+
+uint32_t blink_get_wakeups(void)
+{
+    return blink_wakeups;
+}
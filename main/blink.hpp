@@ -0,0 +1,18 @@
+#ifndef BLINK_HPP_INCLUDED
+#define BLINK_HPP_INCLUDED
+
+#include <stdint.h>
+
+#include "esp_err.h"
+
+esp_err_t blink_setup(void);
+
+// Hands the active low LEDs in the pin mask over to the blink timer, which
+// keeps toggling them every second on its own. An unchanged mask keeps the
+// current phase, an empty one stops the timer.
+void blink_set(uint32_t pin_mask);
+
+// Blink timer interrupts since boot, each one a CPU wakeup.
+uint32_t blink_get_wakeups(void);
+
+#endif /* BLINK_HPP_INCLUDED */
@@ -0,0 +1,69 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "sdkconfig.h"
+#if CONFIG_POMODORO_CONSOLE_ENABLE
+#include "esp_console.h"
+#endif
+
+#include "pomodoro.hpp"
+#include "busy.hpp"
+
+esp_err_t busy_post(const char *request)
+{
+    uint32_t input;
+    if (strcmp(request, "on") == 0)
+    {
+        input = INPUT_BUSY_ON;
+    }
+    else if (strcmp(request, "off") == 0)
+    {
+        input = INPUT_BUSY_OFF;
+    }
+    else if (strcmp(request, "toggle") == 0)
+    {
+        input = INPUT_BUSY_TOGGLE;
+    }
+    else
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    return pomodoro_post_input(input) ? ESP_OK : ESP_ERR_TIMEOUT;
+}
+
+#if CONFIG_POMODORO_CONSOLE_ENABLE
+static int busy_command(int argc, char **argv)
+{
+    if (argc == 1)
+    {
+        printf("busy: %s\n", pomodoro_get_status().is_busy ? "on" : "off");
+        return 0;
+    }
+    esp_err_t err = argc == 2 ? busy_post(argv[1]) : ESP_ERR_INVALID_ARG;
+    if (err == ESP_ERR_TIMEOUT)
+    {
+        printf("busy: input queue full, try again\n");
+        return 1;
+    }
+    if (err != ESP_OK)
+    {
+        printf("usage: busy [on|off|toggle]\n");
+        return 1;
+    }
+
+    return 0;
+}
+
+esp_err_t busy_register_command(void)
+{
+    esp_console_cmd_t cmd = {};
+
+    cmd.command = "busy";
+    cmd.help = "Show or set the busy override";
+    cmd.hint = "[on|off|toggle]";
+    cmd.func = &busy_command;
+
+    return esp_console_cmd_register(&cmd);
+}
+#endif
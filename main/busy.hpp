@@ -0,0 +1,18 @@
+#ifndef BUSY_HPP_INCLUDED
+#define BUSY_HPP_INCLUDED
+
+#include "esp_err.h"
+
+// Busy override, an on-air sign on top of the pomodoro light. While it is on
+// the LEDs show steady red and green, a combination no period uses, and the
+// running period pauses or keeps counting behind it depending on
+// CONFIG_POMODORO_BUSY_POLICY. Set with INPUT_BUSY_ON, INPUT_BUSY_OFF and
+// INPUT_BUSY_TOGGLE from the expander, the console or the http api.
+
+// "on", "off" or "toggle", ESP_ERR_INVALID_ARG for anything else and
+// ESP_ERR_TIMEOUT when the input queue was full.
+esp_err_t busy_post(const char *request);
+
+esp_err_t busy_register_command(void);
+
+#endif /* BUSY_HPP_INCLUDED */
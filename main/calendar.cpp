@@ -0,0 +1,731 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <inttypes.h>
+
+#include "sdkconfig.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_http_client.h"
+#if CONFIG_POMODORO_CONSOLE_ENABLE
+#include "esp_console.h"
+#endif
+
+#include "pomodoro.hpp"
+#include "tz.hpp"
+#include "calendar.hpp"
+
+#define CALENDAR_EPOCH 1577836800 // 2020-01-01, earlier means no SNTP yet
+#define CALENDAR_FETCH_SECONDS (CONFIG_POMODORO_CALENDAR_FETCH_MINUTES * 60)
+#define CALENDAR_WAIT_MAX_SECONDS 600 // longest single sleep, well below the tick overflow
+
+static const char *TAG = "calendar";
+
+static calendar_interval intervals[CONFIG_POMODORO_CALENDAR_EVENTS];
+static size_t intervals_count = 0;
+static uint32_t fetched_at = 0;
+static bool is_fetch_failed = false;
+
+static void calendar_task(void *arg);
+
+// The zone of a local time, from its TZID parameter when tz_table.inc knows
+// the name, the device local time otherwise.
+static void calendar_parse_zone(const char *params, calendar_time *time)
+{
+    time->has_rule = false;
+
+    const char *tzid = params != nullptr ? strstr(params, "TZID=") : nullptr;
+    if (tzid == nullptr)
+    {
+        return;
+    }
+    tzid += strlen("TZID=");
+    if (*tzid == '"')
+    {
+        tzid++;
+    }
+
+    char name[48];
+    size_t len = strcspn(tzid, "\";");
+    if (len >= sizeof(name))
+    {
+        return;
+    }
+    memcpy(name, tzid, len);
+    name[len] = '\0';
+
+    const char *posix = tz_find_zone(name);
+    time->has_rule = posix != nullptr && tz_parse(posix, &time->rule);
+}
+
+// YYYYMMDDTHHMMSS with a trailing Z for UTC, in the TZID zone of the
+// parameters without.
+static bool calendar_parse_time(const char *value, const char *params, calendar_time *time)
+{
+    int year, month, day, hour, minute, second;
+    char zone = '\0';
+    if (sscanf(value, "%4d%2d%2dT%2d%2d%2d%c", &year, &month, &day, &hour, &minute, &second, &zone) < 6)
+    {
+        return false;
+    }
+    if (month < 1 || month > 12 || day < 1 || day > 31 || hour > 23 || minute > 59 || second > 60)
+    {
+        return false;
+    }
+
+    time->day = tz_days_from_civil(year, month, day);
+    time->seconds = hour * 3600 + minute * 60 + second;
+    time->is_utc = zone == 'Z';
+    if (time->is_utc)
+    {
+        time->has_rule = false;
+    }
+    else
+    {
+        calendar_parse_zone(params, time);
+    }
+    return true;
+}
+
+// The instant of the time's wall clock reading on another day.
+static uint32_t calendar_to_utc(const calendar_time &time, int64_t day)
+{
+    int64_t local = day * 86400 + time.seconds;
+    if (time.is_utc)
+    {
+        return local;
+    }
+    return tz_local_to_utc(time.has_rule ? &time.rule : nullptr, local);
+}
+
+static bool calendar_parse_number(const char *text, uint32_t max, uint32_t *value)
+{
+    char *end;
+    unsigned long parsed = strtoul(text, &end, 10);
+    if (end == text || *end != '\0' || text[0] == '-' || parsed < 1 || parsed > max)
+    {
+        return false;
+    }
+    *value = parsed;
+    return true;
+}
+
+// SU to SA, -1 for anything else; BYDAY ordinals like 1MO are for monthly
+// rules and fall out here as well.
+static int calendar_parse_weekday(const char *code)
+{
+    static const char *const weekdays[] = {"SU", "MO", "TU", "WE", "TH", "FR", "SA"};
+    for (int i = 0; i < 7; i++)
+    {
+        if (strcmp(code, weekdays[i]) == 0)
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// Only what daily and weekly rules need, anything else leaves the rule
+// empty and the event counts once.
+static void calendar_parse_rrule(char *value, calendar_rrule *rrule)
+{
+    calendar_rrule parsed = {};
+    parsed.interval = 1;
+    parsed.wkst = 1; // Monday
+
+    bool is_understood = true;
+    char *parts;
+    for (char *part = strtok_r(value, ";", &parts); part != nullptr && is_understood; part = strtok_r(nullptr, ";", &parts))
+    {
+        char *argument = strchr(part, '=');
+        if (argument == nullptr)
+        {
+            is_understood = false;
+            break;
+        }
+        *argument++ = '\0';
+
+        uint32_t number = 1;
+        if (strcmp(part, "FREQ") == 0)
+        {
+            parsed.freq = strcmp(argument, "DAILY") == 0 ? 'D' : strcmp(argument, "WEEKLY") == 0 ? 'W' : '\0';
+            is_understood = parsed.freq != '\0';
+        }
+        else if (strcmp(part, "INTERVAL") == 0)
+        {
+            is_understood = calendar_parse_number(argument, UINT16_MAX, &number);
+            parsed.interval = number;
+        }
+        else if (strcmp(part, "COUNT") == 0)
+        {
+            is_understood = calendar_parse_number(argument, UINT16_MAX, &number);
+            parsed.count = number;
+        }
+        else if (strcmp(part, "UNTIL") == 0)
+        {
+            // a date alone means the whole of that day
+            int year, month, day;
+            calendar_time until;
+            if (strlen(argument) == 8 && sscanf(argument, "%4d%2d%2d", &year, &month, &day) == 3)
+            {
+                parsed.until = tz_days_from_civil(year, month, day) * 86400 + 86399;
+            }
+            else if (calendar_parse_time(argument, nullptr, &until))
+            {
+                parsed.until = (int64_t)until.day * 86400 + until.seconds;
+                parsed.is_until_utc = until.is_utc;
+            }
+            else
+            {
+                is_understood = false;
+            }
+        }
+        else if (strcmp(part, "BYDAY") == 0)
+        {
+            char *days;
+            for (char *code = strtok_r(argument, ",", &days); code != nullptr && is_understood; code = strtok_r(nullptr, ",", &days))
+            {
+                int weekday = calendar_parse_weekday(code);
+                is_understood = weekday >= 0;
+                parsed.byday |= is_understood ? 1 << weekday : 0;
+            }
+        }
+        else if (strcmp(part, "WKST") == 0)
+        {
+            int weekday = calendar_parse_weekday(argument);
+            is_understood = weekday >= 0;
+            parsed.wkst = is_understood ? weekday : 0;
+        }
+        else
+        {
+            is_understood = false;
+        }
+    }
+
+    *rrule = is_understood ? parsed : calendar_rrule{};
+}
+
+// P[nW][nD][T[nH][nM][nS]], the only forms events use.
+static bool calendar_parse_duration(const char *value, uint32_t *result)
+{
+    if (*value == '+')
+    {
+        value++;
+    }
+    if (*value++ != 'P')
+    {
+        return false;
+    }
+
+    uint32_t total = 0;
+    bool in_time = false;
+    while (*value != '\0')
+    {
+        if (*value == 'T')
+        {
+            in_time = true;
+            value++;
+            continue;
+        }
+
+        char *end;
+        unsigned long number = strtoul(value, &end, 10);
+        if (end == value)
+        {
+            return false;
+        }
+
+        switch (*end)
+        {
+        case 'W':
+            total += number * 7 * 86400;
+            break;
+        case 'D':
+            total += number * 86400;
+            break;
+        case 'H':
+            total += number * 3600;
+            break;
+        case 'M':
+            if (!in_time)
+            {
+                return false;
+            }
+            total += number * 60;
+            break;
+        case 'S':
+            total += number;
+            break;
+        default:
+            return false;
+        }
+        value = end + 1;
+    }
+
+    *result = total;
+    return true;
+}
+
+// Keeps the earliest events when there are more than fit.
+static void calendar_insert(calendar_parser *parser, uint32_t start, uint32_t end)
+{
+    if (parser->count == parser->max)
+    {
+        if (start >= parser->intervals[parser->max - 1].start)
+        {
+            return;
+        }
+        parser->count--;
+    }
+
+    size_t i = parser->count;
+    while (i > 0 && parser->intervals[i - 1].start > start)
+    {
+        parser->intervals[i] = parser->intervals[i - 1];
+        i--;
+    }
+    parser->intervals[i].start = start;
+    parser->intervals[i].end = end;
+    parser->count++;
+}
+
+static bool calendar_is_excluded(const calendar_parser *parser, uint32_t at)
+{
+    for (size_t i = 0; i < parser->exdates_count; i++)
+    {
+        if (parser->exdates[i] == at)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+static int calendar_weekday(int64_t day)
+{
+    // 1970-01-01 was a Thursday
+    return ((day + 4) % 7 + 7) % 7;
+}
+
+// Inserts the occurrences of the event that are not over yet and start
+// within the recurrence window, the event itself when it has no rule.
+static void calendar_expand(calendar_parser *parser, uint32_t length)
+{
+    const calendar_rrule &rrule = parser->rrule;
+    const calendar_time &start = parser->start_time;
+
+    if (rrule.freq == '\0')
+    {
+        if (parser->start + length > parser->now)
+        {
+            calendar_insert(parser, parser->start, parser->start + length);
+        }
+        return;
+    }
+
+    uint32_t horizon = parser->now + CALENDAR_RECURRENCE_DAYS * 86400;
+    bool is_weekly = rrule.freq == 'W';
+    uint8_t byday = rrule.byday != 0 ? rrule.byday : is_weekly ? 1 << calendar_weekday(start.day) : 0x7F;
+    int64_t period_days = (is_weekly ? 7 : 1) * rrule.interval;
+
+    // periods are counted from the one holding DTSTART, a week from WKST
+    int64_t period = start.day - (is_weekly ? (calendar_weekday(start.day) - rrule.wkst + 7) % 7 : 0);
+
+    // Without COUNT the periods over well before now need not be walked. Two
+    // days of margin cover any offset change between DTSTART and now.
+    if (rrule.count == 0 && parser->now > parser->start + length)
+    {
+        int64_t past_days = (int64_t)(parser->now - parser->start - length) / 86400 - 2;
+        if (past_days > 0)
+        {
+            period += past_days / period_days * period_days;
+        }
+    }
+
+    uint32_t occurrences = 0;
+    for (;; period += period_days)
+    {
+        // checked per period as well, a BYDAY the periods never reach must
+        // still end the walk
+        uint32_t period_at = calendar_to_utc(start, period);
+        int64_t period_until_at = rrule.is_until_utc ? period_at : period * 86400 + start.seconds;
+        if ((rrule.until != 0 && period_until_at > rrule.until) || period_at > horizon)
+        {
+            return;
+        }
+
+        for (int64_t day = period; day < period + (is_weekly ? 7 : 1); day++)
+        {
+            if (day < start.day || !(byday & (1 << calendar_weekday(day))))
+            {
+                continue;
+            }
+
+            uint32_t at = calendar_to_utc(start, day);
+            int64_t until_at = rrule.is_until_utc ? at : day * 86400 + start.seconds;
+            if ((rrule.count != 0 && occurrences == rrule.count) || (rrule.until != 0 && until_at > rrule.until) || at > horizon)
+            {
+                return;
+            }
+            occurrences++;
+
+            if (at + length > parser->now && !calendar_is_excluded(parser, at))
+            {
+                calendar_insert(parser, at, at + length);
+            }
+        }
+    }
+}
+
+static void calendar_parse_line(calendar_parser *parser)
+{
+    char *line = parser->line;
+    char *value = strchr(line, ':');
+    if (value == nullptr)
+    {
+        return;
+    }
+    *value++ = '\0';
+
+    // the name ends at the first parameter, if any
+    char *params = strchr(line, ';');
+    if (params != nullptr)
+    {
+        *params++ = '\0';
+    }
+
+    if (strcmp(line, "BEGIN") == 0 && strcmp(value, "VEVENT") == 0)
+    {
+        parser->in_event = true;
+        parser->is_skipped = false;
+        parser->start = 0;
+        parser->end = 0;
+        parser->duration = 0;
+        parser->rrule = {};
+        parser->exdates_count = 0;
+        return;
+    }
+    if (!parser->in_event)
+    {
+        return;
+    }
+
+    if (strcmp(line, "END") == 0 && strcmp(value, "VEVENT") == 0)
+    {
+        parser->in_event = false;
+
+        uint32_t end = parser->end != 0 ? parser->end : parser->start + parser->duration;
+        if (!parser->is_skipped && parser->start != 0 && end > parser->start)
+        {
+            calendar_expand(parser, end - parser->start);
+        }
+        return;
+    }
+
+    if (strcmp(line, "DTSTART") == 0 || strcmp(line, "DTEND") == 0)
+    {
+        calendar_time time;
+
+        // all day events are rather reminders than meetings
+        if (params != nullptr && strstr(params, "VALUE=DATE") != nullptr && strstr(params, "VALUE=DATE-TIME") == nullptr)
+        {
+            parser->is_skipped = true;
+        }
+        else if (!calendar_parse_time(value, params, &time))
+        {
+            parser->is_skipped = true;
+        }
+        else if (line[2] == 'S')
+        {
+            parser->start_time = time;
+            parser->start = calendar_to_utc(time, time.day);
+        }
+        else
+        {
+            parser->end = calendar_to_utc(time, time.day);
+        }
+    }
+    else if (strcmp(line, "RRULE") == 0)
+    {
+        calendar_parse_rrule(value, &parser->rrule);
+    }
+    else if (strcmp(line, "EXDATE") == 0)
+    {
+        // a list cut short by the line length loses its last dates only
+        char *dates;
+        for (char *date = strtok_r(value, ",", &dates); date != nullptr && parser->exdates_count < CALENDAR_EXDATES; date = strtok_r(nullptr, ",", &dates))
+        {
+            calendar_time time;
+            if (calendar_parse_time(date, params, &time))
+            {
+                parser->exdates[parser->exdates_count++] = calendar_to_utc(time, time.day);
+            }
+        }
+    }
+    else if (strcmp(line, "DURATION") == 0)
+    {
+        if (!calendar_parse_duration(value, &parser->duration))
+        {
+            parser->is_skipped = true;
+        }
+    }
+    else if (strcmp(line, "STATUS") == 0)
+    {
+        parser->is_skipped = parser->is_skipped || strcmp(value, "CANCELLED") == 0;
+    }
+    else if (strcmp(line, "TRANSP") == 0)
+    {
+        parser->is_skipped = parser->is_skipped || strcmp(value, "TRANSPARENT") == 0;
+    }
+}
+
+void calendar_parser_init(calendar_parser *parser, calendar_interval *intervals, size_t max, uint32_t now)
+{
+    memset(parser, 0, sizeof(*parser));
+    parser->intervals = intervals;
+    parser->max = max;
+    parser->now = now;
+}
+
+// Lines end with CRLF and continue on the next one when it starts with a
+// space or a tab, so a line is only complete once the next one has started.
+void calendar_parser_feed(calendar_parser *parser, const char *data, size_t len)
+{
+    for (size_t i = 0; i < len; i++)
+    {
+        char c = data[i];
+
+        if (c == '\r')
+        {
+            continue;
+        }
+        if (c == '\n')
+        {
+            parser->is_line_ended = true;
+            continue;
+        }
+
+        if (parser->is_line_ended)
+        {
+            parser->is_line_ended = false;
+            if (c == ' ' || c == '\t')
+            {
+                continue;
+            }
+
+            parser->line[parser->len] = '\0';
+            calendar_parse_line(parser);
+            parser->len = 0;
+        }
+
+        // longer lines are cut, the properties used here are short
+        if (parser->len < sizeof(parser->line) - 1)
+        {
+            parser->line[parser->len++] = c;
+        }
+    }
+}
+
+size_t calendar_parser_finish(calendar_parser *parser)
+{
+    if (parser->len > 0)
+    {
+        parser->line[parser->len] = '\0';
+        calendar_parse_line(parser);
+        parser->len = 0;
+    }
+
+    size_t merged = 0;
+    for (size_t i = 0; i < parser->count; i++)
+    {
+        if (merged > 0 && parser->intervals[i].start <= parser->intervals[merged - 1].end)
+        {
+            if (parser->intervals[i].end > parser->intervals[merged - 1].end)
+            {
+                parser->intervals[merged - 1].end = parser->intervals[i].end;
+            }
+            continue;
+        }
+        parser->intervals[merged++] = parser->intervals[i];
+    }
+    parser->count = merged;
+
+    return merged;
+}
+
+static bool calendar_fetch(uint32_t now)
+{
+    static calendar_interval fetched[CONFIG_POMODORO_CALENDAR_EVENTS];
+    static calendar_parser parser;
+
+    esp_http_client_config_t config = {};
+    config.url = CONFIG_POMODORO_CALENDAR_URL;
+    config.timeout_ms = 10000;
+
+    esp_http_client_handle_t client = esp_http_client_init(&config);
+    if (client == nullptr)
+    {
+        return false;
+    }
+
+    esp_err_t err = esp_http_client_open(client, 0);
+    if (err != ESP_OK)
+    {
+        ESP_LOGW(TAG, "cannot fetch the calendar: %s", esp_err_to_name(err));
+        esp_http_client_cleanup(client);
+        return false;
+    }
+
+    esp_http_client_fetch_headers(client);
+    int status = esp_http_client_get_status_code(client);
+    bool is_ok = status == 200;
+    if (!is_ok)
+    {
+        ESP_LOGW(TAG, "calendar fetch answered %d", status);
+    }
+
+    calendar_parser_init(&parser, fetched, CONFIG_POMODORO_CALENDAR_EVENTS, now);
+    while (is_ok)
+    {
+        char buf[128];
+        int len = esp_http_client_read(client, buf, sizeof(buf));
+        if (len < 0)
+        {
+            ESP_LOGW(TAG, "calendar fetch interrupted");
+            is_ok = false;
+            break;
+        }
+        if (len == 0)
+        {
+            break;
+        }
+        calendar_parser_feed(&parser, buf, len);
+    }
+
+    esp_http_client_close(client);
+    esp_http_client_cleanup(client);
+
+    if (!is_ok)
+    {
+        return false;
+    }
+
+    size_t count = calendar_parser_finish(&parser);
+
+    portENTER_CRITICAL();
+    memcpy(intervals, fetched, count * sizeof(fetched[0]));
+    intervals_count = count;
+    portEXIT_CRITICAL();
+
+    ESP_LOGI(TAG, "%u upcoming busy intervals", (unsigned)count);
+
+    return true;
+}
+
+esp_err_t calendar_setup(void)
+{
+    if (strlen(CONFIG_POMODORO_CALENDAR_URL) == 0)
+    {
+        ESP_LOGW(TAG, "no calendar url configured, calendar pauses disabled");
+        return ESP_OK;
+    }
+
+    xTaskCreate(calendar_task, "calendar_task", 4096, nullptr, 3, nullptr);
+
+    return ESP_OK;
+}
+
+// Sleeps until the next event edge or fetch, nothing runs in between.
+static void calendar_task(void *arg)
+{
+    bool is_busy = false;
+
+    for (;;)
+    {
+        uint32_t now = time(nullptr);
+        if (now < CALENDAR_EPOCH)
+        {
+            vTaskDelay(pdMS_TO_TICKS(10000));
+            continue;
+        }
+
+        if (fetched_at == 0 || now - fetched_at >= CALENDAR_FETCH_SECONDS)
+        {
+            // a failed fetch keeps the intervals known so far
+            is_fetch_failed = !calendar_fetch(now);
+            fetched_at = now;
+        }
+
+        // the list is merged and sorted, the first event not over decides
+        uint32_t wake_at = fetched_at + CALENDAR_FETCH_SECONDS;
+        bool is_busy_now = false;
+        for (size_t i = 0; i < intervals_count; i++)
+        {
+            if (intervals[i].end <= now)
+            {
+                continue;
+            }
+
+            is_busy_now = intervals[i].start <= now;
+            uint32_t edge = is_busy_now ? intervals[i].end : intervals[i].start;
+            wake_at = edge < wake_at ? edge : wake_at;
+            break;
+        }
+
+        if (is_busy_now != is_busy)
+        {
+            // the edge counts once the FSM has it, a full queue is tried again
+            if (pomodoro_post_input(is_busy_now ? INPUT_CALENDAR_BUSY : INPUT_CALENDAR_FREE))
+            {
+                is_busy = is_busy_now;
+                ESP_LOGI(TAG, "calendar %s", is_busy ? "busy, pausing work" : "free again");
+            }
+            else
+            {
+                wake_at = now + 1;
+            }
+        }
+
+        // in steps, so the ticks cannot overflow and a clock set back or
+        // forward is noticed
+        uint32_t wait = wake_at > now ? wake_at - now : 1;
+        vTaskDelay(pdMS_TO_TICKS((wait < CALENDAR_WAIT_MAX_SECONDS ? wait : CALENDAR_WAIT_MAX_SECONDS) * 1000));
+    }
+}
+
+#if CONFIG_POMODORO_CONSOLE_ENABLE
+static int calendar_command(int argc, char **argv)
+{
+    calendar_interval copy[CONFIG_POMODORO_CALENDAR_EVENTS];
+
+    portENTER_CRITICAL();
+    size_t count = intervals_count;
+    memcpy(copy, intervals, count * sizeof(copy[0]));
+    portEXIT_CRITICAL();
+
+    printf("fetched at %" PRIu32 "%s, %d intervals\n", fetched_at, is_fetch_failed ? " (last fetch failed)" : "", count);
+    for (size_t i = 0; i < count; i++)
+    {
+        struct tm local;
+        tz_localtime(copy[i].start, &local);
+
+        char text[24];
+        strftime(text, sizeof(text), "%Y-%m-%d %H:%M", &local);
+        printf("%s %4" PRIu32 " min\n", text, (copy[i].end - copy[i].start) / 60);
+    }
+    return 0;
+}
+
+esp_err_t calendar_register_command(void)
+{
+    esp_console_cmd_t cmd = {};
+
+    cmd.command = "calendar";
+    cmd.help = "Print the upcoming busy intervals of the calendar feed";
+    cmd.func = &calendar_command;
+
+    return esp_console_cmd_register(&cmd);
+}
+#endif
@@ -0,0 +1,85 @@
+#ifndef CALENDAR_HPP_INCLUDED
+#define CALENDAR_HPP_INCLUDED
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "esp_err.h"
+
+#include "tz.hpp"
+
+// Busy times from an ICS feed at CONFIG_POMODORO_CALENDAR_URL. The feed is
+// fetched every CONFIG_POMODORO_CALENDAR_FETCH_MINUTES and parsed as it
+// streams in, only the start and end of the upcoming events are kept, sorted
+// and merged. Work pauses while an event runs and resumes after it.
+//
+// Understood: VEVENT with DTSTART and DTEND or DURATION, in UTC, in a TZID
+// zone from tz_table.inc or in the device local time; DAILY and WEEKLY
+// RRULE with INTERVAL, COUNT, UNTIL, BYDAY and WKST, expanded over the next
+// CALENDAR_RECURRENCE_DAYS, and EXDATE. Skipped: all day events, cancelled
+// or transparent ones. Other rules only count the first occurrence, other
+// zones are taken as the device local time, and an occurrence moved with
+// RECURRENCE-ID keeps its original slot busy as well.
+
+#define CALENDAR_RECURRENCE_DAYS 2 // the feed is fetched again long before
+#define CALENDAR_EXDATES 8
+
+struct calendar_interval
+{
+    uint32_t start; // unix time
+    uint32_t end;
+};
+
+// A wall clock time as written in the feed, recurrences keep it.
+struct calendar_time
+{
+    int32_t day;     // days since 1970-01-01
+    int32_t seconds; // after midnight
+    bool is_utc;
+    bool has_rule; // in rule, else in the device local time
+    tz_rule rule;
+};
+
+struct calendar_rrule
+{
+    char freq; // 'D' daily, 'W' weekly, '\0' without a rule we understand
+    uint16_t interval;
+    uint16_t count; // 0 without
+    int64_t until;  // wall clock seconds in the zone of DTSTART, 0 without
+    bool is_until_utc;
+    uint8_t byday; // bit 0 Sunday, 0 for the weekday of DTSTART
+    uint8_t wkst;  // 0-6, Sunday first
+};
+
+// Streaming ICS parser, fed with whatever the socket returns.
+struct calendar_parser
+{
+    char line[128];
+    size_t len;
+    bool is_line_ended; // waiting for a folded continuation
+    bool in_event;
+    bool is_skipped;
+    calendar_time start_time;
+    uint32_t start;
+    uint32_t end;
+    uint32_t duration;
+    calendar_rrule rrule;
+    uint32_t exdates[CALENDAR_EXDATES];
+    size_t exdates_count;
+
+    calendar_interval *intervals;
+    size_t max;
+    size_t count;
+    uint32_t now; // events over before this are dropped
+};
+
+void calendar_parser_init(calendar_parser *parser, calendar_interval *intervals, size_t max, uint32_t now);
+void calendar_parser_feed(calendar_parser *parser, const char *data, size_t len);
+// Flushes the last line, merges overlapping events and returns their count.
+size_t calendar_parser_finish(calendar_parser *parser);
+
+esp_err_t calendar_setup(void);
+
+esp_err_t calendar_register_command(void);
+
+#endif /* CALENDAR_HPP_INCLUDED */
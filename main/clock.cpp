@@ -0,0 +1,100 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "sdkconfig.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#if CONFIG_POMODORO_CONSOLE_ENABLE
+#include "esp_console.h"
+#endif
+
+#include "pomodoro.hpp"
+#include "clock.hpp"
+
+using time_units::microseconds;
+using time_units::time_point;
+
+static const char *TAG = "clock";
+
+// The clock is piecewise linear: it advances from the anchor at the current
+// scale, a scale change moves the anchor to the current reading.
+static int64_t anchor_real = 0;
+static int64_t anchor_scaled = 0;
+static uint32_t time_scale = CONFIG_POMODORO_TIME_SCALE;
+
+time_point clock_now(void)
+{
+    int64_t real = esp_timer_get_time();
+
+    portENTER_CRITICAL();
+    int64_t scaled = anchor_scaled + (real - anchor_real) * time_scale;
+    portEXIT_CRITICAL();
+
+    return time_point(microseconds(scaled));
+}
+
+microseconds clock_to_real(microseconds scaled)
+{
+    // rounded up, a deadline must not fire before its scaled instant
+    return microseconds((scaled.count() + time_scale - 1) / time_scale);
+}
+
+void clock_set_scale(uint32_t scale)
+{
+    if (scale == 0)
+    {
+        return;
+    }
+
+    int64_t real = esp_timer_get_time();
+
+    portENTER_CRITICAL();
+    anchor_scaled = anchor_scaled + (real - anchor_real) * time_scale;
+    anchor_real = real;
+    time_scale = scale;
+    portEXIT_CRITICAL();
+
+    ESP_LOGI(TAG, "time runs %u times faster", scale);
+
+    // the pending deadline was computed at the old pace
+    pomodoro_post_input(INPUT_CHECK_TIMER);
+}
+
+uint32_t clock_get_scale(void)
+{
+    return time_scale;
+}
+
+#if CONFIG_POMODORO_CONSOLE_ENABLE
+static int timescale_command(int argc, char **argv)
+{
+    if (argc > 1)
+    {
+        char *end;
+        long scale = strtol(argv[1], &end, 10);
+        if (end == argv[1] || *end != '\0' || scale < 1 || scale > 3600)
+        {
+            printf("time scale must be within 1..3600\n");
+            return 1;
+        }
+        clock_set_scale(scale);
+    }
+
+    printf("time scale: %u\n", clock_get_scale());
+    return 0;
+}
+
+esp_err_t clock_register_command(void)
+{
+    esp_console_cmd_t cmd = {};
+
+    cmd.command = "timescale";
+    cmd.help = "Show or set how many times faster the pomodoro timer runs";
+    cmd.hint = "[factor]";
+    cmd.func = &timescale_command;
+
+    return esp_console_cmd_register(&cmd);
+}
+#endif
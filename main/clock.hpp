@@ -0,0 +1,26 @@
+#ifndef CLOCK_HPP_INCLUDED
+#define CLOCK_HPP_INCLUDED
+
+#include <stdint.h>
+
+#include "esp_err.h"
+
+#include "time_units.hpp"
+
+// Time base of the pomodoro timer. Runs at real time unless a time scale is
+// set, then it runs that many times faster, e.g. 60 turns minutes into
+// seconds for demos and soak tests. Only the timer is scaled: debouncing,
+// blinking and networking keep using real time.
+
+time_units::time_point clock_now(void);
+
+// Real time it takes the clock to advance by the given amount.
+time_units::microseconds clock_to_real(time_units::microseconds scaled);
+
+// Changing the scale never makes the clock jump, it only changes its pace.
+void clock_set_scale(uint32_t scale);
+uint32_t clock_get_scale(void);
+
+esp_err_t clock_register_command(void);
+
+#endif /* CLOCK_HPP_INCLUDED */
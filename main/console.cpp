@@ -0,0 +1,87 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_console.h"
+#include "driver/uart.h"
+
+#include "console.hpp"
+
+#define CONSOLE_UART UART_NUM_0
+#define CONSOLE_LINE_MAX 128
+
+static const char *TAG = "console";
+
+static void console_task(void *arg);
+
+esp_err_t console_setup(void)
+{
+    esp_console_config_t console_config = {};
+
+    console_config.max_cmdline_args = 8;
+    console_config.max_cmdline_length = CONSOLE_LINE_MAX;
+
+    ESP_ERROR_CHECK(uart_driver_install(CONSOLE_UART, 256, 0, 0, nullptr, 0));
+    ESP_ERROR_CHECK(esp_console_init(&console_config));
+    ESP_ERROR_CHECK(esp_console_register_help_command());
+
+    xTaskCreate(console_task, "console_task", 3072, nullptr, 3, nullptr);
+
+    return ESP_OK;
+}
+
+static void console_task(void *arg)
+{
+    char line[CONSOLE_LINE_MAX];
+    size_t len = 0;
+    bool is_overlong = false;
+
+    for (;;)
+    {
+        uint8_t c;
+        if (uart_read_bytes(CONSOLE_UART, &c, 1, portMAX_DELAY) != 1)
+        {
+            continue;
+        }
+        if (c != '\r' && c != '\n')
+        {
+            // a truncated line could still parse as some other command
+            if (len == sizeof(line) - 1)
+            {
+                is_overlong = true;
+            }
+            else if (c >= ' ' && c < 0x7F)
+            {
+                line[len++] = c;
+            }
+            continue;
+        }
+        if (is_overlong)
+        {
+            printf("line too long, at most %d characters\n", CONSOLE_LINE_MAX - 1);
+            is_overlong = false;
+            len = 0;
+            continue;
+        }
+        if (len == 0)
+        {
+            continue;
+        }
+
+        line[len] = '\0';
+        len = 0;
+
+        int ret;
+        esp_err_t err = esp_console_run(line, &ret);
+        if (err == ESP_ERR_NOT_FOUND)
+        {
+            printf("unknown command, try 'help'\n");
+        }
+        else if (err != ESP_OK && err != ESP_ERR_INVALID_ARG)
+        {
+            ESP_LOGW(TAG, "command failed: %s", esp_err_to_name(err));
+        }
+    }
+}
@@ -0,0 +1,10 @@
+#ifndef CONSOLE_HPP_INCLUDED
+#define CONSOLE_HPP_INCLUDED
+
+#include "esp_err.h"
+
+// Line based command console on UART0, subsystems register their commands
+// with esp_console_cmd_register() once this is set up.
+esp_err_t console_setup(void);
+
+#endif /* CONSOLE_HPP_INCLUDED */
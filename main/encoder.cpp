@@ -0,0 +1,98 @@
+#include "sdkconfig.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "gpio.h"
+
+#include "pomodoro.hpp"
+#include "encoder.hpp"
+
+// Both encoder pins interrupt on any edge and the ISR decodes every
+// transition with a state table, so fast spins lose no steps. Contact bounce
+// shows up as a transition followed by its reverse and cancels itself out.
+
+#define GPIO_ENCODER_A ((gpio_num_t)CONFIG_POMODORO_ENCODER_A_GPIO)
+#define GPIO_ENCODER_B ((gpio_num_t)CONFIG_POMODORO_ENCODER_B_GPIO)
+
+// Both contacts open, the pulled up rest position between detents.
+#define ENCODER_REST 0x3
+
+static const char *TAG = "encoder";
+
+// Indexed by (previous AB << 2) | current AB: +1 and -1 for valid quarter
+// steps, 0 for no change and for impossible double transitions.
+static const int8_t transitions[16] = {
+    0, -1, 1, 0,
+    1, 0, 0, -1,
+    -1, 0, 0, 1,
+    0, 1, -1, 0};
+
+static uint8_t last_ab = ENCODER_REST;
+static int8_t quarter_steps = 0;
+static volatile int32_t pending_steps = 0;
+// set once the input task has been told about the pending steps
+static volatile bool is_posted = false;
+
+static void IRAM_ATTR encoder_isr_handler(void *arg)
+{
+    uint8_t ab = (gpio_get_level(GPIO_ENCODER_A) << 1) | gpio_get_level(GPIO_ENCODER_B);
+
+    quarter_steps += transitions[(last_ab << 2) | ab];
+    last_ab = ab;
+
+    if (ab != ENCODER_REST)
+    {
+        return;
+    }
+
+    // a detent counts once the rest position is reached, at least half way
+    // through the cycle in one direction
+    int32_t step = quarter_steps >= 2 ? 1 : quarter_steps <= -2 ? -1
+                                                               : 0;
+    quarter_steps = 0;
+    if (step == 0)
+    {
+        return;
+    }
+
+    // the input task collects everything that piled up, one wakeup is
+    // enough; a post lost to a full queue is retried on the next detent
+    pending_steps += step;
+    if (!is_posted)
+    {
+        is_posted = pomodoro_post_input_from_isr(INPUT_ENCODER_TURNED);
+    }
+}
+
+esp_err_t encoder_setup(void)
+{
+    gpio_config_t io_conf;
+
+    io_conf.intr_type = GPIO_INTR_ANYEDGE;
+    io_conf.mode = GPIO_MODE_INPUT;
+    io_conf.pin_bit_mask = (1 << GPIO_ENCODER_A) | (1 << GPIO_ENCODER_B);
+    io_conf.pull_down_en = GPIO_PULLDOWN_DISABLE;
+    io_conf.pull_up_en = GPIO_PULLUP_ENABLE;
+    gpio_config(&io_conf);
+
+    last_ab = (gpio_get_level(GPIO_ENCODER_A) << 1) | gpio_get_level(GPIO_ENCODER_B);
+
+    // expects the isr service to be installed by gpio_setup()
+    gpio_isr_handler_add(GPIO_ENCODER_A, encoder_isr_handler, nullptr);
+    gpio_isr_handler_add(GPIO_ENCODER_B, encoder_isr_handler, nullptr);
+
+    ESP_LOGI(TAG, "rotary encoder on GPIO[%d] and GPIO[%d]", GPIO_ENCODER_A, GPIO_ENCODER_B);
+
+    return ESP_OK;
+}
+
+int32_t encoder_take_steps(void)
+{
+    portENTER_CRITICAL();
+    int32_t steps = pending_steps;
+    pending_steps = 0;
+    is_posted = false;
+    portEXIT_CRITICAL();
+
+    return steps;
+}
@@ -0,0 +1,13 @@
+#ifndef ENCODER_HPP_INCLUDED
+#define ENCODER_HPP_INCLUDED
+
+#include <stdint.h>
+
+#include "esp_err.h"
+
+esp_err_t encoder_setup(void);
+
+// Detents turned since the last call, clockwise is positive.
+int32_t encoder_take_steps(void);
+
+#endif /* ENCODER_HPP_INCLUDED */
@@ -0,0 +1,90 @@
+#include <stdio.h>
+#include <inttypes.h>
+
+#include "sdkconfig.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_timer.h"
+#include "esp_wifi.h"
+#if CONFIG_POMODORO_CONSOLE_ENABLE
+#include "esp_console.h"
+#endif
+
+#include "blink.hpp"
+#include "energy.hpp"
+
+static uint32_t task_wakeups = 0;
+
+// LED time is accumulated in half LED microseconds, so a blinking LED at
+// 50% duty adds up exactly.
+static int64_t led_half_us = 0;
+static int64_t leds_changed_at = 0;
+static uint32_t leds_lit = 0;
+static uint32_t leds_blinking = 0;
+
+// Only the input task writes the counters, readers may see them mid update
+// which is fine for statistics.
+static void energy_accumulate(int64_t now)
+{
+    int64_t elapsed = now - leds_changed_at;
+
+    led_half_us += elapsed * (2 * leds_lit + leds_blinking);
+    leds_changed_at = now;
+}
+
+void energy_count_wakeup(void)
+{
+    task_wakeups++;
+}
+
+void energy_leds_changed(uint32_t lit, uint32_t blinking)
+{
+    if (lit == leds_lit && blinking == leds_blinking)
+    {
+        return;
+    }
+
+    energy_accumulate(esp_timer_get_time());
+    leds_lit = lit;
+    leds_blinking = blinking;
+}
+
+energy_counters energy_get_counters(void)
+{
+    int64_t now = esp_timer_get_time();
+    int64_t elapsed = now - leds_changed_at;
+    energy_counters counters = {};
+
+    counters.uptime_seconds = now / 1000000;
+    counters.task_wakeups = task_wakeups;
+    counters.led_seconds = (led_half_us + elapsed * (2 * leds_lit + leds_blinking)) / 2000000;
+    counters.blink_wakeups = blink_get_wakeups();
+
+    return counters;
+}
+
+#if CONFIG_POMODORO_CONSOLE_ENABLE
+static int energy_command(int argc, char **argv)
+{
+    energy_counters counters = energy_get_counters();
+
+    wifi_ps_type_t ps_mode = WIFI_PS_NONE;
+    esp_wifi_get_ps(&ps_mode);
+
+    // one line of key=value pairs, tools/energy_model.py reads it as is
+    printf("energy uptime_s=%" PRId64 " task_wakeups=%" PRIu32 " blink_wakeups=%" PRIu32 " led_s=%" PRId64 " wifi_ps=%d\n",
+           counters.uptime_seconds, counters.task_wakeups, counters.blink_wakeups, counters.led_seconds, (int)ps_mode);
+    return 0;
+}
+
+esp_err_t energy_register_command(void)
+{
+    esp_console_cmd_t cmd = {};
+
+    cmd.command = "energy";
+    cmd.help = "Print the activity counters for tools/energy_model.py";
+    cmd.func = &energy_command;
+
+    return esp_console_cmd_register(&cmd);
+}
+#endif
@@ -0,0 +1,30 @@
+#ifndef ENERGY_HPP_INCLUDED
+#define ENERGY_HPP_INCLUDED
+
+#include <stdint.h>
+
+#include "esp_err.h"
+
+// Activity counters that drive the energy model in tools/energy_model.py.
+// Everything is measured on real time, a scaled pomodoro clock changes how
+// often things happen but not what they cost.
+
+struct energy_counters
+{
+    int64_t uptime_seconds;
+    uint32_t task_wakeups;  // input task dispatches
+    uint32_t blink_wakeups; // blink timer interrupts
+    int64_t led_seconds;    // LED on time, summed over all LEDs
+};
+
+// Called from the input task for every event it handles.
+void energy_count_wakeup(void);
+
+// Called whenever the LEDs change: how many are lit and how many blink.
+void energy_leds_changed(uint32_t lit, uint32_t blinking);
+
+energy_counters energy_get_counters(void);
+
+esp_err_t energy_register_command(void);
+
+#endif /* ENERGY_HPP_INCLUDED */
@@ -0,0 +1,204 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <inttypes.h>
+
+#include "sdkconfig.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#if CONFIG_POMODORO_CONSOLE_ENABLE
+#include "esp_console.h"
+#endif
+
+#include "pomodoro.hpp"
+#include "i2c_bus.hpp"
+#include "environment.hpp"
+
+#define SCD4X_ADDRESS 0x62
+#define SCD4X_START_LOW_POWER_PERIODIC 0x21AC
+#define SCD4X_STOP_PERIODIC 0x3F86
+#define SCD4X_GET_DATA_READY 0xE4B8
+#define SCD4X_READ_MEASUREMENT 0xEC05
+
+#define ENVIRONMENT_SAMPLE_US (CONFIG_POMODORO_ENV_SAMPLE_SECONDS * 1000000LL)
+#define ENVIRONMENT_HYSTERESIS_PPM 200
+
+static const char *TAG = "environment";
+
+static bool is_present = false;
+static int64_t attempted_at = 0;
+static bool needs_air = false;
+
+// written by the input task only, read by the console as a copy
+static environment_reading reading = {};
+
+static uint8_t scd4x_crc(const uint8_t *data)
+{
+    uint8_t crc = 0xFF;
+    for (int i = 0; i < 2; i++)
+    {
+        crc ^= data[i];
+        for (int bit = 0; bit < 8; bit++)
+        {
+            crc = crc & 0x80 ? (crc << 1) ^ 0x31 : crc << 1;
+        }
+    }
+    return crc;
+}
+
+static esp_err_t scd4x_command(uint16_t command)
+{
+    uint8_t data[2] = {(uint8_t)(command >> 8), (uint8_t)command};
+    return i2c_bus_write(SCD4X_ADDRESS, data, sizeof(data));
+}
+
+// The sensor needs a millisecond between a command and its answer.
+static esp_err_t scd4x_read(uint16_t command, uint8_t *data, size_t len)
+{
+    esp_err_t err = scd4x_command(command);
+    if (err != ESP_OK)
+    {
+        return err;
+    }
+    vTaskDelay(1);
+    return i2c_bus_read(SCD4X_ADDRESS, data, len);
+}
+
+bool environment_decode(const uint8_t *data, environment_reading *result)
+{
+    uint16_t words[3];
+    for (int i = 0; i < 3; i++)
+    {
+        if (scd4x_crc(data + i * 3) != data[i * 3 + 2])
+        {
+            return false;
+        }
+        words[i] = (data[i * 3] << 8) | data[i * 3 + 1];
+    }
+
+    // right after start the first result reads 0 ppm
+    if (words[0] == 0)
+    {
+        return false;
+    }
+
+    result->co2_ppm = words[0];
+    result->temperature_centi = -4500 + (int32_t)17500 * words[1] / 65535;
+    result->humidity_centi = (uint32_t)10000 * words[2] / 65535;
+    result->is_valid = true;
+    return true;
+}
+
+esp_err_t environment_setup(void)
+{
+    ESP_ERROR_CHECK(i2c_bus_setup());
+
+    // still measuring after a reset without power loss, it only listens
+    // to a stop then
+    scd4x_command(SCD4X_STOP_PERIODIC);
+    vTaskDelay(pdMS_TO_TICKS(500));
+
+    esp_err_t err = scd4x_command(SCD4X_START_LOW_POWER_PERIODIC);
+    if (err != ESP_OK)
+    {
+        // the light works without it, the env command tells
+        ESP_LOGW(TAG, "no SCD4x at 0x%02x: %s", SCD4X_ADDRESS, esp_err_to_name(err));
+        return ESP_OK;
+    }
+
+    is_present = true;
+    ESP_LOGI(TAG, "SCD4x measuring every 30 s, read at most every %d s", CONFIG_POMODORO_ENV_SAMPLE_SECONDS);
+
+    return ESP_OK;
+}
+
+void environment_sample_if_due(void)
+{
+    int64_t now = esp_timer_get_time();
+    if (!is_present || (attempted_at != 0 && now - attempted_at < ENVIRONMENT_SAMPLE_US))
+    {
+        return;
+    }
+    attempted_at = now;
+
+    uint8_t data[9];
+    if (scd4x_read(SCD4X_GET_DATA_READY, data, 3) != ESP_OK || scd4x_crc(data) != data[2])
+    {
+        ESP_LOGW(TAG, "SCD4x not answering");
+        return;
+    }
+    if ((((data[0] << 8) | data[1]) & 0x07FF) == 0)
+    {
+        // nothing new yet, the last reading stays
+        return;
+    }
+
+    environment_reading next = {};
+    if (scd4x_read(SCD4X_READ_MEASUREMENT, data, sizeof(data)) != ESP_OK || !environment_decode(data, &next))
+    {
+        ESP_LOGW(TAG, "SCD4x measurement unreadable");
+        return;
+    }
+    next.sampled_at = now;
+
+    portENTER_CRITICAL();
+    reading = next;
+    portEXIT_CRITICAL();
+
+    bool had_air = !needs_air;
+    needs_air = next.co2_ppm >= CONFIG_POMODORO_ENV_VENTILATE_PPM ||
+                (needs_air && next.co2_ppm >= CONFIG_POMODORO_ENV_VENTILATE_PPM - ENVIRONMENT_HYSTERESIS_PPM);
+
+    ESP_LOGI(TAG, "CO2 %d ppm, %d.%02d C, %d.%02d %%RH", next.co2_ppm, next.temperature_centi / 100, abs(next.temperature_centi % 100),
+             next.humidity_centi / 100, next.humidity_centi % 100);
+
+    if (had_air && needs_air)
+    {
+        // only Work reacts, and only once most of it is done
+        ESP_LOGI(TAG, "air is stale, suggesting a break");
+        pomodoro_post_input(INPUT_BREAK_SUGGESTED);
+    }
+}
+
+environment_reading environment_get_reading(void)
+{
+    portENTER_CRITICAL();
+    environment_reading copy = reading;
+    portEXIT_CRITICAL();
+
+    return copy;
+}
+
+bool environment_needs_air(void)
+{
+    return needs_air;
+}
+
+#if CONFIG_POMODORO_CONSOLE_ENABLE
+static int environment_command(int argc, char **argv)
+{
+    environment_reading current = environment_get_reading();
+    if (!current.is_valid)
+    {
+        printf("no reading yet\n");
+        return 0;
+    }
+
+    printf("CO2 %d ppm, %d.%02d C, %d.%02d %%RH, %" PRId64 " s ago%s\n", current.co2_ppm, current.temperature_centi / 100,
+           abs(current.temperature_centi % 100), current.humidity_centi / 100, current.humidity_centi % 100,
+           (esp_timer_get_time() - current.sampled_at) / 1000000, needs_air ? ", ventilate" : "");
+    return 0;
+}
+
+esp_err_t environment_register_command(void)
+{
+    esp_console_cmd_t cmd = {};
+
+    cmd.command = "env";
+    cmd.help = "Print the latest room air reading";
+    cmd.func = &environment_command;
+
+    return esp_console_cmd_register(&cmd);
+}
+#endif
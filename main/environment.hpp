@@ -0,0 +1,41 @@
+#ifndef ENVIRONMENT_HPP_INCLUDED
+#define ENVIRONMENT_HPP_INCLUDED
+
+#include <stdint.h>
+
+#include "esp_err.h"
+
+// Room air from a Sensirion SCD4x on the shared I2C bus. The sensor runs its
+// own low power periodic measurement, one every 30 s, and the light only
+// reads the latest result when it is awake anyway: after the input task has
+// handled an event, at most every CONFIG_POMODORO_ENV_SAMPLE_SECONDS. Period
+// changes are such events, so every break starts with a fresh reading.
+//
+// At CONFIG_POMODORO_ENV_VENTILATE_PPM and above the yellow LED blinks
+// during breaks as a cue to open a window, and crossing it during work
+// suggests a break like the desktop agent does.
+
+struct environment_reading
+{
+    bool is_valid;
+    uint16_t co2_ppm;
+    int16_t temperature_centi; // 0.01 degrees Celsius
+    uint16_t humidity_centi;   // 0.01 % RH
+    int64_t sampled_at;        // esp_timer time, microseconds
+};
+
+esp_err_t environment_setup(void);
+
+// Called from the input task after every event.
+void environment_sample_if_due(void);
+
+// Decodes a read_measurement answer, three words each followed by its CRC.
+bool environment_decode(const uint8_t *data, environment_reading *reading);
+
+environment_reading environment_get_reading(void);
+
+bool environment_needs_air(void);
+
+esp_err_t environment_register_command(void);
+
+#endif /* ENVIRONMENT_HPP_INCLUDED */
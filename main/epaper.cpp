@@ -0,0 +1,509 @@
+#include <string.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "sdkconfig.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "esp_log.h"
+#include "gpio.h"
+
+#include "clock.hpp"
+#include "tz.hpp"
+#include "epaper.hpp"
+
+// SSD1680 based 2.13" panel (122x250), driven write-only over a bit-banged
+// SPI bus: the hardware HSPI pins are taken by the traffic light LEDs.
+
+#define EPAPER_WIDTH 122
+#define EPAPER_HEIGHT 250
+#define EPAPER_LINE_BYTES ((EPAPER_WIDTH + 7) / 8)
+
+#define GLYPH_WIDTH 5
+#define GLYPH_HEIGHT 7
+#define GLYPH_SCALE 2
+#define GLYPH_ADVANCE ((GLYPH_WIDTH + 1) * GLYPH_SCALE)
+
+#define TEXT_LINES 3
+#define TEXT_LINE_CHARS (EPAPER_WIDTH / GLYPH_ADVANCE)
+#define TEXT_LINE_HEIGHT ((GLYPH_HEIGHT + 2) * GLYPH_SCALE)
+
+// Only this band of the panel is ever rewritten, the rest stays white.
+#define WINDOW_TOP 16
+#define WINDOW_ROWS (TEXT_LINES * TEXT_LINE_HEIGHT)
+
+// Partial refreshes accumulate ghosting, clean up with a full one now and then.
+#define FULL_REFRESH_EVERY 20
+
+#define CMD_DRIVER_OUTPUT 0x01
+#define CMD_DEEP_SLEEP 0x10
+#define CMD_DATA_ENTRY_MODE 0x11
+#define CMD_SW_RESET 0x12
+#define CMD_TEMP_SENSOR 0x18
+#define CMD_MASTER_ACTIVATION 0x20
+#define CMD_UPDATE_CONTROL_1 0x21
+#define CMD_UPDATE_CONTROL_2 0x22
+#define CMD_WRITE_RAM_BW 0x24
+#define CMD_WRITE_RAM_OLD 0x26
+#define CMD_BORDER_WAVEFORM 0x3C
+#define CMD_RAM_X_RANGE 0x44
+#define CMD_RAM_Y_RANGE 0x45
+#define CMD_RAM_X_COUNTER 0x4E
+#define CMD_RAM_Y_COUNTER 0x4F
+
+#define UPDATE_FULL 0xF7
+#define UPDATE_PARTIAL 0xFF
+
+#define GPIO_EPAPER_CLK ((gpio_num_t)CONFIG_POMODORO_EPAPER_CLK_GPIO)
+#define GPIO_EPAPER_MOSI ((gpio_num_t)CONFIG_POMODORO_EPAPER_MOSI_GPIO)
+#define GPIO_EPAPER_DC ((gpio_num_t)CONFIG_POMODORO_EPAPER_DC_GPIO)
+#define GPIO_EPAPER_RST ((gpio_num_t)CONFIG_POMODORO_EPAPER_RST_GPIO)
+#define GPIO_EPAPER_BUSY ((gpio_num_t)CONFIG_POMODORO_EPAPER_BUSY_GPIO)
+
+static const char *TAG = "epaper";
+
+// 5x7 glyphs for ' ' .. 'Z', one byte per column, LSB is the top row.
+// Lowercase is folded to uppercase, anything else renders as a blank.
+static const uint8_t font5x7[][GLYPH_WIDTH] = {
+    {0x00, 0x00, 0x00, 0x00, 0x00}, // ' '
+    {0x00, 0x00, 0x5F, 0x00, 0x00}, // '!'
+    {0x00, 0x07, 0x00, 0x07, 0x00}, // '"'
+    {0x14, 0x7F, 0x14, 0x7F, 0x14}, // '#'
+    {0x24, 0x2A, 0x7F, 0x2A, 0x12}, // '$'
+    {0x23, 0x13, 0x08, 0x64, 0x62}, // '%'
+    {0x36, 0x49, 0x55, 0x22, 0x50}, // '&'
+    {0x00, 0x05, 0x03, 0x00, 0x00}, // '''
+    {0x00, 0x1C, 0x22, 0x41, 0x00}, // '('
+    {0x00, 0x41, 0x22, 0x1C, 0x00}, // ')'
+    {0x08, 0x2A, 0x1C, 0x2A, 0x08}, // '*'
+    {0x08, 0x08, 0x3E, 0x08, 0x08}, // '+'
+    {0x00, 0x50, 0x30, 0x00, 0x00}, // ','
+    {0x08, 0x08, 0x08, 0x08, 0x08}, // '-'
+    {0x00, 0x60, 0x60, 0x00, 0x00}, // '.'
+    {0x20, 0x10, 0x08, 0x04, 0x02}, // '/'
+    {0x3E, 0x51, 0x49, 0x45, 0x3E}, // '0'
+    {0x00, 0x42, 0x7F, 0x40, 0x00}, // '1'
+    {0x42, 0x61, 0x51, 0x49, 0x46}, // '2'
+    {0x21, 0x41, 0x45, 0x4B, 0x31}, // '3'
+    {0x18, 0x14, 0x12, 0x7F, 0x10}, // '4'
+    {0x27, 0x45, 0x45, 0x45, 0x39}, // '5'
+    {0x3C, 0x4A, 0x49, 0x49, 0x30}, // '6'
+    {0x01, 0x71, 0x09, 0x05, 0x03}, // '7'
+    {0x36, 0x49, 0x49, 0x49, 0x36}, // '8'
+    {0x06, 0x49, 0x49, 0x29, 0x1E}, // '9'
+    {0x00, 0x36, 0x36, 0x00, 0x00}, // ':'
+    {0x00, 0x56, 0x36, 0x00, 0x00}, // ';'
+    {0x00, 0x08, 0x14, 0x22, 0x41}, // '<'
+    {0x14, 0x14, 0x14, 0x14, 0x14}, // '='
+    {0x41, 0x22, 0x14, 0x08, 0x00}, // '>'
+    {0x02, 0x01, 0x51, 0x09, 0x06}, // '?'
+    {0x32, 0x49, 0x79, 0x41, 0x3E}, // '@'
+    {0x7E, 0x11, 0x11, 0x11, 0x7E}, // 'A'
+    {0x7F, 0x49, 0x49, 0x49, 0x36}, // 'B'
+    {0x3E, 0x41, 0x41, 0x41, 0x22}, // 'C'
+    {0x7F, 0x41, 0x41, 0x22, 0x1C}, // 'D'
+    {0x7F, 0x49, 0x49, 0x49, 0x41}, // 'E'
+    {0x7F, 0x09, 0x09, 0x01, 0x01}, // 'F'
+    {0x3E, 0x41, 0x41, 0x51, 0x32}, // 'G'
+    {0x7F, 0x08, 0x08, 0x08, 0x7F}, // 'H'
+    {0x00, 0x41, 0x7F, 0x41, 0x00}, // 'I'
+    {0x20, 0x40, 0x41, 0x3F, 0x01}, // 'J'
+    {0x7F, 0x08, 0x14, 0x22, 0x41}, // 'K'
+    {0x7F, 0x40, 0x40, 0x40, 0x40}, // 'L'
+    {0x7F, 0x02, 0x04, 0x02, 0x7F}, // 'M'
+    {0x7F, 0x04, 0x08, 0x10, 0x7F}, // 'N'
+    {0x3E, 0x41, 0x41, 0x41, 0x3E}, // 'O'
+    {0x7F, 0x09, 0x09, 0x09, 0x06}, // 'P'
+    {0x3E, 0x41, 0x51, 0x21, 0x5E}, // 'Q'
+    {0x7F, 0x09, 0x19, 0x29, 0x46}, // 'R'
+    {0x46, 0x49, 0x49, 0x49, 0x31}, // 'S'
+    {0x01, 0x01, 0x7F, 0x01, 0x01}, // 'T'
+    {0x3F, 0x40, 0x40, 0x40, 0x3F}, // 'U'
+    {0x1F, 0x20, 0x40, 0x20, 0x1F}, // 'V'
+    {0x7F, 0x20, 0x18, 0x20, 0x7F}, // 'W'
+    {0x63, 0x14, 0x08, 0x14, 0x63}, // 'X'
+    {0x03, 0x04, 0x78, 0x04, 0x03}, // 'Y'
+    {0x61, 0x51, 0x49, 0x45, 0x43}, // 'Z'
+};
+
+static QueueHandle_t epaper_queue = nullptr;
+static uint8_t window[WINDOW_ROWS][EPAPER_LINE_BYTES];
+
+static void epaper_task(void *arg);
+
+static void epaper_write_byte(uint8_t value)
+{
+    for (int bit = 7; bit >= 0; bit--)
+    {
+        gpio_set_level(GPIO_EPAPER_MOSI, (value >> bit) & 1);
+        gpio_set_level(GPIO_EPAPER_CLK, 1);
+        gpio_set_level(GPIO_EPAPER_CLK, 0);
+    }
+}
+
+static void epaper_command(uint8_t command)
+{
+    gpio_set_level(GPIO_EPAPER_DC, 0);
+    epaper_write_byte(command);
+}
+
+static void epaper_data(const uint8_t *data, size_t len)
+{
+    gpio_set_level(GPIO_EPAPER_DC, 1);
+    for (size_t i = 0; i < len; i++)
+    {
+        epaper_write_byte(data[i]);
+    }
+}
+
+static void epaper_command_args(uint8_t command, const uint8_t *args, size_t len)
+{
+    epaper_command(command);
+    epaper_data(args, len);
+}
+
+static void epaper_wait_busy()
+{
+    while (gpio_get_level(GPIO_EPAPER_BUSY) == 1)
+    {
+        vTaskDelay(10 / portTICK_PERIOD_MS);
+    }
+}
+
+// Brings the controller out of deep sleep; only a hardware reset can do that.
+static void epaper_wake()
+{
+    gpio_set_level(GPIO_EPAPER_RST, 0);
+    vTaskDelay(10 / portTICK_PERIOD_MS);
+    gpio_set_level(GPIO_EPAPER_RST, 1);
+    vTaskDelay(10 / portTICK_PERIOD_MS);
+    epaper_wait_busy();
+}
+
+static void epaper_sleep()
+{
+    // mode 1 keeps the RAM, so the next partial refresh still has its base image
+    const uint8_t mode = 0x01;
+    epaper_command_args(CMD_DEEP_SLEEP, &mode, 1);
+}
+
+static void epaper_set_window(uint16_t y_start, uint16_t y_end)
+{
+    const uint8_t x_range[] = {0x00, EPAPER_LINE_BYTES - 1};
+    const uint8_t y_range[] = {(uint8_t)(y_start & 0xFF), (uint8_t)(y_start >> 8), (uint8_t)(y_end & 0xFF), (uint8_t)(y_end >> 8)};
+    const uint8_t x_counter = 0x00;
+    const uint8_t y_counter[] = {(uint8_t)(y_start & 0xFF), (uint8_t)(y_start >> 8)};
+
+    epaper_command_args(CMD_RAM_X_RANGE, x_range, sizeof(x_range));
+    epaper_command_args(CMD_RAM_Y_RANGE, y_range, sizeof(y_range));
+    epaper_command_args(CMD_RAM_X_COUNTER, &x_counter, 1);
+    epaper_command_args(CMD_RAM_Y_COUNTER, y_counter, sizeof(y_counter));
+}
+
+static void epaper_init_geometry()
+{
+    const uint8_t driver_output[] = {(EPAPER_HEIGHT - 1) & 0xFF, (EPAPER_HEIGHT - 1) >> 8, 0x00};
+    const uint8_t data_entry_mode = 0x03; // x and y increment
+
+    epaper_command_args(CMD_DRIVER_OUTPUT, driver_output, sizeof(driver_output));
+    epaper_command_args(CMD_DATA_ENTRY_MODE, &data_entry_mode, 1);
+}
+
+static void epaper_init_controller()
+{
+    const uint8_t border = 0x05;
+    const uint8_t update_control_1[] = {0x00, 0x80};
+    const uint8_t temp_sensor = 0x80; // internal sensor
+
+    epaper_command(CMD_SW_RESET);
+    epaper_wait_busy();
+
+    epaper_init_geometry();
+    epaper_command_args(CMD_BORDER_WAVEFORM, &border, 1);
+    epaper_command_args(CMD_UPDATE_CONTROL_1, update_control_1, sizeof(update_control_1));
+    epaper_command_args(CMD_TEMP_SENSOR, &temp_sensor, 1);
+    epaper_wait_busy();
+}
+
+static void epaper_refresh(uint8_t mode)
+{
+    epaper_command_args(CMD_UPDATE_CONTROL_2, &mode, 1);
+    epaper_command(CMD_MASTER_ACTIVATION);
+    epaper_wait_busy();
+}
+
+// Full refresh of the whole panel: white everywhere except the text window.
+static void epaper_refresh_full()
+{
+    uint8_t white[EPAPER_LINE_BYTES];
+    memset(white, 0xFF, sizeof(white));
+
+    epaper_init_controller();
+
+    const uint8_t ram[] = {CMD_WRITE_RAM_BW, CMD_WRITE_RAM_OLD};
+    for (size_t i = 0; i < sizeof(ram); i++)
+    {
+        epaper_set_window(0, EPAPER_HEIGHT - 1);
+        epaper_command(ram[i]);
+        for (int y = 0; y < EPAPER_HEIGHT; y++)
+        {
+            bool in_window = y >= WINDOW_TOP && y < WINDOW_TOP + WINDOW_ROWS;
+            epaper_data(in_window ? window[y - WINDOW_TOP] : white, EPAPER_LINE_BYTES);
+        }
+    }
+
+    epaper_refresh(UPDATE_FULL);
+}
+
+// Partial refresh of the text window only, waveform is driven by the
+// difference between the "old" and the "new" RAM.
+static void epaper_refresh_partial()
+{
+    const uint8_t border = 0x80;
+
+    // no software reset here, it would wipe the base image kept in RAM
+    epaper_init_geometry();
+    epaper_command_args(CMD_BORDER_WAVEFORM, &border, 1);
+
+    epaper_set_window(WINDOW_TOP, WINDOW_TOP + WINDOW_ROWS - 1);
+    epaper_command(CMD_WRITE_RAM_BW);
+    epaper_data(&window[0][0], sizeof(window));
+
+    epaper_refresh(UPDATE_PARTIAL);
+
+    // the shown image becomes the base for the next partial refresh
+    epaper_set_window(WINDOW_TOP, WINDOW_TOP + WINDOW_ROWS - 1);
+    epaper_command(CMD_WRITE_RAM_OLD);
+    epaper_data(&window[0][0], sizeof(window));
+}
+
+static const uint8_t *glyph(char c)
+{
+    if (c >= 'a' && c <= 'z')
+    {
+        c = c - 'a' + 'A';
+    }
+    if (c < ' ' || c > 'Z')
+    {
+        c = ' ';
+    }
+    return font5x7[c - ' '];
+}
+
+static void render_pixel(int x, int y)
+{
+    if (x < 0 || x >= EPAPER_WIDTH || y < 0 || y >= WINDOW_ROWS)
+    {
+        return;
+    }
+    window[y][x / 8] &= ~(0x80 >> (x % 8));
+}
+
+static void render_text(int line, const char *text)
+{
+    int top = line * TEXT_LINE_HEIGHT + GLYPH_SCALE;
+
+    for (int i = 0; text[i] != '\0' && i < TEXT_LINE_CHARS; i++)
+    {
+        const uint8_t *columns = glyph(text[i]);
+        int left = i * GLYPH_ADVANCE + GLYPH_SCALE;
+
+        for (int col = 0; col < GLYPH_WIDTH; col++)
+        {
+            for (int row = 0; row < GLYPH_HEIGHT; row++)
+            {
+                if (!(columns[col] & (1 << row)))
+                {
+                    continue;
+                }
+                for (int sy = 0; sy < GLYPH_SCALE; sy++)
+                {
+                    for (int sx = 0; sx < GLYPH_SCALE; sx++)
+                    {
+                        render_pixel(left + col * GLYPH_SCALE + sx, top + row * GLYPH_SCALE + sy);
+                    }
+                }
+            }
+        }
+    }
+}
+
+static bool is_time_valid()
+{
+    struct tm local;
+    tz_localtime(time(nullptr), &local);
+
+    return local.tm_year >= (2020 - 1900);
+}
+
+// Fills the two lines telling when the running phase is over: the wall clock
+// time once SNTP has synced, the amount of minutes left otherwise.
+static void format_until(char (*lines)[TEXT_LINE_CHARS + 1], int64_t seconds_left)
+{
+    time_t now = time(nullptr);
+    struct tm local;
+
+    if (!is_time_valid())
+    {
+        snprintf(lines[1], TEXT_LINE_CHARS + 1, "%d MIN", (int)((seconds_left + 59) / 60));
+        snprintf(lines[2], TEXT_LINE_CHARS + 1, "LEFT");
+        return;
+    }
+
+    tz_localtime(now + seconds_left, &local);
+
+    snprintf(lines[1], TEXT_LINE_CHARS + 1, "UNTIL");
+    snprintf(lines[2], TEXT_LINE_CHARS + 1, "%02d:%02d", local.tm_hour, local.tm_min);
+}
+
+static void format_status(const pomodoro_status &status, char (*lines)[TEXT_LINE_CHARS + 1])
+{
+    const char *title = "";
+
+    if (status.is_busy)
+    {
+        snprintf(lines[0], TEXT_LINE_CHARS + 1, "BUSY");
+        return;
+    }
+
+    switch (status.phase)
+    {
+    case PHASE_OFF:
+        snprintf(lines[0], TEXT_LINE_CHARS + 1, "STARTING");
+        return;
+    case PHASE_IDLE:
+        title = "READY";
+        break;
+    case PHASE_WORK:
+        title = status.is_paused ? "PAUSED" : status.is_started ? "FOCUS"
+                                                                : "WORK";
+        break;
+    case PHASE_SHORT_BREAK:
+        title = "BREAK";
+        break;
+    case PHASE_LONG_BREAK:
+    case PHASE_LONG_BREAK_LAST_MINUTES:
+        title = "LONG BREAK";
+        break;
+    }
+
+    snprintf(lines[0], TEXT_LINE_CHARS + 1, "%s", title);
+
+    if (status.phase == PHASE_IDLE || !status.is_started)
+    {
+        snprintf(lines[1], TEXT_LINE_CHARS + 1, "PRESS TO");
+        snprintf(lines[2], TEXT_LINE_CHARS + 1, "START");
+        return;
+    }
+    if (status.is_paused)
+    {
+        snprintf(lines[1], TEXT_LINE_CHARS + 1, "%d MIN", (int)((status.seconds_left + 59) / 60));
+        snprintf(lines[2], TEXT_LINE_CHARS + 1, "LEFT");
+        return;
+    }
+
+    format_until(lines, status.seconds_left);
+}
+
+esp_err_t epaper_setup(void)
+{
+    gpio_config_t io_conf;
+
+    io_conf.intr_type = GPIO_INTR_DISABLE;
+    io_conf.mode = GPIO_MODE_OUTPUT;
+    io_conf.pin_bit_mask = (1 << GPIO_EPAPER_CLK) | (1 << GPIO_EPAPER_MOSI) | (1 << GPIO_EPAPER_DC) | (1 << GPIO_EPAPER_RST);
+    io_conf.pull_down_en = GPIO_PULLDOWN_DISABLE;
+    io_conf.pull_up_en = GPIO_PULLUP_DISABLE;
+    gpio_config(&io_conf);
+
+    io_conf.mode = GPIO_MODE_INPUT;
+    io_conf.pin_bit_mask = (1 << GPIO_EPAPER_BUSY);
+    gpio_config(&io_conf);
+
+    gpio_set_level(GPIO_EPAPER_CLK, 0);
+    gpio_set_level(GPIO_EPAPER_RST, 1);
+
+    epaper_queue = xQueueCreate(1, sizeof(pomodoro_status));
+    if (epaper_queue == nullptr)
+    {
+        return ESP_ERR_NO_MEM;
+    }
+
+    xTaskCreate(epaper_task, "epaper_task", 2048, nullptr, 5, nullptr);
+
+    return ESP_OK;
+}
+
+void epaper_show(const pomodoro_status &status)
+{
+    if (epaper_queue == nullptr)
+    {
+        return;
+    }
+
+    xQueueOverwrite(epaper_queue, &status);
+}
+
+// Minutes left are counted down here until SNTP has synced, then the
+// display switches over to the wall clock end time.
+static bool is_counting_down(const pomodoro_status &status)
+{
+    return status.is_started && !status.is_paused && !status.is_busy && status.phase != PHASE_IDLE &&
+           status.phase != PHASE_OFF && !is_time_valid();
+}
+
+static void epaper_task(void *arg)
+{
+    pomodoro_status status = {};
+    time_units::time_point received_at;
+    char shown[TEXT_LINES][TEXT_LINE_CHARS + 1] = {};
+    bool has_shown = false;
+    size_t partial_refreshes = 0;
+
+    for (;;)
+    {
+        TickType_t wait = has_shown && is_counting_down(status) ? pdMS_TO_TICKS(60 * 1000) : portMAX_DELAY;
+        if (xQueueReceive(epaper_queue, &status, wait))
+        {
+            received_at = clock_now();
+        }
+
+        pomodoro_status current = status;
+        if (current.is_started && !current.is_paused)
+        {
+            current.seconds_left -= time_units::duration_cast<time_units::seconds>(clock_now() - received_at).count();
+        }
+
+        // the text is the state of the panel, only a change in it is worth a refresh
+        char lines[TEXT_LINES][TEXT_LINE_CHARS + 1] = {};
+        format_status(current, lines);
+        if (has_shown && memcmp(lines, shown, sizeof(lines)) == 0)
+        {
+            continue;
+        }
+        has_shown = true;
+        memcpy(shown, lines, sizeof(shown));
+
+        memset(window, 0xFF, sizeof(window));
+        for (int line = 0; line < TEXT_LINES; line++)
+        {
+            render_text(line, lines[line]);
+        }
+
+        epaper_wake();
+        if (partial_refreshes == 0)
+        {
+            epaper_refresh_full();
+        }
+        else
+        {
+            epaper_refresh_partial();
+        }
+        epaper_sleep();
+
+        partial_refreshes = (partial_refreshes + 1) % FULL_REFRESH_EVERY;
+
+        ESP_LOGI(TAG, "shown: %s / %s / %s", lines[0], lines[1], lines[2]);
+    }
+}
@@ -0,0 +1,15 @@
+#ifndef EPAPER_HPP_INCLUDED
+#define EPAPER_HPP_INCLUDED
+
+#include "esp_err.h"
+
+#include "pomodoro.hpp"
+
+esp_err_t epaper_setup(void);
+
+// Queues the status for rendering; the panel is only refreshed when the
+// text it renders to differs from what is currently shown, e.g. a new
+// phase or an end time moved by the encoder.
+void epaper_show(const pomodoro_status &status);
+
+#endif /* EPAPER_HPP_INCLUDED */
@@ -0,0 +1,150 @@
+#include <inttypes.h>
+
+#include "sdkconfig.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "gpio.h"
+
+#include "pomodoro.hpp"
+#include "i2c_bus.hpp"
+#include "expander.hpp"
+
+// Extra buttons on a PCF8574 GPIO expander. The expander pulls its interrupt
+// line low on any input change; only then all eight keys are read back in a
+// single one byte bus transaction. Buttons short to ground, pressed is 0.
+
+#define GPIO_EXPANDER_INT ((gpio_num_t)CONFIG_POMODORO_EXPANDER_INT_GPIO)
+
+struct expander_key
+{
+    uint8_t bit;
+    uint32_t input;
+};
+
+// Which key feeds which input, keys not listed here are ignored.
+static const expander_key keys[] = {
+    {0, INPUT_TIMER_ACTION},
+    {1, INPUT_TIMER_START},
+    {2, INPUT_TIMER_RESET},
+    {3, INPUT_MARK_INTERNAL},
+    {4, INPUT_MARK_EXTERNAL},
+    {5, INPUT_BUSY_TOGGLE},
+};
+
+static const int64_t debounce_time = 50000; // 50 ms per key
+
+// A failed read leaves the interrupt line latched low without a new edge,
+// retries back off from the first delay up to the last one.
+static const int64_t retry_first = 20000;
+static const int64_t retry_last = 10000000;
+
+static const char *TAG = "expander";
+
+static uint8_t last_port = 0xFF;
+static int64_t last_press_at[8] = {};
+
+static esp_timer_handle_t retry_timer;
+static int64_t retry_delay = retry_first;
+
+static void IRAM_ATTR expander_isr_handler(void *arg)
+{
+    pomodoro_post_input_from_isr(INPUT_EXPANDER_CHANGED);
+}
+
+static void retry_timer_callback(void *arg)
+{
+    pomodoro_post_input(INPUT_EXPANDER_CHANGED);
+}
+
+esp_err_t expander_setup(void)
+{
+    ESP_ERROR_CHECK(i2c_bus_setup());
+
+    // quasi-bidirectional pins have to be written high to work as inputs
+    uint8_t port = 0xFF;
+    esp_err_t err = i2c_bus_write(CONFIG_POMODORO_EXPANDER_ADDRESS, &port, 1);
+    if (err != ESP_OK)
+    {
+        // the light works without it, only the extra keys are missing
+        ESP_LOGW(TAG, "no expander at 0x%02x: %s", CONFIG_POMODORO_EXPANDER_ADDRESS, esp_err_to_name(err));
+        return ESP_OK;
+    }
+
+    esp_timer_create_args_t retry_timer_args = {};
+
+    retry_timer_args.callback = &retry_timer_callback;
+    retry_timer_args.name = "expander_retry";
+
+    ESP_ERROR_CHECK(esp_timer_create(&retry_timer_args, &retry_timer));
+
+    gpio_config_t io_conf;
+
+    io_conf.intr_type = GPIO_INTR_NEGEDGE;
+    io_conf.mode = GPIO_MODE_INPUT;
+    io_conf.pin_bit_mask = (1 << GPIO_EXPANDER_INT);
+    io_conf.pull_down_en = GPIO_PULLDOWN_DISABLE;
+    io_conf.pull_up_en = GPIO_PULLUP_ENABLE;
+    gpio_config(&io_conf);
+
+    // expects the isr service to be installed by gpio_setup()
+    gpio_isr_handler_add(GPIO_EXPANDER_INT, expander_isr_handler, nullptr);
+
+    // reading the port clears a pending interrupt and sets the baseline
+    i2c_bus_read(CONFIG_POMODORO_EXPANDER_ADDRESS, &last_port, 1);
+
+    return ESP_OK;
+}
+
+void expander_scan(void)
+{
+    if (retry_timer == nullptr)
+    {
+        // not found at boot
+        return;
+    }
+
+    uint8_t port;
+    esp_err_t err = i2c_bus_read(CONFIG_POMODORO_EXPANDER_ADDRESS, &port, 1);
+    if (err != ESP_OK)
+    {
+        ESP_LOGW(TAG, "expander read failed: %s", esp_err_to_name(err));
+
+        // only a read releases the line, no edge will come until then
+        if (gpio_get_level(GPIO_EXPANDER_INT) == 0)
+        {
+            esp_timer_stop(retry_timer);
+            esp_timer_start_once(retry_timer, retry_delay);
+            retry_delay = retry_delay * 2 < retry_last ? retry_delay * 2 : retry_last;
+        }
+        return;
+    }
+    retry_delay = retry_first;
+
+    uint8_t pressed = last_port & ~port;
+    last_port = port;
+    if (pressed == 0)
+    {
+        return;
+    }
+
+    int64_t current_time = esp_timer_get_time();
+
+    for (size_t i = 0; i < sizeof(keys) / sizeof(keys[0]); i++)
+    {
+        uint8_t bit = keys[i].bit;
+        if (!(pressed & (1 << bit)))
+        {
+            continue;
+        }
+        if (current_time - last_press_at[bit] < debounce_time)
+        {
+            continue;
+        }
+        last_press_at[bit] = current_time;
+
+        ESP_LOGI(TAG, "key %d pressed", bit);
+        pomodoro_post_input(keys[i].input);
+    }
+}
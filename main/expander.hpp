@@ -0,0 +1,11 @@
+#ifndef EXPANDER_HPP_INCLUDED
+#define EXPANDER_HPP_INCLUDED
+
+#include "esp_err.h"
+
+esp_err_t expander_setup(void);
+
+// Called from the GPIO event task when the expander raised its interrupt line.
+void expander_scan(void);
+
+#endif /* EXPANDER_HPP_INCLUDED */
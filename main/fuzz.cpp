@@ -0,0 +1,103 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <inttypes.h>
+
+#include "sdkconfig.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_system.h"
+#include "esp_console.h"
+
+#include "pomodoro.hpp"
+#include "fuzz.hpp"
+
+static const uint32_t inputs[] = {
+    INPUT_PRESENCE_LOST,
+    INPUT_PRESENCE_RETURNED,
+    INPUT_BREAK_SUGGESTED,
+    INPUT_ENCODER_TURNED,
+    INPUT_TIMER_ACTION,
+    INPUT_TIMER_START,
+    INPUT_TIMER_RESET,
+    INPUT_CHECK_TIMER,
+    INPUT_MARK_INTERNAL,
+    INPUT_MARK_EXTERNAL,
+    INPUT_CALENDAR_BUSY,
+    INPUT_CALENDAR_FREE,
+    INPUT_BUSY_ON,
+    INPUT_BUSY_OFF,
+    INPUT_BUSY_TOGGLE,
+};
+
+// xorshift32, the same seed gives the same stream on every unit
+static uint32_t fuzz_next(uint32_t &state)
+{
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+static int fuzz_command(int argc, char **argv)
+{
+    if (argc < 2)
+    {
+        printf("usage: fuzz <count> [seed]\n");
+        return 1;
+    }
+
+    char *end;
+    long count = strtol(argv[1], &end, 10);
+    if (*end != '\0' || count < 1)
+    {
+        printf("count must be a positive number\n");
+        return 1;
+    }
+
+    uint32_t seed = esp_random();
+    if (argc > 2)
+    {
+        seed = strtoul(argv[2], &end, 0);
+        if (*end != '\0')
+        {
+            printf("seed must be a number\n");
+            return 1;
+        }
+    }
+    if (seed == 0)
+    {
+        seed = 1; // xorshift never leaves zero
+    }
+
+    printf("posting %ld inputs, seed 0x%08" PRIx32 "\n", count, seed);
+
+    uint32_t state = seed;
+    for (long i = 0; i < count; i++)
+    {
+        uint32_t r = fuzz_next(state);
+
+        // one in eight is an arbitrary value, the input task has to ignore it
+        uint32_t input = (r & 7) == 0 ? fuzz_next(state) : inputs[(r >> 3) % (sizeof(inputs) / sizeof(inputs[0]))];
+        pomodoro_post_input(input);
+
+        // the input queue is short, give the task a tick to drain it
+        vTaskDelay(1);
+    }
+
+    pomodoro_status status = pomodoro_get_status();
+    printf("done, phase %d started %d paused %d, %" PRId64 " sec left\n",
+           status.phase, status.is_started, status.is_paused, status.seconds_left);
+    return 0;
+}
+
+esp_err_t fuzz_register_command(void)
+{
+    esp_console_cmd_t cmd = {};
+
+    cmd.command = "fuzz";
+    cmd.help = "Post a random stream of inputs to the pomodoro FSM";
+    cmd.hint = "<count> [seed]";
+    cmd.func = &fuzz_command;
+
+    return esp_console_cmd_register(&cmd);
+}
@@ -0,0 +1,12 @@
+#ifndef FUZZ_HPP_INCLUDED
+#define FUZZ_HPP_INCLUDED
+
+#include "esp_err.h"
+
+// `fuzz <count> [seed]` console command: posts a reproducible random stream
+// of inputs, unknown values included, into the input task. Combined with
+// the timescale command it drives the FSM through every state in minutes,
+// the liveness watchdog catches hangs. For bench units only.
+esp_err_t fuzz_register_command(void);
+
+#endif /* FUZZ_HPP_INCLUDED */
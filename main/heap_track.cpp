@@ -0,0 +1,351 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <inttypes.h>
+
+#include "sdkconfig.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_system.h"
+#include "esp_timer.h"
+#include "esp_heap_caps.h"
+#if CONFIG_POMODORO_CONSOLE_ENABLE
+#include "esp_console.h"
+#endif
+
+#include "heap_track.hpp"
+
+// Needs the _heap_caps_* functions wrapped at link time, see
+// main/CMakeLists.txt. The wrappers run for every allocation in the
+// firmware, so they only count under a short critical section: no logging,
+// no allocation of their own.
+//
+// The newlib shims pass the return address of malloc's caller down as the
+// file with line 0, that is the caller key then. Direct heap_caps users are
+// keyed by their own return address.
+
+#define TREND_SAMPLES 16
+#define SAMPLE_US (CONFIG_POMODORO_HEAP_TRACK_SAMPLE_SECONDS * 1000000LL)
+
+static const char *TAG = "heap";
+
+static uint32_t size_buckets[HEAP_TRACK_SIZE_BUCKETS];
+static heap_track_caller callers[HEAP_TRACK_CALLERS];
+static size_t caller_count = 0;
+static uint32_t other_allocations = 0;
+static uint32_t allocations = 0;
+static uint32_t frees = 0;
+
+static uint32_t failures = 0;
+static uint32_t reported_failures = 0;
+static size_t last_failed_size = 0;
+static size_t free_at_last_failure = 0;
+
+struct heap_sample
+{
+    uint32_t free_bytes;
+    uint32_t largest_block;
+};
+
+// one entry per sample, oldest first once the ring has wrapped
+static heap_sample trend[TREND_SAMPLES];
+static size_t trend_next = 0;
+static size_t trend_count = 0;
+static int64_t sampled_at = 0;
+
+extern "C" void *__real__heap_caps_malloc(size_t size, uint32_t caps, const char *file, size_t line);
+extern "C" void *__real__heap_caps_zalloc(size_t size, uint32_t caps, const char *file, size_t line);
+extern "C" void *__real__heap_caps_calloc(size_t count, size_t size, uint32_t caps, const char *file, size_t line);
+extern "C" void *__real__heap_caps_realloc(void *ptr, size_t size, uint32_t caps, const char *file, size_t line);
+extern "C" void __real__heap_caps_free(void *ptr, const char *file, size_t line);
+
+static size_t size_bucket(size_t size)
+{
+    size_t bucket = 0;
+    while (bucket < HEAP_TRACK_SIZE_BUCKETS - 1 && size > ((size_t)16 << bucket))
+    {
+        bucket++;
+    }
+    return bucket;
+}
+
+static void heap_track_record(size_t size, const void *caller, bool is_allocated)
+{
+    size_t bucket = size_bucket(size);
+    size_t free_bytes = is_allocated ? 0 : esp_get_free_heap_size();
+
+    portENTER_CRITICAL();
+
+    size_buckets[bucket]++;
+
+    if (is_allocated)
+    {
+        allocations++;
+    }
+    else
+    {
+        failures++;
+        last_failed_size = size;
+        free_at_last_failure = free_bytes;
+    }
+
+    size_t i = 0;
+    while (i < caller_count && callers[i].caller != caller)
+    {
+        i++;
+    }
+    if (i == caller_count && caller_count < HEAP_TRACK_CALLERS)
+    {
+        callers[caller_count++] = {caller, 0, 0};
+    }
+    if (i < caller_count)
+    {
+        callers[i].allocations++;
+        callers[i].bytes += size;
+    }
+    else
+    {
+        other_allocations++;
+    }
+
+    portEXIT_CRITICAL();
+}
+
+static inline const void *heap_track_caller_of(const char *file, size_t line, const void *return_address)
+{
+    return line == 0 && file != nullptr ? (const void *)file : return_address;
+}
+
+extern "C" void *__wrap__heap_caps_malloc(size_t size, uint32_t caps, const char *file, size_t line)
+{
+    void *ptr = __real__heap_caps_malloc(size, caps, file, line);
+    heap_track_record(size, heap_track_caller_of(file, line, __builtin_return_address(0)), ptr != nullptr);
+    return ptr;
+}
+
+extern "C" void *__wrap__heap_caps_zalloc(size_t size, uint32_t caps, const char *file, size_t line)
+{
+    void *ptr = __real__heap_caps_zalloc(size, caps, file, line);
+    heap_track_record(size, heap_track_caller_of(file, line, __builtin_return_address(0)), ptr != nullptr);
+    return ptr;
+}
+
+extern "C" void *__wrap__heap_caps_calloc(size_t count, size_t size, uint32_t caps, const char *file, size_t line)
+{
+    void *ptr = __real__heap_caps_calloc(count, size, caps, file, line);
+    heap_track_record(count * size, heap_track_caller_of(file, line, __builtin_return_address(0)), ptr != nullptr);
+    return ptr;
+}
+
+// Counted like a new allocation of the new size, a shrink or a free through
+// realloc included.
+extern "C" void *__wrap__heap_caps_realloc(void *ptr, size_t size, uint32_t caps, const char *file, size_t line)
+{
+    void *moved = __real__heap_caps_realloc(ptr, size, caps, file, line);
+    if (size == 0)
+    {
+        portENTER_CRITICAL();
+        frees++;
+        portEXIT_CRITICAL();
+        return moved;
+    }
+
+    heap_track_record(size, heap_track_caller_of(file, line, __builtin_return_address(0)), moved != nullptr);
+    if (moved != nullptr && ptr != nullptr)
+    {
+        portENTER_CRITICAL();
+        frees++;
+        portEXIT_CRITICAL();
+    }
+    return moved;
+}
+
+extern "C" void __wrap__heap_caps_free(void *ptr, const char *file, size_t line)
+{
+    __real__heap_caps_free(ptr, file, line);
+    if (ptr == nullptr)
+    {
+        return;
+    }
+
+    portENTER_CRITICAL();
+    frees++;
+    portEXIT_CRITICAL();
+}
+
+// The heap has no query for its largest free block, a binary search of
+// trial allocations finds it. The trials bypass the counters and run with
+// the scheduler suspended, so no task sees the heap emptied by one of them.
+static size_t heap_track_largest_block(size_t free_bytes)
+{
+    size_t low = 0;
+    size_t high = free_bytes;
+
+    vTaskSuspendAll();
+    while (low + 16 < high)
+    {
+        size_t size = low + (high - low) / 2;
+        void *ptr = __real__heap_caps_malloc(size, MALLOC_CAP_8BIT, nullptr, 0);
+        if (ptr == nullptr)
+        {
+            high = size;
+            continue;
+        }
+        __real__heap_caps_free(ptr, nullptr, 0);
+        low = size;
+    }
+    xTaskResumeAll();
+
+    return low;
+}
+
+void heap_track_sample(void)
+{
+    heap_sample sample;
+    sample.free_bytes = esp_get_free_heap_size();
+    sample.largest_block = heap_track_largest_block(sample.free_bytes);
+
+    portENTER_CRITICAL();
+    sampled_at = esp_timer_get_time();
+    trend[trend_next] = sample;
+    trend_next = (trend_next + 1) % TREND_SAMPLES;
+    if (trend_count < TREND_SAMPLES)
+    {
+        trend_count++;
+    }
+    uint32_t failed = failures;
+    portEXIT_CRITICAL();
+
+    if (sample.free_bytes < CONFIG_POMODORO_HEAP_TRACK_LOW_BYTES)
+    {
+        ESP_LOGW(TAG, "free heap low: %" PRIu32 " bytes", sample.free_bytes);
+    }
+    if (sample.largest_block < CONFIG_POMODORO_HEAP_TRACK_LOW_BLOCK_BYTES)
+    {
+        ESP_LOGW(TAG, "heap fragmented: largest block %" PRIu32 " of %" PRIu32 " free bytes",
+                 sample.largest_block, sample.free_bytes);
+    }
+
+    // reported here, the wrappers must not log
+    if (failed != reported_failures)
+    {
+        reported_failures = failed;
+        ESP_LOGW(TAG, "%" PRIu32 " allocations failed, last %u bytes with %u free",
+                 failed, (unsigned)last_failed_size, (unsigned)free_at_last_failure);
+    }
+}
+
+void heap_track_sample_if_due(void)
+{
+    if (esp_timer_get_time() - sampled_at < SAMPLE_US)
+    {
+        return;
+    }
+    heap_track_sample();
+}
+
+esp_err_t heap_track_setup(void)
+{
+    heap_track_sample();
+
+    return ESP_OK;
+}
+
+heap_track_stats heap_track_get_stats(void)
+{
+    heap_track_stats stats = {};
+
+    portENTER_CRITICAL();
+    for (size_t i = 0; i < HEAP_TRACK_SIZE_BUCKETS; i++)
+    {
+        stats.size_buckets[i] = size_buckets[i];
+    }
+    stats.allocations = allocations;
+    stats.frees = frees;
+    stats.failures = failures;
+    stats.last_failed_size = last_failed_size;
+    stats.free_at_last_failure = free_at_last_failure;
+    stats.largest_free_block = trend[(trend_next + TREND_SAMPLES - 1) % TREND_SAMPLES].largest_block;
+    portEXIT_CRITICAL();
+
+    stats.free_bytes = esp_get_free_heap_size();
+    stats.minimum_free_bytes = esp_get_minimum_free_heap_size();
+
+    return stats;
+}
+
+size_t heap_track_get_callers(heap_track_caller *out, size_t max)
+{
+    portENTER_CRITICAL();
+    size_t count = caller_count;
+    for (size_t i = 0; i < count && i < max; i++)
+    {
+        out[i] = callers[i];
+    }
+    portEXIT_CRITICAL();
+
+    return count;
+}
+
+#if CONFIG_POMODORO_CONSOLE_ENABLE
+static int heap_command(int argc, char **argv)
+{
+    // a fresh sample, the console wakes the light up anyway
+    heap_track_sample();
+    heap_track_stats stats = heap_track_get_stats();
+
+    printf("free %u, minimum %u, largest block %u\n",
+           (unsigned)stats.free_bytes, (unsigned)stats.minimum_free_bytes, (unsigned)stats.largest_free_block);
+    printf("allocations %" PRIu32 ", frees %" PRIu32 ", failed %" PRIu32 "\n",
+           stats.allocations, stats.frees, stats.failures);
+
+    printf("sizes:");
+    for (size_t i = 0; i < HEAP_TRACK_SIZE_BUCKETS; i++)
+    {
+        if (i == HEAP_TRACK_SIZE_BUCKETS - 1)
+        {
+            printf(" >%u:%" PRIu32, 16u << (i - 1), stats.size_buckets[i]);
+            break;
+        }
+        printf(" %u:%" PRIu32, 16u << i, stats.size_buckets[i]);
+    }
+    printf("\n");
+
+    heap_track_caller top[HEAP_TRACK_CALLERS];
+    size_t count = heap_track_get_callers(top, HEAP_TRACK_CALLERS);
+    for (size_t i = 0; i < count; i++)
+    {
+        printf("caller %p: %" PRIu32 " allocations, %" PRIu32 " bytes\n", top[i].caller, top[i].allocations, top[i].bytes);
+    }
+    printf("other callers: %" PRIu32 " allocations\n", other_allocations);
+
+    heap_sample copy[TREND_SAMPLES];
+    portENTER_CRITICAL();
+    size_t samples = trend_count;
+    for (size_t i = 0; i < samples; i++)
+    {
+        copy[i] = trend[(trend_next + TREND_SAMPLES - samples + i) % TREND_SAMPLES];
+    }
+    portEXIT_CRITICAL();
+
+    printf("free/largest trend:");
+    for (size_t i = 0; i < samples; i++)
+    {
+        printf(" %" PRIu32 "/%" PRIu32, copy[i].free_bytes, copy[i].largest_block);
+    }
+    printf("\n");
+
+    return 0;
+}
+
+esp_err_t heap_track_register_command(void)
+{
+    esp_console_cmd_t cmd = {};
+
+    cmd.command = "heap";
+    cmd.help = "Print allocation histograms, top callers and the free heap and largest block trend";
+    cmd.func = &heap_command;
+
+    return esp_console_cmd_register(&cmd);
+}
+#endif
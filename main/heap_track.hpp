@@ -0,0 +1,55 @@
+#ifndef HEAP_TRACK_HPP_INCLUDED
+#define HEAP_TRACK_HPP_INCLUDED
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+
+// Allocation tracking for long running units. The heap_caps layer, where
+// malloc, pvPortMalloc and the Wi-Fi and lwIP libraries all end up, is
+// wrapped at link time: every allocation lands in a size histogram and a
+// per caller table. Samples of the free heap and of its largest free block
+// are taken when the light is awake anyway, never on a timer of their own.
+
+#define HEAP_TRACK_SIZE_BUCKETS 10
+#define HEAP_TRACK_CALLERS 16
+
+struct heap_track_caller
+{
+    const void *caller;
+    uint32_t allocations;
+    uint32_t bytes;
+};
+
+struct heap_track_stats
+{
+    // bucket i counts sizes up to 16 << i bytes, the last one everything above
+    uint32_t size_buckets[HEAP_TRACK_SIZE_BUCKETS];
+    uint32_t allocations;
+    uint32_t frees;
+    uint32_t failures;
+    size_t last_failed_size;
+    size_t free_at_last_failure;
+    size_t free_bytes;
+    size_t minimum_free_bytes;
+    size_t largest_free_block; // at the last sample
+};
+
+esp_err_t heap_track_setup(void);
+
+// Takes a sample now, e.g. on a Wi-Fi disconnect.
+void heap_track_sample(void);
+
+// Called from the input task after every event, samples at most every
+// CONFIG_POMODORO_HEAP_TRACK_SAMPLE_SECONDS.
+void heap_track_sample_if_due(void);
+
+heap_track_stats heap_track_get_stats(void);
+
+// Copies up to max callers out, returns how many there are.
+size_t heap_track_get_callers(heap_track_caller *callers, size_t max);
+
+esp_err_t heap_track_register_command(void);
+
+#endif /* HEAP_TRACK_HPP_INCLUDED */
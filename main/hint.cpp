@@ -0,0 +1,286 @@
+#include <string.h>
+#include <time.h>
+#include <inttypes.h>
+
+#include "sdkconfig.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "lwip/sockets.h"
+#include "mbedtls/md.h"
+
+#include "pomodoro.hpp"
+#include "provision.hpp"
+#include "hint.hpp"
+
+// Agents remembered at once. Only one silent for longer than
+// HINT_AGENT_TIMEOUT_US makes room, its packets are out of the sequence
+// window by then.
+#define HINT_AGENTS 4
+// An agent silent for this long no longer keeps the desk occupied.
+#define HINT_AGENT_TIMEOUT_US (10 * 60 * 1000000LL)
+// Receive timeout while a desk edge waits for room in the input queue.
+#define HINT_RETRY_US 100000
+
+static const char *TAG = "hint";
+
+static const char *hint_key = CONFIG_POMODORO_HINT_KEY;
+
+struct hint_agent
+{
+    uint32_t id;
+    uint32_t last_sequence;
+    int64_t heard_at;
+    bool is_idle;
+};
+
+// owned by the hint task
+static hint_agent agents[HINT_AGENTS];
+// A new agent must start above every sequence an agent that made room had
+// reached, so its old packets cannot come back under a fresh slot.
+static uint32_t evicted_sequence = 0;
+static bool is_desk_idle = false;
+static bool is_desk_posted = true;
+static bool is_break_pending = false;
+
+static void hint_task(void *arg);
+
+bool hint_decode(const uint8_t *data, size_t len, const uint8_t *key, size_t key_len, hint_packet *hint)
+{
+    if (len != HINT_PACKET_SIZE)
+    {
+        return false;
+    }
+    if (data[0] != 'P' || data[1] != 'H' || data[2] != HINT_VERSION)
+    {
+        return false;
+    }
+    if (data[3] < HINT_ACTIVE || data[3] > HINT_BREAK)
+    {
+        return false;
+    }
+
+    uint8_t mac[32];
+    const size_t signed_len = HINT_PACKET_SIZE - HINT_MAC_SIZE;
+    const mbedtls_md_info_t *md = mbedtls_md_info_from_type(MBEDTLS_MD_SHA256);
+    if (mbedtls_md_hmac(md, key, key_len, data, signed_len, mac) != 0)
+    {
+        return false;
+    }
+
+    // constant time compare, so the timing tells nothing about the mac
+    uint8_t diff = 0;
+    for (size_t i = 0; i < HINT_MAC_SIZE; i++)
+    {
+        diff |= mac[i] ^ data[signed_len + i];
+    }
+    if (diff != 0)
+    {
+        return false;
+    }
+
+    hint->kind = (hint_kind)data[3];
+    hint->agent = ((uint32_t)data[4] << 24) | ((uint32_t)data[5] << 16) | ((uint32_t)data[6] << 8) | data[7];
+    hint->sequence = ((uint32_t)data[8] << 24) | ((uint32_t)data[9] << 16) | ((uint32_t)data[10] << 8) | data[11];
+
+    return true;
+}
+
+esp_err_t hint_setup(void)
+{
+    if (provision_get().hint_key[0] != '\0')
+    {
+        hint_key = provision_get().hint_key;
+    }
+    if (strlen(hint_key) == 0)
+    {
+        ESP_LOGW(TAG, "no hint key configured, activity hints disabled");
+        return ESP_OK;
+    }
+
+    xTaskCreate(hint_task, "hint_task", 3072, nullptr, 5, nullptr);
+
+    return ESP_OK;
+}
+
+// The slot of a known agent, a new one only while one is free or timed out.
+static hint_agent *hint_find_agent(uint32_t id, uint32_t sequence, int64_t now)
+{
+    hint_agent *oldest = &agents[0];
+    for (size_t i = 0; i < HINT_AGENTS; i++)
+    {
+        if (agents[i].heard_at != 0 && agents[i].id == id)
+        {
+            return &agents[i];
+        }
+        if (agents[i].heard_at < oldest->heard_at)
+        {
+            oldest = &agents[i];
+        }
+    }
+
+    if (oldest->heard_at != 0 && now - oldest->heard_at < HINT_AGENT_TIMEOUT_US)
+    {
+        ESP_LOGW(TAG, "no room for agent %08" PRIx32, id);
+        return nullptr;
+    }
+    if (oldest->heard_at != 0 && (int32_t)(oldest->last_sequence - evicted_sequence) > 0)
+    {
+        evicted_sequence = oldest->last_sequence;
+    }
+    if (evicted_sequence != 0 && (int32_t)(sequence - evicted_sequence) <= 0)
+    {
+        ESP_LOGW(TAG, "dropped hint %" PRIu32 " of agent %08" PRIx32 " below %" PRIu32, sequence, id, evicted_sequence);
+        return nullptr;
+    }
+
+    *oldest = {};
+    oldest->id = id;
+    return oldest;
+}
+
+// Sequences are agent time in tenths of a second, they must be close to ours.
+static bool hint_is_sequence_current(uint32_t sequence)
+{
+    time_t now = time(nullptr);
+    if (now < 1577836800) // 2020-01-01, SNTP has not synced yet
+    {
+        return true;
+    }
+
+    int32_t skew = (int32_t)(sequence - (uint32_t)((int64_t)now * 10));
+    return skew > -HINT_SEQUENCE_WINDOW && skew < HINT_SEQUENCE_WINDOW;
+}
+
+// The desk is idle once every agent heard from lately reports idle.
+static void hint_update_desk(int64_t now)
+{
+    bool is_idle = true;
+    for (size_t i = 0; i < HINT_AGENTS; i++)
+    {
+        if (agents[i].heard_at != 0 && now - agents[i].heard_at < HINT_AGENT_TIMEOUT_US && !agents[i].is_idle)
+        {
+            is_idle = false;
+        }
+    }
+
+    if (is_idle == is_desk_idle && is_desk_posted)
+    {
+        return;
+    }
+
+    // a full queue is tried again on the next packet or the receive timeout
+    is_desk_idle = is_idle;
+    is_desk_posted = pomodoro_post_input(is_idle ? INPUT_PRESENCE_LOST : INPUT_PRESENCE_RETURNED);
+}
+
+static void hint_post_break(void)
+{
+    if (is_break_pending)
+    {
+        is_break_pending = !pomodoro_post_input(INPUT_BREAK_SUGGESTED);
+    }
+}
+
+static void hint_task(void *arg)
+{
+    int sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_IP);
+    if (sock < 0)
+    {
+        ESP_LOGE(TAG, "unable to create socket: errno %d", errno);
+        vTaskDelete(nullptr);
+        return;
+    }
+
+    struct sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons(CONFIG_POMODORO_HINT_PORT);
+
+    if (bind(sock, (struct sockaddr *)&addr, sizeof(addr)) < 0)
+    {
+        ESP_LOGE(TAG, "unable to bind port %d: errno %d", CONFIG_POMODORO_HINT_PORT, errno);
+        close(sock);
+        vTaskDelete(nullptr);
+        return;
+    }
+
+    ESP_LOGI(TAG, "listening for activity hints on port %d", CONFIG_POMODORO_HINT_PORT);
+
+    bool is_timeout_set = false;
+    for (;;)
+    {
+        // blocks for good unless an input still waits to be posted
+        bool is_pending = !is_desk_posted || is_break_pending;
+        if (is_timeout_set != is_pending)
+        {
+            is_timeout_set = is_pending;
+            struct timeval timeout = {};
+            timeout.tv_usec = is_timeout_set ? HINT_RETRY_US : 0;
+            setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        }
+
+        // one byte more than a valid packet, so oversized ones are noticed
+        uint8_t buf[HINT_PACKET_SIZE + 1];
+        int len = recv(sock, buf, sizeof(buf), 0);
+        if (len < 0)
+        {
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+            {
+                hint_update_desk(esp_timer_get_time());
+                hint_post_break();
+            }
+            else
+            {
+                ESP_LOGE(TAG, "recv failed: errno %d", errno);
+            }
+            continue;
+        }
+
+        hint_packet hint;
+        if (!hint_decode(buf, len, (const uint8_t *)hint_key, strlen(hint_key), &hint))
+        {
+            ESP_LOGW(TAG, "dropped malformed or unsigned hint");
+            continue;
+        }
+        if (!hint_is_sequence_current(hint.sequence))
+        {
+            ESP_LOGW(TAG, "dropped stale hint %" PRIu32, hint.sequence);
+            continue;
+        }
+
+        int64_t now = esp_timer_get_time();
+        hint_agent *agent = hint_find_agent(hint.agent, hint.sequence, now);
+        if (agent == nullptr)
+        {
+            continue;
+        }
+        if (agent->heard_at != 0 && hint.sequence <= agent->last_sequence)
+        {
+            ESP_LOGW(TAG, "dropped replayed hint %" PRIu32, hint.sequence);
+            continue;
+        }
+
+        agent->last_sequence = hint.sequence;
+        agent->heard_at = now;
+
+        // Agents repeat the current activity as a heartbeat, only the edges
+        // of the whole desk are forwarded so bursts never reach the FSM.
+        switch (hint.kind)
+        {
+        case HINT_ACTIVE:
+            agent->is_idle = false;
+            break;
+        case HINT_IDLE:
+            agent->is_idle = true;
+            break;
+        case HINT_BREAK:
+            agent->is_idle = false;
+            is_break_pending = true;
+            break;
+        }
+        hint_update_desk(now);
+        hint_post_break();
+    }
+}
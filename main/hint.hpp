@@ -0,0 +1,48 @@
+#ifndef HINT_HPP_INCLUDED
+#define HINT_HPP_INCLUDED
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+
+// Activity hints sent by a desktop agent, see tools/activity_agent.py.
+//
+// Wire format, 20 bytes:
+//   0  'P' 'H'   magic
+//   2  version   HINT_VERSION
+//   3  kind      hint_kind
+//   4  agent     u32 big-endian, chosen by the agent
+//   8  sequence  u32 big-endian, strictly increasing per agent
+//   12 mac       first 8 bytes of HMAC-SHA256(key, bytes 0..11)
+//
+// Agents are told apart by the signed agent id, not by the source address
+// anyone can fake, each one has its own sequence and idle state. The sequence is the agent's unix time in tenths
+// of a second: once SNTP has synced, sequences further than
+// HINT_SEQUENCE_WINDOW away from the light's own time are dropped, so
+// packets captured before a restart do not replay after it.
+#define HINT_VERSION 2
+#define HINT_PACKET_SIZE 20
+#define HINT_MAC_SIZE 8
+#define HINT_SEQUENCE_WINDOW (5 * 60 * 10)
+
+enum hint_kind : uint8_t
+{
+    HINT_ACTIVE = 1,
+    HINT_IDLE = 2,
+    HINT_BREAK = 3,
+};
+
+struct hint_packet
+{
+    hint_kind kind;
+    uint32_t agent;
+    uint32_t sequence;
+};
+
+esp_err_t hint_setup(void);
+
+// Checks framing and signature of a received datagram.
+bool hint_decode(const uint8_t *data, size_t len, const uint8_t *key, size_t key_len, hint_packet *hint);
+
+#endif /* HINT_HPP_INCLUDED */
@@ -0,0 +1,527 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+
+#include "sdkconfig.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "esp_log.h"
+#include "esp_partition.h"
+#if CONFIG_POMODORO_CONSOLE_ENABLE
+#include "esp_console.h"
+#endif
+
+#include "history.hpp"
+
+#define HISTORY_BLOCK_SIZE 4096
+#define HISTORY_BLOCKS_MAX 32
+#define HISTORY_RECORD_MAX 12
+
+// timestamps before this are seconds since boot, not wall clock
+#define HISTORY_EPOCH 1577836800 // 2020-01-01
+
+#define CODE_EVENT_MASK 0x03
+#define CODE_PHASE_SHIFT 2
+#define CODE_PHASE_MASK 0x07
+#define CODE_HAS_TAG 0x20
+#define CODE_RESERVED 0xC0
+
+static const char *TAG = "history";
+
+// What is known about every block, built by scanning the partition on boot
+// and kept up to date by the writer, so range queries skip whole blocks.
+struct block_index
+{
+    uint32_t sequence; // 0 for an unused block
+    uint32_t first_timestamp;
+    uint32_t last_timestamp;
+    uint16_t end;
+    uint16_t records;
+};
+
+static const esp_partition_t *partition = nullptr;
+static SemaphoreHandle_t history_mutex = nullptr;
+
+static block_index blocks[HISTORY_BLOCKS_MAX];
+static size_t blocks_count = 0;
+static size_t current_block = 0;
+
+static uint32_t last_timestamp = 0;
+static int64_t last_delta = 0;
+
+// the current block ends in a partial record, nothing may be appended to it
+static bool is_block_damaged = false;
+
+static uint32_t zigzag_encode(int64_t value)
+{
+    return (uint32_t)((value << 1) ^ (value >> 63));
+}
+
+static int64_t zigzag_decode(uint32_t value)
+{
+    return (int64_t)(value >> 1) ^ -(int64_t)(value & 1);
+}
+
+static size_t varint_encode(uint32_t value, uint8_t *out)
+{
+    size_t len = 0;
+    while (value >= 0x80)
+    {
+        out[len++] = (value & 0x7F) | 0x80;
+        value >>= 7;
+    }
+    out[len++] = value;
+    return len;
+}
+
+// Reads from the cursor's block through its small buffer.
+static bool cursor_byte(history_cursor *cursor, uint8_t *byte)
+{
+    if (cursor->offset >= cursor->end)
+    {
+        return false;
+    }
+    if (cursor->offset < cursor->buf_start || cursor->offset >= cursor->buf_start + cursor->buf_len)
+    {
+        size_t len = cursor->end - cursor->offset;
+        if (len > sizeof(cursor->buf))
+        {
+            len = sizeof(cursor->buf);
+        }
+
+        xSemaphoreTake(history_mutex, portMAX_DELAY);
+        // the block was recycled under the reader, nothing more to read there
+        bool is_recycled = blocks[cursor->block].sequence != cursor->sequence;
+        esp_err_t err = is_recycled ? ESP_ERR_INVALID_STATE : esp_partition_read(partition, cursor->block * HISTORY_BLOCK_SIZE + cursor->offset, cursor->buf, len);
+        xSemaphoreGive(history_mutex);
+
+        if (err != ESP_OK)
+        {
+            cursor->end = cursor->offset;
+            return false;
+        }
+        cursor->buf_start = cursor->offset;
+        cursor->buf_len = len;
+    }
+
+    *byte = cursor->buf[cursor->offset - cursor->buf_start];
+    cursor->offset++;
+    return true;
+}
+
+static bool cursor_varint(history_cursor *cursor, uint32_t *value)
+{
+    *value = 0;
+    for (int shift = 0; shift < 35; shift += 7)
+    {
+        uint8_t byte;
+        if (!cursor_byte(cursor, &byte))
+        {
+            return false;
+        }
+        *value |= (uint32_t)(byte & 0x7F) << shift;
+        if (!(byte & 0x80))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void cursor_open_block(history_cursor *cursor, size_t block, uint32_t sequence, uint32_t first_timestamp, size_t end)
+{
+    cursor->block = block;
+    cursor->sequence = sequence;
+    cursor->offset = sizeof(history_block_header);
+    cursor->end = end;
+    cursor->timestamp = first_timestamp;
+    cursor->delta = 0;
+    cursor->buf_start = 0;
+    cursor->buf_len = 0;
+}
+
+// Decodes the next record of the open block, false at its end or at the
+// first byte that does not make sense.
+static bool cursor_decode(history_cursor *cursor, journal_record *record)
+{
+    uint8_t code;
+    uint32_t dod;
+    uint32_t detail;
+    uint8_t tag = 0;
+
+    if (!cursor_byte(cursor, &code) || (code & CODE_RESERVED))
+    {
+        return false;
+    }
+    if (!cursor_varint(cursor, &dod) || !cursor_varint(cursor, &detail))
+    {
+        return false;
+    }
+    if ((code & CODE_HAS_TAG) && !cursor_byte(cursor, &tag))
+    {
+        return false;
+    }
+
+    cursor->delta += zigzag_decode(dod);
+    cursor->timestamp += cursor->delta;
+
+    record->timestamp = cursor->timestamp;
+    record->event = (journal_event)(code & CODE_EVENT_MASK);
+    record->phase = (code >> CODE_PHASE_SHIFT) & CODE_PHASE_MASK;
+    record->detail = detail;
+    record->tag = tag;
+
+    return true;
+}
+
+static bool block_read_header(size_t block, history_block_header *header)
+{
+    if (esp_partition_read(partition, block * HISTORY_BLOCK_SIZE, header, sizeof(*header)) != ESP_OK)
+    {
+        return false;
+    }
+    return header->magic == HISTORY_BLOCK_MAGIC && header->version == HISTORY_VERSION && header->sequence != 0;
+}
+
+static void block_scan(size_t block)
+{
+    history_block_header header;
+    block_index &index = blocks[block];
+
+    index = {};
+    if (!block_read_header(block, &header))
+    {
+        return;
+    }
+
+    index.sequence = header.sequence;
+    index.first_timestamp = header.first_timestamp;
+    index.last_timestamp = header.first_timestamp;
+
+    history_cursor cursor = {};
+    cursor_open_block(&cursor, block, header.sequence, header.first_timestamp, HISTORY_BLOCK_SIZE);
+
+    journal_record record;
+    size_t end = cursor.offset;
+    while (cursor_decode(&cursor, &record))
+    {
+        end = cursor.offset;
+        index.records++;
+        index.last_timestamp = record.timestamp;
+    }
+    index.end = end;
+
+    if (block == current_block)
+    {
+        last_timestamp = cursor.timestamp;
+        last_delta = cursor.delta;
+    }
+}
+
+static esp_err_t block_start(size_t block, uint32_t sequence, uint32_t timestamp)
+{
+    // whatever the index said about the block is gone from here on
+    blocks[block] = {};
+
+    esp_err_t err = esp_partition_erase_range(partition, block * HISTORY_BLOCK_SIZE, HISTORY_BLOCK_SIZE);
+    if (err != ESP_OK)
+    {
+        return err;
+    }
+
+    history_block_header header = {};
+    header.magic = HISTORY_BLOCK_MAGIC;
+    header.version = HISTORY_VERSION;
+    header.sequence = sequence;
+    header.first_timestamp = timestamp;
+
+    err = esp_partition_write(partition, block * HISTORY_BLOCK_SIZE, &header, sizeof(header));
+    if (err != ESP_OK)
+    {
+        return err;
+    }
+
+    blocks[block] = {sequence, timestamp, timestamp, sizeof(header), 0};
+    current_block = block;
+    is_block_damaged = false;
+    last_timestamp = timestamp;
+    last_delta = 0;
+
+    return ESP_OK;
+}
+
+esp_err_t history_setup(void)
+{
+    partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, "history");
+    if (partition == nullptr)
+    {
+        ESP_LOGW(TAG, "no history partition, history is not kept");
+        return ESP_OK;
+    }
+
+    blocks_count = partition->size / HISTORY_BLOCK_SIZE;
+    if (blocks_count > HISTORY_BLOCKS_MAX)
+    {
+        blocks_count = HISTORY_BLOCKS_MAX;
+    }
+
+    history_mutex = xSemaphoreCreateMutex();
+    if (history_mutex == nullptr)
+    {
+        return ESP_ERR_NO_MEM;
+    }
+
+    // the block with the highest sequence is the one being written
+    uint32_t newest = 0;
+    history_block_header header;
+    for (size_t i = 0; i < blocks_count; i++)
+    {
+        if (block_read_header(i, &header) && header.sequence > newest)
+        {
+            newest = header.sequence;
+            current_block = i;
+        }
+    }
+    for (size_t i = 0; i < blocks_count; i++)
+    {
+        block_scan(i);
+    }
+
+    // A record cut short by a reset leaves bits that cannot be written over,
+    // carry on in a fresh block instead.
+    uint8_t tail = 0xFF;
+    block_index &current = blocks[current_block];
+    if (current.sequence != 0 && current.end < HISTORY_BLOCK_SIZE)
+    {
+        esp_partition_read(partition, current_block * HISTORY_BLOCK_SIZE + current.end, &tail, 1);
+    }
+    if (tail != 0xFF)
+    {
+        ESP_LOGW(TAG, "block %u ends in a partial record, starting the next one", (unsigned)current_block);
+        is_block_damaged = true;
+        esp_err_t err = block_start((current_block + 1) % blocks_count, current.sequence + 1, current.last_timestamp);
+        if (err != ESP_OK)
+        {
+            ESP_LOGE(TAG, "cannot start block: %s, trying again on the next record", esp_err_to_name(err));
+        }
+    }
+
+    history_stats stats = history_get_stats();
+    ESP_LOGI(TAG, "%u records in %u of %u blocks", (unsigned)stats.records, (unsigned)stats.blocks_used, (unsigned)stats.blocks);
+
+    return ESP_OK;
+}
+
+void history_append(const journal_record &record)
+{
+    if (partition == nullptr || record.timestamp < HISTORY_EPOCH)
+    {
+        return;
+    }
+
+    xSemaphoreTake(history_mutex, portMAX_DELAY);
+
+    esp_err_t err = ESP_OK;
+    if (blocks[current_block].sequence == 0)
+    {
+        err = block_start(current_block, 1, record.timestamp);
+    }
+    else if (is_block_damaged)
+    {
+        err = block_start((current_block + 1) % blocks_count, blocks[current_block].sequence + 1, record.timestamp);
+    }
+    if (err != ESP_OK)
+    {
+        xSemaphoreGive(history_mutex);
+        ESP_LOGE(TAG, "cannot start block: %s", esp_err_to_name(err));
+        return;
+    }
+
+    int64_t delta = (int64_t)record.timestamp - last_timestamp;
+
+    uint8_t buf[HISTORY_RECORD_MAX];
+    size_t len = 0;
+
+    buf[len++] = (record.event & CODE_EVENT_MASK) | ((record.phase & CODE_PHASE_MASK) << CODE_PHASE_SHIFT) | (record.tag != 0 ? CODE_HAS_TAG : 0);
+    len += varint_encode(zigzag_encode(delta - last_delta), buf + len);
+    len += varint_encode(record.detail, buf + len);
+    if (record.tag != 0)
+    {
+        buf[len++] = record.tag;
+    }
+
+    if (blocks[current_block].end + len > HISTORY_BLOCK_SIZE)
+    {
+        // on to the next block, the oldest one; it starts a fresh delta chain
+        uint32_t sequence = blocks[current_block].sequence + 1;
+        err = block_start((current_block + 1) % blocks_count, sequence, record.timestamp);
+        if (err != ESP_OK)
+        {
+            xSemaphoreGive(history_mutex);
+            ESP_LOGE(TAG, "cannot start block: %s", esp_err_to_name(err));
+            return;
+        }
+
+        len = 1;
+        len += varint_encode(zigzag_encode(0), buf + len);
+        len += varint_encode(record.detail, buf + len);
+        if (record.tag != 0)
+        {
+            buf[len++] = record.tag;
+        }
+        delta = 0;
+    }
+
+    block_index &current = blocks[current_block];
+    err = esp_partition_write(partition, current_block * HISTORY_BLOCK_SIZE + current.end, buf, len);
+    if (err == ESP_OK)
+    {
+        current.end += len;
+        current.records++;
+        current.last_timestamp = record.timestamp;
+        last_timestamp = record.timestamp;
+        last_delta = delta;
+    }
+
+    xSemaphoreGive(history_mutex);
+
+    if (err != ESP_OK)
+    {
+        ESP_LOGE(TAG, "cannot write record: %s", esp_err_to_name(err));
+    }
+}
+
+void history_query(history_cursor *cursor, uint32_t from, uint32_t to)
+{
+    *cursor = {};
+    cursor->from = from;
+    cursor->to = to;
+
+    if (partition == nullptr)
+    {
+        return;
+    }
+
+    // oldest block first: the one after the block being written
+    cursor->blocks_left = blocks_count;
+    cursor->block = current_block;
+    cursor->end = 0;
+}
+
+bool history_next(history_cursor *cursor, journal_record *record)
+{
+    for (;;)
+    {
+        while (cursor_decode(cursor, record))
+        {
+            if (record->timestamp >= cursor->from && record->timestamp <= cursor->to)
+            {
+                return true;
+            }
+        }
+
+        // the index tells which blocks can hold anything in range
+        bool is_found = false;
+        while (cursor->blocks_left > 0 && !is_found)
+        {
+            cursor->blocks_left--;
+            size_t block = (cursor->block + 1) % blocks_count;
+
+            xSemaphoreTake(history_mutex, portMAX_DELAY);
+            block_index index = blocks[block];
+            xSemaphoreGive(history_mutex);
+
+            cursor->block = block;
+            if (index.sequence == 0 || index.last_timestamp < cursor->from || index.first_timestamp > cursor->to)
+            {
+                continue;
+            }
+
+            cursor_open_block(cursor, block, index.sequence, index.first_timestamp, index.end);
+            is_found = true;
+        }
+        if (!is_found)
+        {
+            return false;
+        }
+    }
+}
+
+history_stats history_get_stats(void)
+{
+    history_stats stats = {};
+    if (partition == nullptr)
+    {
+        return stats;
+    }
+
+    xSemaphoreTake(history_mutex, portMAX_DELAY);
+    stats.blocks = blocks_count;
+    for (size_t i = 0; i < blocks_count; i++)
+    {
+        if (blocks[i].sequence != 0)
+        {
+            stats.blocks_used++;
+            stats.records += blocks[i].records;
+            stats.bytes += blocks[i].end;
+        }
+    }
+    xSemaphoreGive(history_mutex);
+
+    return stats;
+}
+
+#if CONFIG_POMODORO_CONSOLE_ENABLE
+static bool history_parse_time(const char *text, uint32_t *value)
+{
+    char *end;
+    unsigned long parsed = strtoul(text, &end, 10);
+    if (end == text || *end != '\0' || text[0] == '-' || parsed > UINT32_MAX)
+    {
+        return false;
+    }
+    *value = parsed;
+    return true;
+}
+
+static int history_command(int argc, char **argv)
+{
+    uint32_t from = 0;
+    uint32_t to = UINT32_MAX;
+    if (argc > 3 || (argc > 1 && !history_parse_time(argv[1], &from)) || (argc > 2 && !history_parse_time(argv[2], &to)) || from > to)
+    {
+        printf("usage: history [from] [to], unix times with from <= to\n");
+        return 1;
+    }
+
+    history_cursor cursor;
+    journal_record record;
+    size_t count = 0;
+
+    history_query(&cursor, from, to);
+    while (history_next(&cursor, &record))
+    {
+        printf("%" PRIu32 " event %d phase %d detail %d tag %d\n", record.timestamp, record.event, record.phase, record.detail, record.tag);
+        count++;
+    }
+
+    history_stats stats = history_get_stats();
+    printf("%u records shown, %u kept in %u bytes, %u of %u blocks used\n",
+           (unsigned)count, (unsigned)stats.records, (unsigned)stats.bytes, (unsigned)stats.blocks_used, (unsigned)stats.blocks);
+    return 0;
+}
+
+esp_err_t history_register_command(void)
+{
+    esp_console_cmd_t cmd = {};
+
+    cmd.command = "history";
+    cmd.help = "Print the records kept in flash, optionally within a unix time range";
+    cmd.hint = "[from] [to]";
+    cmd.func = &history_command;
+
+    return esp_console_cmd_register(&cmd);
+}
+#endif
@@ -0,0 +1,77 @@
+#ifndef HISTORY_HPP_INCLUDED
+#define HISTORY_HPP_INCLUDED
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+
+#include "journal.hpp"
+
+// Journal records kept for good in the "history" flash partition, see
+// partitions.csv. The partition is a ring of 4 KB blocks, each one erased
+// and rewritten as a whole once the ring comes around to it again.
+//
+// Block layout: history_block_header, then records until the first 0xFF.
+// Record layout:
+//   code      1 byte: event in bits 0-1, phase in bits 2-4, has tag in bit 5
+//   timestamp zigzag varint, delta of delta to the previous record; the
+//             first record of a block starts from header.first_timestamp
+//             with a previous delta of 0
+//   detail    varint
+//   tag       1 byte, only if the code says so
+// Phases end at regular intervals, so most timestamps take one or two bytes
+// and a whole record three to five.
+
+#define HISTORY_BLOCK_MAGIC 0x4248 // "HB"
+#define HISTORY_VERSION 1
+
+struct history_block_header
+{
+    uint16_t magic;
+    uint8_t version;
+    uint8_t reserved;
+    uint32_t sequence; // increases by one per block written
+    uint32_t first_timestamp;
+};
+
+struct history_stats
+{
+    size_t blocks;
+    size_t blocks_used;
+    size_t records;
+    size_t bytes;
+};
+
+// Streaming reader, decodes records straight out of flash a few bytes at a
+// time. Only records with a timestamp within [from, to] are returned.
+struct history_cursor
+{
+    uint32_t from;
+    uint32_t to;
+    size_t blocks_left;
+    size_t block;
+    uint32_t sequence;
+    size_t offset;
+    size_t end;
+    uint32_t timestamp;
+    int64_t delta;
+    uint8_t buf[32];
+    size_t buf_start;
+    size_t buf_len;
+};
+
+esp_err_t history_setup(void);
+
+// Called by the journal for every record. Records without a wall clock
+// timestamp, from before the first SNTP sync, are not kept.
+void history_append(const journal_record &record);
+
+void history_query(history_cursor *cursor, uint32_t from, uint32_t to);
+bool history_next(history_cursor *cursor, journal_record *record);
+
+history_stats history_get_stats(void);
+
+esp_err_t history_register_command(void);
+
+#endif /* HISTORY_HPP_INCLUDED */
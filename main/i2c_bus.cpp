@@ -0,0 +1,80 @@
+#include "sdkconfig.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "esp_log.h"
+#include "driver/i2c.h"
+
+#include "i2c_bus.hpp"
+
+#define I2C_BUS_PORT I2C_NUM_0
+#define I2C_BUS_TIMEOUT (100 / portTICK_PERIOD_MS)
+
+static const char *TAG = "i2c_bus";
+
+static SemaphoreHandle_t bus_mutex = nullptr;
+
+esp_err_t i2c_bus_setup(void)
+{
+    if (bus_mutex != nullptr)
+    {
+        return ESP_OK;
+    }
+
+    i2c_config_t conf = {};
+
+    conf.mode = I2C_MODE_MASTER;
+    conf.sda_io_num = (gpio_num_t)CONFIG_POMODORO_I2C_SDA_GPIO;
+    conf.sda_pullup_en = GPIO_PULLUP_ENABLE;
+    conf.scl_io_num = (gpio_num_t)CONFIG_POMODORO_I2C_SCL_GPIO;
+    conf.scl_pullup_en = GPIO_PULLUP_ENABLE;
+    conf.clk_stretch_tick = 300;
+
+    ESP_ERROR_CHECK(i2c_driver_install(I2C_BUS_PORT, conf.mode));
+    ESP_ERROR_CHECK(i2c_param_config(I2C_BUS_PORT, &conf));
+
+    bus_mutex = xSemaphoreCreateMutex();
+    if (bus_mutex == nullptr)
+    {
+        return ESP_ERR_NO_MEM;
+    }
+
+    ESP_LOGI(TAG, "I2C bus on SDA GPIO[%d] SCL GPIO[%d]", CONFIG_POMODORO_I2C_SDA_GPIO, CONFIG_POMODORO_I2C_SCL_GPIO);
+
+    return ESP_OK;
+}
+
+static esp_err_t i2c_bus_transfer(uint8_t address, bool is_read, uint8_t *data, size_t len)
+{
+    i2c_cmd_handle_t cmd = i2c_cmd_link_create();
+
+    i2c_master_start(cmd);
+    i2c_master_write_byte(cmd, (address << 1) | (is_read ? I2C_MASTER_READ : I2C_MASTER_WRITE), true);
+    if (is_read)
+    {
+        i2c_master_read(cmd, data, len, I2C_MASTER_LAST_NACK);
+    }
+    else
+    {
+        i2c_master_write(cmd, data, len, true);
+    }
+    i2c_master_stop(cmd);
+
+    xSemaphoreTake(bus_mutex, portMAX_DELAY);
+    esp_err_t err = i2c_master_cmd_begin(I2C_BUS_PORT, cmd, I2C_BUS_TIMEOUT);
+    xSemaphoreGive(bus_mutex);
+
+    i2c_cmd_link_delete(cmd);
+
+    return err;
+}
+
+esp_err_t i2c_bus_read(uint8_t address, uint8_t *data, size_t len)
+{
+    return i2c_bus_transfer(address, true, data, len);
+}
+
+esp_err_t i2c_bus_write(uint8_t address, const uint8_t *data, size_t len)
+{
+    return i2c_bus_transfer(address, false, (uint8_t *)data, len);
+}
@@ -0,0 +1,15 @@
+#ifndef I2C_BUS_HPP_INCLUDED
+#define I2C_BUS_HPP_INCLUDED
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+
+// Shared I2C master bus, safe to set up from every subsystem using it.
+esp_err_t i2c_bus_setup(void);
+
+esp_err_t i2c_bus_read(uint8_t address, uint8_t *data, size_t len);
+esp_err_t i2c_bus_write(uint8_t address, const uint8_t *data, size_t len);
+
+#endif /* I2C_BUS_HPP_INCLUDED */
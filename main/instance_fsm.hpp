@@ -0,0 +1,137 @@
+#ifndef INSTANCE_FSM_HPP_INCLUDED
+#define INSTANCE_FSM_HPP_INCLUDED
+
+#include <new>
+#include <type_traits>
+
+// Instance based variant of tinyfsm. States are written the same way, as
+// subclasses of the machine class F overriding react() and entry(), but a
+// machine is an object instead of a set of statics: it holds the current
+// state in place, together with the context all its states share. Any
+// number of machines can exist side by side, each one as big as one state.
+//
+// Rules on top of tinyfsm:
+//  - states must not add data members, run data goes into the context;
+//  - states inherit the constructor, `using Fsm::Fsm;` in the machine class
+//    and `using F::F;` in every state;
+//  - transit<S>() replaces the running state object in place, so it has to
+//    be the last thing a reaction does.
+
+namespace instance_fsm
+{
+
+    struct Event
+    {
+    };
+
+    // One address per state type, used to tell which state is running.
+    template <typename S>
+    struct state_tag
+    {
+        static const char value;
+    };
+
+    template <typename S>
+    const char state_tag<S>::value = 0;
+
+    template <typename F>
+    class Machine;
+
+    // What the next state is built from. The context is copied straight into
+    // it, it is never seen zeroed or half built.
+    template <typename C>
+    struct Entering
+    {
+        const C &context;
+        const char *tag;
+    };
+
+    template <typename F, typename C>
+    class Fsm
+    {
+    public:
+        using context_type = C;
+
+        C context;
+
+        explicit Fsm(const Entering<C> &entering) : context(entering.context), tag(entering.tag) {}
+
+        template <typename S>
+        bool is_in_state() const
+        {
+            return this->tag == &state_tag<S>::value;
+        }
+
+    protected:
+        template <typename S>
+        void transit()
+        {
+            static_assert(std::is_base_of<F, S>::value, "not a state of this machine");
+            static_assert(sizeof(S) == sizeof(F), "states must not add data members");
+
+            F *current = static_cast<F *>(this);
+            current->exit();
+
+            // the state object is about to be replaced, the context moves over
+            C saved = current->context;
+            Machine<F>::template enter<S>(current, saved);
+        }
+
+    private:
+        const char *tag;
+
+        friend class Machine<F>;
+    };
+
+    template <typename F>
+    class Machine
+    {
+        static_assert(std::is_trivially_destructible<typename F::context_type>::value,
+                      "states are replaced without running destructors");
+
+    public:
+        template <typename S>
+        void start(const typename F::context_type &context)
+        {
+            Machine<F>::enter<S>(this->state(), context);
+        }
+
+        template <typename E>
+        void dispatch(E const &event)
+        {
+            this->state()->react(event);
+        }
+
+        template <typename S>
+        bool is_in_state() const
+        {
+            return this->state()->template is_in_state<S>();
+        }
+
+        F *state()
+        {
+            return reinterpret_cast<F *>(&this->storage);
+        }
+
+        const F *state() const
+        {
+            return reinterpret_cast<const F *>(&this->storage);
+        }
+
+    private:
+        typename std::aligned_storage<sizeof(F), alignof(F)>::type storage;
+
+        template <typename S>
+        static void enter(void *where, const typename F::context_type &context)
+        {
+            Entering<typename F::context_type> entering = {context, &state_tag<S>::value};
+            S *next = new (where) S(entering);
+            next->entry();
+        }
+
+        friend class Fsm<F, typename F::context_type>;
+    };
+
+} /* namespace instance_fsm */
+
+#endif /* INSTANCE_FSM_HPP_INCLUDED */
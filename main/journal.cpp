@@ -0,0 +1,198 @@
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <inttypes.h>
+
+#include "sdkconfig.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_timer.h"
+#if CONFIG_POMODORO_CONSOLE_ENABLE
+#include "esp_console.h"
+#endif
+
+#include "journal.hpp"
+#include "tags.hpp"
+#include "tz.hpp"
+#if CONFIG_POMODORO_HISTORY_ENABLE
+#include "history.hpp"
+#endif
+
+#define JOURNAL_RECORDS CONFIG_POMODORO_JOURNAL_RECORDS
+
+static journal_record records[JOURNAL_RECORDS];
+static size_t records_next = 0;
+static size_t records_count = 0;
+
+static journal_daily_counts daily_counts = {};
+static int counts_day = -1;
+
+// Days are counted from year 1 so they stay consecutive across years.
+static int journal_day_of(const struct tm &local)
+{
+    int year = local.tm_year + 1900 - 1;
+    return year * 365 + year / 4 - year / 100 + year / 400 + local.tm_yday;
+}
+
+static uint32_t journal_timestamp(int *day)
+{
+    time_t now = time(nullptr);
+    struct tm local;
+    tz_localtime(now, &local);
+
+    if (local.tm_year < (2020 - 1900))
+    {
+        *day = 0;
+        return esp_timer_get_time() / 1000000;
+    }
+
+    *day = journal_day_of(local);
+    return now;
+}
+
+int journal_today(void)
+{
+    int day;
+    journal_timestamp(&day);
+    return day;
+}
+
+static void journal_count(journal_daily_counts &counts, const journal_record &record)
+{
+    switch (record.event)
+    {
+    case JOURNAL_WORK_DONE:
+        counts.work_done++;
+        counts.work_minutes += record.detail;
+        break;
+    case JOURNAL_INTERRUPTION_INTERNAL:
+        counts.interruptions_internal++;
+        break;
+    case JOURNAL_INTERRUPTION_EXTERNAL:
+        counts.interruptions_external++;
+        break;
+    case JOURNAL_ABSENCE:
+        counts.absences++;
+        counts.absent_minutes += record.detail;
+        break;
+    }
+}
+
+void journal_add(journal_event event, pomodoro_phase phase, uint16_t detail)
+{
+    int day;
+    journal_record record = {};
+
+    record.timestamp = journal_timestamp(&day);
+    record.event = event;
+    record.phase = phase;
+    record.detail = detail;
+    record.tag = tags_get_active();
+
+    portENTER_CRITICAL();
+
+    records[records_next] = record;
+    records_next = (records_next + 1) % JOURNAL_RECORDS;
+    if (records_count < JOURNAL_RECORDS)
+    {
+        records_count++;
+    }
+
+    if (day != counts_day)
+    {
+        counts_day = day;
+        daily_counts = {};
+    }
+    journal_count(daily_counts, record);
+
+    portEXIT_CRITICAL();
+
+    if (event == JOURNAL_WORK_DONE)
+    {
+        tags_count_work(record.tag, detail, day);
+    }
+
+#if CONFIG_POMODORO_HISTORY_ENABLE
+    history_append(record);
+#endif
+}
+
+journal_daily_counts journal_get_daily_counts(void)
+{
+    // counts are only reset by a record, until today's first one they
+    // belong to an earlier day
+    int today = journal_today();
+
+    portENTER_CRITICAL();
+    journal_daily_counts counts = counts_day == today ? daily_counts : journal_daily_counts{};
+    portEXIT_CRITICAL();
+
+    return counts;
+}
+
+size_t journal_read(journal_record *out, size_t max)
+{
+    portENTER_CRITICAL();
+    size_t count = records_count < max ? records_count : max;
+    size_t first = (records_next + JOURNAL_RECORDS - records_count) % JOURNAL_RECORDS;
+    for (size_t i = 0; i < count; i++)
+    {
+        out[i] = records[(first + i) % JOURNAL_RECORDS];
+    }
+    portEXIT_CRITICAL();
+
+    return count;
+}
+
+#if CONFIG_POMODORO_CONSOLE_ENABLE
+static int mark_command(int argc, char **argv)
+{
+    if (argc != 2 || (strcmp(argv[1], "internal") != 0 && strcmp(argv[1], "external") != 0))
+    {
+        printf("usage: mark internal|external\n");
+        return 1;
+    }
+
+    pomodoro_post_input(strcmp(argv[1], "internal") == 0 ? INPUT_MARK_INTERNAL : INPUT_MARK_EXTERNAL);
+    return 0;
+}
+
+static int journal_command(int argc, char **argv)
+{
+    static const char *const events[] = {"work", "internal", "external", "absence"};
+
+    // static, too big for the console task stack
+    static journal_record copy[JOURNAL_RECORDS];
+    size_t count = journal_read(copy, JOURNAL_RECORDS);
+
+    for (size_t i = 0; i < count; i++)
+    {
+        printf("%" PRIu32 " %s phase %d detail %d tag %s\n",
+               copy[i].timestamp, events[copy[i].event], copy[i].phase, copy[i].detail, tags_name(copy[i].tag));
+    }
+
+    journal_daily_counts counts = journal_get_daily_counts();
+    printf("today: %d pomodoros, %d min, %d internal and %d external interruptions, %d absences, %d min away\n",
+           counts.work_done, counts.work_minutes, counts.interruptions_internal, counts.interruptions_external,
+           counts.absences, counts.absent_minutes);
+    return 0;
+}
+
+esp_err_t journal_register_command(void)
+{
+    esp_console_cmd_t cmd = {};
+
+    cmd.command = "mark";
+    cmd.help = "Mark an interruption of the running work period";
+    cmd.hint = "internal|external";
+    cmd.func = &mark_command;
+    ESP_ERROR_CHECK(esp_console_cmd_register(&cmd));
+
+    cmd = {};
+    cmd.command = "journal";
+    cmd.help = "Print the session journal and today's counts";
+    cmd.func = &journal_command;
+
+    return esp_console_cmd_register(&cmd);
+}
+#endif
@@ -0,0 +1,55 @@
+#ifndef JOURNAL_HPP_INCLUDED
+#define JOURNAL_HPP_INCLUDED
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+
+#include "pomodoro.hpp"
+
+// Session journal: the latest CONFIG_POMODORO_JOURNAL_RECORDS events of the
+// timer kept in RAM, written by the FSM only, readable from any task.
+
+enum journal_event : uint8_t
+{
+    JOURNAL_WORK_DONE,             // detail: minutes counted
+    JOURNAL_INTERRUPTION_INTERNAL, // detail: minutes into the period
+    JOURNAL_INTERRUPTION_EXTERNAL, // detail: minutes into the period
+    JOURNAL_ABSENCE,               // detail: minutes away from the desk
+};
+
+struct journal_record
+{
+    uint32_t timestamp; // unix time, seconds since boot until SNTP has synced
+    journal_event event;
+    uint8_t phase; // pomodoro_phase
+    uint16_t detail;
+    uint8_t tag; // project tag active at the time, see tags.hpp
+};
+
+// Per day counts, kept up to date on every record. Without SNTP time the
+// day is the one the light was switched on.
+struct journal_daily_counts
+{
+    uint16_t work_done;
+    uint16_t work_minutes;
+    uint16_t interruptions_internal;
+    uint16_t interruptions_external;
+    uint16_t absences;
+    uint16_t absent_minutes;
+};
+
+void journal_add(journal_event event, pomodoro_phase phase, uint16_t detail);
+
+journal_daily_counts journal_get_daily_counts(void);
+
+// Consecutive day number of today, 0 until SNTP has synced.
+int journal_today(void);
+
+// Copies up to max records out, oldest first, returns how many were copied.
+size_t journal_read(journal_record *records, size_t max);
+
+esp_err_t journal_register_command(void);
+
+#endif /* JOURNAL_HPP_INCLUDED */
@@ -0,0 +1,187 @@
+#include <inttypes.h>
+
+#include "sdkconfig.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_system.h"
+#include "esp_timer.h"
+#include "nvs.h"
+
+#include "liveness.hpp"
+
+// esp_timer callbacks run in the FreeRTOS timer task here, so the supervisor
+// is a task of its own to keep going when the timer task is the one that
+// hangs. If the supervisor itself is starved, so is the idle task, which then
+// stops feeding the hardware watchdog and that one resets.
+
+#define TIMEOUT_US (CONFIG_POMODORO_LIVENESS_TIMEOUT_SECONDS * 1000000LL)
+
+static const char *TAG = "liveness";
+static const char *NVS_NAMESPACE = "liveness";
+static const char *NVS_KEY = "last_hang";
+
+static const char *const task_names[LIVENESS_TASKS] = {"input", "esp_timer"};
+
+struct liveness_watched
+{
+    liveness_pending_fn pending_since;
+    int64_t checkin_at;
+};
+
+// what is left in NVS before restarting
+struct liveness_diagnostic
+{
+    uint32_t task;
+    uint32_t stalled_seconds;
+    uint32_t uptime_seconds;
+    uint32_t free_heap;
+};
+
+static liveness_watched watched[LIVENESS_TASKS];
+static TaskHandle_t supervisor = nullptr;
+
+static void liveness_restart(liveness_task task, int64_t stalled_us)
+{
+    liveness_diagnostic diagnostic = {};
+
+    diagnostic.task = task;
+    diagnostic.stalled_seconds = stalled_us / 1000000;
+    diagnostic.uptime_seconds = esp_timer_get_time() / 1000000;
+    diagnostic.free_heap = esp_get_free_heap_size();
+
+    ESP_LOGE(TAG, "%s task hung for %" PRIu32 " sec, restarting", task_names[task], diagnostic.stalled_seconds);
+
+    nvs_handle handle;
+    if (nvs_open(NVS_NAMESPACE, NVS_READWRITE, &handle) == ESP_OK)
+    {
+        nvs_set_blob(handle, NVS_KEY, &diagnostic, sizeof(diagnostic));
+        nvs_commit(handle);
+        nvs_close(handle);
+    }
+
+    esp_restart();
+}
+
+// Returns how long the supervisor may sleep before some pending work turns
+// overdue, -1 while nothing is pending.
+static int64_t supervisor_check(void)
+{
+    int64_t now = esp_timer_get_time();
+    int64_t next_overdue = INT64_MAX;
+
+    for (int i = 0; i < LIVENESS_TASKS; i++)
+    {
+        liveness_watched &task = watched[i];
+        if (task.pending_since == nullptr)
+        {
+            continue;
+        }
+
+        int64_t since = task.pending_since();
+        if (since == 0)
+        {
+            continue;
+        }
+
+        // every check-in restarts the clock, the task is still getting somewhere
+        portENTER_CRITICAL();
+        int64_t checkin_at = task.checkin_at;
+        portEXIT_CRITICAL();
+
+        int64_t stalled_since = since > checkin_at ? since : checkin_at;
+        int64_t overdue_at = stalled_since + TIMEOUT_US;
+        if (now >= overdue_at)
+        {
+            liveness_restart((liveness_task)i, now - stalled_since);
+        }
+        if (overdue_at < next_overdue)
+        {
+            next_overdue = overdue_at;
+        }
+    }
+
+    return next_overdue == INT64_MAX ? -1 : next_overdue - now;
+}
+
+static void supervisor_task(void *arg)
+{
+    for (;;)
+    {
+        int64_t sleep_us = supervisor_check();
+        TickType_t ticks = sleep_us < 0 ? portMAX_DELAY : pdMS_TO_TICKS(sleep_us / 1000) + 1;
+        ulTaskNotifyTake(pdTRUE, ticks);
+    }
+}
+
+static void liveness_report_last_hang(void)
+{
+    nvs_handle handle;
+    if (nvs_open(NVS_NAMESPACE, NVS_READWRITE, &handle) != ESP_OK)
+    {
+        return;
+    }
+
+    liveness_diagnostic diagnostic;
+    size_t len = sizeof(diagnostic);
+    if (nvs_get_blob(handle, NVS_KEY, &diagnostic, &len) == ESP_OK && len == sizeof(diagnostic) && diagnostic.task < LIVENESS_TASKS)
+    {
+        ESP_LOGW(TAG, "restarted after the %s task hung for %" PRIu32 " sec, uptime was %" PRIu32 " sec, free heap %" PRIu32,
+                 task_names[diagnostic.task], diagnostic.stalled_seconds, diagnostic.uptime_seconds, diagnostic.free_heap);
+        nvs_erase_key(handle, NVS_KEY);
+        nvs_commit(handle);
+    }
+    nvs_close(handle);
+
+    esp_reset_reason_t reason = esp_reset_reason();
+    if (reason == ESP_RST_TASK_WDT || reason == ESP_RST_WDT)
+    {
+        ESP_LOGW(TAG, "restarted by the hardware watchdog");
+    }
+}
+
+esp_err_t liveness_setup(void)
+{
+    liveness_report_last_hang();
+
+    // above the input task, so a busy loop there cannot starve the supervisor
+    if (xTaskCreate(supervisor_task, "liveness_task", 2048, nullptr, 12, &supervisor) != pdPASS)
+    {
+        return ESP_FAIL;
+    }
+
+    return ESP_OK;
+}
+
+void liveness_watch(liveness_task task, liveness_pending_fn pending_since)
+{
+    watched[task].checkin_at = esp_timer_get_time();
+    watched[task].pending_since = pending_since;
+}
+
+void liveness_checkin(liveness_task task)
+{
+    int64_t now = esp_timer_get_time();
+
+    portENTER_CRITICAL();
+    watched[task].checkin_at = now;
+    portEXIT_CRITICAL();
+
+    liveness_kick();
+}
+
+void liveness_kick(void)
+{
+    if (supervisor != nullptr)
+    {
+        xTaskNotifyGive(supervisor);
+    }
+}
+
+void IRAM_ATTR liveness_kick_from_isr(void)
+{
+    if (supervisor != nullptr)
+    {
+        vTaskNotifyGiveFromISR(supervisor, nullptr);
+    }
+}
@@ -0,0 +1,37 @@
+#ifndef LIVENESS_HPP_INCLUDED
+#define LIVENESS_HPP_INCLUDED
+
+#include <stdint.h>
+
+#include "esp_err.h"
+
+// Software watchdog for the tasks the light depends on. A task checks in
+// whenever it picks up or finishes work and counts as hung only while it
+// has work pending and stops checking in. The supervisor sleeps until some
+// work would turn overdue and is woken early by check-ins and kicks, so a
+// healthy light costs it no wakeups of its own.
+
+enum liveness_task
+{
+    LIVENESS_INPUT, // GPIO event task, runs every FSM dispatch
+    LIVENESS_TIMER, // esp_timer task, runs the deadline timer
+    LIVENESS_TASKS,
+};
+
+// Since when a task has work waiting, in esp_timer microseconds and in the
+// future for work scheduled later; 0 while it has none.
+typedef int64_t (*liveness_pending_fn)(void);
+
+// Restarts with a diagnostic left in NVS when a task stays hung for
+// CONFIG_POMODORO_LIVENESS_TIMEOUT_SECONDS. Logs the diagnostic of the
+// previous restart, if any.
+esp_err_t liveness_setup(void);
+
+void liveness_watch(liveness_task task, liveness_pending_fn pending_since);
+void liveness_checkin(liveness_task task);
+
+// New work for a watched task, e.g. a queued input or an armed timer.
+void liveness_kick(void);
+void liveness_kick_from_isr(void);
+
+#endif /* LIVENESS_HPP_INCLUDED */
@@ -16,7 +16,61 @@
 #include "nvs.h"
 #include "nvs_flash.h"
 
-#include "tinyfsm.hpp"
+#include "pomodoro.hpp"
+#include "pomodoro_fsm.hpp"
+#include "clock.hpp"
+#include "tz.hpp"
+#include "provision.hpp"
+#include "blink.hpp"
+#include "energy.hpp"
+#include "journal.hpp"
+#include "tags.hpp"
+#include "busy.hpp"
+#if CONFIG_POMODORO_HISTORY_ENABLE
+#include "history.hpp"
+#endif
+#if CONFIG_POMODORO_HTTP_ENABLE
+#include "web.hpp"
+#endif
+#if CONFIG_POMODORO_SYSLOG_ENABLE
+#include "syslog.hpp"
+#endif
+#if CONFIG_POMODORO_CALENDAR_ENABLE
+#include "calendar.hpp"
+#endif
+#if CONFIG_POMODORO_SELFTEST_ENABLE
+#include "selftest.hpp"
+#endif
+#if CONFIG_POMODORO_CONSOLE_ENABLE
+#include "console.hpp"
+#endif
+#if CONFIG_POMODORO_FUZZ_COMMAND
+#include "fuzz.hpp"
+#endif
+#if CONFIG_POMODORO_HEAP_TRACK_ENABLE
+#include "heap_track.hpp"
+#endif
+#if CONFIG_POMODORO_LIVENESS_ENABLE
+#include "liveness.hpp"
+#endif
+#if CONFIG_POMODORO_EPAPER_ENABLE
+#include "epaper.hpp"
+#endif
+#if CONFIG_POMODORO_PRESENCE_ENABLE
+#include "presence.hpp"
+#endif
+#if CONFIG_POMODORO_HINT_ENABLE
+#include "hint.hpp"
+#endif
+#if CONFIG_POMODORO_ENCODER_ENABLE
+#include "encoder.hpp"
+#endif
+#if CONFIG_POMODORO_EXPANDER_ENABLE
+#include "expander.hpp"
+#endif
+#if CONFIG_POMODORO_ENV_ENABLE
+#include "environment.hpp"
+#endif
 
 static const char *TAG = "pomodoro";
 
@@ -38,45 +92,53 @@ static const char *TAG = "pomodoro";
 #define GPIO_LIGHT_YELLOW GPIO_NUM_12
 #define GPIO_LIGHT_RED GPIO_NUM_14
 
-// #define LONG_BREAK_ENABLE 1
+// Each enabled feature needs pins of its own, overlapping settings stop the build.
+static constexpr int pins_in_use[] = {
+    GPIO_ACTION_BUTTON,
+    GPIO_LIGHT_GREEN,
+    GPIO_LIGHT_YELLOW,
+    GPIO_LIGHT_RED,
+#if CONFIG_POMODORO_EPAPER_ENABLE
+    CONFIG_POMODORO_EPAPER_CLK_GPIO,
+    CONFIG_POMODORO_EPAPER_MOSI_GPIO,
+    CONFIG_POMODORO_EPAPER_DC_GPIO,
+    CONFIG_POMODORO_EPAPER_RST_GPIO,
+    CONFIG_POMODORO_EPAPER_BUSY_GPIO,
+#endif
+#if CONFIG_POMODORO_PRESENCE_ENABLE
+    CONFIG_POMODORO_PRESENCE_GPIO,
+#endif
+#if CONFIG_POMODORO_ENCODER_ENABLE
+    CONFIG_POMODORO_ENCODER_A_GPIO,
+    CONFIG_POMODORO_ENCODER_B_GPIO,
+#endif
+#if CONFIG_POMODORO_EXPANDER_ENABLE
+    CONFIG_POMODORO_EXPANDER_INT_GPIO,
+#endif
+#if CONFIG_POMODORO_I2C_ENABLE
+    CONFIG_POMODORO_I2C_SDA_GPIO,
+    CONFIG_POMODORO_I2C_SCL_GPIO,
+#endif
+};
 
-esp_err_t wifi_connect(void);
+static constexpr size_t pins_count = sizeof(pins_in_use) / sizeof(pins_in_use[0]);
 
-extern "C"
+static constexpr bool pins_are_distinct(size_t i, size_t j)
 {
-    void app_main(void);
+    return i + 1 >= pins_count ? true
+           : j >= pins_count   ? pins_are_distinct(i + 1, i + 2)
+                               : pins_in_use[i] != pins_in_use[j] && pins_are_distinct(i, j + 1);
 }
 
-struct Off; // forward declaration
-struct Idle;
-struct Work;
-struct ShortBreak;
-struct LongBreak;
-struct LongBreakLastMinutes;
+static_assert(pins_are_distinct(0, 1), "two enabled features are set to the same GPIO");
 
-// Triggered when the timer is ready to start.
-struct TimerReady : tinyfsm::Event
-{
-};
-// Triggered to start the work period.
-struct StartTimer : tinyfsm::Event
-{
-};
-// Triggered to check the timer.
-struct CheckTimer : tinyfsm::Event
-{
-};
-// Triggered when the timer finishes counting down.
-struct TimerComplete : tinyfsm::Event
-{
-};
-// Triggered to reset the timer to the initial state.
-struct ResetTimer : tinyfsm::Event
-{
-};
-struct TimerAction : tinyfsm::Event
+esp_err_t wifi_connect(void);
+esp_err_t time_sync_start(void);
+
+extern "C"
 {
-};
+    void app_main(void);
+}
 
 static TimerReady timer_ready_event;
 static StartTimer start_timer_event;
@@ -84,400 +146,138 @@ static CheckTimer check_timer_event;
 static TimerComplete timer_complete_event;
 static ResetTimer reset_timer_event;
 static TimerAction timer_action_event;
+static PresenceLost presence_lost_event;
+static PresenceReturned presence_returned_event;
+static BreakSuggested break_suggested_event;
+static AdjustPeriod adjust_period_event;
+static MarkInterruption mark_interruption_event;
+static CalendarChanged calendar_changed_event;
+static BusyChanged busy_changed_event;
+
+static instance_fsm::Machine<Pomodoro> pomodoro_fsm;
+
+static esp_timer_handle_t deadline_timer;
+static esp_timer_handle_t feedback_timer;
+static volatile bool led_feedback_active = false;
+static int32_t led_feedback_steps = 0;
+static QueueHandle_t gpio_evt_queue = nullptr;
+static volatile bool input_is_busy = false;
 
-struct Pomodoro : tinyfsm::Fsm<Pomodoro>
-{
-    static constexpr int64_t WORK_PERIOD_SECONDS = 45 * 60;
-    static constexpr int64_t SHORT_BREAK_PERIOD_SECONDS = 15 * 60;
-    static constexpr int64_t LONG_BREAK_PERIOD_SECONDS = 30 * 60;
-    static constexpr int64_t LONG_BREAK_AFTER = 4;
-
-    virtual void react(StartTimer const &) {};
-    virtual void react(TimerComplete const &) {};
-    virtual void react(ResetTimer const &) = 0;
-    virtual void react(TimerReady const &) {};
-    virtual void react(CheckTimer const &) {};
-    virtual void react(TimerAction const &) {};
-
-    virtual void entry(void) {};
-
-    void exit(void) {};
-
-private:
-    size_t short_breaks;
-    size_t long_breaks;
-    int64_t counting_started_at;
-    int64_t pause_started_at;
-    bool timer_active;
-
-public:
-    void start_counting()
-    {
-        if (this->timer_active)
-        {
-            return;
-        }
-        if (this->pause_started_at > 0)
-        {
-            int64_t time_since_boot = esp_timer_get_time();
-
-            this->counting_started_at += time_since_boot - this->pause_started_at;
-            this->pause_started_at = 0;
-            this->timer_active = true;
-
-            ESP_LOGI(TAG, "pomodoro timer resumed counting at %" PRIu64 " sec", time_since_boot / 1000000);
-            return;
-        }
-
-        int64_t time_since_boot = esp_timer_get_time();
-
-        this->counting_started_at = time_since_boot;
-        this->pause_started_at = 0;
-        this->timer_active = true;
-
-        ESP_LOGI(TAG, "pomodoro timer started counting at %" PRIu64 " sec", time_since_boot / 1000000);
-        return;
-    };
-
-    void pause_counting()
-    {
-        if (!this->timer_active)
-        {
-            ESP_LOGI(TAG, "pomodoro timer cannot pause, not counting");
-            return;
-        }
-
-        int64_t time_since_boot = esp_timer_get_time();
-
-        this->timer_active = false;
-        this->pause_started_at = time_since_boot;
-
-        ESP_LOGI(TAG, "pomodoro timer paused counting at %" PRIu64 " sec", this->get_counting_seconds());
-    };
-
-    void reset_counting()
-    {
-        this->counting_started_at = 0;
-        this->pause_started_at = 0;
-        this->timer_active = false;
-
-        ESP_LOGI(TAG, "pomodoro timer reset");
-    };
-
-    void reset_short_breaks()
-    {
-        this->short_breaks = 0;
-    };
-
-    int64_t get_counting_seconds()
-    {
-        if (this->pause_started_at > 0)
-        {
-            return (this->pause_started_at - this->counting_started_at) / 1000000;
-        }
-        if (this->counting_started_at > 0)
-        {
-            int64_t time_since_boot = esp_timer_get_time();
-            int64_t elapsed_time_in_seconds = time_since_boot - this->counting_started_at;
-            return elapsed_time_in_seconds / 1000000;
-        }
-
-        return 0;
-    };
-
-    bool is_timer_active()
-    {
-        return this->timer_active;
-    };
-
-    bool is_paused()
-    {
-        return this->pause_started_at > 0;
-    };
+static void deadline_timer_callback(void *arg);
+static void feedback_timer_callback(void *arg);
+static void IRAM_ATTR gpio_isr_handler(void *arg);
+static void gpio_handle_evt_from_isr(void *arg);
+#if CONFIG_POMODORO_LIVENESS_ENABLE
+static int64_t input_pending_since(void);
+#endif
+static void pomodoro_refresh(void);
+static pomodoro_status pomodoro_read_status(void);
+static void led_visualize(const pomodoro_status &status);
+static void led_feedback(int32_t steps);
 
-    bool is_started()
-    {
-        return this->counting_started_at > 0;
-    };
+static esp_err_t start_timer()
+{
+    pomodoro_fsm.dispatch(timer_ready_event);
+    pomodoro_fsm.dispatch(start_timer_event);
 
-    void add_short_break()
-    {
-        this->short_breaks++;
-    };
+    esp_timer_create_args_t deadline_timer_args = {};
 
-    void add_long_break()
-    {
-        this->long_breaks++;
-    };
+    deadline_timer_args.callback = &deadline_timer_callback;
+    deadline_timer_args.name = "deadline_timer";
 
-    size_t get_short_breaks()
-    {
-        return this->short_breaks;
-    };
+    ESP_ERROR_CHECK(esp_timer_create(&deadline_timer_args, &deadline_timer));
 
-    size_t get_long_breaks()
-    {
-        return this->long_breaks;
-    };
+    esp_timer_create_args_t feedback_timer_args = {};
 
-    size_t get_short_breaks_left()
-    {
-        return Pomodoro::LONG_BREAK_AFTER - this->short_breaks;
-    };
-};
+    feedback_timer_args.callback = &feedback_timer_callback;
+    feedback_timer_args.name = "feedback_timer";
 
-constexpr int64_t Pomodoro::WORK_PERIOD_SECONDS;
-constexpr int64_t Pomodoro::SHORT_BREAK_PERIOD_SECONDS;
-constexpr int64_t Pomodoro::LONG_BREAK_PERIOD_SECONDS;
-constexpr int64_t Pomodoro::LONG_BREAK_AFTER;
+    ESP_ERROR_CHECK(esp_timer_create(&feedback_timer_args, &feedback_timer));
 
-// ----------------------------------------------------------------------------
-// 3. State Declarations
-//
-// The off state where the timer is completely stopped.
-struct Off : Pomodoro
-{
-    void entry() override
-    {
-        ESP_LOGI(TAG, "starting timer");
-    };
-    void react(ResetTimer const &) override
-    {
-        ESP_LOGI(TAG, "timer not ready");
-    };
-    void react(TimerReady const &) override
-    {
-        ESP_LOGI(TAG, "got timer ready event");
+    ESP_ERROR_CHECK(blink_setup());
 
-        return transit<Idle>();
-    };
+    return ESP_OK;
+}
 
-public:
-};
+#if CONFIG_POMODORO_LIVENESS_ENABLE
+// When the armed deadline is due, 0 while disarmed. The deadline doubles as
+// the liveness probe of the esp_timer task.
+static int64_t deadline_due_at = 0;
 
-// The initial state where the timer is ready to start.
-struct Idle : Pomodoro
+static int64_t deadline_pending_since(void)
 {
-    void entry() override
-    {
-        this->reset_counting();
-        ESP_LOGI(TAG, "timer is ready, idle");
-    };
-    void react(ResetTimer const &) override { return transit<Work>(); };
+    portENTER_CRITICAL();
+    int64_t due_at = deadline_due_at;
+    portEXIT_CRITICAL();
 
-    void react(StartTimer const &) override { return transit<Work>(); };
-
-    void react(TimerAction const &) override { return transit<Work>(); };
-};
+    return due_at;
+}
 
-// The state where the timer is counting down the work period.
-struct Work : Pomodoro
+static void deadline_set_due(int64_t due_at)
 {
-    void entry() override
-    {
-        this->reset_counting();
-        ESP_LOGI(TAG, "let's get to work");
-    };
-    void react(ResetTimer const &) override { return transit<Idle>(); };
-
-    void react(CheckTimer const &) override
-    {
-        if (!this->is_timer_active())
-        {
-            return;
-        }
-
-        int64_t elapsed_time_in_seconds = this->get_counting_seconds();
-        if (elapsed_time_in_seconds < Pomodoro::WORK_PERIOD_SECONDS)
-        {
-            ESP_LOGI(TAG, "work time left: %" PRIu64 " sec", Pomodoro::WORK_PERIOD_SECONDS - elapsed_time_in_seconds);
-            return;
-        }
-
-#ifdef LONG_BREAK_ENABLE
-        bool is_last_work = this->get_short_breaks_left() == 0;
-        if (is_last_work)
-        {
-            transit<LongBreak>();
-        }
-        else
+    portENTER_CRITICAL();
+    deadline_due_at = due_at;
+    portEXIT_CRITICAL();
+}
 #endif
-        {
-            transit<ShortBreak>();
-        }
-    };
 
-    void react(TimerAction const &) override
-    {
-        if (!this->is_started())
-        {
-            this->start_counting();
-            return;
-        }
-
-        if (this->is_paused())
-        {
-            this->start_counting();
-            return;
-        }
-
-        this->pause_counting();
-    };
-};
-// The state where the timer is counting down a short break period.
-struct ShortBreak : Pomodoro
+// Nothing ticks while a period runs: the timer is armed once for the moment
+// the running period is over and stays disarmed while idle or paused.
+static void deadline_timer_callback(void *arg)
 {
-    void entry() override
-    {
-        this->reset_counting();
-        this->add_short_break();
-        ESP_LOGI(TAG, "short break, amount left: %" PRIu32 "", this->get_short_breaks_left());
-    };
-    void react(ResetTimer const &) override { transit<Idle>(); };
-
-    void react(CheckTimer const &) override
-    {
-        if (!this->is_timer_active())
-        {
-            return;
-        }
-
-        int64_t elapsed_time_in_seconds = this->get_counting_seconds();
-        if (elapsed_time_in_seconds < Pomodoro::SHORT_BREAK_PERIOD_SECONDS)
-        {
-            ESP_LOGI(TAG, "short break time left: %" PRIu64 " sec", Pomodoro::SHORT_BREAK_PERIOD_SECONDS - elapsed_time_in_seconds);
-            return;
-        }
-
-        transit<Work>();
-    };
-
-    void react(TimerAction const &) override
-    {
-        if (!this->is_started())
-        {
-            this->start_counting();
-            return;
-        }
+#if CONFIG_POMODORO_LIVENESS_ENABLE
+    deadline_set_due(0);
+    liveness_checkin(LIVENESS_TIMER);
+#endif
+    pomodoro_post_input(INPUT_CHECK_TIMER);
+}
 
-        transit<Work>();
-    };
-};
-// The state where the timer is counting down a long break period.
-struct LongBreak : Pomodoro
+static void feedback_timer_callback(void *arg)
 {
-    void entry() override
-    {
-        this->reset_counting();
-        this->reset_short_breaks();
-        this->add_long_break();
-        ESP_LOGI(TAG, "long break, amount taken: %" PRIu32 "", this->get_long_breaks());
-    };
-    void react(ResetTimer const &) override { transit<Idle>(); };
-
-    void react(CheckTimer const &) override
-    {
-        if (!this->is_timer_active())
-        {
-            return;
-        }
-
-        int64_t elapsed_time_in_seconds = this->get_counting_seconds();
-        if (elapsed_time_in_seconds < Pomodoro::LONG_BREAK_PERIOD_SECONDS - Pomodoro::SHORT_BREAK_PERIOD_SECONDS)
-        {
-            ESP_LOGI(TAG, "long break time left: %" PRIu64 " sec", Pomodoro::LONG_BREAK_PERIOD_SECONDS - elapsed_time_in_seconds);
-            return;
-        }
-
-        transit<LongBreakLastMinutes>();
-    };
-
-    void react(TimerAction const &) override
-    {
-        if (!this->is_started())
-        {
-            this->start_counting();
-            return;
-        }
+    led_feedback_active = false;
+    pomodoro_post_input(INPUT_CHECK_TIMER);
+}
 
-        transit<Work>();
-    };
-};
-// The state where the timer is counting down last minutes of the long break period.
-struct LongBreakLastMinutes : Pomodoro
+static void deadline_schedule(const pomodoro_status &status)
 {
-    void entry() override
-    {
-        ESP_LOGI(TAG, "long break last minutes");
-    };
-    void react(ResetTimer const &) override { transit<Idle>(); };
-
-    void react(CheckTimer const &) override
-    {
-        if (!this->is_timer_active())
-        {
-            return;
-        }
-
-        int64_t elapsed_time_in_seconds = this->get_counting_seconds();
-        if (elapsed_time_in_seconds < Pomodoro::LONG_BREAK_PERIOD_SECONDS)
-        {
-            ESP_LOGI(TAG, "long break time left, it's last minutes: %" PRIu64 "", Pomodoro::LONG_BREAK_PERIOD_SECONDS - elapsed_time_in_seconds);
-            return;
-        }
-
-        transit<Work>();
-    };
+    esp_timer_stop(deadline_timer);
+#if CONFIG_POMODORO_LIVENESS_ENABLE
+    deadline_set_due(0);
+#endif
 
-    void react(TimerAction const &) override
+    if (!status.is_started || status.is_paused)
     {
-        if (!this->is_started())
-        {
-            this->start_counting();
-            return;
-        }
-
-        transit<Work>();
-    };
-};
-
-FSM_INITIAL_STATE(Pomodoro, Off)
-using fsm_handle = Pomodoro;
-
-static esp_timer_handle_t periodic_timer;
-static QueueHandle_t gpio_evt_queue = nullptr;
-
-static void periodic_timer_callback(void *arg);
-static void IRAM_ATTR gpio_isr_handler(void *arg);
-static void gpio_handle_evt_from_isr(void *arg);
-static void led_visualize(int64_t time_since_boot);
-
-static esp_err_t start_timer()
-{
-    fsm_handle::dispatch(timer_ready_event);
-    fsm_handle::dispatch(start_timer_event);
-
-    esp_timer_create_args_t periodic_timer_args = {};
-
-    periodic_timer_args.callback = &periodic_timer_callback;
-    periodic_timer_args.name = "dispatch_timer";
-
-    ESP_ERROR_CHECK(esp_timer_create(&periodic_timer_args, &periodic_timer));
-
-    /* Start the timers */
-    ESP_ERROR_CHECK(esp_timer_start_periodic(periodic_timer, 500000));
+        return;
+    }
 
-    return ESP_OK;
+    int64_t real_us = clock_to_real(pomodoro_next_check(status, pomodoro_fsm.state()->context)).count();
+    esp_timer_start_once(deadline_timer, real_us);
+#if CONFIG_POMODORO_LIVENESS_ENABLE
+    deadline_set_due(esp_timer_get_time() + real_us);
+    liveness_kick();
+#endif
 }
 
-static void periodic_timer_callback(void *arg)
+// The FSM is only safe to look at from the input task, other tasks get the
+// copy it publishes after each dispatch.
+static pomodoro_status published_status = {};
+static time_point published_at;
+
+// Brings every output in line with the FSM, called after each dispatch.
+static void pomodoro_refresh(void)
 {
-    int64_t time_since_boot = esp_timer_get_time();
-    ESP_LOGI(TAG, "periodic timer called, time since boot: %" PRIu64 " sec", time_since_boot / 1000000);
+    pomodoro_status status = pomodoro_read_status();
 
-    fsm_handle::dispatch(check_timer_event);
+    portENTER_CRITICAL();
+    published_status = status;
+    published_at = clock_now();
+    portEXIT_CRITICAL();
 
-    led_visualize(time_since_boot);
+    led_visualize(status);
+    deadline_schedule(status);
+#if CONFIG_POMODORO_EPAPER_ENABLE
+    epaper_show(status);
+#endif
 }
 
 static esp_err_t gpio_setup()
@@ -505,12 +305,19 @@ static esp_err_t gpio_setup()
     gpio_evt_queue = xQueueCreate(10, sizeof(uint32_t));
     // start gpio task
     xTaskCreate(gpio_handle_evt_from_isr, "gpio_handle_evt_from_isr", 2048, nullptr, 10, nullptr);
+#if CONFIG_POMODORO_LIVENESS_ENABLE
+    liveness_watch(LIVENESS_INPUT, input_pending_since);
+    liveness_watch(LIVENESS_TIMER, deadline_pending_since);
+#endif
 
     // install gpio isr service
     gpio_install_isr_service(ESP_INTR_FLAG_DEFAULT);
     // hook isr handler for specific gpio pin
     gpio_isr_handler_add(GPIO_ACTION_BUTTON, gpio_isr_handler, (void *)(GPIO_ACTION_BUTTON));
 
+    // first refresh of the outputs, from the task that owns them from now on
+    pomodoro_post_input(INPUT_CHECK_TIMER);
+
     return ESP_OK;
 }
 
@@ -518,156 +325,422 @@ static void IRAM_ATTR gpio_isr_handler(void *arg)
 {
     uint32_t gpio_num = (uint32_t)arg;
     xQueueSendFromISR(gpio_evt_queue, &gpio_num, nullptr);
+#if CONFIG_POMODORO_LIVENESS_ENABLE
+    liveness_kick_from_isr();
+#endif
+}
+
+bool pomodoro_post_input(uint32_t input)
+{
+    bool is_queued = xQueueSend(gpio_evt_queue, &input, 0) == pdTRUE;
+#if CONFIG_POMODORO_LIVENESS_ENABLE
+    liveness_kick();
+#endif
+    return is_queued;
+}
+
+bool IRAM_ATTR pomodoro_post_input_from_isr(uint32_t input)
+{
+    bool is_queued = xQueueSendFromISR(gpio_evt_queue, &input, nullptr) == pdTRUE;
+#if CONFIG_POMODORO_LIVENESS_ENABLE
+    liveness_kick_from_isr();
+#endif
+    return is_queued;
 }
 
+#if CONFIG_POMODORO_LIVENESS_ENABLE
+// Only touched by the liveness supervisor, which the kicks above wake up.
+static int64_t input_pending_at = 0;
+
+// Work is pending while an event is being handled or waits in the queue,
+// since the supervisor first saw it.
+static int64_t input_pending_since(void)
+{
+    if (!input_is_busy && uxQueueMessagesWaiting(gpio_evt_queue) == 0)
+    {
+        input_pending_at = 0;
+        return 0;
+    }
+    if (input_pending_at == 0)
+    {
+        input_pending_at = esp_timer_get_time();
+    }
+    return input_pending_at;
+}
+#endif
+
 static void gpio_handle_evt_from_isr(void *arg)
 {
     uint32_t gpio_num;
-    static int64_t last_isr_time = 0;
-    const int64_t debounce_time = 200000; // 200 ms debounce time
+    static time_point last_isr_time;
+    const microseconds debounce_time = time_units::milliseconds(200);
 
     for (;;)
     {
+        // cleared here, so the debounce shortcut cannot leave it set
+        input_is_busy = false;
+#if CONFIG_POMODORO_LIVENESS_ENABLE
+        // going idle is progress too, it lets the supervisor sleep again
+        liveness_checkin(LIVENESS_INPUT);
+#endif
+
         if (xQueueReceive(gpio_evt_queue, &gpio_num, portMAX_DELAY))
         {
-            int64_t current_time = esp_timer_get_time();
-            if (current_time - last_isr_time < debounce_time)
-            {
-                continue; // Ignore the event if it's within the debounce time
-            }
-            last_isr_time = current_time;
-
             ESP_LOGI(TAG, "GPIO[%" PRIu32 "] evt received", gpio_num);
+            energy_count_wakeup();
+#if CONFIG_POMODORO_LIVENESS_ENABLE
+            liveness_checkin(LIVENESS_INPUT);
+#endif
+            input_is_busy = true;
             switch (gpio_num)
             {
             case GPIO_ACTION_BUTTON:
-                fsm_handle::dispatch(timer_action_event);
+            {
+                // debouncing is about contacts, not the timer, so it stays on real time
+                time_point current_time = time_point(microseconds(esp_timer_get_time()));
+                if (current_time - last_isr_time < debounce_time)
+                {
+                    continue; // Ignore the event if it's within the debounce time
+                }
+                last_isr_time = current_time;
+
+                pomodoro_fsm.dispatch(timer_action_event);
+                break;
+            }
+#if CONFIG_POMODORO_PRESENCE_ENABLE
+            case INPUT_PRESENCE_EDGE:
+                presence_handle_edge();
+                break;
+#endif
+            case INPUT_PRESENCE_LOST:
+                pomodoro_fsm.dispatch(presence_lost_event);
+                break;
+            case INPUT_PRESENCE_RETURNED:
+                pomodoro_fsm.dispatch(presence_returned_event);
+                break;
+            case INPUT_BREAK_SUGGESTED:
+                pomodoro_fsm.dispatch(break_suggested_event);
+                break;
+            case INPUT_TIMER_ACTION:
+                pomodoro_fsm.dispatch(timer_action_event);
+                break;
+            case INPUT_TIMER_START:
+                pomodoro_fsm.dispatch(start_timer_event);
+                break;
+            case INPUT_TIMER_RESET:
+                pomodoro_fsm.dispatch(reset_timer_event);
+                break;
+#if CONFIG_POMODORO_EXPANDER_ENABLE
+            case INPUT_EXPANDER_CHANGED:
+                expander_scan();
+                break;
+#endif
+#if CONFIG_POMODORO_ENCODER_ENABLE
+            case INPUT_ENCODER_TURNED:
+            {
+                int32_t steps = encoder_take_steps();
+                if (steps == 0)
+                {
+                    break;
+                }
+
+                adjust_period_event.delta = minutes(steps * CONFIG_POMODORO_ENCODER_STEP_MINUTES);
+                pomodoro_fsm.dispatch(adjust_period_event);
+                led_feedback(steps);
+                break;
+            }
+#endif
+            case INPUT_CHECK_TIMER:
+                pomodoro_fsm.dispatch(check_timer_event);
+                break;
+            case INPUT_MARK_INTERNAL:
+            case INPUT_MARK_EXTERNAL:
+                mark_interruption_event.is_external = gpio_num == INPUT_MARK_EXTERNAL;
+                pomodoro_fsm.dispatch(mark_interruption_event);
+                break;
+            case INPUT_CALENDAR_BUSY:
+            case INPUT_CALENDAR_FREE:
+                calendar_changed_event.is_busy = gpio_num == INPUT_CALENDAR_BUSY;
+                pomodoro_fsm.dispatch(calendar_changed_event);
+                break;
+            case INPUT_BUSY_ON:
+            case INPUT_BUSY_OFF:
+            case INPUT_BUSY_TOGGLE:
+                busy_changed_event.is_busy = gpio_num == INPUT_BUSY_TOGGLE ? !pomodoro_fsm.state()->context.busy : gpio_num == INPUT_BUSY_ON;
+                pomodoro_fsm.dispatch(busy_changed_event);
                 break;
             default:
                 break;
             }
+
+#if CONFIG_POMODORO_ENV_ENABLE
+            // already awake, so reading the sensor costs no extra wakeup
+            environment_sample_if_due();
+#endif
+#if CONFIG_POMODORO_HEAP_TRACK_ENABLE
+            heap_track_sample_if_due();
+#endif
+            pomodoro_refresh();
         }
     }
 }
 
-static void led_visualize(int64_t time_since_boot)
+pomodoro_status pomodoro_get_status(void)
 {
-    enum led_state
+    portENTER_CRITICAL();
+    pomodoro_status status = published_status;
+    time_point at = published_at;
+    portEXIT_CRITICAL();
+
+    // the copy may be a while old, a running period has gone on since
+    if (status.is_started && !status.is_paused)
     {
-        OFF,
-        IDLE,
-        WORK,
-        SHORT_BREAK,
-#ifdef LONG_BREAK_ENABLE
-        LONG_BREAK,
-        LONG_BREAK_LAST_MINUTES,
-#endif
-    };
-    led_state state = OFF;
-    state = fsm_handle::is_in_state<Idle>() ? IDLE : state;
-    state = fsm_handle::is_in_state<Work>() ? WORK : state;
-    state = fsm_handle::is_in_state<ShortBreak>() ? SHORT_BREAK : state;
+        status.seconds_left -= duration_cast<seconds>(clock_now() - at).count();
+    }
+    return status;
+}
 
-#ifdef LONG_BREAK_ENABLE
-    state = fsm_handle::is_in_state<LongBreak>() ? LONG_BREAK : state;
-    state = fsm_handle::is_in_state<LongBreakLastMinutes>() ? LONG_BREAK_LAST_MINUTES : state;
+static pomodoro_status pomodoro_read_status(void)
+{
+    pomodoro_status status = pomodoro_fsm_status(pomodoro_fsm);
+#if CONFIG_POMODORO_ENV_ENABLE
+    status.needs_air = environment_needs_air();
 #endif
+    return status;
+}
 
-    bool is_paused = Pomodoro::current_state_ptr->is_paused();
-    bool is_started = Pomodoro::current_state_ptr->is_started();
+// Acknowledges a period adjustment for a second: yellow with red for longer,
+// yellow with green for shorter. The refresh after the timer restores the LEDs.
+static void led_feedback(int32_t steps)
+{
+    led_feedback_steps = steps;
+    led_feedback_active = true;
 
-    int64_t seconds_since_boot = time_since_boot / 1000000;
-    bool is_even = seconds_since_boot % 2 == 0;
-    uint32_t led_on = 0;
-    uint32_t led_off = 1;
-    uint32_t led_blink = is_even ? led_on : led_off;
+    esp_timer_stop(feedback_timer);
+    esp_timer_start_once(feedback_timer, microseconds(seconds(1)).count());
+}
+
+enum led_mode
+{
+    LED_OFF,
+    LED_ON,
+    LED_BLINK,
+};
+
+// LEDs are active low. Blinking ones are handed over to the blink timer which
+// toggles them on its own, the CPU only comes back here on the next change.
+static void led_show(led_mode red, led_mode yellow, led_mode green)
+{
+    const gpio_num_t pins[] = {GPIO_LIGHT_RED, GPIO_LIGHT_YELLOW, GPIO_LIGHT_GREEN};
+    const led_mode modes[] = {red, yellow, green};
+    uint32_t blink_mask = 0;
+    uint32_t lit = 0;
+    uint32_t blinking = 0;
+
+    for (size_t i = 0; i < sizeof(pins) / sizeof(pins[0]); i++)
+    {
+        if (modes[i] == LED_BLINK)
+        {
+            blink_mask |= 1 << pins[i];
+            blinking++;
+        }
+        if (modes[i] == LED_ON)
+        {
+            lit++;
+        }
+    }
+
+    energy_leds_changed(lit, blinking);
+
+    // take pins back from the blink timer before setting them
+    blink_set(blink_mask);
+
+    for (size_t i = 0; i < sizeof(pins) / sizeof(pins[0]); i++)
+    {
+        if (modes[i] != LED_BLINK)
+        {
+            gpio_set_level(pins[i], modes[i] == LED_ON ? 0 : 1);
+        }
+    }
+}
+
+static void led_visualize(const pomodoro_status &status)
+{
+    bool is_paused = status.is_paused;
+    bool is_started = status.is_started;
 
-    switch (state)
+    if (led_feedback_active)
     {
-    case OFF:
-        gpio_set_level(GPIO_LIGHT_RED, led_on);
-        gpio_set_level(GPIO_LIGHT_YELLOW, led_on);
-        gpio_set_level(GPIO_LIGHT_GREEN, led_on);
+        led_show(led_feedback_steps > 0 ? LED_ON : LED_OFF, LED_ON, led_feedback_steps < 0 ? LED_ON : LED_OFF);
         return;
-    case IDLE:
-        gpio_set_level(GPIO_LIGHT_RED, led_off);
-        gpio_set_level(GPIO_LIGHT_YELLOW, led_blink);
-        gpio_set_level(GPIO_LIGHT_GREEN, led_off);
+    }
+
+    // steady, so the override adds no blink wakeups
+    if (status.is_busy)
+    {
+        led_show(LED_ON, LED_OFF, LED_ON);
+        return;
+    }
+
+    switch (status.phase)
+    {
+    case PHASE_OFF:
+        led_show(LED_ON, LED_ON, LED_ON);
+        return;
+    case PHASE_IDLE:
+        led_show(LED_OFF, LED_BLINK, LED_OFF);
         return;
-    case WORK:
+    case PHASE_WORK:
         if (!is_started)
         {
-            gpio_set_level(GPIO_LIGHT_RED, led_on);
-            gpio_set_level(GPIO_LIGHT_YELLOW, led_on);
-            gpio_set_level(GPIO_LIGHT_GREEN, led_off);
+            led_show(LED_ON, LED_ON, LED_OFF);
             return;
         }
         if (is_paused)
         {
-            gpio_set_level(GPIO_LIGHT_RED, led_off);
-            gpio_set_level(GPIO_LIGHT_YELLOW, led_blink);
-            gpio_set_level(GPIO_LIGHT_GREEN, led_on);
+            led_show(LED_OFF, LED_BLINK, LED_ON);
             return;
         }
-        gpio_set_level(GPIO_LIGHT_RED, led_off);
-        gpio_set_level(GPIO_LIGHT_YELLOW, led_off);
-        gpio_set_level(GPIO_LIGHT_GREEN, led_on);
+        led_show(LED_OFF, LED_OFF, LED_ON);
         return;
 
-    case SHORT_BREAK:
+    case PHASE_SHORT_BREAK:
 #ifdef LONG_BREAK_ENABLE
         if (!is_started)
         {
-            gpio_set_level(GPIO_LIGHT_RED, led_off);
-            gpio_set_level(GPIO_LIGHT_YELLOW, led_on);
-            gpio_set_level(GPIO_LIGHT_GREEN, led_on);
+            led_show(LED_OFF, LED_ON, LED_ON);
             return;
         }
-        gpio_set_level(GPIO_LIGHT_RED, led_blink);
-        gpio_set_level(GPIO_LIGHT_YELLOW, led_off);
-        gpio_set_level(GPIO_LIGHT_GREEN, led_off);
+        // blinking yellow next to the break colour asks for a window
+        led_show(LED_BLINK, status.needs_air ? LED_BLINK : LED_OFF, LED_OFF);
         return;
-    case LONG_BREAK:
+    case PHASE_LONG_BREAK:
 #endif
         if (!is_started)
         {
-            gpio_set_level(GPIO_LIGHT_RED, led_off);
-            gpio_set_level(GPIO_LIGHT_YELLOW, led_on);
-            gpio_set_level(GPIO_LIGHT_GREEN, led_on);
+            led_show(LED_OFF, LED_ON, LED_ON);
             return;
         }
-        gpio_set_level(GPIO_LIGHT_RED, led_on);
-        gpio_set_level(GPIO_LIGHT_YELLOW, led_off);
-        gpio_set_level(GPIO_LIGHT_GREEN, led_off);
+        led_show(LED_ON, status.needs_air ? LED_BLINK : LED_OFF, LED_OFF);
         return;
 #ifdef LONG_BREAK_ENABLE
-    case LONG_BREAK_LAST_MINUTES:
+    case PHASE_LONG_BREAK_LAST_MINUTES:
         if (!is_started)
         {
-            gpio_set_level(GPIO_LIGHT_RED, led_blink);
-            gpio_set_level(GPIO_LIGHT_YELLOW, led_off);
-            gpio_set_level(GPIO_LIGHT_GREEN, led_off);
+            led_show(LED_BLINK, LED_OFF, LED_OFF);
             return;
         }
-        gpio_set_level(GPIO_LIGHT_RED, led_blink);
-        gpio_set_level(GPIO_LIGHT_YELLOW, led_off);
-        gpio_set_level(GPIO_LIGHT_GREEN, led_off);
+        led_show(LED_BLINK, LED_OFF, LED_OFF);
         return;
 #endif
+    default:
+        return;
+    }
+}
+
+// Period lengths from the provisioning bundle, before any task can dispatch.
+static void pomodoro_apply_provisioned_periods(void)
+{
+    const provision_config &provisioned = provision_get();
+    pomodoro_context &context = pomodoro_fsm.state()->context;
+
+    if (provisioned.work_minutes != 0)
+    {
+        context.work_period_seconds = minutes(provisioned.work_minutes);
+    }
+    if (provisioned.short_break_minutes != 0)
+    {
+        context.short_break_period_seconds = minutes(provisioned.short_break_minutes);
+    }
+    if (provisioned.long_break_minutes != 0)
+    {
+        context.long_break_period_seconds = minutes(provisioned.long_break_minutes);
     }
 }
 
 void app_main(void)
 {
-    fsm_handle::start();
+    pomodoro_fsm.start<Off>(initial_context);
 
     ESP_ERROR_CHECK(nvs_flash_init());
+    ESP_ERROR_CHECK(provision_load());
+    ESP_ERROR_CHECK(tz_setup());
+    pomodoro_apply_provisioned_periods();
+#if CONFIG_POMODORO_SELFTEST_ENABLE
+    selftest_run_if_held({GPIO_ACTION_BUTTON, {GPIO_LIGHT_RED, GPIO_LIGHT_YELLOW, GPIO_LIGHT_GREEN}});
+#endif
+#if CONFIG_POMODORO_LIVENESS_ENABLE
+    ESP_ERROR_CHECK(liveness_setup());
+#endif
+#if CONFIG_POMODORO_HISTORY_ENABLE
+    ESP_ERROR_CHECK(history_setup());
+#endif
+#if CONFIG_POMODORO_CONSOLE_ENABLE
+    ESP_ERROR_CHECK(console_setup());
+    ESP_ERROR_CHECK(clock_register_command());
+    ESP_ERROR_CHECK(tz_register_command());
+    ESP_ERROR_CHECK(provision_register_command());
+    ESP_ERROR_CHECK(energy_register_command());
+    ESP_ERROR_CHECK(journal_register_command());
+    ESP_ERROR_CHECK(tags_register_command());
+    ESP_ERROR_CHECK(busy_register_command());
+#if CONFIG_POMODORO_HISTORY_ENABLE
+    ESP_ERROR_CHECK(history_register_command());
+#endif
+#endif
+#if CONFIG_POMODORO_FUZZ_COMMAND
+    ESP_ERROR_CHECK(fuzz_register_command());
+#endif
+#if CONFIG_POMODORO_HEAP_TRACK_ENABLE
+    ESP_ERROR_CHECK(heap_track_setup());
+#if CONFIG_POMODORO_CONSOLE_ENABLE
+    ESP_ERROR_CHECK(heap_track_register_command());
+#endif
+#endif
     ESP_ERROR_CHECK(esp_netif_init());
     ESP_ERROR_CHECK(esp_event_loop_create_default());
+#if CONFIG_POMODORO_SYSLOG_ENABLE
+    ESP_ERROR_CHECK(syslog_setup());
+#if CONFIG_POMODORO_CONSOLE_ENABLE
+    ESP_ERROR_CHECK(syslog_register_command());
+#endif
+#endif
 
     ESP_ERROR_CHECK(wifi_connect());
+    ESP_ERROR_CHECK(time_sync_start());
+#if CONFIG_POMODORO_HTTP_ENABLE
+    ESP_ERROR_CHECK(web_setup());
+#endif
+#if CONFIG_POMODORO_CALENDAR_ENABLE
+    ESP_ERROR_CHECK(calendar_setup());
+#if CONFIG_POMODORO_CONSOLE_ENABLE
+    ESP_ERROR_CHECK(calendar_register_command());
+#endif
+#endif
+#if CONFIG_POMODORO_EPAPER_ENABLE
+    ESP_ERROR_CHECK(epaper_setup());
+#endif
     ESP_ERROR_CHECK(start_timer());
     ESP_ERROR_CHECK(gpio_setup());
+#if CONFIG_POMODORO_PRESENCE_ENABLE
+    ESP_ERROR_CHECK(presence_setup());
+#endif
+#if CONFIG_POMODORO_ENCODER_ENABLE
+    ESP_ERROR_CHECK(encoder_setup());
+#endif
+#if CONFIG_POMODORO_EXPANDER_ENABLE
+    ESP_ERROR_CHECK(expander_setup());
+#endif
+#if CONFIG_POMODORO_ENV_ENABLE
+    ESP_ERROR_CHECK(environment_setup());
+#if CONFIG_POMODORO_CONSOLE_ENABLE
+    ESP_ERROR_CHECK(environment_register_command());
+#endif
+#endif
+
+#if CONFIG_POMODORO_HINT_ENABLE
+    ESP_ERROR_CHECK(hint_setup());
+#endif
 
     esp_wifi_set_ps(DEFAULT_PS_MODE);
 
@@ -0,0 +1,60 @@
+#ifndef POMODORO_HPP_INCLUDED
+#define POMODORO_HPP_INCLUDED
+
+#include <stdint.h>
+
+// Coarse phase of the pomodoro cycle as seen by output subsystems.
+enum pomodoro_phase
+{
+    PHASE_OFF,
+    PHASE_IDLE,
+    PHASE_WORK,
+    PHASE_SHORT_BREAK,
+    PHASE_LONG_BREAK,
+    PHASE_LONG_BREAK_LAST_MINUTES,
+};
+
+// Snapshot of the timer as the input task last published it.
+struct pomodoro_status
+{
+    pomodoro_phase phase;
+    bool is_started;
+    bool is_paused;
+    int64_t seconds_left;
+    uint16_t interruptions; // marked during the current work period
+    bool is_busy;           // busy override on, see busy.hpp
+    bool needs_air;         // CO2 above the ventilate level, see environment.hpp
+};
+
+// Inputs posted to the GPIO event task next to raw GPIO numbers, so the
+// FSM is only ever dispatched from that one task.
+enum pomodoro_input : uint32_t
+{
+    INPUT_PRESENCE_EDGE = 0x100,
+    INPUT_PRESENCE_LOST,
+    INPUT_PRESENCE_RETURNED,
+    INPUT_BREAK_SUGGESTED,
+    INPUT_ENCODER_TURNED,
+    INPUT_EXPANDER_CHANGED,
+    INPUT_TIMER_ACTION,
+    INPUT_TIMER_START,
+    INPUT_TIMER_RESET,
+    INPUT_CHECK_TIMER,
+    INPUT_MARK_INTERNAL,
+    INPUT_MARK_EXTERNAL,
+    INPUT_CALENDAR_BUSY,
+    INPUT_CALENDAR_FREE,
+    INPUT_BUSY_ON,
+    INPUT_BUSY_OFF,
+    INPUT_BUSY_TOGGLE,
+};
+
+// Safe from any task: a copy taken after the latest dispatch, with
+// seconds_left counted on to now.
+pomodoro_status pomodoro_get_status(void);
+
+// Both return false when the input queue is full and the input was dropped.
+bool pomodoro_post_input(uint32_t input);
+bool pomodoro_post_input_from_isr(uint32_t input);
+
+#endif /* POMODORO_HPP_INCLUDED */
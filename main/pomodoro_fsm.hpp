@@ -0,0 +1,711 @@
+#ifndef POMODORO_FSM_HPP_INCLUDED
+#define POMODORO_FSM_HPP_INCLUDED
+
+#include <stddef.h>
+#include <stdint.h>
+#include <inttypes.h>
+
+#include "sdkconfig.h"
+#include "esp_log.h"
+
+#include "instance_fsm.hpp"
+#include "time_units.hpp"
+#include "pomodoro.hpp"
+#include "clock.hpp"
+#include "journal.hpp"
+
+// The pomodoro state machine: its events, the context its states share and
+// the states. Header only like instance_fsm.hpp, so the host tests drive the
+// same states the firmware runs. It defines the constants of Pomodoro, so
+// it goes into one translation unit per program, pomodoro.cpp on the device.
+
+using time_units::duration_cast;
+using time_units::microseconds;
+using time_units::minutes;
+using time_units::seconds;
+using time_units::time_point;
+
+static const char *const POMODORO_TAG = "pomodoro";
+
+// #define LONG_BREAK_ENABLE 1
+
+struct Off; // forward declaration
+struct Idle;
+struct Work;
+struct ShortBreak;
+struct LongBreak;
+struct LongBreakLastMinutes;
+
+// Triggered when the timer is ready to start.
+struct TimerReady : instance_fsm::Event
+{
+};
+// Triggered to start the work period.
+struct StartTimer : instance_fsm::Event
+{
+};
+// Triggered to check the timer.
+struct CheckTimer : instance_fsm::Event
+{
+};
+// Triggered when the timer finishes counting down.
+struct TimerComplete : instance_fsm::Event
+{
+};
+// Triggered to reset the timer to the initial state.
+struct ResetTimer : instance_fsm::Event
+{
+};
+struct TimerAction : instance_fsm::Event
+{
+};
+// Triggered when nobody has been seen around for a while.
+struct PresenceLost : instance_fsm::Event
+{
+};
+// Triggered when somebody shows up again after being away.
+struct PresenceReturned : instance_fsm::Event
+{
+};
+// Triggered when the desktop agent thinks a break is due.
+struct BreakSuggested : instance_fsm::Event
+{
+};
+// Triggered to make the current period longer or shorter.
+struct AdjustPeriod : instance_fsm::Event
+{
+    minutes delta;
+};
+// Triggered to note an interruption without stopping the clock.
+struct MarkInterruption : instance_fsm::Event
+{
+    bool is_external;
+};
+// Triggered when a calendar event starts or ends.
+struct CalendarChanged : instance_fsm::Event
+{
+    bool is_busy;
+};
+// Triggered when the busy override is switched on or off.
+struct BusyChanged : instance_fsm::Event
+{
+    bool is_busy;
+};
+
+
+// Run data of the timer, shared by all states. The machine replaces the state
+// object on every transition and carries the context over.
+struct pomodoro_context
+{
+    size_t short_breaks;
+    size_t long_breaks;
+    time_point counting_started_at;
+    time_point pause_started_at;
+    bool timer_active;
+    bool auto_paused;
+    bool calendar_busy;
+    bool busy;
+    bool present; // nobody away from the desk, see presence.hpp
+    uint16_t interruptions;
+
+    // Period lengths in use, they start from the defaults and can be adjusted
+    // on the fly, the running period picks up the change immediately.
+    seconds work_period_seconds;
+    seconds short_break_period_seconds;
+    seconds long_break_period_seconds;
+};
+
+struct Pomodoro : instance_fsm::Fsm<Pomodoro, pomodoro_context>
+{
+    using Fsm::Fsm;
+
+    static constexpr seconds WORK_PERIOD_SECONDS = minutes(45);
+    static constexpr seconds SHORT_BREAK_PERIOD_SECONDS = minutes(15);
+    static constexpr seconds LONG_BREAK_PERIOD_SECONDS = minutes(30);
+    static constexpr int64_t LONG_BREAK_AFTER = 4;
+    static constexpr seconds MIN_PERIOD_SECONDS = minutes(1);
+    static constexpr seconds MAX_PERIOD_SECONDS = minutes(120);
+
+    virtual void react(StartTimer const &) {};
+    virtual void react(TimerComplete const &) {};
+    virtual void react(ResetTimer const &) = 0;
+    virtual void react(TimerReady const &) {};
+    virtual void react(CheckTimer const &) {};
+    virtual void react(TimerAction const &) {};
+    virtual void react(PresenceLost const &) { this->context.present = false; };
+    virtual void react(PresenceReturned const &) { this->context.present = true; };
+    virtual void react(BreakSuggested const &) {};
+    virtual void react(AdjustPeriod const &) {};
+    virtual void react(MarkInterruption const &) {};
+    virtual void react(CalendarChanged const &event) { this->context.calendar_busy = event.is_busy; };
+
+    // The override sits above every state. With the pause policy it holds
+    // whatever period is running, breaks included, until it is switched off.
+    virtual void react(BusyChanged const &event)
+    {
+        this->context.busy = event.is_busy;
+#if CONFIG_POMODORO_BUSY_PAUSES
+        if (event.is_busy)
+        {
+            this->auto_pause_counting();
+        }
+        else
+        {
+            this->auto_resume_counting();
+        }
+#endif
+    };
+
+    virtual void entry(void) {};
+
+    void exit(void) {};
+
+    void start_counting()
+    {
+        if (this->context.timer_active)
+        {
+            return;
+        }
+        if (this->context.pause_started_at.is_set())
+        {
+            time_point time_since_boot = clock_now();
+
+            this->context.counting_started_at += time_since_boot - this->context.pause_started_at;
+            this->context.pause_started_at = time_point();
+            this->context.timer_active = true;
+            this->context.auto_paused = false;
+
+            ESP_LOGI(POMODORO_TAG, "pomodoro timer resumed counting at %" PRId64 " sec", duration_cast<seconds>(time_since_boot.time_since_boot()).count());
+            return;
+        }
+
+        time_point time_since_boot = clock_now();
+
+        this->context.counting_started_at = time_since_boot;
+        this->context.pause_started_at = time_point();
+        this->context.timer_active = true;
+
+        ESP_LOGI(POMODORO_TAG, "pomodoro timer started counting at %" PRId64 " sec", duration_cast<seconds>(time_since_boot.time_since_boot()).count());
+        return;
+    };
+
+    void pause_counting()
+    {
+        if (!this->context.timer_active)
+        {
+            ESP_LOGI(POMODORO_TAG, "pomodoro timer cannot pause, not counting");
+            return;
+        }
+
+        this->context.timer_active = false;
+        this->context.pause_started_at = clock_now();
+
+        ESP_LOGI(POMODORO_TAG, "pomodoro timer paused counting at %" PRId64 " sec", this->get_counting_seconds().count());
+    };
+
+    void reset_counting()
+    {
+        this->context.counting_started_at = time_point();
+        this->context.pause_started_at = time_point();
+        this->context.timer_active = false;
+        this->context.auto_paused = false;
+
+        ESP_LOGI(POMODORO_TAG, "pomodoro timer reset");
+    };
+
+    // Pauses on behalf of the user, so that auto_resume_counting() only ever
+    // resumes what was paused automatically and never a manual pause.
+    void auto_pause_counting()
+    {
+        if (!this->context.timer_active)
+        {
+            return;
+        }
+
+        this->pause_counting();
+        this->context.auto_paused = true;
+    };
+
+    // Resumes once nothing keeps the pause any more: somebody is at the desk
+    // and neither a meeting nor the busy override holds it.
+    void auto_resume_counting()
+    {
+        if (!this->context.auto_paused || !this->context.present || this->is_held())
+        {
+            return;
+        }
+
+        this->start_counting();
+    };
+
+    // True while something other than presence keeps an automatic pause.
+    bool is_held()
+    {
+#if CONFIG_POMODORO_BUSY_PAUSES
+        return this->context.calendar_busy || this->context.busy;
+#else
+        return this->context.calendar_busy;
+#endif
+    };
+
+    void reset_short_breaks()
+    {
+        this->context.short_breaks = 0;
+    };
+
+    seconds get_counting_seconds()
+    {
+        if (this->context.pause_started_at.is_set())
+        {
+            return duration_cast<seconds>(this->context.pause_started_at - this->context.counting_started_at);
+        }
+        if (this->context.counting_started_at.is_set())
+        {
+            return duration_cast<seconds>(clock_now() - this->context.counting_started_at);
+        }
+
+        return seconds(0);
+    };
+
+    bool is_timer_active()
+    {
+        return this->context.timer_active;
+    };
+
+    bool is_paused()
+    {
+        return this->context.pause_started_at.is_set();
+    };
+
+    bool is_started()
+    {
+        return this->context.counting_started_at.is_set();
+    };
+
+    void add_short_break()
+    {
+        this->context.short_breaks++;
+    };
+
+    void add_long_break()
+    {
+        this->context.long_breaks++;
+    };
+
+    size_t get_short_breaks()
+    {
+        return this->context.short_breaks;
+    };
+
+    size_t get_long_breaks()
+    {
+        return this->context.long_breaks;
+    };
+
+    size_t get_short_breaks_left()
+    {
+        return Pomodoro::LONG_BREAK_AFTER - this->context.short_breaks;
+    };
+
+    void finish_work()
+    {
+        journal_add(JOURNAL_WORK_DONE, PHASE_WORK, duration_cast<minutes>(this->get_counting_seconds()).count());
+    };
+
+    static void adjust_period(seconds &period_seconds, minutes delta)
+    {
+        period_seconds += delta;
+        if (period_seconds < Pomodoro::MIN_PERIOD_SECONDS)
+        {
+            period_seconds = Pomodoro::MIN_PERIOD_SECONDS;
+        }
+        if (period_seconds > Pomodoro::MAX_PERIOD_SECONDS)
+        {
+            period_seconds = Pomodoro::MAX_PERIOD_SECONDS;
+        }
+
+        ESP_LOGI(POMODORO_TAG, "period adjusted to %" PRId64 " min", duration_cast<minutes>(period_seconds).count());
+    };
+};
+
+constexpr seconds Pomodoro::WORK_PERIOD_SECONDS;
+constexpr seconds Pomodoro::SHORT_BREAK_PERIOD_SECONDS;
+constexpr seconds Pomodoro::LONG_BREAK_PERIOD_SECONDS;
+constexpr int64_t Pomodoro::LONG_BREAK_AFTER;
+constexpr seconds Pomodoro::MIN_PERIOD_SECONDS;
+constexpr seconds Pomodoro::MAX_PERIOD_SECONDS;
+
+static const pomodoro_context initial_context = {
+    0,
+    0,
+    time_point(),
+    time_point(),
+    false,
+    false,
+    false,
+    false,
+    true,
+    0,
+    Pomodoro::WORK_PERIOD_SECONDS,
+    Pomodoro::SHORT_BREAK_PERIOD_SECONDS,
+    Pomodoro::LONG_BREAK_PERIOD_SECONDS,
+};
+
+// ----------------------------------------------------------------------------
+// 3. State Declarations
+//
+// The off state where the timer is completely stopped.
+struct Off : Pomodoro
+{
+    using Pomodoro::Pomodoro;
+
+    void entry() override
+    {
+        ESP_LOGI(POMODORO_TAG, "starting timer");
+    };
+    void react(ResetTimer const &) override
+    {
+        ESP_LOGI(POMODORO_TAG, "timer not ready");
+    };
+    void react(TimerReady const &) override
+    {
+        ESP_LOGI(POMODORO_TAG, "got timer ready event");
+
+        return transit<Idle>();
+    };
+
+public:
+};
+
+// The initial state where the timer is ready to start.
+struct Idle : Pomodoro
+{
+    using Pomodoro::Pomodoro;
+
+    void entry() override
+    {
+        this->reset_counting();
+        ESP_LOGI(POMODORO_TAG, "timer is ready, idle");
+    };
+    void react(ResetTimer const &) override { return transit<Work>(); };
+
+    void react(StartTimer const &) override { return transit<Work>(); };
+
+    void react(TimerAction const &) override { return transit<Work>(); };
+
+    void react(AdjustPeriod const &event) override { Pomodoro::adjust_period(this->context.work_period_seconds, event.delta); };
+};
+
+// The state where the timer is counting down the work period.
+struct Work : Pomodoro
+{
+    using Pomodoro::Pomodoro;
+
+    void entry() override
+    {
+        this->reset_counting();
+        this->context.interruptions = 0;
+        ESP_LOGI(POMODORO_TAG, "let's get to work");
+    };
+    void react(ResetTimer const &) override { return transit<Idle>(); };
+
+    void react(CheckTimer const &) override
+    {
+        if (!this->is_timer_active())
+        {
+            return;
+        }
+
+        seconds elapsed_time_in_seconds = this->get_counting_seconds();
+        if (elapsed_time_in_seconds < this->context.work_period_seconds)
+        {
+            ESP_LOGI(POMODORO_TAG, "work time left: %" PRId64 " sec", (this->context.work_period_seconds - elapsed_time_in_seconds).count());
+            return;
+        }
+
+        this->finish_work();
+
+#ifdef LONG_BREAK_ENABLE
+        bool is_last_work = this->get_short_breaks_left() == 0;
+        if (is_last_work)
+        {
+            transit<LongBreak>();
+        }
+        else
+#endif
+        {
+            transit<ShortBreak>();
+        }
+    };
+
+    void react(TimerAction const &) override
+    {
+        if (!this->is_started())
+        {
+            this->start_counting();
+            return;
+        }
+
+        if (this->is_paused())
+        {
+            this->start_counting();
+            return;
+        }
+
+        this->pause_counting();
+    };
+
+    void react(PresenceLost const &) override
+    {
+        this->context.present = false;
+        this->auto_pause_counting();
+    };
+
+    // Counted while paused as well, interruptions are often what paused it.
+    void react(MarkInterruption const &event) override
+    {
+        if (!this->is_started())
+        {
+            return;
+        }
+
+        uint16_t minutes_in = duration_cast<minutes>(this->get_counting_seconds()).count();
+        journal_add(event.is_external ? JOURNAL_INTERRUPTION_EXTERNAL : JOURNAL_INTERRUPTION_INTERNAL, PHASE_WORK, minutes_in);
+        this->context.interruptions++;
+
+        ESP_LOGI(POMODORO_TAG, "%s interruption at %d min, %d this session", event.is_external ? "external" : "internal", minutes_in, this->context.interruptions);
+    };
+
+    // a meeting keeps the period paused even with somebody around
+    void react(PresenceReturned const &) override
+    {
+        this->context.present = true;
+        this->auto_resume_counting();
+    };
+
+    // the end of a meeting does not resume a period paused for an empty desk
+    void react(CalendarChanged const &event) override
+    {
+        this->context.calendar_busy = event.is_busy;
+        if (event.is_busy)
+        {
+            this->auto_pause_counting();
+        }
+        else
+        {
+            this->auto_resume_counting();
+        }
+    };
+
+    void react(AdjustPeriod const &event) override { Pomodoro::adjust_period(this->context.work_period_seconds, event.delta); };
+
+    // Finishes the work period early, but only once most of it is done.
+    void react(BreakSuggested const &) override
+    {
+        if (!this->is_timer_active())
+        {
+            return;
+        }
+
+        seconds elapsed_time_in_seconds = this->get_counting_seconds();
+        if (elapsed_time_in_seconds < this->context.work_period_seconds / 2)
+        {
+            ESP_LOGI(POMODORO_TAG, "break suggested too early, %" PRId64 " sec into work", elapsed_time_in_seconds.count());
+            return;
+        }
+
+        this->finish_work();
+        transit<ShortBreak>();
+    };
+};
+// The state where the timer is counting down a short break period.
+struct ShortBreak : Pomodoro
+{
+    using Pomodoro::Pomodoro;
+
+    void entry() override
+    {
+        this->reset_counting();
+        this->add_short_break();
+        ESP_LOGI(POMODORO_TAG, "short break, amount left: %" PRIu32 "", (uint32_t)this->get_short_breaks_left());
+    };
+    void react(ResetTimer const &) override { transit<Idle>(); };
+
+    void react(AdjustPeriod const &event) override { Pomodoro::adjust_period(this->context.short_break_period_seconds, event.delta); };
+
+    void react(CheckTimer const &) override
+    {
+        if (!this->is_timer_active())
+        {
+            return;
+        }
+
+        seconds elapsed_time_in_seconds = this->get_counting_seconds();
+        if (elapsed_time_in_seconds < this->context.short_break_period_seconds)
+        {
+            ESP_LOGI(POMODORO_TAG, "short break time left: %" PRId64 " sec", (this->context.short_break_period_seconds - elapsed_time_in_seconds).count());
+            return;
+        }
+
+        transit<Work>();
+    };
+
+    void react(TimerAction const &) override
+    {
+        if (!this->is_started())
+        {
+            this->start_counting();
+            return;
+        }
+
+        transit<Work>();
+    };
+};
+// The state where the timer is counting down a long break period.
+struct LongBreak : Pomodoro
+{
+    using Pomodoro::Pomodoro;
+
+    void entry() override
+    {
+        this->reset_counting();
+        this->reset_short_breaks();
+        this->add_long_break();
+        ESP_LOGI(POMODORO_TAG, "long break, amount taken: %" PRIu32 "", (uint32_t)this->get_long_breaks());
+    };
+    void react(ResetTimer const &) override { transit<Idle>(); };
+
+    void react(AdjustPeriod const &event) override { Pomodoro::adjust_period(this->context.long_break_period_seconds, event.delta); };
+
+    void react(CheckTimer const &) override
+    {
+        if (!this->is_timer_active())
+        {
+            return;
+        }
+
+        seconds elapsed_time_in_seconds = this->get_counting_seconds();
+        if (elapsed_time_in_seconds < this->context.long_break_period_seconds - this->context.short_break_period_seconds)
+        {
+            ESP_LOGI(POMODORO_TAG, "long break time left: %" PRId64 " sec", (this->context.long_break_period_seconds - elapsed_time_in_seconds).count());
+            return;
+        }
+
+        transit<LongBreakLastMinutes>();
+    };
+
+    void react(TimerAction const &) override
+    {
+        if (!this->is_started())
+        {
+            this->start_counting();
+            return;
+        }
+
+        transit<Work>();
+    };
+};
+// The state where the timer is counting down last minutes of the long break period.
+struct LongBreakLastMinutes : Pomodoro
+{
+    using Pomodoro::Pomodoro;
+
+    void entry() override
+    {
+        ESP_LOGI(POMODORO_TAG, "long break last minutes");
+    };
+    void react(ResetTimer const &) override { transit<Idle>(); };
+
+    void react(AdjustPeriod const &event) override { Pomodoro::adjust_period(this->context.long_break_period_seconds, event.delta); };
+
+    void react(CheckTimer const &) override
+    {
+        if (!this->is_timer_active())
+        {
+            return;
+        }
+
+        seconds elapsed_time_in_seconds = this->get_counting_seconds();
+        if (elapsed_time_in_seconds < this->context.long_break_period_seconds)
+        {
+            ESP_LOGI(POMODORO_TAG, "long break time left, it's last minutes: %" PRId64 "", (this->context.long_break_period_seconds - elapsed_time_in_seconds).count());
+            return;
+        }
+
+        transit<Work>();
+    };
+
+    void react(TimerAction const &) override
+    {
+        if (!this->is_started())
+        {
+            this->start_counting();
+            return;
+        }
+
+        transit<Work>();
+    };
+};
+
+// Everything of the status the FSM knows, the sensors are added by the caller.
+inline pomodoro_status pomodoro_fsm_status(instance_fsm::Machine<Pomodoro> &fsm)
+{
+    pomodoro_status status = {};
+    seconds period_seconds(0);
+
+    status.phase = PHASE_OFF;
+    if (fsm.is_in_state<Idle>())
+    {
+        status.phase = PHASE_IDLE;
+    }
+    if (fsm.is_in_state<Work>())
+    {
+        status.phase = PHASE_WORK;
+        period_seconds = fsm.state()->context.work_period_seconds;
+    }
+    if (fsm.is_in_state<ShortBreak>())
+    {
+        status.phase = PHASE_SHORT_BREAK;
+        period_seconds = fsm.state()->context.short_break_period_seconds;
+    }
+    if (fsm.is_in_state<LongBreak>())
+    {
+        status.phase = PHASE_LONG_BREAK;
+        period_seconds = fsm.state()->context.long_break_period_seconds;
+    }
+    if (fsm.is_in_state<LongBreakLastMinutes>())
+    {
+        status.phase = PHASE_LONG_BREAK_LAST_MINUTES;
+        period_seconds = fsm.state()->context.long_break_period_seconds;
+    }
+
+    status.is_paused = fsm.state()->is_paused();
+    status.is_started = fsm.state()->is_started();
+    status.seconds_left = (period_seconds - fsm.state()->get_counting_seconds()).count();
+    status.interruptions = fsm.state()->context.interruptions;
+    status.is_busy = fsm.state()->context.busy;
+    status.needs_air = false;
+
+    return status;
+}
+
+// Clock time until the running period needs its next CheckTimer, only
+// meaningful while it is started and not paused.
+inline seconds pomodoro_next_check(const pomodoro_status &status, const pomodoro_context &context)
+{
+    seconds seconds_to_check(status.seconds_left);
+    if (status.phase == PHASE_LONG_BREAK)
+    {
+        // the long break turns into its last minutes one short break before the end
+        seconds_to_check -= context.short_break_period_seconds;
+    }
+    if (seconds_to_check < seconds(1))
+    {
+        seconds_to_check = seconds(1);
+    }
+
+    // seconds_left is rounded down to whole seconds elapsed, so this never fires early
+    return seconds_to_check;
+}
+
+#endif /* POMODORO_FSM_HPP_INCLUDED */
@@ -0,0 +1,137 @@
+#include <inttypes.h>
+
+#include "sdkconfig.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "gpio.h"
+
+#include "pomodoro.hpp"
+#include "journal.hpp"
+#include "presence.hpp"
+
+// PIR sensor keeps its output high while it sees motion. Nothing is polled:
+// a falling edge arms a one-shot absence timer and a rising edge disarms it.
+
+#define GPIO_PRESENCE_SENSOR ((gpio_num_t)CONFIG_POMODORO_PRESENCE_GPIO)
+
+static const char *TAG = "presence";
+
+static const int64_t absence_timeout = (int64_t)CONFIG_POMODORO_PRESENCE_ABSENCE_SECONDS * 1000000;
+
+#define PRESENCE_RETRY_US 100000
+
+static esp_timer_handle_t absence_timer;
+static esp_timer_handle_t retry_timer;
+static bool is_away = false;
+static int64_t away_since = 0;
+
+static void IRAM_ATTR presence_isr_handler(void *arg)
+{
+    pomodoro_post_input_from_isr(INPUT_PRESENCE_EDGE);
+}
+
+// Posts the current state, not the edge, so a retry after a full queue can
+// never deliver an old one. The FSM takes a repeated state as is.
+static void presence_post(void)
+{
+    portENTER_CRITICAL();
+    bool was_away = is_away;
+    portEXIT_CRITICAL();
+
+    if (pomodoro_post_input(was_away ? INPUT_PRESENCE_LOST : INPUT_PRESENCE_RETURNED))
+    {
+        esp_timer_stop(retry_timer);
+        return;
+    }
+
+    ESP_LOGW(TAG, "input queue full, trying again");
+    esp_timer_stop(retry_timer);
+    esp_timer_start_once(retry_timer, PRESENCE_RETRY_US);
+}
+
+static void retry_timer_callback(void *arg)
+{
+    presence_post();
+}
+
+static void absence_timer_callback(void *arg)
+{
+    portENTER_CRITICAL();
+    is_away = true;
+    away_since = esp_timer_get_time();
+    portEXIT_CRITICAL();
+
+    ESP_LOGI(TAG, "nobody around for %d sec", CONFIG_POMODORO_PRESENCE_ABSENCE_SECONDS);
+
+    presence_post();
+}
+
+esp_err_t presence_setup(void)
+{
+    gpio_config_t io_conf;
+
+    io_conf.intr_type = GPIO_INTR_ANYEDGE;
+    io_conf.mode = GPIO_MODE_INPUT;
+    io_conf.pin_bit_mask = (1 << GPIO_PRESENCE_SENSOR);
+    io_conf.pull_down_en = GPIO_PULLDOWN_DISABLE;
+    io_conf.pull_up_en = GPIO_PULLUP_DISABLE;
+    gpio_config(&io_conf);
+
+    esp_timer_create_args_t absence_timer_args = {};
+
+    absence_timer_args.callback = &absence_timer_callback;
+    absence_timer_args.name = "absence_timer";
+
+    ESP_ERROR_CHECK(esp_timer_create(&absence_timer_args, &absence_timer));
+
+    esp_timer_create_args_t retry_timer_args = {};
+
+    retry_timer_args.callback = &retry_timer_callback;
+    retry_timer_args.name = "presence_retry";
+
+    ESP_ERROR_CHECK(esp_timer_create(&retry_timer_args, &retry_timer));
+
+    // expects the isr service to be installed by gpio_setup()
+    gpio_isr_handler_add(GPIO_PRESENCE_SENSOR, presence_isr_handler, nullptr);
+
+    if (gpio_get_level(GPIO_PRESENCE_SENSOR) == 0)
+    {
+        esp_timer_start_once(absence_timer, absence_timeout);
+    }
+
+    return ESP_OK;
+}
+
+void presence_handle_edge(void)
+{
+    if (gpio_get_level(GPIO_PRESENCE_SENSOR) == 0)
+    {
+        // restarting keeps the timer counting from the last seen motion
+        esp_timer_stop(absence_timer);
+        esp_timer_start_once(absence_timer, absence_timeout);
+        return;
+    }
+
+    esp_timer_stop(absence_timer);
+
+    portENTER_CRITICAL();
+    bool was_away = is_away;
+    int64_t absent_for = esp_timer_get_time() - away_since;
+    is_away = false;
+    portEXIT_CRITICAL();
+
+    if (!was_away)
+    {
+        return;
+    }
+
+    // the timeout itself is counted as presence, the user was only about to leave
+    int64_t absent_minutes = absent_for / (60 * 1000000LL);
+    journal_add(JOURNAL_ABSENCE, pomodoro_get_status().phase, absent_minutes < UINT16_MAX ? absent_minutes : UINT16_MAX);
+
+    ESP_LOGI(TAG, "welcome back after %" PRId64 " sec", absent_for / 1000000);
+
+    presence_post();
+}
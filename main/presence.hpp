@@ -0,0 +1,14 @@
+#ifndef PRESENCE_HPP_INCLUDED
+#define PRESENCE_HPP_INCLUDED
+
+#include "esp_err.h"
+
+// Every absence longer than the timeout goes into the journal, see
+// journal.hpp, and through it into the daily counts and the history.
+
+esp_err_t presence_setup(void);
+
+// Called from the GPIO event task on every sensor edge.
+void presence_handle_edge(void);
+
+#endif /* PRESENCE_HPP_INCLUDED */
@@ -0,0 +1,427 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+
+#include "sdkconfig.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_system.h"
+#include "nvs.h"
+#include "mbedtls/sha256.h"
+#include "mbedtls/ecdsa.h"
+#if CONFIG_POMODORO_CONSOLE_ENABLE
+#include "esp_console.h"
+#endif
+
+#include "provision.hpp"
+
+#define NVS_NAMESPACE "provision"
+#define NVS_KEY "bundle"
+// the highest sequence a bundle verified on this unit had, kept apart from
+// the bundle so a corrupt or foreign blob cannot move it
+#define NVS_SEQUENCE_KEY "sequence"
+
+static const char *TAG = "provision";
+
+static uint8_t public_key[PROVISION_PUBLIC_KEY_SIZE];
+static bool is_enabled = false;
+
+static provision_config config = {};
+
+static int provision_hex_value(char c)
+{
+    if (c >= '0' && c <= '9')
+    {
+        return c - '0';
+    }
+    if (c >= 'a' && c <= 'f')
+    {
+        return c - 'a' + 10;
+    }
+    if (c >= 'A' && c <= 'F')
+    {
+        return c - 'A' + 10;
+    }
+    return -1;
+}
+
+static bool provision_read_public_key(void)
+{
+    const char *hex = CONFIG_POMODORO_PROVISION_PUBLIC_KEY;
+    if (strlen(hex) == 0)
+    {
+        return false;
+    }
+    if (strlen(hex) != 2 * PROVISION_PUBLIC_KEY_SIZE)
+    {
+        ESP_LOGE(TAG, "public key needs %d hex digits, provisioning is off", 2 * PROVISION_PUBLIC_KEY_SIZE);
+        return false;
+    }
+    for (size_t i = 0; i < PROVISION_PUBLIC_KEY_SIZE; i++)
+    {
+        int high = provision_hex_value(hex[2 * i]);
+        int low = provision_hex_value(hex[2 * i + 1]);
+        if (high < 0 || low < 0)
+        {
+            ESP_LOGE(TAG, "public key is not hex, provisioning is off");
+            return false;
+        }
+        public_key[i] = high << 4 | low;
+    }
+    return true;
+}
+
+// Around a second on the ESP8266, it only runs at boot and on commit.
+static bool provision_check_signature(const uint8_t *bundle, size_t signed_len, const uint8_t *key)
+{
+    uint8_t hash[32];
+    if (mbedtls_sha256_ret(bundle, signed_len, hash, 0) != 0)
+    {
+        return false;
+    }
+
+    mbedtls_ecp_group group;
+    mbedtls_ecp_point point;
+    mbedtls_mpi r;
+    mbedtls_mpi s;
+    mbedtls_ecp_group_init(&group);
+    mbedtls_ecp_point_init(&point);
+    mbedtls_mpi_init(&r);
+    mbedtls_mpi_init(&s);
+
+    const uint8_t *signature = bundle + signed_len;
+    bool is_signed = mbedtls_ecp_group_load(&group, MBEDTLS_ECP_DP_SECP256R1) == 0 &&
+                     mbedtls_ecp_point_read_binary(&group, &point, key, PROVISION_PUBLIC_KEY_SIZE) == 0 &&
+                     mbedtls_ecp_check_pubkey(&group, &point) == 0 &&
+                     mbedtls_mpi_read_binary(&r, signature, PROVISION_SIGNATURE_SIZE / 2) == 0 &&
+                     mbedtls_mpi_read_binary(&s, signature + PROVISION_SIGNATURE_SIZE / 2, PROVISION_SIGNATURE_SIZE / 2) == 0 &&
+                     mbedtls_ecdsa_verify(&group, hash, sizeof(hash), &point, &r, &s) == 0;
+
+    mbedtls_mpi_free(&s);
+    mbedtls_mpi_free(&r);
+    mbedtls_ecp_point_free(&point);
+    mbedtls_ecp_group_free(&group);
+    return is_signed;
+}
+
+static bool provision_copy_string(char *out, size_t size, const uint8_t *value, size_t len)
+{
+    if (len >= size || memchr(value, '\0', len) != nullptr)
+    {
+        return false;
+    }
+    memcpy(out, value, len);
+    out[len] = '\0';
+    return true;
+}
+
+static bool provision_copy_minutes(uint8_t *out, const uint8_t *value, size_t len)
+{
+    if (len != 1 || value[0] < 1 || value[0] > 120)
+    {
+        return false;
+    }
+    *out = value[0];
+    return true;
+}
+
+bool provision_verify(const uint8_t *bundle, size_t len, const uint8_t *key, const uint8_t *device_mac, provision_config *result,
+                      const char **reason)
+{
+    *reason = "malformed";
+    if (len < PROVISION_HEADER_SIZE + PROVISION_SIGNATURE_SIZE || len > PROVISION_BUNDLE_MAX)
+    {
+        return false;
+    }
+    if (bundle[0] != 'P' || bundle[1] != 'V' || bundle[2] != PROVISION_VERSION)
+    {
+        return false;
+    }
+
+    size_t fields_len = bundle[8] | (bundle[9] << 8);
+    if (PROVISION_HEADER_SIZE + fields_len + PROVISION_SIGNATURE_SIZE != len)
+    {
+        return false;
+    }
+
+    if (!provision_check_signature(bundle, len - PROVISION_SIGNATURE_SIZE, key))
+    {
+        *reason = "signature";
+        return false;
+    }
+
+    provision_config parsed = {};
+    parsed.sequence = bundle[4] | (bundle[5] << 8) | (bundle[6] << 16) | ((uint32_t)bundle[7] << 24);
+
+    const uint8_t *p = bundle + PROVISION_HEADER_SIZE;
+    const uint8_t *end = p + fields_len;
+    while (p < end)
+    {
+        if (end - p < 2 || end - p - 2 < p[1])
+        {
+            return false;
+        }
+
+        provision_field type = (provision_field)p[0];
+        size_t size = p[1];
+        const uint8_t *value = p + 2;
+        p += 2 + size;
+
+        bool is_valid;
+        switch (type)
+        {
+        case PROVISION_DEVICE_MAC:
+            if (size != 6 || memcmp(value, device_mac, 6) != 0)
+            {
+                *reason = "device";
+                return false;
+            }
+            is_valid = true;
+            break;
+        case PROVISION_WIFI_SSID:
+            is_valid = provision_copy_string(parsed.wifi_ssid, sizeof(parsed.wifi_ssid), value, size);
+            break;
+        case PROVISION_WIFI_PASSWORD:
+            is_valid = provision_copy_string(parsed.wifi_password, sizeof(parsed.wifi_password), value, size);
+            break;
+        case PROVISION_HINT_KEY:
+            is_valid = provision_copy_string(parsed.hint_key, sizeof(parsed.hint_key), value, size);
+            break;
+        case PROVISION_TIMEZONE:
+            is_valid = provision_copy_string(parsed.timezone, sizeof(parsed.timezone), value, size);
+            break;
+        case PROVISION_WORK_MINUTES:
+            is_valid = provision_copy_minutes(&parsed.work_minutes, value, size);
+            break;
+        case PROVISION_SHORT_BREAK_MINUTES:
+            is_valid = provision_copy_minutes(&parsed.short_break_minutes, value, size);
+            break;
+        case PROVISION_LONG_BREAK_MINUTES:
+            is_valid = provision_copy_minutes(&parsed.long_break_minutes, value, size);
+            break;
+        default:
+            // unknown fields are refused, a newer tool must not half apply
+            is_valid = false;
+            break;
+        }
+        if (!is_valid)
+        {
+            *reason = "field";
+            return false;
+        }
+    }
+
+    *result = parsed;
+    *reason = "ok";
+    return true;
+}
+
+esp_err_t provision_load(void)
+{
+    is_enabled = provision_read_public_key();
+    if (!is_enabled)
+    {
+        return ESP_OK;
+    }
+
+    nvs_handle handle;
+    if (nvs_open(NVS_NAMESPACE, NVS_READONLY, &handle) != ESP_OK)
+    {
+        return ESP_OK;
+    }
+
+    uint32_t sequence = 0;
+    nvs_get_u32(handle, NVS_SEQUENCE_KEY, &sequence);
+
+    static uint8_t bundle[PROVISION_BUNDLE_MAX];
+    size_t len = sizeof(bundle);
+    esp_err_t err = nvs_get_blob(handle, NVS_KEY, bundle, &len);
+    nvs_close(handle);
+    config.sequence = sequence;
+    if (err != ESP_OK)
+    {
+        return ESP_OK;
+    }
+
+    uint8_t mac[6];
+    esp_read_mac(mac, ESP_MAC_WIFI_STA);
+
+    // checked again, a changed key must not leave old settings applied
+    const char *reason;
+    if (!provision_verify(bundle, len, public_key, mac, &config, &reason))
+    {
+        ESP_LOGW(TAG, "stored bundle rejected (%s), using the built in settings", reason);
+        config = {};
+        config.sequence = sequence;
+        return ESP_OK;
+    }
+
+    ESP_LOGI(TAG, "provisioned with bundle %" PRIu32, config.sequence);
+
+    // a restart between the two writes of a commit leaves the stored one higher
+    if (config.sequence < sequence)
+    {
+        config.sequence = sequence;
+    }
+
+    return ESP_OK;
+}
+
+const provision_config &provision_get(void)
+{
+    return config;
+}
+
+#if CONFIG_POMODORO_CONSOLE_ENABLE
+// One transfer at a time, filled by data lines at increasing offsets.
+static uint8_t received[PROVISION_BUNDLE_MAX];
+static size_t received_size = 0;
+static size_t received_len = 0;
+
+static bool provision_parse_size(const char *text, size_t max, size_t *value)
+{
+    char *end;
+    unsigned long parsed = strtoul(text, &end, 10);
+    if (end == text || *end != '\0' || text[0] == '-' || parsed > max)
+    {
+        return false;
+    }
+    *value = parsed;
+    return true;
+}
+
+static int provision_commit(void)
+{
+    if (received_size == 0 || received_len != received_size)
+    {
+        printf("PROVISION error incomplete\n");
+        return 1;
+    }
+    received_size = 0;
+
+    uint8_t mac[6];
+    esp_read_mac(mac, ESP_MAC_WIFI_STA);
+
+    provision_config parsed;
+    const char *reason;
+    if (!provision_verify(received, received_len, public_key, mac, &parsed, &reason))
+    {
+        printf("PROVISION error %s\n", reason);
+        return 1;
+    }
+    if (parsed.sequence <= config.sequence)
+    {
+        printf("PROVISION error stale\n");
+        return 1;
+    }
+
+    nvs_handle handle;
+    esp_err_t err = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &handle);
+    if (err == ESP_OK)
+    {
+        // the sequence goes first, the bundle can then never be ahead of it
+        err = nvs_set_u32(handle, NVS_SEQUENCE_KEY, parsed.sequence);
+        if (err == ESP_OK)
+        {
+            // a single blob replaces the old one as a whole or not at all
+            err = nvs_set_blob(handle, NVS_KEY, received, received_len);
+        }
+        if (err == ESP_OK)
+        {
+            err = nvs_commit(handle);
+        }
+        nvs_close(handle);
+    }
+    if (err != ESP_OK)
+    {
+        printf("PROVISION error storage\n");
+        return 1;
+    }
+
+    printf("PROVISION ok %" PRIu32 "\n", parsed.sequence);
+    fflush(stdout);
+
+    // settings are read at boot only
+    vTaskDelay(pdMS_TO_TICKS(500));
+    esp_restart();
+    return 0;
+}
+
+static int provision_command(int argc, char **argv)
+{
+    if (!is_enabled)
+    {
+        printf("PROVISION error disabled\n");
+        return 1;
+    }
+
+    if (argc == 2 && strcmp(argv[1], "id") == 0)
+    {
+        uint8_t mac[6];
+        esp_read_mac(mac, ESP_MAC_WIFI_STA);
+        printf("PROVISION id %02x:%02x:%02x:%02x:%02x:%02x %" PRIu32 "\n", mac[0], mac[1], mac[2], mac[3], mac[4], mac[5], config.sequence);
+        return 0;
+    }
+    if (argc == 3 && strcmp(argv[1], "begin") == 0)
+    {
+        size_t size;
+        if (!provision_parse_size(argv[2], PROVISION_BUNDLE_MAX, &size) || size == 0)
+        {
+            printf("PROVISION error size\n");
+            return 1;
+        }
+        received_size = size;
+        received_len = 0;
+        printf("PROVISION ready %u\n", received_size);
+        return 0;
+    }
+    if (argc == 4 && strcmp(argv[1], "data") == 0)
+    {
+        size_t offset;
+        size_t hex_len = strlen(argv[3]);
+        if (received_size == 0 || !provision_parse_size(argv[2], PROVISION_BUNDLE_MAX, &offset) || offset != received_len || hex_len % 2 != 0 ||
+            received_len + hex_len / 2 > received_size)
+        {
+            printf("PROVISION error sequence %u\n", received_len);
+            return 1;
+        }
+
+        for (size_t i = 0; i < hex_len; i += 2)
+        {
+            int high = provision_hex_value(argv[3][i]);
+            int low = provision_hex_value(argv[3][i + 1]);
+            if (high < 0 || low < 0)
+            {
+                printf("PROVISION error hex %u\n", received_len);
+                return 1;
+            }
+            received[received_len + i / 2] = high << 4 | low;
+        }
+        received_len += hex_len / 2;
+
+        printf("PROVISION ack %u\n", received_len);
+        return 0;
+    }
+    if (argc == 2 && strcmp(argv[1], "commit") == 0)
+    {
+        return provision_commit();
+    }
+
+    printf("usage: provision id|begin <size>|data <offset> <hex>|commit\n");
+    return 1;
+}
+
+esp_err_t provision_register_command(void)
+{
+    esp_console_cmd_t cmd = {};
+
+    cmd.command = "provision";
+    cmd.help = "Receive a signed settings bundle, see tools/provision.py";
+    cmd.hint = "id|begin <size>|data <offset> <hex>|commit";
+    cmd.func = &provision_command;
+
+    return esp_console_cmd_register(&cmd);
+}
+#endif
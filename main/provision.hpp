@@ -0,0 +1,67 @@
+#ifndef PROVISION_HPP_INCLUDED
+#define PROVISION_HPP_INCLUDED
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+
+// Device settings from a provisioning bundle, signed by tools/provision.py
+// with the private key to CONFIG_POMODORO_PROVISION_PUBLIC_KEY and sent over
+// the serial console. The whole bundle is verified in RAM and stored as one
+// NVS blob, so a unit has either the old settings or all of the new ones.
+//
+// Bundle, little endian:
+//   "PV", version, 0, uint32 sequence, uint16 length,
+//   length bytes of fields as type, size, value,
+//   ECDSA P-256 signature of the SHA-256 of everything before it, r and s
+//   as 32 big endian bytes each
+// A sequence not above the stored one is refused, so old bundles cannot be
+// replayed. With PROVISION_DEVICE_MAC the bundle only fits that one unit.
+
+#define PROVISION_VERSION 2
+#define PROVISION_HEADER_SIZE 10
+#define PROVISION_SIGNATURE_SIZE 64
+#define PROVISION_PUBLIC_KEY_SIZE 65
+#define PROVISION_BUNDLE_MAX 512
+
+enum provision_field : uint8_t
+{
+    PROVISION_DEVICE_MAC = 1,      // 6 bytes, station MAC
+    PROVISION_WIFI_SSID,           // up to 32 bytes
+    PROVISION_WIFI_PASSWORD,       // up to 63 bytes
+    PROVISION_HINT_KEY,            // up to 32 bytes
+    PROVISION_TIMEZONE,            // zone name or POSIX rule, up to 47 bytes
+    PROVISION_WORK_MINUTES,        // 1 byte, 1-120
+    PROVISION_SHORT_BREAK_MINUTES, // 1 byte, 1-120
+    PROVISION_LONG_BREAK_MINUTES,  // 1 byte, 1-120
+};
+
+// Fields the bundle does not set stay empty or 0, the Kconfig value applies.
+struct provision_config
+{
+    uint32_t sequence;
+    char wifi_ssid[33];
+    char wifi_password[64];
+    char hint_key[33];
+    char timezone[48];
+    uint8_t work_minutes;
+    uint8_t short_break_minutes;
+    uint8_t long_break_minutes;
+};
+
+// Checks the signature against the uncompressed public key, the target
+// device and every field. On failure the reason is a single word for the
+// host tool.
+bool provision_verify(const uint8_t *bundle, size_t len, const uint8_t *public_key, const uint8_t *device_mac,
+                      provision_config *config, const char **reason);
+
+// Loads the stored bundle, call after nvs_flash_init() and before anything
+// reads the settings.
+esp_err_t provision_load(void);
+
+const provision_config &provision_get(void);
+
+esp_err_t provision_register_command(void);
+
+#endif /* PROVISION_HPP_INCLUDED */
@@ -0,0 +1,232 @@
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+
+#include "sdkconfig.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_system.h"
+#include "esp_timer.h"
+
+#include "selftest.hpp"
+
+#define SELFTEST_HOLD_MS 1000
+#define SELFTEST_LED_MS 500
+#define SELFTEST_PRESS_TIMEOUT_MS 30000
+#define SELFTEST_DEBOUNCE_US 200000 // what the pomodoro input task ignores
+#define SELFTEST_EDGES 256
+
+static const char *TAG = "selftest";
+
+static selftest_edge edges[SELFTEST_EDGES];
+static volatile size_t edges_count = 0;
+static gpio_num_t button_pin;
+
+static selftest_result result = {};
+
+static void IRAM_ATTR selftest_isr_handler(void *arg)
+{
+    size_t index = edges_count;
+    if (index < SELFTEST_EDGES)
+    {
+        edges[index].at = esp_timer_get_time();
+        edges[index].level = gpio_get_level(button_pin);
+        edges_count = index + 1;
+    }
+}
+
+static bool selftest_is_held(gpio_num_t button)
+{
+    gpio_config_t io_conf = {};
+    io_conf.intr_type = GPIO_INTR_DISABLE;
+    io_conf.mode = GPIO_MODE_INPUT;
+    io_conf.pin_bit_mask = 1 << button;
+    io_conf.pull_up_en = GPIO_PULLUP_ENABLE;
+    gpio_config(&io_conf);
+
+    // one look at boot, a light nobody touches starts without waiting
+    if (gpio_get_level(button) != 0)
+    {
+        return false;
+    }
+
+    for (int held_ms = 0; held_ms < SELFTEST_HOLD_MS; held_ms += 50)
+    {
+        vTaskDelay(pdMS_TO_TICKS(50));
+        if (gpio_get_level(button) != 0)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void selftest_leds(const selftest_pins &pins)
+{
+    gpio_config_t io_conf = {};
+    io_conf.intr_type = GPIO_INTR_DISABLE;
+    io_conf.mode = GPIO_MODE_OUTPUT;
+    io_conf.pin_bit_mask = (1 << pins.leds[0]) | (1 << pins.leds[1]) | (1 << pins.leds[2]);
+    gpio_config(&io_conf);
+
+    // LEDs are active low: one at a time twice over, then all together
+    for (int round = 0; round < 2; round++)
+    {
+        for (size_t i = 0; i < 3; i++)
+        {
+            for (size_t j = 0; j < 3; j++)
+            {
+                gpio_set_level(pins.leds[j], i == j ? 0 : 1);
+            }
+            vTaskDelay(pdMS_TO_TICKS(SELFTEST_LED_MS));
+        }
+    }
+    for (size_t i = 0; i < 3; i++)
+    {
+        gpio_set_level(pins.leds[i], 0);
+    }
+    vTaskDelay(pdMS_TO_TICKS(2 * SELFTEST_LED_MS));
+    for (size_t i = 0; i < 3; i++)
+    {
+        gpio_set_level(pins.leds[i], 1);
+    }
+}
+
+// Splits the edges into bursts separated by SELFTEST_QUIET_US; a burst
+// settling low is a press, one settling high a release.
+selftest_result selftest_analyze(const selftest_edge *edges, size_t count, int64_t now, bool is_final)
+{
+    uint8_t presses = 0;
+    uint16_t edges_max = 0;
+    uint32_t bounce_max = 0;
+    uint64_t bounce_sum = 0;
+    uint32_t bursts = 0;
+    uint32_t press_min = UINT32_MAX;
+    uint32_t press_max = 0;
+    int64_t pressed_at = -1;
+
+    size_t first = 0;
+    while (first < count)
+    {
+        size_t last = first;
+        while (last + 1 < count && edges[last + 1].at - edges[last].at < SELFTEST_QUIET_US)
+        {
+            last++;
+        }
+        // the newest burst may still be bouncing
+        if (last + 1 == count && !is_final && now - edges[last].at < SELFTEST_QUIET_US)
+        {
+            break;
+        }
+
+        uint32_t bounce = edges[last].at - edges[first].at;
+        uint16_t burst_edges = last - first + 1;
+        edges_max = burst_edges > edges_max ? burst_edges : edges_max;
+        bounce_max = bounce > bounce_max ? bounce : bounce_max;
+        bounce_sum += bounce;
+        bursts++;
+
+        if (edges[last].level == 0)
+        {
+            presses++;
+            pressed_at = edges[first].at;
+        }
+        else if (pressed_at >= 0)
+        {
+            uint32_t press = (edges[first].at - pressed_at) / 1000;
+            press_min = press < press_min ? press : press_min;
+            press_max = press > press_max ? press : press_max;
+            pressed_at = -1;
+        }
+
+        first = last + 1;
+    }
+
+    selftest_result measured = {};
+    measured.presses = presses;
+    measured.edges_max = edges_max;
+    measured.bounce_max_us = bounce_max;
+    measured.bounce_avg_us = bursts > 0 ? bounce_sum / bursts : 0;
+    measured.press_min_ms = press_min == UINT32_MAX ? 0 : press_min;
+    measured.press_max_ms = press_max;
+    return measured;
+}
+
+bool selftest_run_if_held(const selftest_pins &pins)
+{
+    if (!selftest_is_held(pins.button))
+    {
+        return false;
+    }
+
+    ESP_LOGI(TAG, "self-test started, watch the LEDs");
+    selftest_leds(pins);
+
+    ESP_LOGI(TAG, "release the button, then press it %d times", CONFIG_POMODORO_SELFTEST_PRESSES);
+    for (int waited_ms = 0; gpio_get_level(pins.button) == 0 && waited_ms < SELFTEST_PRESS_TIMEOUT_MS; waited_ms += 50)
+    {
+        vTaskDelay(pdMS_TO_TICKS(50));
+    }
+    vTaskDelay(pdMS_TO_TICKS(SELFTEST_QUIET_US / 1000));
+
+    button_pin = pins.button;
+    edges_count = 0;
+    gpio_set_intr_type(pins.button, GPIO_INTR_ANYEDGE);
+    gpio_install_isr_service(0);
+    gpio_isr_handler_add(pins.button, selftest_isr_handler, nullptr);
+
+    // done after the last release, or when time or edge space runs out
+    for (int waited_ms = 0; waited_ms < SELFTEST_PRESS_TIMEOUT_MS; waited_ms += 100)
+    {
+        vTaskDelay(pdMS_TO_TICKS(100));
+
+        size_t count = edges_count;
+        int64_t now = esp_timer_get_time();
+        selftest_result progress = selftest_analyze(edges, count, now, false);
+        if (count == SELFTEST_EDGES || (progress.presses >= CONFIG_POMODORO_SELFTEST_PRESSES && gpio_get_level(pins.button) == 1 && progress.press_max_ms > 0 &&
+                                        now - edges[count - 1].at >= SELFTEST_QUIET_US))
+        {
+            break;
+        }
+    }
+
+    gpio_isr_handler_remove(pins.button);
+    gpio_uninstall_isr_service();
+    gpio_set_intr_type(pins.button, GPIO_INTR_DISABLE);
+
+    result = selftest_analyze(edges, edges_count, esp_timer_get_time(), true);
+    result.has_run = true;
+    result.is_passed = result.presses == CONFIG_POMODORO_SELFTEST_PRESSES && result.bounce_max_us < SELFTEST_DEBOUNCE_US;
+
+    char json[256];
+    selftest_format(json, sizeof(json));
+    // on its own line and without log decoration, for provisioning scripts
+    printf("SELFTEST %s\n", json);
+
+    return true;
+}
+
+selftest_result selftest_get_result(void)
+{
+    return result;
+}
+
+size_t selftest_format(char *buf, size_t size)
+{
+    if (!result.has_run)
+    {
+        return 0;
+    }
+
+    uint8_t mac[6];
+    esp_read_mac(mac, ESP_MAC_WIFI_STA);
+
+    int len = snprintf(buf, size,
+                       "{\"mac\":\"%02x:%02x:%02x:%02x:%02x:%02x\",\"result\":\"%s\",\"leds_cycled\":3,\"presses\":%d,\"presses_expected\":%d,"
+                       "\"edges_max\":%d,\"bounce_max_us\":%" PRIu32 ",\"bounce_avg_us\":%" PRIu32 ",\"press_min_ms\":%" PRIu32 ",\"press_max_ms\":%" PRIu32 "}",
+                       mac[0], mac[1], mac[2], mac[3], mac[4], mac[5], result.is_passed ? "pass" : "fail", result.presses, CONFIG_POMODORO_SELFTEST_PRESSES,
+                       result.edges_max, result.bounce_max_us, result.bounce_avg_us, result.press_min_ms, result.press_max_ms);
+
+    return len < (int)size ? len : size - 1;
+}
@@ -0,0 +1,61 @@
+#ifndef SELFTEST_HPP_INCLUDED
+#define SELFTEST_HPP_INCLUDED
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "gpio.h"
+#include "esp_err.h"
+
+// Factory self-test. A button already down when the firmware starts and
+// held for a second cycles the LEDs one by one for the assembler to check,
+// then asks for CONFIG_POMODORO_SELFTEST_PRESSES presses and measures how
+// the button bounces. The result is one "SELFTEST {json}" line on the serial port and
+// GET /selftest on the http api, then the light boots on as usual.
+//
+// GPIO2 is a boot strap pin, a button held through reset keeps the chip
+// from booting, so it is pressed right after power on instead, before the
+// firmware looks at it a few hundred milliseconds later.
+
+#define SELFTEST_QUIET_US 30000 // no edge for this long ends a bounce
+
+struct selftest_pins
+{
+    gpio_num_t button; // active low
+    gpio_num_t leds[3];
+};
+
+struct selftest_result
+{
+    bool has_run;
+    bool is_passed;
+    uint8_t presses;
+    uint16_t edges_max;     // edges seen within one press or release
+    uint32_t bounce_max_us; // first to last edge of one press or release
+    uint32_t bounce_avg_us;
+    uint32_t press_min_ms;
+    uint32_t press_max_ms;
+};
+
+// Button level right after an edge, as the interrupt handler saw it.
+struct selftest_edge
+{
+    int64_t at; // esp_timer time, microseconds
+    uint8_t level;
+};
+
+// Measures presses and bounces in the edges recorded so far. Unless it is
+// final, a burst less than SELFTEST_QUIET_US before now is left out, it may
+// still be bouncing. Leaves has_run and is_passed to the caller.
+selftest_result selftest_analyze(const selftest_edge *edges, size_t count, int64_t now, bool is_final);
+
+// Runs the self-test when the button is held, before the pins are set up for
+// the pomodoro. Returns whether it ran.
+bool selftest_run_if_held(const selftest_pins &pins);
+
+selftest_result selftest_get_result(void);
+
+// The result as one JSON object, 0 when no self-test ran since boot.
+size_t selftest_format(char *buf, size_t size);
+
+#endif /* SELFTEST_HPP_INCLUDED */
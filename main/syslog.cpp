@@ -0,0 +1,410 @@
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include <time.h>
+#include <sys/time.h>
+#include <inttypes.h>
+
+#include "sdkconfig.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "lwip/sockets.h"
+#include "lwip/netdb.h"
+#if CONFIG_POMODORO_CONSOLE_ENABLE
+#include "esp_console.h"
+#endif
+
+#include "syslog.hpp"
+
+#define SYSLOG_EPOCH 1577836800 // 2020-01-01, earlier means no SNTP yet
+#define SYSLOG_FACILITY 16      // local0
+#define SYSLOG_TAGS 8
+#define SYSLOG_TAG_MAX 16
+#define SYSLOG_TEXT_MAX 104
+#define SYSLOG_LINE_MAX 160
+
+static const char *TAG = "syslog";
+
+struct syslog_entry
+{
+    uint32_t seconds;
+    uint16_t millis;
+    uint8_t severity;
+    uint8_t suppressed; // lines of this tag dropped just before, saturating
+    char tag[SYSLOG_TAG_MAX];
+    char text[SYSLOG_TEXT_MAX];
+};
+
+// Token bucket per tag holding up to CONFIG_POMODORO_SYSLOG_TAG_RATE lines
+// and refilled at that many per 60 s. The credit is kept in 1/60 of a line,
+// so a second adds CONFIG_POMODORO_SYSLOG_TAG_RATE and no fraction of a line
+// is lost between two refills. Tags beyond the table share its last bucket.
+#define SYSLOG_LINE_CREDIT 60
+#define SYSLOG_CREDIT_MAX (CONFIG_POMODORO_SYSLOG_TAG_RATE * SYSLOG_LINE_CREDIT)
+
+struct syslog_bucket
+{
+    char tag[SYSLOG_TAG_MAX];
+    uint32_t credit;
+    uint32_t refilled_at;
+    uint32_t suppressed;
+};
+
+static syslog_entry entries[CONFIG_POMODORO_SYSLOG_BUFFER];
+static size_t entries_head = 0;
+static size_t entries_count = 0;
+static uint32_t entries_popped = 0; // bumped whenever the head moves
+
+static syslog_bucket buckets[SYSLOG_TAGS];
+static size_t buckets_count = 0;
+
+static syslog_stats stats = {};
+
+static vprintf_like_t uart_vprintf = nullptr;
+static TaskHandle_t syslog_task_handle = nullptr;
+
+static void syslog_task(void *arg);
+
+// "W (1234) tag: text", possibly wrapped in color escapes
+static bool syslog_parse(char *line, char *level, char **tag, char **text)
+{
+    char *p = line;
+    if (*p == '\033')
+    {
+        p = strchr(p, 'm');
+        if (p == nullptr)
+        {
+            return false;
+        }
+        p++;
+    }
+    if (*p == '\0' || strchr("EWIDV", *p) == nullptr || p[1] != ' ' || p[2] != '(')
+    {
+        return false;
+    }
+    *level = *p;
+
+    p = strstr(p, ") ");
+    if (p == nullptr)
+    {
+        return false;
+    }
+    *tag = p + 2;
+
+    p = strstr(*tag, ": ");
+    if (p == nullptr)
+    {
+        return false;
+    }
+    *p = '\0';
+    *text = p + 2;
+
+    // strip the trailing color reset and newline
+    (*text)[strcspn(*text, "\033\r\n")] = '\0';
+
+    return true;
+}
+
+static uint8_t syslog_severity(char level)
+{
+    switch (level)
+    {
+    case 'E':
+        return 3;
+    case 'W':
+        return 4;
+    case 'I':
+        return 6;
+    default:
+        return 7;
+    }
+}
+
+// Called with interrupts off, returns false when the line is over the limit.
+// The tag is a whole SYSLOG_TAG_MAX buffer, terminated within it.
+static bool syslog_take_token(const char *tag, uint32_t now, uint8_t *suppressed)
+{
+    syslog_bucket *bucket = nullptr;
+    for (size_t i = 0; i < buckets_count; i++)
+    {
+        if (strncmp(buckets[i].tag, tag, SYSLOG_TAG_MAX - 1) == 0)
+        {
+            bucket = &buckets[i];
+            break;
+        }
+    }
+    if (bucket == nullptr)
+    {
+        if (buckets_count < SYSLOG_TAGS)
+        {
+            bucket = &buckets[buckets_count++];
+            memcpy(bucket->tag, tag, sizeof(bucket->tag));
+            bucket->credit = SYSLOG_CREDIT_MAX;
+            bucket->refilled_at = now;
+        }
+        else
+        {
+            bucket = &buckets[SYSLOG_TAGS - 1];
+        }
+    }
+
+    // a minute fills any bucket, longer gaps must not overflow the product
+    uint32_t elapsed = now - bucket->refilled_at;
+    uint32_t refill = (elapsed < 60 ? elapsed : 60) * CONFIG_POMODORO_SYSLOG_TAG_RATE;
+    bucket->credit = bucket->credit + refill > SYSLOG_CREDIT_MAX ? SYSLOG_CREDIT_MAX : bucket->credit + refill;
+    bucket->refilled_at = now;
+
+    if (bucket->credit < SYSLOG_LINE_CREDIT)
+    {
+        bucket->suppressed++;
+        stats.rate_limited++;
+        return false;
+    }
+
+    bucket->credit -= SYSLOG_LINE_CREDIT;
+    *suppressed = bucket->suppressed > UINT8_MAX ? UINT8_MAX : bucket->suppressed;
+    bucket->suppressed = 0;
+    return true;
+}
+
+static int syslog_vprintf(const char *format, va_list args)
+{
+    va_list copy;
+    va_copy(copy, args);
+    int written = uart_vprintf(format, args);
+
+    // the sender must not feed its own lines back, nor can ISRs queue
+    if (xTaskGetCurrentTaskHandle() == syslog_task_handle || xPortInIsrContext())
+    {
+        va_end(copy);
+        return written;
+    }
+
+    char line[SYSLOG_LINE_MAX];
+    vsnprintf(line, sizeof(line), format, copy);
+    va_end(copy);
+
+    char level;
+    char *tag;
+    char *text;
+    if (!syslog_parse(line, &level, &tag, &text))
+    {
+        return written;
+    }
+
+    struct timeval tv;
+    gettimeofday(&tv, nullptr);
+    uint32_t uptime = esp_log_timestamp() / 1000;
+
+    // everything is formatted before interrupts go off, only copied after
+    syslog_entry entry = {};
+    entry.seconds = tv.tv_sec;
+    entry.millis = tv.tv_usec / 1000;
+    entry.severity = syslog_severity(level);
+    strncpy(entry.tag, tag, sizeof(entry.tag) - 1);
+    strncpy(entry.text, text, sizeof(entry.text) - 1);
+    bool is_urgent = entry.severity <= 4;
+
+    portENTER_CRITICAL();
+    bool is_taken = syslog_take_token(entry.tag, uptime, &entry.suppressed);
+    if (is_taken)
+    {
+        // a full ring drops its oldest line, the newest tells more
+        size_t index = (entries_head + entries_count) % CONFIG_POMODORO_SYSLOG_BUFFER;
+        if (entries_count == CONFIG_POMODORO_SYSLOG_BUFFER)
+        {
+            entries_head = (entries_head + 1) % CONFIG_POMODORO_SYSLOG_BUFFER;
+            entries_popped++;
+            stats.overwritten++;
+        }
+        else
+        {
+            entries_count++;
+        }
+
+        entries[index] = entry;
+
+        is_urgent = is_urgent || entries_count * 4 >= CONFIG_POMODORO_SYSLOG_BUFFER * 3;
+    }
+    portEXIT_CRITICAL();
+
+    if (is_taken && is_urgent && syslog_task_handle != nullptr)
+    {
+        xTaskNotifyGive(syslog_task_handle);
+    }
+
+    return written;
+}
+
+esp_err_t syslog_setup(void)
+{
+    if (strlen(CONFIG_POMODORO_SYSLOG_HOST) == 0)
+    {
+        ESP_LOGW(TAG, "no syslog host configured, remote logging disabled");
+        return ESP_OK;
+    }
+
+    xTaskCreate(syslog_task, "syslog_task", 3072, nullptr, 2, &syslog_task_handle);
+    uart_vprintf = esp_log_set_vprintf(syslog_vprintf);
+
+    return ESP_OK;
+}
+
+syslog_stats syslog_get_stats(void)
+{
+    portENTER_CRITICAL();
+    syslog_stats copy = stats;
+    portEXIT_CRITICAL();
+
+    return copy;
+}
+
+static bool syslog_resolve(struct sockaddr_in *addr)
+{
+    struct addrinfo hints = {};
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_DGRAM;
+
+    struct addrinfo *result = nullptr;
+    if (getaddrinfo(CONFIG_POMODORO_SYSLOG_HOST, nullptr, &hints, &result) != 0 || result == nullptr)
+    {
+        return false;
+    }
+
+    *addr = *(struct sockaddr_in *)result->ai_addr;
+    addr->sin_port = htons(CONFIG_POMODORO_SYSLOG_PORT);
+    freeaddrinfo(result);
+
+    return true;
+}
+
+// <PRI>1 TIMESTAMP HOSTNAME APP-NAME PROCID MSGID SD MSG
+static int syslog_format(const syslog_entry *entry, char *buf, size_t size)
+{
+    char timestamp[32] = "-";
+    if (entry->seconds >= SYSLOG_EPOCH)
+    {
+        time_t seconds = entry->seconds;
+        struct tm tm;
+        gmtime_r(&seconds, &tm);
+        size_t len = strftime(timestamp, sizeof(timestamp), "%Y-%m-%dT%H:%M:%S", &tm);
+        snprintf(timestamp + len, sizeof(timestamp) - len, ".%03dZ", entry->millis);
+    }
+
+    int len = snprintf(buf, size, "<%d>1 %s %s %s - - - ", SYSLOG_FACILITY * 8 + entry->severity, timestamp,
+                       CONFIG_POMODORO_SYSLOG_HOSTNAME, entry->tag[0] != '\0' ? entry->tag : "-");
+    if (entry->suppressed > 0)
+    {
+        len += snprintf(buf + len, size - len, "(%d%s earlier lines suppressed) ", entry->suppressed, entry->suppressed == UINT8_MAX ? "+" : "");
+    }
+    len += snprintf(buf + len, size - len, "%s", entry->text);
+
+    return len < (int)size ? len : size - 1;
+}
+
+static void syslog_task(void *arg)
+{
+    int sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_IP);
+    if (sock < 0)
+    {
+        ESP_LOGE(TAG, "unable to create socket: errno %d", errno);
+        vTaskDelete(nullptr);
+        return;
+    }
+
+    struct sockaddr_in addr = {};
+    bool is_resolved = false;
+
+    for (;;)
+    {
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(CONFIG_POMODORO_SYSLOG_FLUSH_SECONDS * 1000));
+
+        if (!is_resolved)
+        {
+            // retried every burst, the network may not be up yet
+            is_resolved = syslog_resolve(&addr);
+            if (!is_resolved)
+            {
+                continue;
+            }
+        }
+
+        // One datagram per line as RFC 5426 asks, but all of them back to
+        // back, so the whole batch goes out in one radio wake.
+        bool is_sent = false;
+        for (;;)
+        {
+            syslog_entry entry;
+            uint32_t popped;
+
+            portENTER_CRITICAL();
+            bool has_entry = entries_count > 0;
+            if (has_entry)
+            {
+                entry = entries[entries_head];
+            }
+            popped = entries_popped;
+            portEXIT_CRITICAL();
+
+            if (!has_entry)
+            {
+                break;
+            }
+
+            char packet[SYSLOG_TEXT_MAX + 96];
+            int len = syslog_format(&entry, packet, sizeof(packet));
+            if (sendto(sock, packet, len, 0, (struct sockaddr *)&addr, sizeof(addr)) < 0)
+            {
+                // kept queued for the next burst
+                portENTER_CRITICAL();
+                stats.send_failed++;
+                portEXIT_CRITICAL();
+                break;
+            }
+
+            // unless a full ring overwrote it meanwhile, the head is the line sent
+            portENTER_CRITICAL();
+            if (popped == entries_popped)
+            {
+                entries_head = (entries_head + 1) % CONFIG_POMODORO_SYSLOG_BUFFER;
+                entries_count--;
+                entries_popped++;
+            }
+            stats.sent++;
+            portEXIT_CRITICAL();
+
+            is_sent = true;
+        }
+
+        if (is_sent)
+        {
+            portENTER_CRITICAL();
+            stats.bursts++;
+            portEXIT_CRITICAL();
+        }
+    }
+}
+
+#if CONFIG_POMODORO_CONSOLE_ENABLE
+static int syslog_command(int argc, char **argv)
+{
+    syslog_stats current = syslog_get_stats();
+
+    printf("syslog to %s:%d, sent=%" PRIu32 " bursts=%" PRIu32 " rate_limited=%" PRIu32 " overwritten=%" PRIu32 " send_failed=%" PRIu32 "\n",
+           CONFIG_POMODORO_SYSLOG_HOST, CONFIG_POMODORO_SYSLOG_PORT, current.sent, current.bursts, current.rate_limited, current.overwritten,
+           current.send_failed);
+    return 0;
+}
+
+esp_err_t syslog_register_command(void)
+{
+    esp_console_cmd_t cmd = {};
+
+    cmd.command = "syslog";
+    cmd.help = "Print the remote syslog counters";
+    cmd.func = &syslog_command;
+
+    return esp_console_cmd_register(&cmd);
+}
+#endif
@@ -0,0 +1,30 @@
+#ifndef SYSLOG_HPP_INCLUDED
+#define SYSLOG_HPP_INCLUDED
+
+#include <stdint.h>
+
+#include "esp_err.h"
+
+// Forwards ESP_LOG output to a remote RFC 5424 syslog server over UDP.
+// Lines still go to the UART, a copy is queued in a small ring and sent in
+// bursts every CONFIG_POMODORO_SYSLOG_FLUSH_SECONDS, or right away for
+// warnings and errors, so the radio wakes for a batch instead of a line.
+// Every tag gets CONFIG_POMODORO_SYSLOG_TAG_RATE lines a minute, the rest
+// is counted and reported with the next line that gets through.
+
+struct syslog_stats
+{
+    uint32_t sent;
+    uint32_t rate_limited; // dropped by the per tag limit
+    uint32_t overwritten;  // dropped because the ring was full
+    uint32_t send_failed;
+    uint32_t bursts;
+};
+
+esp_err_t syslog_setup(void);
+
+syslog_stats syslog_get_stats(void);
+
+esp_err_t syslog_register_command(void);
+
+#endif /* SYSLOG_HPP_INCLUDED */
@@ -0,0 +1,195 @@
+#include <ctype.h>
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+
+#include "sdkconfig.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#if CONFIG_POMODORO_CONSOLE_ENABLE
+#include "esp_console.h"
+#endif
+
+#include "journal.hpp"
+#include "tags.hpp"
+
+static const char *TAG = "tags";
+
+// Names are only ever appended, so a name pointer stays valid once handed out.
+static char names[TAGS_MAX][TAGS_NAME_MAX] = {""};
+static volatile size_t names_count = 1;
+static volatile uint8_t active_tag = TAGS_NONE;
+
+static tag_totals totals[TAGS_MAX];
+
+// Rolling totals use one bucket per day of the window, shared by all tags:
+// a bucket is cleared when a new day first lands on it, so counting stays
+// O(1) however long the history gets.
+static uint16_t day_minutes[TAGS_MAX][TAGS_ROLLING_DAYS];
+static int bucket_day[TAGS_ROLLING_DAYS] = {-1, -1, -1, -1, -1, -1, -1};
+
+static int tags_find(const char *name)
+{
+    for (size_t i = 0; i < names_count; i++)
+    {
+        if (strcmp(names[i], name) == 0)
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// Names end up unquoted in the console, CSV and JSON, so only characters
+// that need no escaping anywhere are accepted.
+static bool tags_is_valid_name(const char *name)
+{
+    for (const char *c = name; *c != '\0'; c++)
+    {
+        if (!isalnum((unsigned char)*c) && *c != '_' && *c != '.' && *c != '-')
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+esp_err_t tags_set_active(const char *name)
+{
+    if (strlen(name) >= TAGS_NAME_MAX)
+    {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    if (!tags_is_valid_name(name))
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    // the console and the http server both set tags, appends are serialized
+    // and readers never see a half written name
+    portENTER_CRITICAL();
+    int tag = tags_find(name);
+    if (tag < 0 && names_count < TAGS_MAX)
+    {
+        strcpy(names[names_count], name);
+        tag = names_count;
+        names_count++;
+    }
+    if (tag >= 0)
+    {
+        active_tag = tag;
+    }
+    portEXIT_CRITICAL();
+
+    if (tag < 0)
+    {
+        ESP_LOGW(TAG, "tag table full, %s not added", name);
+        return ESP_ERR_NO_MEM;
+    }
+    ESP_LOGI(TAG, "active tag: %s", names[tag]);
+
+    return ESP_OK;
+}
+
+uint8_t tags_get_active(void)
+{
+    return active_tag;
+}
+
+const char *tags_name(uint8_t tag)
+{
+    return tag < names_count ? names[tag] : "";
+}
+
+void tags_count_work(uint8_t tag, uint16_t minutes, int day)
+{
+    if (tag >= TAGS_MAX)
+    {
+        return;
+    }
+
+    size_t bucket = day % TAGS_ROLLING_DAYS;
+
+    portENTER_CRITICAL();
+
+    totals[tag].pomodoros++;
+    totals[tag].minutes += minutes;
+
+    if (bucket_day[bucket] != day)
+    {
+        bucket_day[bucket] = day;
+        for (size_t i = 0; i < TAGS_MAX; i++)
+        {
+            day_minutes[i][bucket] = 0;
+        }
+    }
+    day_minutes[tag][bucket] += minutes;
+
+    portEXIT_CRITICAL();
+}
+
+tag_totals tags_get_totals(uint8_t tag)
+{
+    tag_totals result = {};
+    if (tag >= TAGS_MAX)
+    {
+        return result;
+    }
+
+    int today = journal_today();
+
+    portENTER_CRITICAL();
+    result = totals[tag];
+    for (size_t i = 0; i < TAGS_ROLLING_DAYS; i++)
+    {
+        if (bucket_day[i] >= 0 && bucket_day[i] > today - TAGS_ROLLING_DAYS && bucket_day[i] <= today)
+        {
+            result.rolling_minutes += day_minutes[tag][i];
+        }
+    }
+    portEXIT_CRITICAL();
+
+    return result;
+}
+
+#if CONFIG_POMODORO_CONSOLE_ENABLE
+static int tag_command(int argc, char **argv)
+{
+    if (argc > 2)
+    {
+        printf("usage: tag [name]\n");
+        return 1;
+    }
+    if (argc == 2)
+    {
+        esp_err_t err = tags_set_active(strcmp(argv[1], "-") == 0 ? "" : argv[1]);
+        if (err != ESP_OK)
+        {
+            printf("cannot use tag %s: %s\n", argv[1], esp_err_to_name(err));
+            return 1;
+        }
+    }
+
+    printf("active tag: %s\n", tags_name(tags_get_active()));
+    for (size_t i = 0; i < names_count; i++)
+    {
+        tag_totals t = tags_get_totals(i);
+        printf("%-15s %" PRIu32 " pomodoros, %" PRIu32 " min, %" PRIu32 " min in %d days\n",
+               i == TAGS_NONE ? "(untagged)" : names[i], t.pomodoros, t.minutes, t.rolling_minutes, TAGS_ROLLING_DAYS);
+    }
+    return 0;
+}
+
+esp_err_t tags_register_command(void)
+{
+    esp_console_cmd_t cmd = {};
+
+    cmd.command = "tag";
+    cmd.help = "Show per tag totals, or set the active tag, - clears it";
+    cmd.hint = "[name]";
+    cmd.func = &tag_command;
+
+    return esp_console_cmd_register(&cmd);
+}
+#endif
@@ -0,0 +1,41 @@
+#ifndef TAGS_HPP_INCLUDED
+#define TAGS_HPP_INCLUDED
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+
+// Project tags attached to journal records. Names are interned into a fixed
+// table once and referred to by their index from then on, so tagging never
+// touches the heap. Index 0 is the empty "untagged" tag.
+
+#define TAGS_MAX 16
+#define TAGS_NAME_MAX 16 // including the terminator
+#define TAGS_ROLLING_DAYS 7
+#define TAGS_NONE 0
+
+struct tag_totals
+{
+    uint32_t pomodoros;
+    uint32_t minutes;
+    uint32_t rolling_minutes; // over the last TAGS_ROLLING_DAYS days
+};
+
+// Makes the named tag the active one, interning it if needed. An empty name
+// clears it. Names may only use [A-Za-z0-9_.-]. Fails when the name is too
+// long, has other characters or the table is full.
+esp_err_t tags_set_active(const char *name);
+
+uint8_t tags_get_active(void);
+
+const char *tags_name(uint8_t tag);
+
+// Called once per finished work period.
+void tags_count_work(uint8_t tag, uint16_t minutes, int day);
+
+tag_totals tags_get_totals(uint8_t tag);
+
+esp_err_t tags_register_command(void);
+
+#endif /* TAGS_HPP_INCLUDED */
@@ -0,0 +1,118 @@
+#ifndef TIME_UNITS_HPP_INCLUDED
+#define TIME_UNITS_HPP_INCLUDED
+
+#include <stdint.h>
+#include <type_traits>
+
+// Minimal strongly typed durations and time points, a tiny subset of
+// <chrono> without pulling it into the firmware. Every duration is an int64_t
+// count of ticks of MICROS microseconds; unit factors are template constants
+// so conversions fold at compile time and the types cost nothing at runtime.
+
+namespace time_units
+{
+
+    template <int64_t MICROS>
+    class duration
+    {
+        static_assert(MICROS > 0, "tick length must be positive");
+
+    public:
+        static constexpr int64_t micros_per_tick = MICROS;
+
+        constexpr duration() : ticks(0) {}
+        constexpr explicit duration(int64_t count) : ticks(count) {}
+
+        // lossless conversions from a coarser unit are implicit,
+        // anything that may truncate has to go through duration_cast
+        template <int64_t OTHER, typename = typename std::enable_if<OTHER % MICROS == 0>::type>
+        constexpr duration(duration<OTHER> other) : ticks(other.count() * (OTHER / MICROS)) {}
+
+        constexpr int64_t count() const { return ticks; }
+
+        // hidden friends, so a coarser operand converts implicitly
+        friend constexpr duration operator+(duration a, duration b) { return duration(a.ticks + b.ticks); }
+        friend constexpr duration operator-(duration a, duration b) { return duration(a.ticks - b.ticks); }
+        friend constexpr duration operator*(duration a, int64_t b) { return duration(a.ticks * b); }
+        friend constexpr duration operator*(int64_t a, duration b) { return duration(a * b.ticks); }
+        friend constexpr duration operator/(duration a, int64_t b) { return duration(a.ticks / b); }
+
+        friend constexpr bool operator==(duration a, duration b) { return a.ticks == b.ticks; }
+        friend constexpr bool operator!=(duration a, duration b) { return a.ticks != b.ticks; }
+        friend constexpr bool operator<(duration a, duration b) { return a.ticks < b.ticks; }
+        friend constexpr bool operator<=(duration a, duration b) { return a.ticks <= b.ticks; }
+        friend constexpr bool operator>(duration a, duration b) { return a.ticks > b.ticks; }
+        friend constexpr bool operator>=(duration a, duration b) { return a.ticks >= b.ticks; }
+
+        duration &operator+=(duration other)
+        {
+            ticks += other.ticks;
+            return *this;
+        }
+
+        duration &operator-=(duration other)
+        {
+            ticks -= other.ticks;
+            return *this;
+        }
+
+    private:
+        int64_t ticks;
+    };
+
+    template <int64_t MICROS>
+    constexpr int64_t duration<MICROS>::micros_per_tick;
+
+    using microseconds = duration<1>;
+    using milliseconds = duration<1000>;
+    using seconds = duration<1000000>;
+    using minutes = duration<60 * 1000000LL>;
+
+    // Truncates towards zero, like std::chrono::duration_cast.
+    template <typename TO, int64_t FROM>
+    constexpr TO duration_cast(duration<FROM> d)
+    {
+        return TO(FROM >= TO::micros_per_tick
+                      ? d.count() * (FROM / TO::micros_per_tick)
+                      : d.count() / (TO::micros_per_tick / FROM));
+    }
+
+    // Point on the monotonic esp_timer clock. The default value is the boot
+    // instant and doubles as "not set".
+    class time_point
+    {
+    public:
+        constexpr time_point() : since_boot(0) {}
+        constexpr explicit time_point(microseconds since_boot) : since_boot(since_boot) {}
+
+        constexpr microseconds time_since_boot() const { return since_boot; }
+        constexpr bool is_set() const { return since_boot.count() > 0; }
+
+        friend constexpr microseconds operator-(time_point a, time_point b) { return a.since_boot - b.since_boot; }
+        friend constexpr time_point operator+(time_point a, microseconds b) { return time_point(a.since_boot + b); }
+        friend constexpr time_point operator-(time_point a, microseconds b) { return time_point(a.since_boot - b); }
+
+        friend constexpr bool operator==(time_point a, time_point b) { return a.since_boot == b.since_boot; }
+        friend constexpr bool operator!=(time_point a, time_point b) { return a.since_boot != b.since_boot; }
+        friend constexpr bool operator<(time_point a, time_point b) { return a.since_boot < b.since_boot; }
+        friend constexpr bool operator>(time_point a, time_point b) { return a.since_boot > b.since_boot; }
+
+        time_point &operator+=(microseconds other)
+        {
+            since_boot += other;
+            return *this;
+        }
+
+    private:
+        microseconds since_boot;
+    };
+
+    // the wrappers are free: same size as the raw count, folded at compile time
+    static_assert(sizeof(seconds) == sizeof(int64_t), "duration must not add storage");
+    static_assert(sizeof(time_point) == sizeof(int64_t), "time_point must not add storage");
+    static_assert(seconds(minutes(45)).count() == 45 * 60, "lossless conversion");
+    static_assert(duration_cast<seconds>(microseconds(2999999)).count() == 2, "truncating conversion");
+
+} /* namespace time_units */
+
+#endif /* TIME_UNITS_HPP_INCLUDED */
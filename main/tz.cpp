@@ -0,0 +1,453 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <inttypes.h>
+
+#include "sdkconfig.h"
+#include "freertos/FreeRTOS.h"
+#include "esp_log.h"
+#if CONFIG_POMODORO_CONSOLE_ENABLE
+#include "esp_console.h"
+#endif
+
+#include "provision.hpp"
+#include "tz.hpp"
+
+static const char *TAG = "tz";
+
+struct tz_zone
+{
+    const char *name;
+    const char *rule;
+};
+
+static const tz_zone tz_table[] = {
+#include "tz_table.inc"
+};
+
+// The offset in force from one change to the next, refilled when an instant
+// outside of it is converted.
+struct tz_span
+{
+    int64_t from;
+    int64_t until;
+    int32_t offset;
+    bool is_dst;
+};
+
+static const char *zone_name = "UTC";
+static const char *zone_rule = "UTC0";
+static tz_rule rule = {};
+static tz_span cached = {1, 0, 0, false}; // empty until the first conversion
+
+int64_t tz_days_from_civil(int64_t year, int month, int day)
+{
+    year -= month <= 2;
+    int64_t era = (year >= 0 ? year : year - 399) / 400;
+    int64_t year_of_era = year - era * 400;
+    int64_t day_of_year = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+    int64_t day_of_era = year_of_era * 365 + year_of_era / 4 - year_of_era / 100 + day_of_year;
+    return era * 146097 + day_of_era - 719468;
+}
+
+static int64_t tz_year_of_days(int64_t days)
+{
+    days += 719468;
+    int64_t era = (days >= 0 ? days : days - 146096) / 146097;
+    int64_t day_of_era = days - era * 146097;
+    int64_t year_of_era = (day_of_era - day_of_era / 1460 + day_of_era / 36524 - day_of_era / 146096) / 365;
+    int64_t day_of_year = day_of_era - (365 * year_of_era + year_of_era / 4 - year_of_era / 100);
+    int64_t month = (5 * day_of_year + 2) / 153;
+    return year_of_era + era * 400 + (month >= 10);
+}
+
+static int64_t tz_floor_div(int64_t value, int64_t divisor)
+{
+    return value / divisor - (value % divisor < 0);
+}
+
+static bool tz_is_leap(int64_t year)
+{
+    return (year % 4 == 0 && year % 100 != 0) || year % 400 == 0;
+}
+
+// Name: three or more letters, or anything but '>' within angle brackets.
+static const char *tz_parse_name(const char *p)
+{
+    if (*p == '<')
+    {
+        const char *end = strchr(p, '>');
+        return end != nullptr && end - p >= 4 ? end + 1 : nullptr;
+    }
+
+    const char *start = p;
+    while (isalpha((unsigned char)*p))
+    {
+        p++;
+    }
+    return p - start >= 3 ? p : nullptr;
+}
+
+// [+-]hh[:mm[:ss]], up to 167 hours as the change times allow.
+static const char *tz_parse_time(const char *p, int32_t *seconds)
+{
+    int sign = 1;
+    if (*p == '+' || *p == '-')
+    {
+        sign = *p == '-' ? -1 : 1;
+        p++;
+    }
+    if (!isdigit((unsigned char)*p))
+    {
+        return nullptr;
+    }
+
+    char *end;
+    long hours = strtol(p, &end, 10);
+    long minutes = 0;
+    long secs = 0;
+    // strtol would take a sign or spaces after the colon as well
+    if (*end == ':' && isdigit((unsigned char)end[1]))
+    {
+        minutes = strtol(end + 1, &end, 10);
+        if (*end == ':' && isdigit((unsigned char)end[1]))
+        {
+            secs = strtol(end + 1, &end, 10);
+        }
+    }
+    if (hours > 167 || minutes > 59 || secs > 59)
+    {
+        return nullptr;
+    }
+
+    *seconds = sign * (hours * 3600 + minutes * 60 + secs);
+    return end;
+}
+
+static const char *tz_parse_change(const char *p, tz_change *change)
+{
+    char *end;
+    memset(change, 0, sizeof(*change));
+    change->time = 2 * 3600;
+
+    if (*p == 'M')
+    {
+        change->kind = 'M';
+        long month = strtol(p + 1, &end, 10);
+        if (*end != '.')
+        {
+            return nullptr;
+        }
+        long week = strtol(end + 1, &end, 10);
+        if (*end != '.')
+        {
+            return nullptr;
+        }
+        long weekday = strtol(end + 1, &end, 10);
+        if (month < 1 || month > 12 || week < 1 || week > 5 || weekday < 0 || weekday > 6)
+        {
+            return nullptr;
+        }
+        change->month = month;
+        change->week = week;
+        change->weekday = weekday;
+    }
+    else
+    {
+        change->kind = *p == 'J' ? 'J' : 'D';
+        const char *digits = *p == 'J' ? p + 1 : p;
+        if (!isdigit((unsigned char)*digits))
+        {
+            return nullptr;
+        }
+        long day = strtol(digits, &end, 10);
+        if (day > 365 || (change->kind == 'J' && day < 1))
+        {
+            return nullptr;
+        }
+        change->day = day;
+    }
+
+    p = end;
+    if (*p == '/')
+    {
+        p = tz_parse_time(p + 1, &change->time);
+    }
+    return p;
+}
+
+bool tz_parse(const char *posix, tz_rule *result)
+{
+    tz_rule parsed = {};
+    int32_t west;
+
+    const char *p = tz_parse_name(posix);
+    if (p == nullptr || (p = tz_parse_time(p, &west)) == nullptr)
+    {
+        return false;
+    }
+    // POSIX counts west of Greenwich as positive
+    parsed.std_offset = -west;
+    parsed.dst_offset = parsed.std_offset;
+
+    if (*p != '\0')
+    {
+        p = tz_parse_name(p);
+        if (p == nullptr)
+        {
+            return false;
+        }
+        parsed.has_dst = true;
+        parsed.dst_offset = parsed.std_offset + 3600;
+
+        if (*p != ',' && *p != '\0')
+        {
+            if ((p = tz_parse_time(p, &west)) == nullptr)
+            {
+                return false;
+            }
+            parsed.dst_offset = -west;
+        }
+
+        // without dates POSIX leaves the changes open, the US ones are common
+        const char *changes = *p == ',' ? p + 1 : "M3.2.0,M11.1.0";
+        p = tz_parse_change(changes, &parsed.dst_start);
+        if (p == nullptr || *p != ',' || (p = tz_parse_change(p + 1, &parsed.dst_end)) == nullptr)
+        {
+            return false;
+        }
+    }
+
+    if (*p != '\0')
+    {
+        return false;
+    }
+
+    *result = parsed;
+    return true;
+}
+
+int64_t tz_change_time(const tz_change &change, int year, int32_t offset)
+{
+    int64_t day;
+    if (change.kind == 'M')
+    {
+        int64_t first = tz_days_from_civil(year, change.month, 1);
+        int64_t next = change.month == 12 ? tz_days_from_civil(year + 1, 1, 1) : tz_days_from_civil(year, change.month + 1, 1);
+        // 1970-01-01 was a Thursday
+        int64_t first_weekday = first + 4 - tz_floor_div(first + 4, 7) * 7;
+
+        day = first + (change.weekday - first_weekday + 7) % 7 + (change.week - 1) * 7;
+        while (day >= next)
+        {
+            day -= 7;
+        }
+    }
+    else if (change.kind == 'J')
+    {
+        day = tz_days_from_civil(year, 1, 1) + change.day - 1;
+        if (tz_is_leap(year) && change.day >= 60)
+        {
+            day++;
+        }
+    }
+    else
+    {
+        day = tz_days_from_civil(year, 1, 1) + change.day;
+    }
+
+    return day * 86400 + change.time - offset;
+}
+
+// Both changes of the year before, this one and the next, sorted, tell
+// which offset is in force and until when.
+static tz_span tz_find_span(const tz_rule &zone, int64_t utc)
+{
+    tz_span span = {INT64_MIN, INT64_MAX, zone.std_offset, false};
+    if (!zone.has_dst)
+    {
+        return span;
+    }
+
+    struct
+    {
+        int64_t at;
+        bool is_dst;
+    } changes[6];
+    size_t count = 0;
+
+    int64_t year = tz_year_of_days(tz_floor_div(utc + zone.std_offset, 86400));
+    for (int64_t y = year - 1; y <= year + 1; y++)
+    {
+        int64_t at[2] = {tz_change_time(zone.dst_start, y, zone.std_offset), tz_change_time(zone.dst_end, y, zone.dst_offset)};
+        for (int i = 0; i < 2; i++)
+        {
+            size_t j = count++;
+            while (j > 0 && changes[j - 1].at > at[i])
+            {
+                changes[j] = changes[j - 1];
+                j--;
+            }
+            changes[j].at = at[i];
+            changes[j].is_dst = i == 0;
+        }
+    }
+
+    for (size_t i = 0; i < count; i++)
+    {
+        if (changes[i].at > utc)
+        {
+            span.until = changes[i].at;
+            break;
+        }
+        span.from = changes[i].at;
+        span.is_dst = changes[i].is_dst;
+    }
+    span.offset = span.is_dst ? zone.dst_offset : zone.std_offset;
+
+    return span;
+}
+
+int32_t tz_offset(int64_t utc, bool *is_dst, int64_t *next_change)
+{
+    portENTER_CRITICAL();
+    tz_span span = cached;
+    portEXIT_CRITICAL();
+
+    if (utc < span.from || utc >= span.until)
+    {
+        span = tz_find_span(rule, utc);
+
+        portENTER_CRITICAL();
+        cached = span;
+        portEXIT_CRITICAL();
+    }
+
+    if (is_dst != nullptr)
+    {
+        *is_dst = span.is_dst;
+    }
+    if (next_change != nullptr)
+    {
+        *next_change = span.until;
+    }
+    return span.offset;
+}
+
+void tz_localtime(int64_t utc, struct tm *local)
+{
+    bool is_dst;
+    time_t shifted = utc + tz_offset(utc, &is_dst, nullptr);
+
+    gmtime_r(&shifted, local);
+    local->tm_isdst = is_dst;
+}
+
+int64_t tz_to_utc(const struct tm *local)
+{
+    int64_t seconds = tz_days_from_civil(local->tm_year + 1900, local->tm_mon + 1, 1) * 86400 +
+                      (int64_t)(local->tm_mday - 1) * 86400 + local->tm_hour * 3600 + local->tm_min * 60 + local->tm_sec;
+
+    return tz_local_to_utc(nullptr, seconds);
+}
+
+int64_t tz_local_to_utc(const tz_rule *other, int64_t local)
+{
+    const tz_rule &in = other != nullptr ? *other : rule;
+    if (!in.has_dst)
+    {
+        return local - in.std_offset;
+    }
+
+    int32_t first = in.std_offset > in.dst_offset ? in.std_offset : in.dst_offset;
+    int32_t second = in.std_offset > in.dst_offset ? in.dst_offset : in.std_offset;
+
+    // the larger offset gives the earlier instant; the selected zone goes
+    // through the cache, other rules are looked at once
+    int32_t offset = other != nullptr ? tz_find_span(in, local - first).offset : tz_offset(local - first, nullptr, nullptr);
+    if (offset == first)
+    {
+        return local - first;
+    }
+    // either the smaller offset is in force or the time was skipped, and
+    // then the offset from before the change applies
+    return local - second;
+}
+
+const char *tz_find_zone(const char *name)
+{
+    for (size_t i = 0; i < sizeof(tz_table) / sizeof(tz_table[0]); i++)
+    {
+        if (strcmp(tz_table[i].name, name) == 0)
+        {
+            return tz_table[i].rule;
+        }
+    }
+    return nullptr;
+}
+
+esp_err_t tz_setup(void)
+{
+    const char *config = provision_get().timezone[0] != '\0' ? provision_get().timezone : CONFIG_POMODORO_TIMEZONE;
+
+    // not a known zone name, then it has to be a rule
+    const char *known = tz_find_zone(config);
+    zone_name = config;
+    zone_rule = known != nullptr ? known : config;
+
+    if (!tz_parse(zone_rule, &rule))
+    {
+        ESP_LOGW(TAG, "unknown time zone '%s', using UTC", config);
+        zone_name = "UTC";
+        zone_rule = "UTC0";
+        tz_parse(zone_rule, &rule);
+    }
+
+    // the span cached for another rule says nothing about this one
+    portENTER_CRITICAL();
+    cached = {1, 0, 0, false};
+    portEXIT_CRITICAL();
+
+    // the C library converts the same way wherever it is still used
+    setenv("TZ", zone_rule, 1);
+    tzset();
+
+    ESP_LOGI(TAG, "time zone %s (%s)", zone_name, zone_rule);
+
+    return ESP_OK;
+}
+
+#if CONFIG_POMODORO_CONSOLE_ENABLE
+static int tz_command(int argc, char **argv)
+{
+    int64_t now = time(nullptr);
+    bool is_dst;
+    int64_t next_change;
+    int32_t offset = tz_offset(now, &is_dst, &next_change);
+
+    // the sign on its own, the hours of UTC-0:30 are a zero
+    printf("%s (%s), now UTC%c%d:%02d%s\n", zone_name, zone_rule, offset < 0 ? '-' : '+', (int)(abs(offset) / 3600), (int)(abs(offset) % 3600 / 60),
+           is_dst ? " dst" : "");
+    if (next_change != INT64_MAX)
+    {
+        struct tm local;
+        char text[24];
+        tz_localtime(next_change, &local);
+        strftime(text, sizeof(text), "%Y-%m-%d %H:%M", &local);
+        printf("next change %s\n", text);
+    }
+    return 0;
+}
+
+esp_err_t tz_register_command(void)
+{
+    esp_console_cmd_t cmd = {};
+
+    cmd.command = "tz";
+    cmd.help = "Print the time zone and its next change";
+    cmd.func = &tz_command;
+
+    return esp_console_cmd_register(&cmd);
+}
+#endif
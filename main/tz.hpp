@@ -0,0 +1,64 @@
+#ifndef TZ_HPP_INCLUDED
+#define TZ_HPP_INCLUDED
+
+#include <stdint.h>
+#include <time.h>
+
+#include "esp_err.h"
+
+// Local time from a POSIX TZ rule, e.g. "CET-1CEST,M3.5.0,M10.5.0/3".
+// CONFIG_POMODORO_TIMEZONE is either a zone name from tz_table.inc, which
+// tools/tz_table.py generates from the tz database, or a rule itself. The
+// offset in force is cached together with the instants it starts and ends,
+// so converting only does rule arithmetic once per DST change.
+
+// Parsed rule, a DST change is a date rule plus the local time it happens.
+struct tz_change
+{
+    char kind;       // 'M' month.week.weekday, 'J' day 1-365 without Feb 29, 'D' day 0-365
+    uint8_t month;   // 1-12
+    uint8_t week;    // 1-5, 5 is the last one
+    uint8_t weekday; // 0-6, Sunday first
+    uint16_t day;
+    int32_t time; // seconds after local midnight, may be negative or past 24h
+};
+
+struct tz_rule
+{
+    int32_t std_offset; // seconds east of UTC
+    int32_t dst_offset;
+    bool has_dst;
+    tz_change dst_start;
+    tz_change dst_end;
+};
+
+bool tz_parse(const char *posix, tz_rule *rule);
+
+// Days since 1970-01-01 of a proleptic Gregorian date, month 1-12.
+int64_t tz_days_from_civil(int64_t year, int month, int day);
+
+// UTC instant of the change in the given year, a year like tm_year + 1900.
+int64_t tz_change_time(const tz_change &change, int year, int32_t offset);
+
+// POSIX rule of a zone name from tz_table.inc, nullptr for an unknown one.
+const char *tz_find_zone(const char *name);
+
+// Selects CONFIG_POMODORO_TIMEZONE, also as TZ for the C library.
+esp_err_t tz_setup(void);
+
+// Offset east of UTC at the given instant, next_change is when it changes.
+int32_t tz_offset(int64_t utc, bool *is_dst, int64_t *next_change);
+
+void tz_localtime(int64_t utc, struct tm *local);
+
+// UTC instant of a local time, fields as in mktime(). Times skipped by a
+// DST change are taken as before it, repeated ones as the first of the two.
+int64_t tz_to_utc(const struct tm *local);
+
+// The same for a local time in seconds since 1970-01-01 of the local clock,
+// in the given rule or, for nullptr, in the selected time zone.
+int64_t tz_local_to_utc(const tz_rule *rule, int64_t local);
+
+esp_err_t tz_register_command(void);
+
+#endif /* TZ_HPP_INCLUDED */
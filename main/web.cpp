@@ -0,0 +1,308 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+
+#include "sdkconfig.h"
+#include "esp_log.h"
+#include "esp_http_server.h"
+
+#include "journal.hpp"
+#include "tags.hpp"
+#include "busy.hpp"
+#include "pomodoro.hpp"
+#if CONFIG_POMODORO_HISTORY_ENABLE
+#include "history.hpp"
+#endif
+#if CONFIG_POMODORO_SELFTEST_ENABLE
+#include "selftest.hpp"
+#endif
+#include "web.hpp"
+
+#define WEB_CHUNK_SIZE 512
+#define WEB_TAG_ESCAPED_MAX (TAGS_NAME_MAX * 6) // every character as \u00XX
+#define WEB_LINE_MAX (96 + WEB_TAG_ESCAPED_MAX)
+
+static const char *TAG = "web";
+
+static httpd_handle_t server = nullptr;
+
+// Reads an optional unsigned query parameter, false if present but invalid,
+// a value too long for the buffer included.
+static bool web_query_u32(const char *query, const char *key, uint32_t *value)
+{
+    char buf[12];
+    esp_err_t err = query == nullptr ? ESP_ERR_NOT_FOUND : httpd_query_key_value(query, key, buf, sizeof(buf));
+    if (err == ESP_ERR_NOT_FOUND)
+    {
+        return true;
+    }
+    if (err != ESP_OK)
+    {
+        return false;
+    }
+
+    char *end;
+    unsigned long parsed = strtoul(buf, &end, 10);
+    if (end == buf || *end != '\0' || buf[0] == '-' || parsed > UINT32_MAX)
+    {
+        return false;
+    }
+
+    *value = parsed;
+    return true;
+}
+
+#if CONFIG_POMODORO_HISTORY_ENABLE
+// Tag names are checked when they are set, but the export must stay well
+// formed whatever ends up in them: CSV fields are quoted when they need it,
+// JSON strings get their quotes, backslashes and control characters escaped.
+static void web_escape(const char *text, bool is_json, char *out, size_t size)
+{
+    size_t len = 0;
+    bool needs_quotes = !is_json && strpbrk(text, ",\"\r\n") != nullptr;
+
+    if (needs_quotes)
+    {
+        out[len++] = '"';
+    }
+    for (const char *c = text; *c != '\0' && len + 7 < size; c++)
+    {
+        if (is_json && (*c == '"' || *c == '\\'))
+        {
+            out[len++] = '\\';
+            out[len++] = *c;
+        }
+        else if (is_json && (unsigned char)*c < 0x20)
+        {
+            len += snprintf(out + len, size - len, "\\u%04x", (unsigned char)*c);
+        }
+        else if (needs_quotes && *c == '"')
+        {
+            out[len++] = '"';
+            out[len++] = '"';
+        }
+        else
+        {
+            out[len++] = *c;
+        }
+    }
+    if (needs_quotes)
+    {
+        out[len++] = '"';
+    }
+    out[len] = '\0';
+}
+
+static esp_err_t history_get_handler(httpd_req_t *req)
+{
+    static const char *const events[] = {"work", "internal", "external", "absence"};
+
+    // a query cut short would silently drop the range, so it is refused
+    char query[64] = "";
+    if (httpd_req_get_url_query_len(req) >= sizeof(query))
+    {
+        return httpd_resp_send_err(req, HTTPD_414_URI_TOO_LONG, "query too long");
+    }
+    bool has_query = httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK;
+
+    uint32_t from = 0;
+    uint32_t to = UINT32_MAX;
+    bool is_ndjson = false;
+
+    if (has_query)
+    {
+        char format[8];
+        esp_err_t err = httpd_query_key_value(query, "format", format, sizeof(format));
+        if (err != ESP_ERR_NOT_FOUND)
+        {
+            if (err != ESP_OK || (strcmp(format, "ndjson") != 0 && strcmp(format, "csv") != 0))
+            {
+                return httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "format must be csv or ndjson");
+            }
+            is_ndjson = strcmp(format, "ndjson") == 0;
+        }
+    }
+    if (!web_query_u32(has_query ? query : nullptr, "from", &from) || !web_query_u32(has_query ? query : nullptr, "to", &to) || from > to)
+    {
+        return httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "from and to must be unix times, from <= to");
+    }
+
+    httpd_resp_set_type(req, is_ndjson ? "application/x-ndjson" : "text/csv");
+
+    // Records are formatted into one small chunk buffer that goes out as soon
+    // as the next line might not fit, nothing else is held in RAM.
+    char chunk[WEB_CHUNK_SIZE];
+    size_t len = 0;
+    if (!is_ndjson)
+    {
+        len = snprintf(chunk, sizeof(chunk), "timestamp,event,phase,detail,tag\n");
+    }
+
+    history_cursor cursor;
+    journal_record record;
+
+    history_query(&cursor, from, to);
+    while (history_next(&cursor, &record))
+    {
+        const char *event = record.event < sizeof(events) / sizeof(events[0]) ? events[record.event] : "unknown";
+        const char *format = is_ndjson ? "{\"timestamp\":%" PRIu32 ",\"event\":\"%s\",\"phase\":%d,\"detail\":%d,\"tag\":\"%s\"}\n"
+                                       : "%" PRIu32 ",%s,%d,%d,%s\n";
+
+        char tag[WEB_TAG_ESCAPED_MAX + 3];
+        web_escape(tags_name(record.tag), is_ndjson, tag, sizeof(tag));
+        len += snprintf(chunk + len, sizeof(chunk) - len, format, record.timestamp, event, record.phase, record.detail, tag);
+
+        if (len > sizeof(chunk) - WEB_LINE_MAX)
+        {
+            if (httpd_resp_send_chunk(req, chunk, len) != ESP_OK)
+            {
+                ESP_LOGW(TAG, "history export aborted by the client");
+                return ESP_FAIL;
+            }
+            len = 0;
+        }
+    }
+
+    if (len > 0 && httpd_resp_send_chunk(req, chunk, len) != ESP_OK)
+    {
+        return ESP_FAIL;
+    }
+    return httpd_resp_send_chunk(req, nullptr, 0);
+}
+#endif
+
+static esp_err_t busy_get_handler(httpd_req_t *req)
+{
+    httpd_resp_set_type(req, "application/json");
+    return httpd_resp_send(req, pomodoro_get_status().is_busy ? "{\"busy\":true}\n" : "{\"busy\":false}\n", HTTPD_RESP_USE_STRLEN);
+}
+
+// The change goes through the input queue, the answer only confirms the
+// request was queued. A full queue is worth a retry by the client.
+static esp_err_t busy_post_handler(httpd_req_t *req)
+{
+    char query[32];
+    char state[8];
+    esp_err_t err = ESP_ERR_INVALID_ARG;
+    if (httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK && httpd_query_key_value(query, "state", state, sizeof(state)) == ESP_OK)
+    {
+        err = busy_post(state);
+    }
+    if (err == ESP_ERR_TIMEOUT)
+    {
+        httpd_resp_set_status(req, "503 Service Unavailable");
+        httpd_resp_set_hdr(req, "Retry-After", "1");
+        return httpd_resp_send(req, "input queue full\n", HTTPD_RESP_USE_STRLEN);
+    }
+    if (err != ESP_OK)
+    {
+        return httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "state must be on, off or toggle");
+    }
+
+    httpd_resp_set_status(req, "202 Accepted");
+    return httpd_resp_send(req, nullptr, 0);
+}
+
+static esp_err_t tag_get_handler(httpd_req_t *req)
+{
+    char json[TAGS_NAME_MAX + 16];
+    size_t len = snprintf(json, sizeof(json), "{\"tag\":\"%s\"}\n", tags_name(tags_get_active()));
+
+    httpd_resp_set_type(req, "application/json");
+    return httpd_resp_send(req, json, len);
+}
+
+static esp_err_t tag_post_handler(httpd_req_t *req)
+{
+    char query[32];
+    char name[TAGS_NAME_MAX];
+    if (httpd_req_get_url_query_str(req, query, sizeof(query)) != ESP_OK || httpd_query_key_value(query, "name", name, sizeof(name)) != ESP_OK)
+    {
+        return httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "name must be up to 15 of [A-Za-z0-9_.-], - clears it");
+    }
+
+    esp_err_t err = tags_set_active(strcmp(name, "-") == 0 ? "" : name);
+    if (err == ESP_ERR_NO_MEM)
+    {
+        return httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "tag table full");
+    }
+    if (err != ESP_OK)
+    {
+        return httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "name must be up to 15 of [A-Za-z0-9_.-], - clears it");
+    }
+
+    return tag_get_handler(req);
+}
+
+#if CONFIG_POMODORO_SELFTEST_ENABLE
+static esp_err_t selftest_get_handler(httpd_req_t *req)
+{
+    char json[256];
+    size_t len = selftest_format(json, sizeof(json));
+    if (len == 0)
+    {
+        return httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, "no self-test since boot");
+    }
+
+    httpd_resp_set_type(req, "application/json");
+    return httpd_resp_send(req, json, len);
+}
+#endif
+
+esp_err_t web_setup(void)
+{
+    httpd_config_t config = HTTPD_DEFAULT_CONFIG();
+    config.server_port = CONFIG_POMODORO_HTTP_PORT;
+
+    esp_err_t err = httpd_start(&server, &config);
+    if (err != ESP_OK)
+    {
+        ESP_LOGE(TAG, "cannot start the http server: %s", esp_err_to_name(err));
+        return err;
+    }
+
+#if CONFIG_POMODORO_HISTORY_ENABLE
+    httpd_uri_t history_uri = {};
+    history_uri.uri = "/history";
+    history_uri.method = HTTP_GET;
+    history_uri.handler = history_get_handler;
+    ESP_ERROR_CHECK(httpd_register_uri_handler(server, &history_uri));
+#endif
+
+    httpd_uri_t busy_get_uri = {};
+    busy_get_uri.uri = "/busy";
+    busy_get_uri.method = HTTP_GET;
+    busy_get_uri.handler = busy_get_handler;
+    ESP_ERROR_CHECK(httpd_register_uri_handler(server, &busy_get_uri));
+
+    httpd_uri_t busy_post_uri = {};
+    busy_post_uri.uri = "/busy";
+    busy_post_uri.method = HTTP_POST;
+    busy_post_uri.handler = busy_post_handler;
+    ESP_ERROR_CHECK(httpd_register_uri_handler(server, &busy_post_uri));
+
+    httpd_uri_t tag_get_uri = {};
+    tag_get_uri.uri = "/tag";
+    tag_get_uri.method = HTTP_GET;
+    tag_get_uri.handler = tag_get_handler;
+    ESP_ERROR_CHECK(httpd_register_uri_handler(server, &tag_get_uri));
+
+    httpd_uri_t tag_post_uri = {};
+    tag_post_uri.uri = "/tag";
+    tag_post_uri.method = HTTP_POST;
+    tag_post_uri.handler = tag_post_handler;
+    ESP_ERROR_CHECK(httpd_register_uri_handler(server, &tag_post_uri));
+
+#if CONFIG_POMODORO_SELFTEST_ENABLE
+    httpd_uri_t selftest_uri = {};
+    selftest_uri.uri = "/selftest";
+    selftest_uri.method = HTTP_GET;
+    selftest_uri.handler = selftest_get_handler;
+    ESP_ERROR_CHECK(httpd_register_uri_handler(server, &selftest_uri));
+#endif
+
+    ESP_LOGI(TAG, "http api on port %d", CONFIG_POMODORO_HTTP_PORT);
+
+    return ESP_OK;
+}
@@ -0,0 +1,19 @@
+#ifndef WEB_HPP_INCLUDED
+#define WEB_HPP_INCLUDED
+
+#include "esp_err.h"
+
+// HTTP API on CONFIG_POMODORO_HTTP_PORT:
+//   GET /history?from=&to=&format=csv|ndjson
+//       journal records kept in flash within the unix time range, streamed
+//       chunk by chunk straight from flash; both bounds are optional
+//   GET /busy                          {"busy":true|false}
+//   POST /busy?state=on|off|toggle     sets the busy override, see busy.hpp
+//   GET /tag                           {"tag":"name"}, "" when untagged
+//   POST /tag?name=                    sets the active tag, - clears it; names
+//       are up to 15 of [A-Za-z0-9_.-], see tags.hpp
+//   GET /selftest                      result of the factory self-test run at
+//       this boot, see selftest.hpp; 404 without one
+esp_err_t web_setup(void);
+
+#endif /* WEB_HPP_INCLUDED */
@@ -1,9 +1,11 @@
 #include <string.h>
+#include <inttypes.h>
 
 #include "sdkconfig.h"
 #include "esp_event.h"
 #include "esp_wifi.h"
 #include "esp_log.h"
+#include "esp_system.h"
 #include "esp_event_loop.h"
 #include "tcpip_adapter.h"
 #include "freertos/FreeRTOS.h"
@@ -11,6 +13,12 @@
 #include "freertos/event_groups.h"
 #include "lwip/err.h"
 #include "lwip/sys.h"
+#include "lwip/apps/sntp.h"
+
+#include "provision.hpp"
+#if CONFIG_POMODORO_HEAP_TRACK_ENABLE
+#include "heap_track.hpp"
+#endif
 
 #define GOT_IPV4_BIT BIT(0)
 #define GOT_IPV6_BIT BIT(1)
@@ -18,8 +26,8 @@
 
 static EventGroupHandle_t s_connect_event_group;
 static ip4_addr_t s_ip_addr;
-static char s_connection_name[32] = CONFIG_WIFI_WIFI_SSID;
-static char s_connection_passwd[32] = CONFIG_WIFI_WIFI_PASSWORD;
+static char s_connection_name[33] = CONFIG_WIFI_WIFI_SSID;
+static char s_connection_passwd[64] = CONFIG_WIFI_WIFI_PASSWORD;
 
 static const char *TAG = "wifi_connect";
 
@@ -28,7 +36,11 @@ static void on_wifi_disconnect(void *arg, esp_event_base_t event_base,
 {
     system_event_sta_disconnected_t *event = (system_event_sta_disconnected_t *)event_data;
 
-    ESP_LOGI(TAG, "Wi-Fi disconnected, trying to reconnect...");
+    // reconnect storms are where fragmentation shows up first
+    ESP_LOGI(TAG, "Wi-Fi disconnected, trying to reconnect... (free heap %" PRIu32 ")", esp_get_free_heap_size());
+#if CONFIG_POMODORO_HEAP_TRACK_ENABLE
+    heap_track_sample();
+#endif
     if (event->reason == WIFI_REASON_BASIC_RATE_NOT_SUPPORT)
     {
         /*Switch to 802.11 bgn mode */
@@ -56,8 +68,16 @@ static void start(void)
     ESP_ERROR_CHECK(esp_wifi_set_storage(WIFI_STORAGE_RAM));
     wifi_config_t wifi_config = {};
 
+    // a provisioned network replaces the built in one
+    const provision_config &provisioned = provision_get();
+    if (provisioned.wifi_ssid[0] != '\0')
+    {
+        strncpy(s_connection_name, provisioned.wifi_ssid, sizeof(s_connection_name));
+        strncpy(s_connection_passwd, provisioned.wifi_password, sizeof(s_connection_passwd));
+    }
+
     strncpy((char *)&wifi_config.sta.ssid, s_connection_name, 32);
-    strncpy((char *)&wifi_config.sta.password, s_connection_passwd, 32);
+    strncpy((char *)&wifi_config.sta.password, s_connection_passwd, 64);
 
     ESP_LOGI(TAG, "Connecting to %s...", wifi_config.sta.ssid);
     ESP_ERROR_CHECK(esp_wifi_set_mode(WIFI_MODE_STA));
@@ -96,3 +116,20 @@ esp_err_t wifi_connect(void)
 
     return ESP_OK;
 }
+
+// Keeps the wall clock in sync, only needed by subsystems showing local time.
+esp_err_t time_sync_start(void)
+{
+    if (strlen(CONFIG_POMODORO_SNTP_SERVER) == 0)
+    {
+        return ESP_OK;
+    }
+
+    sntp_setoperatingmode(SNTP_OPMODE_POLL);
+    sntp_setservername(0, (char *)CONFIG_POMODORO_SNTP_SERVER);
+    sntp_init();
+
+    ESP_LOGI(TAG, "SNTP started with %s", CONFIG_POMODORO_SNTP_SERVER);
+
+    return ESP_OK;
+}
@@ -0,0 +1,143 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "esp_timer.h"
+#include "gpio.h"
+#include "driver/hw_timer.h"
+
+#include "blink.hpp"
+#include "check.hpp"
+
+// CPU wakeups of the blink timer, counted on a model of FRC1: none while
+// the LEDs are steady, one a second while any of them blinks, however many
+// blink together. Steady periods and blinking ones follow led_visualize().
+
+#define RED GPIO_NUM_14
+#define YELLOW GPIO_NUM_12
+#define GREEN GPIO_NUM_13
+
+#define SECOND 1000000LL
+#define MINUTE (60 * SECOND)
+#define HOUR (60 * MINUTE)
+
+static int levels[STUB_GPIO_PINS];
+static int writes[STUB_GPIO_PINS];
+
+static void set_level(gpio_num_t pin, uint32_t level)
+{
+    levels[pin] = level;
+    writes[pin]++;
+}
+
+static uint32_t wakeups_during(int64_t us)
+{
+    uint32_t before = stub_hw_timer_interrupts();
+    stub_timer_advance(us);
+    CHECK(blink_get_wakeups() == stub_hw_timer_interrupts());
+    return stub_hw_timer_interrupts() - before;
+}
+
+static void test_steady(void)
+{
+    CHECK(blink_setup() == ESP_OK);
+    CHECK(!stub_hw_timer_armed());
+
+    blink_set(0);
+    CHECK(!stub_hw_timer_armed());
+    CHECK(wakeups_during(HOUR) == 0);
+}
+
+static void test_idle(void)
+{
+    // yellow is lit at once and goes off after the first second
+    blink_set(1 << YELLOW);
+    CHECK(stub_hw_timer_armed());
+    CHECK(levels[YELLOW] == 0);
+    CHECK(wakeups_during(SECOND - 1) == 0);
+    CHECK(wakeups_during(1) == 1);
+    CHECK(levels[YELLOW] == 1);
+    CHECK(wakeups_during(SECOND) == 1);
+    CHECK(levels[YELLOW] == 0);
+
+    // one wakeup per edge, nothing else
+    int before = writes[YELLOW];
+    CHECK(wakeups_during(HOUR) == 3600);
+    CHECK(writes[YELLOW] - before == 3600);
+    CHECK(levels[YELLOW] == 0);
+
+    // the same mask again, as every refresh hands it over, keeps the phase
+    stub_timer_advance(SECOND / 2);
+    blink_set(1 << YELLOW);
+    CHECK(wakeups_during(SECOND / 2) == 1);
+    CHECK(levels[YELLOW] == 1);
+    CHECK(writes[GREEN] == 0);
+}
+
+static void test_together(void)
+{
+    // a break asking for air: red and yellow on the one interrupt
+    blink_set((1 << RED) | (1 << YELLOW));
+    CHECK(levels[RED] == 0 && levels[YELLOW] == 0);
+    for (int i = 0; i < 600; i++)
+    {
+        CHECK(wakeups_during(SECOND) == 1);
+        CHECK(levels[RED] == levels[YELLOW]);
+    }
+
+    // steady again, the pins are left to the caller and nothing wakes up
+    blink_set(0);
+    CHECK(!stub_hw_timer_armed());
+    int red_writes = writes[RED];
+    CHECK(wakeups_during(24 * HOUR) == 0);
+    CHECK(writes[RED] == red_writes);
+}
+
+// The day of tools/energy_model.py --day: eight 45/15 cycles and a long
+// break counted on steady LEDs, the rest of the day idle with yellow blinking.
+// One work period is paused for ten minutes on top, which blinks too.
+static void test_day(void)
+{
+    uint32_t before = stub_hw_timer_interrupts();
+
+    blink_set(1 << YELLOW); // idle in the morning
+    stub_timer_advance(4 * HOUR);
+    for (int cycle = 0; cycle < 8; cycle++)
+    {
+        blink_set(0); // work, green steady
+        stub_timer_advance(20 * MINUTE);
+        if (cycle == 3)
+        {
+            blink_set(1 << YELLOW); // paused
+            stub_timer_advance(10 * MINUTE);
+            blink_set(0);
+        }
+        stub_timer_advance(25 * MINUTE);
+        blink_set(0); // break, red steady
+        stub_timer_advance(15 * MINUTE);
+    }
+    stub_timer_advance(30 * MINUTE);
+    blink_set(1 << YELLOW); // idle until midnight
+    stub_timer_advance(24 * HOUR - 4 * HOUR - 8 * HOUR - 30 * MINUTE);
+    blink_set(0);
+
+    uint32_t idle_seconds = 24 * 3600 - 8 * 3600 - 30 * 60;
+    CHECK(stub_hw_timer_interrupts() - before == idle_seconds + 10 * 60);
+}
+
+int main(void)
+{
+    for (int &level : levels)
+    {
+        level = 1;
+    }
+    stub_gpio().set_level = set_level;
+    stub_timer_set(SECOND);
+
+    test_steady();
+    test_idle();
+    test_together();
+    test_day();
+
+    printf("blink: %d failed checks\n", check_failures);
+    return check_failures != 0;
+}
@@ -0,0 +1,239 @@
+#include <stdio.h>
+
+#include "esp_timer.h"
+#include "pomodoro_fsm.hpp"
+#include "check.hpp"
+
+// The busy override in and out of every state, with the policy the target
+// was built with, see CMakeLists.txt.
+
+static int work_done = 0;
+
+void journal_add(journal_event event, pomodoro_phase phase, uint16_t detail)
+{
+    (void)phase;
+    (void)detail;
+    work_done += event == JOURNAL_WORK_DONE;
+}
+
+bool pomodoro_post_input(uint32_t input)
+{
+    (void)input;
+    return true;
+}
+
+static const TimerAction timer_action = {};
+static const CheckTimer check_timer = {};
+static const ResetTimer reset_timer = {};
+static const PresenceLost presence_lost = {};
+static const PresenceReturned presence_returned = {};
+
+static BusyChanged busy(bool is_busy)
+{
+    BusyChanged event;
+    event.is_busy = is_busy;
+    return event;
+}
+
+static CalendarChanged calendar(bool is_busy)
+{
+    CalendarChanged event;
+    event.is_busy = is_busy;
+    return event;
+}
+
+static void advance_minutes(int64_t count)
+{
+    stub_timer_advance(count * 60 * 1000000);
+}
+
+#if CONFIG_POMODORO_BUSY_PAUSES
+static const bool pauses = true;
+#else
+static const bool pauses = false;
+#endif
+
+// A period started and counted for a minute.
+template <typename S>
+static void start_in(instance_fsm::Machine<Pomodoro> &fsm)
+{
+    fsm.start<S>(initial_context);
+    fsm.dispatch(timer_action);
+    advance_minutes(1);
+}
+
+static void test_idle(void)
+{
+    instance_fsm::Machine<Pomodoro> fsm;
+    fsm.start<Idle>(initial_context);
+
+    fsm.dispatch(busy(true));
+    CHECK(fsm.is_in_state<Idle>());
+    CHECK(fsm.state()->context.busy);
+    CHECK(!fsm.state()->is_started());
+
+    // the override carries into the period started under it
+    fsm.dispatch(timer_action);
+    CHECK(fsm.is_in_state<Work>());
+    CHECK(fsm.state()->context.busy);
+
+    fsm.dispatch(busy(false));
+    CHECK(!fsm.state()->context.busy);
+    CHECK(fsm.is_in_state<Work>());
+    CHECK(!fsm.state()->is_started());
+}
+
+static void test_work(void)
+{
+    instance_fsm::Machine<Pomodoro> fsm;
+    start_in<Work>(fsm);
+
+    fsm.dispatch(busy(true));
+    CHECK(fsm.state()->is_paused() == pauses);
+    CHECK(fsm.state()->context.auto_paused == pauses);
+
+    // the whole period passes under the override
+    advance_minutes(60);
+    fsm.dispatch(check_timer);
+    CHECK(fsm.is_in_state<Work>() == pauses);
+    CHECK(fsm.is_in_state<ShortBreak>() == !pauses);
+    CHECK(work_done == (pauses ? 0 : 1));
+    work_done = 0;
+
+    fsm.dispatch(busy(false));
+    CHECK(!fsm.state()->context.busy);
+    CHECK(!fsm.state()->is_paused());
+    if (pauses)
+    {
+        // counted on from where the override stopped it
+        CHECK(fsm.state()->get_counting_seconds() == minutes(1));
+        advance_minutes(44);
+        fsm.dispatch(check_timer);
+        CHECK(fsm.is_in_state<ShortBreak>());
+        CHECK(work_done == 1);
+        work_done = 0;
+    }
+}
+
+static void test_work_manual_pause(void)
+{
+    instance_fsm::Machine<Pomodoro> fsm;
+    start_in<Work>(fsm);
+
+    fsm.dispatch(timer_action);
+    CHECK(fsm.state()->is_paused());
+
+    // the override never resumes a pause it did not make
+    fsm.dispatch(busy(true));
+    fsm.dispatch(busy(false));
+    CHECK(fsm.state()->is_paused());
+    CHECK(!fsm.state()->context.auto_paused);
+}
+
+// 4a1c18d: the end of the override must not resume an empty desk.
+static void test_work_with_presence(void)
+{
+    instance_fsm::Machine<Pomodoro> fsm;
+    start_in<Work>(fsm);
+
+    fsm.dispatch(presence_lost);
+    CHECK(fsm.state()->is_paused());
+    fsm.dispatch(busy(true));
+    fsm.dispatch(busy(false));
+    CHECK(fsm.state()->is_paused());
+    fsm.dispatch(presence_returned);
+    CHECK(!fsm.state()->is_paused());
+
+    // and the return to the desk must not end the override's pause
+    fsm.dispatch(busy(true));
+    fsm.dispatch(presence_lost);
+    fsm.dispatch(presence_returned);
+    CHECK(fsm.state()->is_paused() == pauses);
+    fsm.dispatch(busy(false));
+    CHECK(!fsm.state()->is_paused());
+}
+
+static void test_work_with_calendar(void)
+{
+    instance_fsm::Machine<Pomodoro> fsm;
+    start_in<Work>(fsm);
+
+    fsm.dispatch(calendar(true));
+    fsm.dispatch(busy(true));
+    fsm.dispatch(busy(false));
+    CHECK(fsm.state()->is_paused());
+    fsm.dispatch(calendar(false));
+    CHECK(!fsm.state()->is_paused());
+
+    fsm.dispatch(busy(true));
+    fsm.dispatch(calendar(true));
+    fsm.dispatch(calendar(false));
+    CHECK(fsm.state()->is_paused() == pauses);
+    fsm.dispatch(busy(false));
+    CHECK(!fsm.state()->is_paused());
+}
+
+// Breaks are held as well, they end once the override is off.
+template <typename S, typename Next>
+static void test_break(minutes period)
+{
+    instance_fsm::Machine<Pomodoro> fsm;
+    start_in<S>(fsm);
+
+    fsm.dispatch(busy(true));
+    CHECK(fsm.state()->is_paused() == pauses);
+    advance_minutes(period.count() * 2);
+    fsm.dispatch(check_timer);
+    CHECK(fsm.template is_in_state<S>() == pauses);
+    CHECK(fsm.template is_in_state<Next>() == !pauses);
+    if (!pauses)
+    {
+        return;
+    }
+
+    fsm.dispatch(busy(false));
+    CHECK(!fsm.state()->is_paused());
+    advance_minutes(period.count());
+    fsm.dispatch(check_timer);
+    CHECK(fsm.template is_in_state<Next>());
+    CHECK(!fsm.state()->context.busy);
+}
+
+// A reset under the override keeps it, only switching it off ends it.
+static void test_reset(void)
+{
+    instance_fsm::Machine<Pomodoro> fsm;
+    start_in<ShortBreak>(fsm);
+
+    fsm.dispatch(busy(true));
+    fsm.dispatch(reset_timer);
+    CHECK(fsm.is_in_state<Idle>());
+    CHECK(fsm.state()->context.busy);
+    CHECK(!fsm.state()->context.auto_paused);
+
+    // a period started by hand under the override runs
+    fsm.dispatch(reset_timer);
+    CHECK(fsm.is_in_state<Work>());
+    fsm.dispatch(timer_action);
+    CHECK(fsm.state()->is_timer_active());
+    fsm.dispatch(busy(false));
+    CHECK(fsm.state()->is_timer_active());
+}
+
+int main(void)
+{
+    stub_timer_set(1000000);
+
+    test_idle();
+    test_work();
+    test_work_manual_pause();
+    test_work_with_presence();
+    test_work_with_calendar();
+    test_break<ShortBreak, Work>(minutes(15));
+    test_break<LongBreak, LongBreakLastMinutes>(minutes(15));
+    test_break<LongBreakLastMinutes, Work>(minutes(30));
+    test_reset();
+
+    printf("busy (%s): %d failed checks\n", pauses ? "pauses" : "keeps running", check_failures);
+    return check_failures != 0;
+}
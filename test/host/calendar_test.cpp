@@ -0,0 +1,291 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "provision.hpp"
+#include "pomodoro.hpp"
+#include "tz.hpp"
+#include "calendar.hpp"
+#include "check.hpp"
+
+#define EVENTS 8
+
+// The device runs on London time, the zone calendar.cpp falls back to.
+static provision_config config = {};
+
+const provision_config &provision_get(void)
+{
+    return config;
+}
+
+bool pomodoro_post_input(uint32_t input)
+{
+    (void)input;
+    return true;
+}
+
+static uint32_t utc(int year, int month, int day, int hour, int minute)
+{
+    return tz_days_from_civil(year, month, day) * 86400 + hour * 3600 + minute * 60;
+}
+
+static calendar_interval intervals[EVENTS];
+
+// Feeds the sample in pieces of the given size, as the socket would.
+static size_t parse(const char *ics, uint32_t now, size_t piece)
+{
+    calendar_parser parser;
+    calendar_parser_init(&parser, intervals, EVENTS, now);
+
+    size_t len = strlen(ics);
+    for (size_t i = 0; i < len; i += piece)
+    {
+        calendar_parser_feed(&parser, ics + i, len - i < piece ? len - i : piece);
+    }
+    return calendar_parser_finish(&parser);
+}
+
+static bool is_interval(size_t i, uint32_t start, uint32_t end)
+{
+    if (intervals[i].start != start || intervals[i].end != end)
+    {
+        fprintf(stderr, "interval %u is %u-%u, not %u-%u\n", (unsigned)i, intervals[i].start, intervals[i].end, start, end);
+        return false;
+    }
+    return true;
+}
+
+static void test_single_events(void)
+{
+    const char *ics = "BEGIN:VCALENDAR\r\n"
+                      "BEGIN:VEVENT\r\n"
+                      "SUMMARY:utc\r\n"
+                      "DTSTART:20240304T090000Z\r\n"
+                      "DTEND:20240304T093000Z\r\n"
+                      "END:VEVENT\r\n"
+                      "BEGIN:VEVENT\r\n"
+                      "SUMMARY:in a known zone\r\n"
+                      "DTSTART;TZID=America/New_York:20240304T080000\r\n"
+                      "DURATION:PT1H\r\n"
+                      "END:VEVENT\r\n"
+                      "BEGIN:VEVENT\r\n"
+                      "SUMMARY:device local time, and a zone nobody knows\r\n"
+                      "DTSTART:20240304T150000\r\n"
+                      "DTEND;TZID=\"W. Europe Standard Time\":20240304T153000\r\n"
+                      "END:VEVENT\r\n"
+                      "BEGIN:VEVENT\r\n"
+                      "SUMMARY:all day\r\n"
+                      "DTSTART;VALUE=DATE:20240304\r\n"
+                      "DTEND;VALUE=DATE:20240305\r\n"
+                      "END:VEVENT\r\n"
+                      "BEGIN:VEVENT\r\n"
+                      "DTSTART:20240304T100000Z\r\n"
+                      "DTEND:20240304T110000Z\r\n"
+                      "STATUS:CANCELLED\r\n"
+                      "END:VEVENT\r\n"
+                      "BEGIN:VEVENT\r\n"
+                      "DTSTART:20240304T100000Z\r\n"
+                      "DTEND:20240304T110000Z\r\n"
+                      "TRANSP:TRANSPARENT\r\n"
+                      "END:VEVENT\r\n"
+                      "BEGIN:VEVENT\r\n"
+                      "SUMMARY:over already\r\n"
+                      "DTSTART:20240304T060000Z\r\n"
+                      "DTEND:20240304T070000Z\r\n"
+                      "END:VEVENT\r\n"
+                      "END:VCALENDAR\r\n";
+
+    // byte by byte and in bigger pieces alike
+    size_t pieces[] = {1, 7, 128};
+    for (size_t i = 0; i < sizeof(pieces) / sizeof(pieces[0]); i++)
+    {
+        CHECK(parse(ics, utc(2024, 3, 4, 8, 0), pieces[i]) == 3);
+        CHECK(is_interval(0, utc(2024, 3, 4, 9, 0), utc(2024, 3, 4, 9, 30)));
+        CHECK(is_interval(1, utc(2024, 3, 4, 13, 0), utc(2024, 3, 4, 14, 0)));
+        CHECK(is_interval(2, utc(2024, 3, 4, 15, 0), utc(2024, 3, 4, 15, 30)));
+    }
+}
+
+static void test_merge_and_folding(void)
+{
+    const char *ics = "BEGIN:VEVENT\r\n"
+                      "DTSTART:20240304T090000Z\r\n"
+                      "DTEND:20240304T100000Z\r\n"
+                      "END:VEVENT\r\n"
+                      "BEGIN:VEVENT\r\n"
+                      "DTSTART:2024030\r\n"
+                      " 4T093000Z\r\n"
+                      "DTEND:20240304T103000Z\r\n"
+                      "RRULE:FREQ=DAILY;CO\r\n"
+                      "\tUNT=2\r\n"
+                      "END:VEVENT\r\n";
+
+    CHECK(parse(ics, utc(2024, 3, 4, 8, 0), 5) == 2);
+    CHECK(is_interval(0, utc(2024, 3, 4, 9, 0), utc(2024, 3, 4, 10, 30)));
+    CHECK(is_interval(1, utc(2024, 3, 5, 9, 30), utc(2024, 3, 5, 10, 30)));
+}
+
+static void test_weekly_count(void)
+{
+    const char *ics = "BEGIN:VEVENT\r\n"
+                      "DTSTART;TZID=Europe/Berlin:20240304T100000\r\n"
+                      "DURATION:PT30M\r\n"
+                      "RRULE:FREQ=WEEKLY;BYDAY=MO,WE,FR;COUNT=5\r\n"
+                      "END:VEVENT\r\n";
+
+    // Mon 4, Wed 6, Fri 8, Mon 11, Wed 13 March, at 10:00 CET
+    CHECK(parse(ics, utc(2024, 3, 7, 0, 0), 64) == 1);
+    CHECK(is_interval(0, utc(2024, 3, 8, 9, 0), utc(2024, 3, 8, 9, 30)));
+
+    CHECK(parse(ics, utc(2024, 3, 10, 0, 0), 64) == 1);
+    CHECK(is_interval(0, utc(2024, 3, 11, 9, 0), utc(2024, 3, 11, 9, 30)));
+
+    // Fri 15 would be within the window, but the series ended
+    CHECK(parse(ics, utc(2024, 3, 13, 12, 0), 64) == 0);
+}
+
+static void test_weekly_across_dst(void)
+{
+    const char *ics = "BEGIN:VEVENT\r\n"
+                      "DTSTART;TZID=Europe/Berlin:20240325T100000\r\n"
+                      "DTEND;TZID=Europe/Berlin:20240325T103000\r\n"
+                      "RRULE:FREQ=WEEKLY\r\n"
+                      "END:VEVENT\r\n";
+
+    // the wall clock time stays, CEST is an hour closer to UTC
+    CHECK(parse(ics, utc(2024, 3, 31, 12, 0), 64) == 1);
+    CHECK(is_interval(0, utc(2024, 4, 1, 8, 0), utc(2024, 4, 1, 8, 30)));
+}
+
+static void test_weekly_long_ago(void)
+{
+    const char *ics = "BEGIN:VEVENT\r\n"
+                      "DTSTART:20200106T090000Z\r\n"
+                      "DTEND:20200106T100000Z\r\n"
+                      "RRULE:FREQ=WEEKLY;INTERVAL=2;WKST=SU\r\n"
+                      "END:VEVENT\r\n";
+
+    // Monday 11 March 2024 is 218 weeks later, the 4th is an odd week off
+    CHECK(parse(ics, utc(2024, 3, 3, 0, 0), 64) == 0);
+    CHECK(parse(ics, utc(2024, 3, 10, 0, 0), 64) == 1);
+    CHECK(is_interval(0, utc(2024, 3, 11, 9, 0), utc(2024, 3, 11, 10, 0)));
+}
+
+static void test_daily_until_and_exdate(void)
+{
+    const char *ics = "BEGIN:VEVENT\r\n"
+                      "DTSTART:20240304T120000Z\r\n"
+                      "DURATION:PT2H\r\n"
+                      "RRULE:FREQ=DAILY;UNTIL=20240306T120000Z\r\n"
+                      "EXDATE:20240305T120000Z\r\n"
+                      "END:VEVENT\r\n";
+
+    CHECK(parse(ics, utc(2024, 3, 4, 13, 0), 64) == 2);
+    CHECK(is_interval(0, utc(2024, 3, 4, 12, 0), utc(2024, 3, 4, 14, 0)));
+    CHECK(is_interval(1, utc(2024, 3, 6, 12, 0), utc(2024, 3, 6, 14, 0)));
+
+    CHECK(parse(ics, utc(2024, 3, 6, 15, 0), 64) == 0);
+}
+
+static void test_daily_weekdays(void)
+{
+    const char *ics = "BEGIN:VEVENT\r\n"
+                      "DTSTART:20240301T090000\r\n"
+                      "DURATION:PT15M\r\n"
+                      "RRULE:FREQ=DAILY;BYDAY=MO,TU,WE,TH,FR;UNTIL=20240308\r\n"
+                      "EXDATE;TZID=Europe/London:20240306T090000,20240307T090000\r\n"
+                      "END:VEVENT\r\n";
+
+    // Fri 8 is the last day, the weekend never counts
+    CHECK(parse(ics, utc(2024, 3, 8, 0, 0), 64) == 1);
+    CHECK(is_interval(0, utc(2024, 3, 8, 9, 0), utc(2024, 3, 8, 9, 15)));
+
+    CHECK(parse(ics, utc(2024, 3, 5, 12, 0), 64) == 0);
+}
+
+// Every seventh day from a Monday is a Monday, the Saturdays never come.
+static void test_byday_never_reached(void)
+{
+    const char *ics = "BEGIN:VEVENT\r\n"
+                      "DTSTART:20240304T090000Z\r\n"
+                      "DURATION:PT15M\r\n"
+                      "RRULE:FREQ=DAILY;INTERVAL=7;BYDAY=SA\r\n"
+                      "END:VEVENT\r\n"
+                      "BEGIN:VEVENT\r\n"
+                      "DTSTART:20240304T100000Z\r\n"
+                      "DURATION:PT15M\r\n"
+                      "RRULE:FREQ=DAILY;INTERVAL=14;BYDAY=SU;COUNT=3\r\n"
+                      "END:VEVENT\r\n";
+
+    CHECK(parse(ics, utc(2024, 3, 4, 0, 0), 64) == 0);
+    CHECK(parse(ics, utc(2025, 6, 1, 0, 0), 64) == 0);
+}
+
+static void test_unsupported_rule(void)
+{
+    const char *ics = "BEGIN:VEVENT\r\n"
+                      "DTSTART:20240304T090000Z\r\n"
+                      "DTEND:20240304T100000Z\r\n"
+                      "RRULE:FREQ=MONTHLY;BYDAY=1MO\r\n"
+                      "END:VEVENT\r\n"
+                      "BEGIN:VEVENT\r\n"
+                      "DTSTART:20240304T110000Z\r\n"
+                      "DTEND:20240304T120000Z\r\n"
+                      "RRULE:FREQ=WEEKLY;BYDAY=1MO\r\n"
+                      "END:VEVENT\r\n";
+
+    // only the first occurrences count
+    CHECK(parse(ics, utc(2024, 3, 4, 0, 0), 64) == 2);
+    CHECK(is_interval(0, utc(2024, 3, 4, 9, 0), utc(2024, 3, 4, 10, 0)));
+    CHECK(is_interval(1, utc(2024, 3, 4, 11, 0), utc(2024, 3, 4, 12, 0)));
+
+    CHECK(parse(ics, utc(2024, 4, 1, 0, 0), 64) == 0);
+}
+
+static void test_earliest_kept(void)
+{
+    const char *ics = "BEGIN:VEVENT\r\n"
+                      "DTSTART:20240304T090000Z\r\n"
+                      "DURATION:PT10M\r\n"
+                      "RRULE:FREQ=DAILY\r\n"
+                      "END:VEVENT\r\n"
+                      "BEGIN:VEVENT\r\n"
+                      "DTSTART:20240304T083000Z\r\n"
+                      "DURATION:PT10M\r\n"
+                      "RRULE:FREQ=DAILY;INTERVAL=1\r\n"
+                      "END:VEVENT\r\n"
+                      "BEGIN:VEVENT\r\n"
+                      "DTSTART:20240304T080000Z\r\n"
+                      "DURATION:PT10M\r\n"
+                      "RRULE:FREQ=DAILY\r\n"
+                      "END:VEVENT\r\n"
+                      "BEGIN:VEVENT\r\n"
+                      "DTSTART:20240304T073000Z\r\n"
+                      "DURATION:PT10M\r\n"
+                      "RRULE:FREQ=DAILY\r\n"
+                      "END:VEVENT\r\n";
+
+    // nine occurrences within the window, the latest one goes
+    CHECK(parse(ics, utc(2024, 3, 4, 7, 35), 64) == EVENTS);
+    CHECK(is_interval(0, utc(2024, 3, 4, 7, 30), utc(2024, 3, 4, 7, 40)));
+    CHECK(is_interval(EVENTS - 1, utc(2024, 3, 5, 9, 0), utc(2024, 3, 5, 9, 10)));
+}
+
+int main(void)
+{
+    strcpy(config.timezone, "Europe/London");
+    tz_setup();
+
+    test_single_events();
+    test_merge_and_folding();
+    test_weekly_count();
+    test_weekly_across_dst();
+    test_weekly_long_ago();
+    test_daily_until_and_exdate();
+    test_daily_weekdays();
+    test_byday_never_reached();
+    test_unsupported_rule();
+    test_earliest_kept();
+
+    printf("calendar: %d failed checks\n", check_failures);
+    return check_failures == 0 ? 0 : 1;
+}
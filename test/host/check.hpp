@@ -0,0 +1,19 @@
+#ifndef CHECK_HPP_INCLUDED
+#define CHECK_HPP_INCLUDED
+
+#include <stdio.h>
+
+// Counts failed checks and carries on, so one run shows all of them.
+static int check_failures = 0;
+
+#define CHECK(condition)                                                     \
+    do                                                                       \
+    {                                                                        \
+        if (!(condition))                                                    \
+        {                                                                    \
+            fprintf(stderr, "%s:%d: %s\n", __FILE__, __LINE__, #condition); \
+            check_failures++;                                                \
+        }                                                                    \
+    } while (0)
+
+#endif /* CHECK_HPP_INCLUDED */
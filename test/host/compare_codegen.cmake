@@ -0,0 +1,32 @@
+# cmake -DNM=<nm> -DLIBRARY=<archive> -P compare_codegen.cmake
+#
+# Every raw_<name> function in the archive has to be as large as its
+# typed_<name> twin, the types are meant to compile away.
+
+execute_process(COMMAND ${NM} --print-size --defined-only ${LIBRARY}
+                OUTPUT_VARIABLE symbols RESULT_VARIABLE result)
+if(NOT result EQUAL 0)
+    message(FATAL_ERROR "nm failed on ${LIBRARY}")
+endif()
+
+string(REGEX MATCHALL "[0-9a-fA-F]+ [0-9a-fA-F]+ [Tt] raw_[A-Za-z_]+" raw_symbols "${symbols}")
+if(NOT raw_symbols)
+    message(FATAL_ERROR "no raw_ functions in ${LIBRARY}")
+endif()
+
+set(failed FALSE)
+foreach(raw ${raw_symbols})
+    string(REGEX REPLACE ".* raw_" "" name "${raw}")
+    string(REGEX REPLACE "^[0-9a-fA-F]+ ([0-9a-fA-F]+) .*" "\\1" raw_size "${raw}")
+    string(REGEX MATCH "[0-9a-fA-F]+ [0-9a-fA-F]+ [Tt] typed_${name}\n" typed "${symbols}\n")
+    string(REGEX REPLACE "^[0-9a-fA-F]+ ([0-9a-fA-F]+) .*" "\\1" typed_size "${typed}")
+    if(NOT typed)
+        message(SEND_ERROR "${name}: no typed_${name}")
+        set(failed TRUE)
+    elseif(NOT raw_size STREQUAL typed_size)
+        message(SEND_ERROR "${name}: raw 0x${raw_size} bytes, typed 0x${typed_size} bytes")
+        set(failed TRUE)
+    else()
+        message(STATUS "${name}: 0x${raw_size} bytes both ways")
+    endif()
+endforeach()
@@ -0,0 +1,174 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "sdkconfig.h"
+#include "gpio.h"
+
+#include "pomodoro.hpp"
+#include "encoder.hpp"
+#include "check.hpp"
+
+// Quadrature sequences into the encoder ISR, as the two contacts make them:
+// clean detents both ways, bounce on every edge, spins faster than the
+// input task and edges the ISR never saw.
+
+#define PIN_A CONFIG_POMODORO_ENCODER_A_GPIO
+#define PIN_B CONFIG_POMODORO_ENCODER_B_GPIO
+
+static int level_a = 1;
+static int level_b = 1;
+static int posts = 0;
+static bool is_queue_full = false;
+
+bool pomodoro_post_input_from_isr(uint32_t input)
+{
+    CHECK(input == INPUT_ENCODER_TURNED);
+    if (is_queue_full)
+    {
+        return false;
+    }
+    posts++;
+    return true;
+}
+
+static int get_level(gpio_num_t pin)
+{
+    return pin == PIN_A ? level_a : level_b;
+}
+
+// Sets the pins to the AB pattern, an interrupt for each pin that changed.
+static void set_ab(int ab)
+{
+    int a = ab >> 1;
+    int b = ab & 1;
+    if (a != level_a)
+    {
+        level_a = a;
+        stub_gpio_interrupt((gpio_num_t)PIN_A);
+    }
+    if (b != level_b)
+    {
+        level_b = b;
+        stub_gpio_interrupt((gpio_num_t)PIN_B);
+    }
+}
+
+// Both pins changed by the time of a single interrupt, one edge was lost.
+static void jump_ab(int ab)
+{
+    level_a = ab >> 1;
+    level_b = ab & 1;
+    stub_gpio_interrupt((gpio_num_t)PIN_A);
+}
+
+// Rest, A closes, both closed, B opens... clockwise is A first.
+static const int clockwise[] = {0x1, 0x0, 0x2, 0x3};
+static const int counterclockwise[] = {0x2, 0x0, 0x1, 0x3};
+
+static void turn(int detents)
+{
+    const int *sequence = detents > 0 ? clockwise : counterclockwise;
+    for (int i = 0; i < (detents > 0 ? detents : -detents); i++)
+    {
+        for (int k = 0; k < 4; k++)
+        {
+            set_ab(sequence[k]);
+        }
+    }
+}
+
+static void test_detents(void)
+{
+    turn(1);
+    CHECK(encoder_take_steps() == 1);
+    turn(-1);
+    CHECK(encoder_take_steps() == -1);
+    CHECK(encoder_take_steps() == 0);
+
+    // half way and back again is no detent
+    set_ab(0x1);
+    set_ab(0x0);
+    set_ab(0x1);
+    set_ab(0x3);
+    CHECK(encoder_take_steps() == 0);
+}
+
+// A bouncing contact makes and breaks a few times before it settles, every
+// bounce reverses the transition before it.
+static void test_bounce(void)
+{
+    posts = 0;
+    int previous = 0x3;
+    for (int k = 0; k < 4; k++)
+    {
+        for (int bounce = 0; bounce < 3; bounce++)
+        {
+            set_ab(clockwise[k]);
+            set_ab(previous);
+        }
+        set_ab(clockwise[k]);
+        previous = clockwise[k];
+    }
+    CHECK(encoder_take_steps() == 1);
+    CHECK(posts == 1);
+
+    // an edge whose level had settled back by the time the ISR read it
+    stub_gpio_interrupt((gpio_num_t)PIN_A);
+    stub_gpio_interrupt((gpio_num_t)PIN_B);
+    CHECK(encoder_take_steps() == 0);
+}
+
+// Faster than the input task takes them: the steps add up, one wakeup only.
+static void test_fast_spin(void)
+{
+    posts = 0;
+    turn(100);
+    turn(-30);
+    CHECK(posts == 1);
+    CHECK(encoder_take_steps() == 70);
+
+    // an edge lost to a busy CPU still counts once half the cycle is seen
+    set_ab(0x1);
+    jump_ab(0x2);
+    set_ab(0x3);
+    CHECK(encoder_take_steps() == 1);
+
+    // a jump across the cycle tells no direction
+    jump_ab(0x0);
+    jump_ab(0x3);
+    CHECK(encoder_take_steps() == 0);
+}
+
+// A post lost to a full queue is made again on the next detent.
+static void test_full_queue(void)
+{
+    posts = 0;
+    is_queue_full = true;
+    turn(2);
+    CHECK(posts == 0);
+
+    is_queue_full = false;
+    turn(1);
+    CHECK(posts == 1);
+    turn(1);
+    CHECK(posts == 1);
+    CHECK(encoder_take_steps() == 4);
+
+    turn(-1);
+    CHECK(posts == 2);
+    CHECK(encoder_take_steps() == -1);
+}
+
+int main(void)
+{
+    stub_gpio().get_level = get_level;
+    CHECK(encoder_setup() == ESP_OK);
+
+    test_detents();
+    test_bounce();
+    test_fast_spin();
+    test_full_queue();
+
+    printf("encoder: %d failed checks\n", check_failures);
+    return check_failures != 0;
+}
@@ -0,0 +1,216 @@
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+#include "sdkconfig.h"
+#include "esp_timer.h"
+#include "environment.hpp"
+#include "i2c_bus.hpp"
+#include "pomodoro.hpp"
+#include "check.hpp"
+
+// The SCD4x answers and the fresh air cue, with the sensor on the bus
+// stood in for below.
+
+#define SAMPLE_US (CONFIG_POMODORO_ENV_SAMPLE_SECONDS * 1000000LL)
+
+static bool is_present = true;
+static uint16_t last_command = 0;
+static uint16_t ready_word = 0x8006;
+static uint16_t words[3] = {};
+static int breaks_suggested = 0;
+
+// CRC-8 of the data sheet, polynomial 0x31 starting from 0xFF.
+static uint8_t crc(uint8_t msb, uint8_t lsb)
+{
+    uint8_t value = 0xFF;
+    for (uint8_t byte : {msb, lsb})
+    {
+        value ^= byte;
+        for (int bit = 0; bit < 8; bit++)
+        {
+            value = value & 0x80 ? (value << 1) ^ 0x31 : value << 1;
+        }
+    }
+    return value;
+}
+
+static void put_word(uint8_t *data, uint16_t word)
+{
+    data[0] = word >> 8;
+    data[1] = word;
+    data[2] = crc(data[0], data[1]);
+}
+
+esp_err_t i2c_bus_setup(void)
+{
+    return ESP_OK;
+}
+
+esp_err_t i2c_bus_write(uint8_t address, const uint8_t *data, size_t len)
+{
+    if (!is_present || address != 0x62 || len != 2)
+    {
+        return ESP_FAIL;
+    }
+    last_command = (data[0] << 8) | data[1];
+    return ESP_OK;
+}
+
+esp_err_t i2c_bus_read(uint8_t address, uint8_t *data, size_t len)
+{
+    if (!is_present || address != 0x62)
+    {
+        return ESP_FAIL;
+    }
+    if (last_command == 0xE4B8 && len == 3)
+    {
+        put_word(data, ready_word);
+        return ESP_OK;
+    }
+    if (last_command == 0xEC05 && len == 9)
+    {
+        for (int i = 0; i < 3; i++)
+        {
+            put_word(data + i * 3, words[i]);
+        }
+        return ESP_OK;
+    }
+    return ESP_FAIL;
+}
+
+bool pomodoro_post_input(uint32_t input)
+{
+    breaks_suggested += input == INPUT_BREAK_SUGGESTED;
+    return true;
+}
+
+static bool decode(uint16_t co2, uint16_t temperature, uint16_t humidity, environment_reading *reading)
+{
+    uint8_t data[9];
+    put_word(data, co2);
+    put_word(data + 3, temperature);
+    put_word(data + 6, humidity);
+    *reading = {};
+    return environment_decode(data, reading);
+}
+
+static void test_decode(void)
+{
+    // the example of the data sheet
+    CHECK(crc(0xBE, 0xEF) == 0x92);
+
+    environment_reading reading;
+    CHECK(decode(500, 0x6667, 0x5EB9, &reading));
+    CHECK(reading.is_valid);
+    CHECK(reading.co2_ppm == 500);
+    CHECK(reading.temperature_centi == 2500); // -45 + 175 * 26215 / 65535
+    CHECK(reading.humidity_centi == 3700);    // 100 * 24249 / 65535
+
+    // both ends of either scale
+    CHECK(decode(400, 0x0000, 0x0000, &reading));
+    CHECK(reading.temperature_centi == -4500);
+    CHECK(reading.humidity_centi == 0);
+    CHECK(decode(40000, 0xFFFF, 0xFFFF, &reading));
+    CHECK(reading.co2_ppm == 40000);
+    CHECK(reading.temperature_centi == 13000);
+    CHECK(reading.humidity_centi == 10000);
+    CHECK(decode(400, 0x4000, 0x8000, &reading));
+    CHECK(reading.temperature_centi == -125); // -45 + 175 * 16384 / 65535, below 0
+    CHECK(reading.humidity_centi == 5000);
+
+    // the first result after start
+    CHECK(!decode(0, 0x6667, 0x5EB9, &reading));
+    CHECK(!reading.is_valid);
+}
+
+static void test_crc_rejected(void)
+{
+    uint8_t data[9];
+    put_word(data, 800);
+    put_word(data + 3, 0x6667);
+    put_word(data + 6, 0x5EB9);
+
+    for (int i = 0; i < 9; i++)
+    {
+        for (int bit = 0; bit < 8; bit++)
+        {
+            uint8_t corrupt[9];
+            memcpy(corrupt, data, sizeof(corrupt));
+            corrupt[i] ^= 1 << bit;
+            environment_reading reading = {};
+            CHECK(!environment_decode(corrupt, &reading));
+            CHECK(!reading.is_valid);
+        }
+    }
+}
+
+// One sample at the next due time, returns whether the cue is on.
+static bool sample(uint16_t co2)
+{
+    stub_timer_advance(SAMPLE_US);
+    words[0] = co2;
+    environment_sample_if_due();
+    return environment_needs_air();
+}
+
+static void test_hysteresis(void)
+{
+    words[1] = 0x6667;
+    words[2] = 0x5EB9;
+    CHECK(environment_setup() == ESP_OK);
+
+    CHECK(!sample(1199));
+    CHECK(environment_get_reading().co2_ppm == 1199);
+    CHECK(sample(1200));
+    CHECK(breaks_suggested == 1);
+
+    // on until it is well below the level again, no second suggestion
+    CHECK(sample(1300));
+    CHECK(sample(1100));
+    CHECK(sample(1000));
+    CHECK(breaks_suggested == 1);
+    CHECK(!sample(999));
+    CHECK(!sample(1199));
+    CHECK(sample(1250));
+    CHECK(breaks_suggested == 2);
+
+    // read at most once per sample interval
+    stub_timer_advance(SAMPLE_US - 1);
+    words[0] = 500;
+    environment_sample_if_due();
+    CHECK(environment_get_reading().co2_ppm == 1250);
+    stub_timer_advance(1);
+    environment_sample_if_due();
+    CHECK(environment_get_reading().co2_ppm == 500);
+    CHECK(!environment_needs_air());
+
+    // nothing new from the sensor keeps the last reading
+    ready_word = 0x8000;
+    CHECK(!sample(1500));
+    CHECK(environment_get_reading().co2_ppm == 500);
+    ready_word = 0x8006;
+
+    // nor does an answer that fails its CRC, or no answer at all
+    words[0] = 1500;
+    is_present = false;
+    stub_timer_advance(SAMPLE_US);
+    environment_sample_if_due();
+    CHECK(environment_get_reading().co2_ppm == 500);
+    is_present = true;
+    CHECK(sample(1500));
+    CHECK(environment_get_reading().sampled_at == esp_timer_get_time());
+    CHECK(breaks_suggested == 3);
+}
+
+int main(void)
+{
+    stub_timer_set(1000000);
+
+    test_decode();
+    test_crc_rejected();
+    test_hysteresis();
+
+    printf("environment: %d failed checks\n", check_failures);
+    return check_failures != 0;
+}
@@ -0,0 +1,375 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <mutex>
+#include <vector>
+
+#include "sdkconfig.h"
+#include "esp_timer.h"
+#include "freertos/queue.h"
+#include "gpio.h"
+
+#include "provision.hpp"
+#include "epaper.hpp"
+#include "check.hpp"
+
+// The display task driving a model of the SSD1680 on the other end of the
+// bit-banged bus. The model keeps the controller RAM and takes a frame on
+// every refresh; frames are compared with the images in epaper/, written
+// there again with EPAPER_UPDATE=1 after a change to the layout.
+
+#define WIDTH 122
+#define HEIGHT 250
+#define LINE_BYTES 16
+#define WINDOW_TOP 16
+#define WINDOW_ROWS 54
+#define FULL_REFRESH_EVERY 20
+
+#define UPDATE_FULL 0xF7
+#define UPDATE_PARTIAL 0xFF
+
+#define MORNING 1709632800 // 2024-03-05 10:00 UTC
+
+struct frame
+{
+    uint8_t mode;
+    int rows_from; // the rows of the black and white RAM written for it
+    int rows_to;
+    uint8_t ram[HEIGHT][LINE_BYTES];
+};
+
+// SSD1680 as the driver uses it: x and y counting up, commands only while
+// awake, the RAM kept through deep sleep.
+struct panel
+{
+    std::mutex mutex;
+    int dc;
+    int mosi;
+    int bits;
+    uint8_t byte;
+    bool is_asleep;
+    int errors;
+
+    uint8_t command;
+    std::vector<uint8_t> args;
+    int x_start, x_end, y_start, y_end, x, y;
+    uint8_t mode;
+    int rows_from, rows_to;
+
+    uint8_t ram_bw[HEIGHT][LINE_BYTES];
+    uint8_t ram_old[HEIGHT][LINE_BYTES];
+    std::vector<frame> frames;
+};
+
+static panel model;
+static int64_t wall_offset = 0;
+
+time_t time(time_t *out) noexcept
+{
+    time_t now = wall_offset + esp_timer_get_time() / 1000000;
+    if (out != nullptr)
+    {
+        *out = now;
+    }
+    return now;
+}
+
+const provision_config &provision_get(void)
+{
+    static provision_config config = {};
+    return config;
+}
+
+bool pomodoro_post_input(uint32_t input)
+{
+    (void)input;
+    return true;
+}
+
+static void panel_data(uint8_t value)
+{
+    if (model.command == 0x24 || model.command == 0x26)
+    {
+        if (model.x < LINE_BYTES && model.y < HEIGHT)
+        {
+            (model.command == 0x24 ? model.ram_bw : model.ram_old)[model.y][model.x] = value;
+        }
+        if (model.command == 0x24)
+        {
+            model.rows_from = model.y < model.rows_from ? model.y : model.rows_from;
+            model.rows_to = model.y > model.rows_to ? model.y : model.rows_to;
+        }
+        if (++model.x > model.x_end)
+        {
+            model.x = model.x_start;
+            model.y = model.y < model.y_end ? model.y + 1 : model.y_start;
+        }
+        return;
+    }
+
+    model.args.push_back(value);
+    const std::vector<uint8_t> &a = model.args;
+    switch (model.command)
+    {
+    case 0x10: // deep sleep
+        model.is_asleep = true;
+        break;
+    case 0x22:
+        model.mode = a[0];
+        break;
+    case 0x44:
+        if (a.size() == 2)
+        {
+            model.x_start = a[0];
+            model.x_end = a[1];
+        }
+        break;
+    case 0x45:
+        if (a.size() == 4)
+        {
+            model.y_start = a[0] | a[1] << 8;
+            model.y_end = a[2] | a[3] << 8;
+        }
+        break;
+    case 0x4E:
+        model.x = a[0];
+        break;
+    case 0x4F:
+        if (a.size() == 2)
+        {
+            model.y = a[0] | a[1] << 8;
+        }
+        break;
+    }
+}
+
+static void panel_byte(uint8_t value)
+{
+    if (model.is_asleep)
+    {
+        model.errors++;
+        return;
+    }
+    if (model.dc == 1)
+    {
+        panel_data(value);
+        return;
+    }
+
+    model.command = value;
+    model.args.clear();
+    if (value == 0x20) // master activation
+    {
+        frame shown;
+        shown.mode = model.mode;
+        shown.rows_from = model.rows_from;
+        shown.rows_to = model.rows_to;
+        memcpy(shown.ram, model.ram_bw, sizeof(shown.ram));
+        model.frames.push_back(shown);
+        model.rows_from = HEIGHT;
+        model.rows_to = -1;
+    }
+}
+
+static void panel_set_level(gpio_num_t pin, uint32_t level)
+{
+    std::lock_guard<std::mutex> lock(model.mutex);
+    if (pin == CONFIG_POMODORO_EPAPER_DC_GPIO)
+    {
+        model.dc = level;
+    }
+    if (pin == CONFIG_POMODORO_EPAPER_MOSI_GPIO)
+    {
+        model.mosi = level;
+    }
+    if (pin == CONFIG_POMODORO_EPAPER_RST_GPIO && level == 0)
+    {
+        model.is_asleep = false;
+        model.bits = 0;
+    }
+    if (pin == CONFIG_POMODORO_EPAPER_CLK_GPIO && level == 1)
+    {
+        model.byte = model.byte << 1 | (model.mosi & 1);
+        if (++model.bits == 8)
+        {
+            model.bits = 0;
+            panel_byte(model.byte);
+        }
+    }
+}
+
+// never busy, a refresh is over at once
+static int panel_get_level(gpio_num_t pin)
+{
+    (void)pin;
+    return 0;
+}
+
+// As a PBM image, black is 1 there and 0 on the panel.
+static bool golden_matches(const char *name, const frame &shown)
+{
+    char path[256];
+    snprintf(path, sizeof(path), "%s/%s.pbm", EPAPER_GOLDEN_DIR, name);
+    char header[32];
+    int header_len = snprintf(header, sizeof(header), "P4\n%d %d\n", WIDTH, HEIGHT);
+
+    uint8_t image[HEIGHT][LINE_BYTES];
+    for (int y = 0; y < HEIGHT; y++)
+    {
+        for (int x = 0; x < LINE_BYTES; x++)
+        {
+            image[y][x] = ~shown.ram[y][x];
+        }
+        image[y][LINE_BYTES - 1] &= 0xFF << (LINE_BYTES * 8 - WIDTH);
+    }
+
+    if (getenv("EPAPER_UPDATE") != nullptr)
+    {
+        FILE *file = fopen(path, "wb");
+        CHECK(file != nullptr);
+        fwrite(header, 1, header_len, file);
+        fwrite(image, 1, sizeof(image), file);
+        fclose(file);
+        return true;
+    }
+
+    uint8_t golden[sizeof(header) + sizeof(image)] = {};
+    FILE *file = fopen(path, "rb");
+    size_t len = file != nullptr ? fread(golden, 1, sizeof(golden), file) : 0;
+    if (file != nullptr)
+    {
+        fclose(file);
+    }
+    bool is_same = len == header_len + sizeof(image) && memcmp(golden, header, header_len) == 0 &&
+                   memcmp(golden + header_len, image, sizeof(image)) == 0;
+    if (!is_same)
+    {
+        // next to the binary, to look at
+        snprintf(path, sizeof(path), "%s.pbm", name);
+        file = fopen(path, "wb");
+        if (file != nullptr)
+        {
+            fwrite(header, 1, header_len, file);
+            fwrite(image, 1, sizeof(image), file);
+            fclose(file);
+        }
+        fprintf(stderr, "frame %s differs from the golden image, see %s\n", name, path);
+    }
+    return is_same;
+}
+
+static pomodoro_status make_status(pomodoro_phase phase, bool is_started, int64_t seconds_left)
+{
+    pomodoro_status status = {};
+    status.phase = phase;
+    status.is_started = is_started;
+    status.seconds_left = seconds_left;
+    return status;
+}
+
+// Shows the status and waits for the task to be done with it, the count of
+// frames it took.
+static size_t show(const pomodoro_status &status)
+{
+    size_t before;
+    {
+        std::lock_guard<std::mutex> lock(model.mutex);
+        before = model.frames.size();
+    }
+    epaper_show(status);
+    stub_queue_wait_idle();
+
+    std::lock_guard<std::mutex> lock(model.mutex);
+    CHECK(model.is_asleep);
+    return model.frames.size() - before;
+}
+
+static const frame &last_frame(void)
+{
+    std::lock_guard<std::mutex> lock(model.mutex);
+    return model.frames.back();
+}
+
+static bool is_partial(const frame &shown)
+{
+    return shown.mode == UPDATE_PARTIAL && shown.rows_from == WINDOW_TOP && shown.rows_to == WINDOW_TOP + WINDOW_ROWS - 1;
+}
+
+static void test_phases(void)
+{
+    // the first one is a full refresh of the whole panel
+    CHECK(show(make_status(PHASE_IDLE, false, 0)) == 1);
+    CHECK(last_frame().mode == UPDATE_FULL && last_frame().rows_from == 0 && last_frame().rows_to == HEIGHT - 1);
+    CHECK(golden_matches("ready", last_frame()));
+
+    // nothing on it changes, nothing is sent
+    CHECK(show(make_status(PHASE_IDLE, false, 0)) == 0);
+    CHECK(show(make_status(PHASE_WORK, false, 2700)) == 1);
+    CHECK(is_partial(last_frame()));
+
+    // before SNTP has synced the minutes left are shown
+    CHECK(show(make_status(PHASE_WORK, true, 1500)) == 1);
+    CHECK(is_partial(last_frame()));
+    CHECK(golden_matches("focus_minutes", last_frame()));
+    CHECK(show(make_status(PHASE_WORK, true, 1481)) == 0);
+    CHECK(show(make_status(PHASE_WORK, true, 1440)) == 1);
+
+    // then the wall clock time the phase ends
+    wall_offset = MORNING - esp_timer_get_time() / 1000000;
+    CHECK(show(make_status(PHASE_WORK, true, 2700)) == 1);
+    CHECK(golden_matches("focus_until", last_frame()));
+    CHECK(show(make_status(PHASE_WORK, true, 2730)) == 0);
+
+    pomodoro_status busy = make_status(PHASE_WORK, true, 2000);
+    busy.is_busy = true;
+    CHECK(show(busy) == 1);
+    CHECK(golden_matches("busy", last_frame()));
+
+    pomodoro_status paused = make_status(PHASE_WORK, true, 600);
+    paused.is_paused = true;
+    CHECK(show(paused) == 1);
+    CHECK(show(make_status(PHASE_SHORT_BREAK, true, 900)) == 1);
+    CHECK(show(make_status(PHASE_LONG_BREAK_LAST_MINUTES, true, 900)) == 1);
+
+    std::lock_guard<std::mutex> lock(model.mutex);
+    CHECK(model.errors == 0);
+    // the base image of the next partial refresh is the one shown
+    CHECK(memcmp(model.ram_old[WINDOW_TOP], model.ram_bw[WINDOW_TOP], WINDOW_ROWS * LINE_BYTES) == 0);
+}
+
+// Partial refreshes leave ghosting behind, every so often a full one clears it.
+static void test_full_refresh_cadence(void)
+{
+    size_t start = model.frames.size();
+    for (int i = 0; i < 2 * FULL_REFRESH_EVERY; i++)
+    {
+        CHECK(show(make_status(PHASE_WORK, true, 3600 + i * 60)) == 1);
+    }
+
+    std::lock_guard<std::mutex> lock(model.mutex);
+    for (size_t i = start; i < model.frames.size(); i++)
+    {
+        bool is_full = i % FULL_REFRESH_EVERY == 0;
+        CHECK(model.frames[i].mode == (is_full ? UPDATE_FULL : UPDATE_PARTIAL));
+    }
+    CHECK(model.errors == 0);
+}
+
+int main(void)
+{
+    stub_timer_set(1000000);
+    model.rows_from = HEIGHT;
+    model.rows_to = -1;
+    stub_gpio().set_level = panel_set_level;
+    stub_gpio().get_level = panel_get_level;
+
+    CHECK(epaper_setup() == ESP_OK);
+    stub_queue_wait_idle();
+
+    test_phases();
+    test_full_refresh_cadence();
+
+    printf("epaper: %d failed checks\n", check_failures);
+    return check_failures != 0;
+}
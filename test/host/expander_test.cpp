@@ -0,0 +1,256 @@
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+#include "sdkconfig.h"
+#include "esp_timer.h"
+#include "gpio.h"
+
+#include "pomodoro.hpp"
+#include "i2c_bus.hpp"
+#include "expander.hpp"
+#include "check.hpp"
+
+// The expander keys from the interrupt line to the inputs they post, with
+// the PCF8574 on the bus stood in for below: a missing chip, a read that
+// fails while the line stays latched, and the key table itself.
+
+#define PIN_INT ((gpio_num_t)CONFIG_POMODORO_EXPANDER_INT_GPIO)
+
+static bool is_present = true;
+static bool is_failing = false;
+static uint8_t port = 0xFF; // pressed keys read 0
+static int reads = 0;
+static int writes = 0;
+static std::vector<uint32_t> posts;
+static std::vector<uint32_t> isr_posts;
+
+esp_err_t i2c_bus_setup(void)
+{
+    return ESP_OK;
+}
+
+esp_err_t i2c_bus_write(uint8_t address, const uint8_t *data, size_t len)
+{
+    if (!is_present || address != CONFIG_POMODORO_EXPANDER_ADDRESS)
+    {
+        return ESP_FAIL;
+    }
+    CHECK(len == 1 && data[0] == 0xFF);
+    writes++;
+    return ESP_OK;
+}
+
+esp_err_t i2c_bus_read(uint8_t address, uint8_t *data, size_t len)
+{
+    if (!is_present || is_failing || address != CONFIG_POMODORO_EXPANDER_ADDRESS)
+    {
+        return ESP_FAIL;
+    }
+    CHECK(len == 1);
+    reads++;
+    data[0] = port;
+    return ESP_OK;
+}
+
+bool pomodoro_post_input(uint32_t input)
+{
+    posts.push_back(input);
+    return true;
+}
+
+bool pomodoro_post_input_from_isr(uint32_t input)
+{
+    isr_posts.push_back(input);
+    return true;
+}
+
+// The line is held low while the chip has a change nobody read.
+static int get_level(gpio_num_t pin)
+{
+    return pin == PIN_INT && is_failing ? 0 : 1;
+}
+
+static void advance_ms(int64_t ms)
+{
+    stub_timer_advance(ms * 1000);
+}
+
+// Sets the keys and runs the interrupt through to a scan, as the GPIO event
+// task would, returns what it posted.
+static std::vector<uint32_t> keys(uint8_t pressed)
+{
+    port = ~pressed;
+    isr_posts.clear();
+    stub_gpio_interrupt(PIN_INT);
+    CHECK(isr_posts.size() == 1 && isr_posts[0] == INPUT_EXPANDER_CHANGED);
+
+    posts.clear();
+    expander_scan();
+    return posts;
+}
+
+static void test_missing(void)
+{
+    is_present = false;
+    CHECK(expander_setup() == ESP_OK);
+    CHECK(stub_gpio().handlers[PIN_INT] == nullptr);
+
+    // the input task may still see the event, it finds nothing to read
+    expander_scan();
+    CHECK(reads == 0);
+    CHECK(posts.empty());
+    is_present = true;
+}
+
+static void test_setup(void)
+{
+    // a key held at boot is the baseline, not a press
+    port = 0xFE;
+    CHECK(expander_setup() == ESP_OK);
+    CHECK(writes == 1);
+    CHECK(reads == 1);
+    CHECK(stub_gpio().handlers[PIN_INT] != nullptr);
+
+    CHECK(keys(0x01).empty());
+    CHECK(keys(0x00).empty());
+}
+
+static void test_table(void)
+{
+    static const uint32_t inputs[] = {
+        INPUT_TIMER_ACTION,
+        INPUT_TIMER_START,
+        INPUT_TIMER_RESET,
+        INPUT_MARK_INTERNAL,
+        INPUT_MARK_EXTERNAL,
+        INPUT_BUSY_TOGGLE,
+    };
+
+    for (int bit = 0; bit < 8; bit++)
+    {
+        advance_ms(100);
+        reads = 0;
+        std::vector<uint32_t> posted = keys(1 << bit);
+        CHECK(reads == 1);
+        if (bit < 6)
+        {
+            CHECK(posted.size() == 1 && posted[0] == inputs[bit]);
+        }
+        else
+        {
+            CHECK(posted.empty());
+        }
+
+        // the release posts nothing
+        CHECK(keys(0x00).empty());
+    }
+
+    // keys pressed together come from the one read, in table order
+    advance_ms(100);
+    reads = 0;
+    std::vector<uint32_t> posted = keys(0x30 | 0x01 | 0x80);
+    CHECK(reads == 1);
+    CHECK(posted.size() == 3 && posted[0] == INPUT_TIMER_ACTION && posted[1] == INPUT_MARK_EXTERNAL && posted[2] == INPUT_BUSY_TOGGLE);
+
+    // a key pressed while another is held
+    advance_ms(100);
+    posted = keys(0x30 | 0x01 | 0x02);
+    CHECK(posted.size() == 1 && posted[0] == INPUT_TIMER_START);
+    CHECK(keys(0x00).empty());
+}
+
+static void test_debounce(void)
+{
+    advance_ms(100);
+    CHECK(keys(0x04).size() == 1);
+
+    // contact bounce within 50 ms of the press
+    CHECK(keys(0x00).empty());
+    advance_ms(10);
+    CHECK(keys(0x04).empty());
+    CHECK(keys(0x00).empty());
+
+    // other keys are not held back by it
+    CHECK(keys(0x08).size() == 1);
+    CHECK(keys(0x00).empty());
+
+    advance_ms(40);
+    CHECK(keys(0x04).size() == 1);
+    CHECK(keys(0x00).empty());
+}
+
+static void test_failed_read(void)
+{
+    advance_ms(100);
+
+    // a failure with the line released needs no retry, the next edge comes
+    port = 0xFE;
+    is_failing = true;
+    stub_gpio().get_level = nullptr;
+    posts.clear();
+    expander_scan();
+    advance_ms(60000);
+    CHECK(posts.empty());
+
+    // with the line latched low the retries back off, 20 ms doubling to 10 s
+    stub_gpio().get_level = get_level;
+    expander_scan();
+    int64_t expected = 20;
+    int64_t waited = 0;
+    for (int i = 0; i < 14; i++)
+    {
+        posts.clear();
+        advance_ms(expected - 1);
+        CHECK(posts.empty());
+        advance_ms(1);
+        CHECK(posts.size() == 1 && posts[0] == INPUT_EXPANDER_CHANGED);
+        waited += expected;
+
+        expander_scan();
+        expected = expected * 2 < 10000 ? expected * 2 : 10000;
+    }
+    CHECK(expected == 10000);
+    CHECK(waited > 60000);
+
+    // the read comes through, the press held all along is seen once
+    is_failing = false;
+    reads = 0;
+    posts.clear();
+    advance_ms(10000);
+    CHECK(posts.size() == 1 && posts[0] == INPUT_EXPANDER_CHANGED);
+    posts.clear();
+    expander_scan();
+    CHECK(reads == 1);
+    CHECK(posts.size() == 1 && posts[0] == INPUT_TIMER_ACTION);
+    CHECK(keys(0x00).empty());
+
+    // and nothing is left armed, the next failure starts from 20 ms again
+    posts.clear();
+    advance_ms(60000);
+    CHECK(posts.empty());
+
+    is_failing = true;
+    expander_scan();
+    advance_ms(20);
+    CHECK(posts.size() == 1);
+    is_failing = false;
+    posts.clear();
+    expander_scan();
+    advance_ms(60000);
+    CHECK(posts.empty());
+}
+
+int main(void)
+{
+    stub_timer_set(1000000);
+
+    test_missing();
+    test_setup();
+    test_table();
+    test_debounce();
+    test_failed_read();
+
+    printf("expander: %d failed checks\n", check_failures);
+    return check_failures != 0;
+}
@@ -0,0 +1,487 @@
+#include <stdio.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "pomodoro_fsm.hpp"
+#include "fleet.hpp"
+
+#define BOOT_US 1000000 // the stub timer at second 0
+#define REACTION_MAX_SECONDS 300
+#define MARK_PERCENT 30
+
+// What the machine running on this thread just logged, see fleet_vprintf.
+static thread_local uint32_t lines_logged = 0;
+static thread_local bool is_urgent_logged = false;
+static thread_local uint64_t work_done = 0;
+
+void journal_add(journal_event event, pomodoro_phase phase, uint16_t detail)
+{
+    (void)phase;
+    (void)detail;
+    work_done += event == JOURNAL_WORK_DONE;
+}
+
+bool pomodoro_post_input(uint32_t input)
+{
+    (void)input;
+    return true;
+}
+
+// Counts the lines instead of printing them, warnings and errors are sent
+// right away by the syslog forwarder.
+static int fleet_vprintf(const char *format, va_list args)
+{
+    (void)args;
+    lines_logged++;
+    is_urgent_logged = is_urgent_logged || format[0] == 'W' || format[0] == 'E';
+    return 0;
+}
+
+// splitmix64, one stream per light
+static uint64_t fleet_random(uint64_t *state)
+{
+    uint64_t z = (*state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+static uint32_t fleet_uniform(uint64_t *state, uint32_t below)
+{
+    return below == 0 ? 0 : fleet_random(state) % below;
+}
+
+struct light
+{
+    instance_fsm::Machine<Pomodoro> fsm;
+    uint64_t random;
+    uint32_t boot_at;
+
+    bool is_connected;
+    bool was_outage_seen;
+    uint32_t connect_at;
+
+    uint32_t syslog_queued;
+    uint32_t flush_at;
+
+    uint32_t fetch_at;
+    bool knows_meeting;
+    bool is_busy;
+    bool was_busy;
+
+    uint32_t press_at;
+    uint32_t mark_at;
+    uint32_t check_at;
+};
+
+// Sums of one thread, the per second counts indexed by the second.
+struct tally
+{
+    fleet_report report;
+    std::vector<uint32_t> messages;
+    std::vector<uint32_t> fetches;
+    std::vector<uint32_t> attempts;
+    std::vector<uint32_t> reconnected;
+    std::vector<uint32_t> busy;
+};
+
+// Waits for every thread of the run, spinning, a step is short.
+class fleet_barrier
+{
+public:
+    explicit fleet_barrier(int count) : count(count), waiting(count), generation(0) {}
+
+    void arrive(void)
+    {
+        unsigned seen = this->generation;
+        if (--this->waiting == 0)
+        {
+            this->waiting = this->count;
+            this->generation++;
+            return;
+        }
+        while (this->generation == seen)
+        {
+            std::this_thread::yield();
+        }
+    }
+
+private:
+    const int count;
+    std::atomic<int> waiting;
+    std::atomic<unsigned> generation;
+};
+
+fleet_config fleet_default_config(void)
+{
+    fleet_config config = {};
+    config.devices = 1000;
+    config.threads = std::thread::hardware_concurrency() > 0 ? std::thread::hardware_concurrency() : 1;
+    config.seconds = 8 * 3600;
+    config.seed = 1;
+    config.boot_spread_seconds = 30 * 60;
+    config.syslog_buffer = 16;
+    config.syslog_flush_seconds = 30;
+    config.calendar_fetch_minutes = 30;
+    config.connect_retry_seconds = 3;
+    config.outage_at = 3 * 3600;
+    config.outage_seconds = 300;
+    config.meeting_added_at = 5 * 3600 + 10 * 60;
+    config.meeting_at = 5 * 3600;
+    config.meeting_minutes = 60;
+    return config;
+}
+
+static bool fleet_is_ap_up(const fleet_config &config, uint32_t t)
+{
+    return config.outage_at == 0 || t < config.outage_at || t >= config.outage_at + config.outage_seconds;
+}
+
+static void fleet_queue(const fleet_config &config, light &l, tally &sums, uint32_t lines)
+{
+    l.syslog_queued += lines;
+    if (l.syslog_queued > config.syslog_buffer)
+    {
+        sums.report.lines_overwritten += l.syslog_queued - config.syslog_buffer;
+        l.syslog_queued = config.syslog_buffer;
+    }
+}
+
+// Sends the whole ring back to back, or fails on the first datagram.
+static void fleet_flush(light &l, tally &sums, uint32_t t)
+{
+    if (l.syslog_queued == 0)
+    {
+        return;
+    }
+    if (!l.is_connected)
+    {
+        sums.report.send_failures++;
+        return;
+    }
+    sums.messages[t] += l.syslog_queued;
+    sums.report.messages += l.syslog_queued;
+    l.syslog_queued = 0;
+}
+
+// The lines a dispatch logged go into the ring, then the deadline is set
+// again as pomodoro.cpp does after every dispatch.
+template <typename E>
+static void fleet_dispatch(const fleet_config &config, light &l, tally &sums, uint32_t t, const E &event)
+{
+    pomodoro_phase before = pomodoro_fsm_status(l.fsm).phase;
+    lines_logged = 0;
+    is_urgent_logged = false;
+
+    l.fsm.dispatch(event);
+
+    pomodoro_status status = pomodoro_fsm_status(l.fsm);
+    if (status.phase != before)
+    {
+        sums.report.transitions++;
+    }
+    if (!status.is_started && l.press_at <= t)
+    {
+        l.press_at = t + 1 + fleet_uniform(&l.random, REACTION_MAX_SECONDS);
+    }
+    if (status.phase == PHASE_WORK && status.is_started && before != PHASE_WORK)
+    {
+        l.mark_at = fleet_uniform(&l.random, 100) < MARK_PERCENT ? t + fleet_uniform(&l.random, 20 * 60) : UINT32_MAX;
+    }
+
+    l.check_at = UINT32_MAX;
+    if (status.is_started && !status.is_paused)
+    {
+        int64_t real_us = clock_to_real(pomodoro_next_check(status, l.fsm.state()->context)).count();
+        l.check_at = t + (real_us + 999999) / 1000000;
+    }
+
+    fleet_queue(config, l, sums, lines_logged);
+    if (is_urgent_logged || l.syslog_queued * 4 >= config.syslog_buffer * 3)
+    {
+        fleet_flush(l, sums, t);
+    }
+}
+
+static void fleet_boot(const fleet_config &config, light &l, tally &sums, uint32_t t)
+{
+    lines_logged = 0;
+    l.fsm.start<Idle>(initial_context);
+    fleet_queue(config, l, sums, lines_logged + 2); // connected, address
+
+    l.is_connected = fleet_is_ap_up(config, t);
+    l.connect_at = t + config.connect_retry_seconds;
+    l.flush_at = t + config.syslog_flush_seconds;
+    l.fetch_at = t;
+    l.press_at = t + 60 + fleet_uniform(&l.random, 30 * 60);
+    l.mark_at = UINT32_MAX;
+    l.check_at = UINT32_MAX;
+}
+
+static void fleet_step(const fleet_config &config, light &l, tally &sums, uint32_t t)
+{
+    if (t < l.boot_at)
+    {
+        return;
+    }
+    if (t == l.boot_at)
+    {
+        fleet_boot(config, l, sums, t);
+    }
+    sums.report.device_seconds++;
+
+    // Wi-Fi: every failed attempt is followed by the next one
+    bool is_ap_up = fleet_is_ap_up(config, t);
+    if (l.is_connected && !is_ap_up)
+    {
+        l.is_connected = false;
+        l.was_outage_seen = true;
+        l.connect_at = t + config.connect_retry_seconds;
+        fleet_queue(config, l, sums, 1);
+    }
+    if (!l.is_connected && t >= l.connect_at)
+    {
+        sums.attempts[t]++;
+        sums.report.connect_attempts++;
+        l.connect_at = t + config.connect_retry_seconds;
+        if (is_ap_up)
+        {
+            l.is_connected = true;
+            fleet_queue(config, l, sums, 2);
+            if (l.was_outage_seen)
+            {
+                sums.reconnected[t - (config.outage_at + config.outage_seconds)]++;
+            }
+        }
+    }
+
+    // calendar: a failed fetch waits for the next one all the same
+    if (t >= l.fetch_at)
+    {
+        if (l.is_connected)
+        {
+            sums.fetches[t]++;
+            sums.report.fetches++;
+            l.knows_meeting = config.meeting_at != 0 && t >= config.meeting_added_at;
+        }
+        l.fetch_at = t + config.calendar_fetch_minutes * 60;
+        fleet_queue(config, l, sums, 1);
+    }
+    bool is_busy_now = l.knows_meeting && t >= config.meeting_at && t < config.meeting_at + config.meeting_minutes * 60;
+    if (is_busy_now != l.is_busy)
+    {
+        l.is_busy = is_busy_now;
+        CalendarChanged changed;
+        changed.is_busy = is_busy_now;
+        fleet_queue(config, l, sums, 1);
+        fleet_dispatch(config, l, sums, t, changed);
+        if (is_busy_now && !l.was_busy)
+        {
+            l.was_busy = true;
+            sums.busy[t - std::max(config.meeting_at, config.meeting_added_at)]++;
+        }
+    }
+
+    // the user and the deadline
+    if (t >= l.press_at && !l.fsm.state()->is_started())
+    {
+        fleet_dispatch(config, l, sums, t, TimerAction());
+    }
+    if (t >= l.mark_at)
+    {
+        l.mark_at = UINT32_MAX;
+        MarkInterruption mark;
+        mark.is_external = fleet_uniform(&l.random, 2) == 0;
+        fleet_dispatch(config, l, sums, t, mark);
+    }
+    if (t >= l.check_at)
+    {
+        fleet_dispatch(config, l, sums, t, CheckTimer());
+    }
+
+    if (t >= l.flush_at)
+    {
+        l.flush_at = t + config.syslog_flush_seconds;
+        fleet_flush(l, sums, t);
+    }
+}
+
+// The second a count first reaches the given share of the total.
+static uint32_t fleet_percentile(const std::vector<uint32_t> &counts, uint64_t total, uint32_t percent)
+{
+    uint64_t seen = 0;
+    for (size_t i = 0; i < counts.size(); i++)
+    {
+        seen += counts[i];
+        if (total > 0 && seen * 100 >= total * percent)
+        {
+            return i;
+        }
+    }
+    return 0;
+}
+
+static uint64_t fleet_peak(const std::vector<uint32_t> &counts, uint32_t *at)
+{
+    uint64_t peak = 0;
+    for (size_t i = 0; i < counts.size(); i++)
+    {
+        if (counts[i] > peak)
+        {
+            peak = counts[i];
+            if (at != nullptr)
+            {
+                *at = i;
+            }
+        }
+    }
+    return peak;
+}
+
+fleet_report fleet_run(const fleet_config &config)
+{
+    vprintf_like_t previous = esp_log_set_vprintf(fleet_vprintf);
+
+    std::vector<light> lights(config.devices);
+    for (size_t i = 0; i < lights.size(); i++)
+    {
+        lights[i].random = config.seed * 0x100000001B3ULL + i;
+        lights[i].boot_at = fleet_uniform(&lights[i].random, config.boot_spread_seconds);
+    }
+
+    int threads = config.threads > 0 ? config.threads : 1;
+    std::vector<tally> tallies(threads);
+    for (tally &sums : tallies)
+    {
+        sums.report = {};
+        sums.messages.assign(config.seconds, 0);
+        sums.fetches.assign(config.seconds, 0);
+        sums.attempts.assign(config.seconds, 0);
+        sums.reconnected.assign(config.seconds, 0);
+        sums.busy.assign(config.seconds, 0);
+    }
+
+    // lock step, the machines all read the one stub timer
+    fleet_barrier barrier(threads);
+    auto worker = [&](int index) {
+        tally &sums = tallies[index];
+        work_done = 0;
+        for (uint32_t t = 0; t < config.seconds; t++)
+        {
+            if (index == 0)
+            {
+                stub_timer_set(BOOT_US + t * 1000000LL);
+            }
+            barrier.arrive();
+            for (size_t i = index; i < lights.size(); i += threads)
+            {
+                fleet_step(config, lights[i], sums, t);
+            }
+            barrier.arrive();
+        }
+        sums.report.work_done = work_done;
+    };
+
+    std::vector<std::thread> pool;
+    for (int i = 1; i < threads; i++)
+    {
+        pool.emplace_back(worker, i);
+    }
+    worker(0);
+    for (std::thread &thread : pool)
+    {
+        thread.join();
+    }
+
+    // merged in thread order, sums only, so any split adds up the same
+    fleet_report report = {};
+    tally merged;
+    merged.messages.assign(config.seconds, 0);
+    merged.fetches.assign(config.seconds, 0);
+    merged.attempts.assign(config.seconds, 0);
+    merged.reconnected.assign(config.seconds, 0);
+    merged.busy.assign(config.seconds, 0);
+    for (const tally &sums : tallies)
+    {
+        report.device_seconds += sums.report.device_seconds;
+        report.work_done += sums.report.work_done;
+        report.transitions += sums.report.transitions;
+        report.messages += sums.report.messages;
+        report.lines_overwritten += sums.report.lines_overwritten;
+        report.send_failures += sums.report.send_failures;
+        report.fetches += sums.report.fetches;
+        report.connect_attempts += sums.report.connect_attempts;
+        for (uint32_t t = 0; t < config.seconds; t++)
+        {
+            merged.messages[t] += sums.messages[t];
+            merged.fetches[t] += sums.fetches[t];
+            merged.attempts[t] += sums.attempts[t];
+            merged.reconnected[t] += sums.reconnected[t];
+            merged.busy[t] += sums.busy[t];
+        }
+    }
+
+    report.messages_peak = fleet_peak(merged.messages, &report.messages_peak_at);
+    report.fetches_peak = fleet_peak(merged.fetches, nullptr);
+    report.connect_attempts_peak = fleet_peak(merged.attempts, nullptr);
+
+    uint64_t reconnected = 0;
+    for (uint32_t count : merged.reconnected)
+    {
+        reconnected += count;
+    }
+    report.reconnected_p50 = fleet_percentile(merged.reconnected, reconnected, 50);
+    report.reconnected_max = fleet_percentile(merged.reconnected, reconnected, 100);
+
+    for (uint32_t count : merged.busy)
+    {
+        report.busy_lights += count;
+    }
+    for (const light &l : lights)
+    {
+        report.never_busy += config.meeting_at != 0 && l.boot_at < config.seconds && !l.was_busy;
+    }
+    report.busy_p50 = fleet_percentile(merged.busy, report.busy_lights, 50);
+    report.busy_p99 = fleet_percentile(merged.busy, report.busy_lights, 99);
+    report.busy_max = fleet_percentile(merged.busy, report.busy_lights, 100);
+
+    esp_log_set_vprintf(previous);
+    return report;
+}
+
+bool fleet_same(const fleet_report &a, const fleet_report &b)
+{
+    return a.device_seconds == b.device_seconds && a.work_done == b.work_done && a.transitions == b.transitions && a.messages == b.messages &&
+           a.messages_peak == b.messages_peak && a.messages_peak_at == b.messages_peak_at && a.lines_overwritten == b.lines_overwritten &&
+           a.send_failures == b.send_failures && a.fetches == b.fetches && a.fetches_peak == b.fetches_peak && a.connect_attempts == b.connect_attempts &&
+           a.connect_attempts_peak == b.connect_attempts_peak && a.reconnected_p50 == b.reconnected_p50 && a.reconnected_max == b.reconnected_max &&
+           a.busy_lights == b.busy_lights && a.never_busy == b.never_busy && a.busy_p50 == b.busy_p50 && a.busy_p99 == b.busy_p99 &&
+           a.busy_max == b.busy_max;
+}
+
+void fleet_print(const fleet_config &config, const fleet_report &report)
+{
+    double seconds = config.seconds > 0 ? config.seconds : 1;
+
+    printf("%zu lights, %u s simulated, %d threads\n", config.devices, (unsigned)config.seconds, config.threads);
+    printf("timer: %llu pomodoros, %llu transitions\n", (unsigned long long)report.work_done, (unsigned long long)report.transitions);
+    printf("syslog: %llu datagrams, %.1f/s average, %llu/s peak at %u s, %llu lines overwritten, %llu failed bursts\n",
+           (unsigned long long)report.messages, report.messages / seconds, (unsigned long long)report.messages_peak, (unsigned)report.messages_peak_at,
+           (unsigned long long)report.lines_overwritten, (unsigned long long)report.send_failures);
+    printf("calendar: %llu fetches, %llu/s peak\n", (unsigned long long)report.fetches, (unsigned long long)report.fetches_peak);
+    if (config.outage_at != 0)
+    {
+        printf("outage: %llu connect attempts, %llu/s peak, reconnected after %u s median, %u s last\n", (unsigned long long)report.connect_attempts,
+               (unsigned long long)report.connect_attempts_peak, (unsigned)report.reconnected_p50, (unsigned)report.reconnected_max);
+    }
+    if (config.meeting_at != 0)
+    {
+        printf("meeting: %zu lights busy after %u s median, %u s p99, %u s last, %zu never\n", report.busy_lights, (unsigned)report.busy_p50,
+               (unsigned)report.busy_p99, (unsigned)report.busy_max, report.never_busy);
+    }
+}
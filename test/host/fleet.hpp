@@ -0,0 +1,87 @@
+#ifndef FLEET_HPP_INCLUDED
+#define FLEET_HPP_INCLUDED
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Many lights on one network segment, each one a Pomodoro machine of its
+// own driven by a simulated user, stepped a second at a time on all cores.
+// Around the machines sits a model of what a light puts on the network:
+//
+//  - syslog: the lines the machine logs are queued in a ring of
+//    syslog_buffer lines and sent as one datagram each every
+//    syslog_flush_seconds, as syslog.cpp does. Sends fail while the link is
+//    down and the lines stay queued;
+//  - calendar: a fetch every calendar_fetch_minutes, as calendar.cpp does.
+//    A meeting of the whole team is put into the calendar at some point and
+//    a light only pauses for it once a fetch has seen it;
+//  - Wi-Fi: the access point goes away for a while, every light retries
+//    every connect_retry_seconds until it is back, as wifi.cpp does.
+//
+// Periodic work starts at boot, and boots are spread over boot_spread_seconds,
+// so the lights are out of phase like a real fleet. Every light draws from
+// its own random stream, the report does not depend on the thread count.
+
+struct fleet_config
+{
+    size_t devices;
+    int threads;
+    uint32_t seconds;
+    uint64_t seed;
+    uint32_t boot_spread_seconds;
+
+    // Kconfig defaults
+    uint32_t syslog_buffer;
+    uint32_t syslog_flush_seconds;
+    uint32_t calendar_fetch_minutes;
+
+    uint32_t connect_retry_seconds;
+    uint32_t outage_at; // 0 for none
+    uint32_t outage_seconds;
+
+    uint32_t meeting_added_at;
+    uint32_t meeting_at; // 0 for none
+    uint32_t meeting_minutes;
+};
+
+fleet_config fleet_default_config(void);
+
+struct fleet_report
+{
+    uint64_t device_seconds;
+
+    uint64_t work_done;
+    uint64_t transitions;
+
+    // datagrams to the syslog collector
+    uint64_t messages;
+    uint64_t messages_peak; // in the busiest second
+    uint32_t messages_peak_at;
+    uint64_t lines_overwritten;
+    uint64_t send_failures;
+
+    uint64_t fetches;
+    uint64_t fetches_peak;
+
+    // after the outage
+    uint64_t connect_attempts;
+    uint64_t connect_attempts_peak;
+    uint32_t reconnected_p50; // seconds after the access point came back
+    uint32_t reconnected_max;
+
+    // from the later of the meeting start and its entry into the calendar
+    // to the light pausing for it, over the lights that were working
+    size_t busy_lights;
+    size_t never_busy; // the meeting was over before a fetch saw it
+    uint32_t busy_p50;
+    uint32_t busy_p99;
+    uint32_t busy_max;
+};
+
+fleet_report fleet_run(const fleet_config &config);
+
+bool fleet_same(const fleet_report &a, const fleet_report &b);
+
+void fleet_print(const fleet_config &config, const fleet_report &report);
+
+#endif /* FLEET_HPP_INCLUDED */
@@ -0,0 +1,107 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+
+#include "fleet.hpp"
+
+// Runs the fleet model with the options given and prints what the network
+// would see, for example ten thousand lights over a working day:
+//
+//   fleet_sim --devices 10000 --hours 8
+
+static void usage(void)
+{
+    fprintf(stderr, "usage: fleet_sim [--devices N] [--threads N] [--hours N] [--seed N]\n"
+                    "                 [--buffer LINES] [--flush SECONDS] [--fetch MINUTES] [--retry SECONDS]\n"
+                    "                 [--outage-at SECONDS] [--outage SECONDS]\n"
+                    "                 [--meeting-at SECONDS] [--meeting-added-at SECONDS] [--meeting MINUTES]\n");
+}
+
+int main(int argc, char **argv)
+{
+    fleet_config config = fleet_default_config();
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (i + 1 >= argc)
+        {
+            usage();
+            return 2;
+        }
+        const char *option = argv[i];
+        unsigned long value = strtoul(argv[++i], nullptr, 10);
+
+        if (strcmp(option, "--devices") == 0)
+        {
+            config.devices = value;
+        }
+        else if (strcmp(option, "--threads") == 0)
+        {
+            config.threads = value;
+        }
+        else if (strcmp(option, "--hours") == 0)
+        {
+            config.seconds = value * 3600;
+        }
+        else if (strcmp(option, "--seed") == 0)
+        {
+            config.seed = value;
+        }
+        else if (strcmp(option, "--buffer") == 0)
+        {
+            config.syslog_buffer = value;
+        }
+        else if (strcmp(option, "--flush") == 0)
+        {
+            config.syslog_flush_seconds = value;
+        }
+        else if (strcmp(option, "--fetch") == 0)
+        {
+            config.calendar_fetch_minutes = value;
+        }
+        else if (strcmp(option, "--retry") == 0)
+        {
+            config.connect_retry_seconds = value;
+        }
+        else if (strcmp(option, "--outage-at") == 0)
+        {
+            config.outage_at = value;
+        }
+        else if (strcmp(option, "--outage") == 0)
+        {
+            config.outage_seconds = value;
+        }
+        else if (strcmp(option, "--meeting-at") == 0)
+        {
+            config.meeting_at = value;
+        }
+        else if (strcmp(option, "--meeting-added-at") == 0)
+        {
+            config.meeting_added_at = value;
+        }
+        else if (strcmp(option, "--meeting") == 0)
+        {
+            config.meeting_minutes = value;
+        }
+        else
+        {
+            usage();
+            return 2;
+        }
+    }
+    if (config.devices == 0 || config.threads <= 0 || config.seconds == 0 || config.syslog_buffer == 0 || config.syslog_flush_seconds == 0 ||
+        config.calendar_fetch_minutes == 0 || config.connect_retry_seconds == 0)
+    {
+        usage();
+        return 2;
+    }
+
+    auto started = std::chrono::steady_clock::now();
+    fleet_report report = fleet_run(config);
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+
+    fleet_print(config, report);
+    printf("took %.1f s, %.0f device seconds/s\n", elapsed, report.device_seconds / elapsed);
+    return 0;
+}
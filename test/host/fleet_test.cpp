@@ -0,0 +1,114 @@
+#include <stdio.h>
+
+#include "fleet.hpp"
+#include "check.hpp"
+
+// The fleet model at a small size: the same report on any number of
+// threads, and the figures it gives for an outage and a meeting where they
+// can be worked out by hand.
+
+#define DEVICES 300
+
+static fleet_config small_config(void)
+{
+    fleet_config config = fleet_default_config();
+    config.devices = DEVICES;
+    config.threads = 1;
+    config.seconds = 6 * 3600;
+    config.outage_at = 2 * 3600;
+    config.outage_seconds = 120;
+    config.meeting_at = 4 * 3600;
+    config.meeting_added_at = 4 * 3600;
+    config.meeting_minutes = 60;
+    config.boot_spread_seconds = config.calendar_fetch_minutes * 60; // fetches in every phase
+    return config;
+}
+
+static void test_threads(void)
+{
+    fleet_config config = small_config();
+    fleet_report one = fleet_run(config);
+    config.threads = 4;
+    fleet_report four = fleet_run(config);
+    config.threads = 7; // not a divisor of the device count
+    fleet_report seven = fleet_run(config);
+
+    CHECK(fleet_same(one, four));
+    CHECK(fleet_same(one, seven));
+    CHECK(one.device_seconds > 0 && one.work_done > 0 && one.messages > 0);
+
+    config.seed = 2;
+    CHECK(!fleet_same(one, fleet_run(config)));
+}
+
+static void test_outage(void)
+{
+    fleet_config config = small_config();
+    fleet_report report = fleet_run(config);
+
+    // every light retries on its own beat, they are all back within one
+    // retry interval and the collector sees the backlog arrive at once
+    CHECK(report.reconnected_max < config.connect_retry_seconds);
+    CHECK(report.connect_attempts >= DEVICES * (config.outage_seconds / config.connect_retry_seconds - 1));
+    CHECK(report.connect_attempts_peak >= DEVICES / config.connect_retry_seconds);
+    CHECK(report.connect_attempts_peak <= DEVICES);
+    CHECK(report.send_failures > 0);
+    CHECK(report.messages_peak_at >= config.outage_at + config.outage_seconds);
+    CHECK(report.messages_peak_at < config.outage_at + config.outage_seconds + config.syslog_flush_seconds);
+
+    config.outage_at = 0;
+    report = fleet_run(config);
+    CHECK(report.connect_attempts == 0);
+    CHECK(report.send_failures == 0);
+}
+
+static void test_meeting(void)
+{
+    fleet_config config = small_config();
+    uint32_t fetch_seconds = config.calendar_fetch_minutes * 60;
+
+    // put in at its start, the lights learn of it at their next fetch
+    fleet_report report = fleet_run(config);
+    CHECK(report.busy_lights == DEVICES);
+    CHECK(report.never_busy == 0);
+    CHECK(report.busy_max < fetch_seconds);
+    CHECK(report.busy_p50 > fetch_seconds / 4 && report.busy_p50 < fetch_seconds * 3 / 4);
+
+    // put in well ahead, every light pauses on time
+    config.meeting_added_at = config.meeting_at - 2 * fetch_seconds;
+    report = fleet_run(config);
+    CHECK(report.busy_lights == DEVICES);
+    CHECK(report.busy_max == 0);
+
+    // shorter than the fetch interval, some lights never see it
+    config.meeting_added_at = config.meeting_at;
+    config.meeting_minutes = 10;
+    report = fleet_run(config);
+    CHECK(report.never_busy > 0);
+    CHECK(report.busy_lights + report.never_busy == DEVICES);
+}
+
+static void test_scale(void)
+{
+    fleet_config config = small_config();
+    config.threads = 4;
+    fleet_report report = fleet_run(config);
+    config.devices = 2 * DEVICES;
+    fleet_report twice = fleet_run(config);
+
+    // the load on the collector grows with the fleet
+    CHECK(twice.messages > report.messages * 3 / 2);
+    CHECK(twice.fetches > report.fetches * 3 / 2);
+    CHECK(twice.connect_attempts_peak > report.connect_attempts_peak);
+}
+
+int main(void)
+{
+    test_threads();
+    test_outage();
+    test_meeting();
+    test_scale();
+
+    printf("fleet: %d failed checks\n", check_failures);
+    return check_failures != 0;
+}
@@ -0,0 +1,63 @@
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+
+#include "provision.hpp"
+#include "pomodoro.hpp"
+#include "calendar.hpp"
+
+// A feed as the socket hands it over: the first byte picks the piece size,
+// the rest is the ICS text. Whatever it holds, the intervals that come out
+// are sorted, merged, not over and within the table.
+
+#define NOW 1709596800 // 2024-03-05 00:00 UTC
+#define EVENTS 8
+
+const provision_config &provision_get(void)
+{
+    static provision_config config = {};
+    return config;
+}
+
+bool pomodoro_post_input(uint32_t input)
+{
+    (void)input;
+    return true;
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+    if (size == 0)
+    {
+        return 0;
+    }
+    size_t piece = data[0] % 64 + 1;
+    const char *ics = (const char *)data + 1;
+    size_t len = size - 1;
+
+    calendar_interval intervals[EVENTS];
+    calendar_parser parser;
+    calendar_parser_init(&parser, intervals, EVENTS, NOW);
+    for (size_t i = 0; i < len; i += piece)
+    {
+        calendar_parser_feed(&parser, ics + i, len - i < piece ? len - i : piece);
+    }
+    size_t count = calendar_parser_finish(&parser);
+
+    if (count > EVENTS)
+    {
+        abort();
+    }
+    for (size_t i = 0; i < count; i++)
+    {
+        if (intervals[i].end <= NOW || intervals[i].start >= intervals[i].end)
+        {
+            abort();
+        }
+        if (i > 0 && intervals[i].start <= intervals[i - 1].end)
+        {
+            abort();
+        }
+    }
+    return 0;
+}
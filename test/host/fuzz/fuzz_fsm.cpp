@@ -0,0 +1,150 @@
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "pomodoro_fsm.hpp"
+
+// A random stream of the events the buttons, the sensors, the calendar and
+// the network post, with the clock moving between them. Two bytes make one
+// step: the event and its argument. After every step the periods stay in
+// range, a pause only comes with a started period, and a started period
+// that is not paused would move on once its deadline has passed.
+
+void journal_add(journal_event event, pomodoro_phase phase, uint16_t detail)
+{
+    (void)event;
+    (void)phase;
+    (void)detail;
+}
+
+bool pomodoro_post_input(uint32_t input)
+{
+    (void)input;
+    return true;
+}
+
+static int fuzz_quiet(const char *format, va_list args)
+{
+    (void)format;
+    (void)args;
+    return 0;
+}
+
+static bool is_period(seconds period)
+{
+    return period >= Pomodoro::MIN_PERIOD_SECONDS && period <= Pomodoro::MAX_PERIOD_SECONDS;
+}
+
+static void fuzz_check(instance_fsm::Machine<Pomodoro> &fsm)
+{
+    const pomodoro_context &context = fsm.state()->context;
+    if (!is_period(context.work_period_seconds) || !is_period(context.short_break_period_seconds) ||
+        !is_period(context.long_break_period_seconds))
+    {
+        abort();
+    }
+
+    pomodoro_status status = pomodoro_fsm_status(fsm);
+    if (status.is_paused && !status.is_started)
+    {
+        abort();
+    }
+    if (!status.is_started || status.is_paused)
+    {
+        return;
+    }
+
+    // the deadline pomodoro.cpp would wait for, on a copy so the stream
+    // goes on from where it was
+    int64_t now = esp_timer_get_time();
+    instance_fsm::Machine<Pomodoro> ahead = fsm;
+    stub_timer_advance(clock_to_real(pomodoro_next_check(status, context)).count());
+    ahead.dispatch(CheckTimer());
+    bool is_moved_on = pomodoro_fsm_status(ahead).phase != status.phase;
+    stub_timer_set(now);
+    if (!is_moved_on)
+    {
+        abort();
+    }
+}
+
+static void fuzz_step(instance_fsm::Machine<Pomodoro> &fsm, uint8_t kind, uint8_t argument)
+{
+    switch (kind % 13)
+    {
+    case 0:
+        fsm.dispatch(TimerReady());
+        break;
+    case 1:
+        fsm.dispatch(StartTimer());
+        break;
+    case 2:
+        fsm.dispatch(TimerAction());
+        break;
+    case 3:
+        fsm.dispatch(ResetTimer());
+        break;
+    case 4:
+        fsm.dispatch(CheckTimer());
+        break;
+    case 5:
+    {
+        AdjustPeriod event;
+        event.delta = minutes((int8_t)argument);
+        fsm.dispatch(event);
+        break;
+    }
+    case 6:
+    {
+        MarkInterruption event;
+        event.is_external = argument & 1;
+        fsm.dispatch(event);
+        break;
+    }
+    case 7:
+    {
+        CalendarChanged event;
+        event.is_busy = argument & 1;
+        fsm.dispatch(event);
+        break;
+    }
+    case 8:
+    {
+        BusyChanged event;
+        event.is_busy = argument & 1;
+        fsm.dispatch(event);
+        break;
+    }
+    case 9:
+        fsm.dispatch(PresenceLost());
+        break;
+    case 10:
+        fsm.dispatch(PresenceReturned());
+        break;
+    case 11:
+        fsm.dispatch(BreakSuggested());
+        break;
+    default:
+        // up to a little over four hours, in steps of a minute
+        stub_timer_advance((int64_t)argument * 60 * 1000000);
+        break;
+    }
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+    esp_log_set_vprintf(fuzz_quiet);
+    stub_timer_set(1000000);
+
+    // from the boot state, as pomodoro.cpp starts it
+    instance_fsm::Machine<Pomodoro> fsm;
+    fsm.start<Off>(initial_context);
+    for (size_t i = 0; i + 1 < size; i += 2)
+    {
+        fuzz_step(fsm, data[i], data[i + 1]);
+        fuzz_check(fsm);
+    }
+    return 0;
+}
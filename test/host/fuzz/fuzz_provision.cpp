@@ -0,0 +1,66 @@
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "provision.hpp"
+
+#include "../provision_vectors.inc"
+
+// A bundle as the console receives it. The signature check is let through
+// in this build, so the fuzzer reaches the fields: an accepted bundle has
+// every string terminated and every period in range, and a refused one
+// gives one of the reasons the host tool knows.
+
+static const uint8_t device_mac[6] = {0xa4, 0xcf, 0x12, 0x34, 0x56, 0x78};
+
+static bool is_terminated(const char *text, size_t size)
+{
+    return memchr(text, '\0', size) != nullptr;
+}
+
+static bool is_minutes(uint8_t value)
+{
+    return value <= 120; // 0 when not set
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+    if (size > PROVISION_BUNDLE_MAX)
+    {
+        return 0;
+    }
+
+    provision_config config;
+    const char *reason = nullptr;
+    bool is_valid = provision_verify(data, size, vector_public_key, device_mac, &config, &reason);
+
+    if (reason == nullptr)
+    {
+        abort();
+    }
+    if (!is_valid)
+    {
+        const char *reasons[] = {"malformed", "signature", "device", "field"};
+        for (const char *known : reasons)
+        {
+            if (strcmp(reason, known) == 0)
+            {
+                return 0;
+            }
+        }
+        abort();
+    }
+
+    if (strcmp(reason, "ok") != 0 || !is_terminated(config.wifi_ssid, sizeof(config.wifi_ssid)) ||
+        !is_terminated(config.wifi_password, sizeof(config.wifi_password)) || !is_terminated(config.hint_key, sizeof(config.hint_key)) ||
+        !is_terminated(config.timezone, sizeof(config.timezone)))
+    {
+        abort();
+    }
+    if (!is_minutes(config.work_minutes) || !is_minutes(config.short_break_minutes) || !is_minutes(config.long_break_minutes))
+    {
+        abort();
+    }
+    return 0;
+}
@@ -0,0 +1,66 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <dirent.h>
+#include <string>
+#include <vector>
+
+// Runs a fuzz target over the files given or the files in the directories
+// given, without libFuzzer, so the seed corpora and every crash kept next
+// to them stay regression tests of the normal host build.
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size);
+
+static bool replay_file(const std::string &path)
+{
+    FILE *file = fopen(path.c_str(), "rb");
+    if (file == nullptr)
+    {
+        return false;
+    }
+    std::vector<uint8_t> data;
+    uint8_t buf[4096];
+    size_t len;
+    while ((len = fread(buf, 1, sizeof(buf), file)) > 0)
+    {
+        data.insert(data.end(), buf, buf + len);
+    }
+    fclose(file);
+
+    LLVMFuzzerTestOneInput(data.data(), data.size());
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    int inputs = 0;
+    for (int i = 1; i < argc; i++)
+    {
+        DIR *dir = opendir(argv[i]);
+        if (dir == nullptr)
+        {
+            if (!replay_file(argv[i]))
+            {
+                fprintf(stderr, "unable to read %s\n", argv[i]);
+                return 1;
+            }
+            inputs++;
+            continue;
+        }
+
+        struct dirent *entry;
+        while ((entry = readdir(dir)) != nullptr)
+        {
+            if (entry->d_name[0] != '.' && replay_file(std::string(argv[i]) + "/" + entry->d_name))
+            {
+                inputs++;
+            }
+        }
+        closedir(dir);
+    }
+
+    // an empty input as well, every target has to take it
+    LLVMFuzzerTestOneInput(nullptr, 0);
+    printf("%s: %d inputs replayed\n", argv[0], inputs);
+    return inputs == 0;
+}
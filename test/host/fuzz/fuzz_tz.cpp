@@ -0,0 +1,55 @@
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "provision.hpp"
+#include "tz.hpp"
+
+// A zone setting as a bundle or the console gives it, a zone name or a
+// POSIX rule. A rule that parses has offsets within the 167 hours a POSIX
+// time may have, and change times that stay near their year.
+
+#define SETTING_MAX 48
+#define OFFSET_MAX (168 * 3600)
+#define SLACK (2 * OFFSET_MAX + 86400)
+
+const provision_config &provision_get(void)
+{
+    static provision_config config = {};
+    return config;
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+    char setting[SETTING_MAX];
+    size_t len = size < SETTING_MAX - 1 ? size : SETTING_MAX - 1;
+    memcpy(setting, data, len);
+    setting[len] = '\0';
+
+    const char *posix = tz_find_zone(setting);
+    tz_rule rule;
+    if (!tz_parse(posix != nullptr ? posix : setting, &rule))
+    {
+        return 0;
+    }
+    if (rule.std_offset <= -OFFSET_MAX || rule.std_offset >= OFFSET_MAX || rule.dst_offset <= -OFFSET_MAX - 3600 || rule.dst_offset >= OFFSET_MAX + 3600)
+    {
+        abort();
+    }
+    if (rule.has_dst)
+    {
+        for (int year = 1970; year <= 2106; year += 17)
+        {
+            int64_t start = tz_change_time(rule.dst_start, year, rule.std_offset);
+            int64_t end = tz_change_time(rule.dst_end, year, rule.dst_offset);
+            int64_t year_start = tz_days_from_civil(year, 1, 1) * 86400;
+            int64_t year_end = tz_days_from_civil(year + 1, 1, 1) * 86400;
+            if (start < year_start - SLACK || start > year_end + SLACK || end < year_start - SLACK || end > year_end + SLACK)
+            {
+                abort();
+            }
+        }
+    }
+    return 0;
+}
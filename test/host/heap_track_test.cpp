@@ -0,0 +1,249 @@
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#include "sdkconfig.h"
+#include "esp_log.h"
+#include "esp_system.h"
+#include "esp_timer.h"
+#include "esp_heap_caps.h"
+
+#include "heap_track.hpp"
+#include "check.hpp"
+
+// The heap_caps hooks on the host heap of esp_heap_caps.cpp, linked with
+// --wrap as the firmware is: histograms, callers, the largest free block
+// found by trial allocations, and the warnings when the heap runs low,
+// fragments or fails an allocation.
+
+#define SAMPLE_US (CONFIG_POMODORO_HEAP_TRACK_SAMPLE_SECONDS * 1000000LL)
+
+static std::string logged;
+
+static int capture(const char *format, va_list args)
+{
+    char line[256];
+    int length = vsnprintf(line, sizeof(line), format, args);
+    logged += line;
+    return length;
+}
+
+static bool was_logged(const char *text)
+{
+    bool is_found = logged.find(text) != std::string::npos;
+    logged.clear();
+    return is_found;
+}
+
+// one call site, so one caller key
+static __attribute__((noinline)) void *alloc_here(size_t size)
+{
+    return heap_caps_malloc(size, MALLOC_CAP_8BIT);
+}
+
+static const heap_track_caller *find_caller(const std::vector<heap_track_caller> &callers, const void *key)
+{
+    for (const heap_track_caller &caller : callers)
+    {
+        if (caller.caller == key)
+        {
+            return &caller;
+        }
+    }
+    return nullptr;
+}
+
+static std::vector<heap_track_caller> get_callers(void)
+{
+    std::vector<heap_track_caller> callers(HEAP_TRACK_CALLERS);
+    callers.resize(heap_track_get_callers(callers.data(), callers.size()));
+    return callers;
+}
+
+static void test_setup(void)
+{
+    CHECK(heap_track_setup() == ESP_OK);
+
+    heap_track_stats stats = heap_track_get_stats();
+    CHECK(stats.free_bytes > STUB_HEAP_BYTES - 64);
+    CHECK(stats.largest_free_block <= stats.free_bytes);
+    CHECK(stats.largest_free_block + 16 >= stats.free_bytes);
+
+    // the trial allocations of the search are not counted
+    CHECK(stats.allocations == 0);
+    CHECK(stats.frees == 0);
+    CHECK(get_callers().empty());
+    CHECK(logged.empty());
+}
+
+static void test_histogram(void)
+{
+    const size_t sizes[] = {1, 16, 17, 100, 4096, 4097, 9000};
+    const size_t buckets[] = {0, 0, 1, 3, 8, 9, 9};
+    std::vector<void *> blocks;
+
+    for (size_t size : sizes)
+    {
+        blocks.push_back(alloc_here(size));
+    }
+    blocks.push_back(heap_caps_calloc(10, 30, MALLOC_CAP_8BIT)); // 300 bytes
+    blocks.push_back(heap_caps_zalloc(40, MALLOC_CAP_8BIT));
+
+    heap_track_stats stats = heap_track_get_stats();
+    uint32_t expected[HEAP_TRACK_SIZE_BUCKETS] = {};
+    for (size_t bucket : buckets)
+    {
+        expected[bucket]++;
+    }
+    expected[5]++;
+    expected[2]++;
+    CHECK(memcmp(stats.size_buckets, expected, sizeof(expected)) == 0);
+    CHECK(stats.allocations == 9);
+
+    // one key for the helper, one for each other call site
+    std::vector<heap_track_caller> callers = get_callers();
+    CHECK(callers.size() == 3);
+    CHECK(callers.size() == 3 && callers[0].allocations == 7);
+    CHECK(callers.size() == 3 && callers[0].bytes == 1 + 16 + 17 + 100 + 4096 + 4097 + 9000);
+    CHECK(callers.size() == 3 && callers[1].bytes == 300);
+
+    // a realloc counts as an allocation of the new size and frees the old
+    blocks[0] = heap_caps_realloc(blocks[0], 200, MALLOC_CAP_8BIT);
+    stats = heap_track_get_stats();
+    CHECK(stats.allocations == 10);
+    CHECK(stats.frees == 1);
+    CHECK(stats.size_buckets[4] == 1);
+
+    for (void *block : blocks)
+    {
+        heap_caps_free(block);
+    }
+    heap_caps_free(nullptr);
+    stats = heap_track_get_stats();
+    CHECK(stats.frees == 10);
+    CHECK(stats.free_bytes > STUB_HEAP_BYTES - 64);
+}
+
+// malloc through the newlib shims is keyed by the caller of malloc, the
+// table keeps the first HEAP_TRACK_CALLERS of them.
+static void test_callers(void)
+{
+    static const char keys[HEAP_TRACK_CALLERS + 4] = {};
+    size_t known = get_callers().size();
+
+    for (size_t i = 0; i < sizeof(keys); i++)
+    {
+        void *ptr = _heap_caps_malloc(24, MALLOC_CAP_32BIT, &keys[i], 0);
+        _heap_caps_free(ptr, &keys[i], 0);
+    }
+    std::vector<heap_track_caller> callers = get_callers();
+    CHECK(callers.size() == HEAP_TRACK_CALLERS);
+    CHECK(find_caller(callers, &keys[0]) != nullptr);
+    CHECK(find_caller(callers, &keys[HEAP_TRACK_CALLERS - known - 1]) != nullptr);
+    CHECK(find_caller(callers, &keys[HEAP_TRACK_CALLERS - known]) == nullptr);
+
+    const heap_track_caller *first = find_caller(callers, &keys[0]);
+    CHECK(first != nullptr && first->allocations == 1 && first->bytes == 24);
+
+    void *ptr = stub_heap_malloc(10);
+    stub_heap_free(ptr);
+    CHECK(get_callers().size() == HEAP_TRACK_CALLERS);
+}
+
+// Plenty of free bytes in small holes: the largest block tells, the free
+// heap does not, and an allocation the free heap would allow fails.
+static void test_fragmented(void)
+{
+    std::vector<void *> blocks;
+    void *ptr;
+    while ((ptr = alloc_here(504)) != nullptr)
+    {
+        blocks.push_back(ptr);
+    }
+    uint32_t failures = heap_track_get_stats().failures;
+    CHECK(failures == 1);
+
+    heap_track_sample();
+    CHECK(logged.find("free heap low") != std::string::npos);
+    CHECK(logged.find("1 allocations failed, last 504 bytes") != std::string::npos);
+    logged.clear();
+
+    for (size_t i = 0; i < blocks.size(); i += 2)
+    {
+        heap_caps_free(blocks[i]);
+    }
+
+    stub_timer_advance(SAMPLE_US);
+    heap_track_sample_if_due();
+    heap_track_stats stats = heap_track_get_stats();
+    CHECK(stats.free_bytes > CONFIG_POMODORO_HEAP_TRACK_LOW_BYTES);
+    CHECK(stats.largest_free_block >= 480 && stats.largest_free_block <= 504);
+    CHECK(stats.free_bytes == esp_get_free_heap_size());
+    std::string line = logged;
+    CHECK(line.find("heap fragmented: largest block") != std::string::npos);
+    CHECK(line.find("free heap low") == std::string::npos);
+    CHECK(line.find("allocations failed") == std::string::npos);
+    logged.clear();
+
+    // fails with the bytes there, the free heap at the time is kept with it
+    CHECK(alloc_here(2000) == nullptr);
+    stats = heap_track_get_stats();
+    CHECK(stats.failures == failures + 1);
+    CHECK(stats.last_failed_size == 2000);
+    CHECK(stats.free_at_last_failure == stats.free_bytes);
+    CHECK(stats.free_at_last_failure > 2000);
+
+    // reported with the next sample, and only once
+    heap_track_sample_if_due();
+    CHECK(logged.empty());
+    stub_timer_advance(SAMPLE_US);
+    heap_track_sample_if_due();
+    CHECK(logged.find("2 allocations failed, last 2000 bytes") != std::string::npos);
+    logged.clear();
+    heap_track_sample();
+    CHECK(!was_logged("allocations failed"));
+
+    for (size_t i = 1; i < blocks.size(); i += 2)
+    {
+        heap_caps_free(blocks[i]);
+    }
+    heap_track_sample();
+    CHECK(!was_logged("heap"));
+    stats = heap_track_get_stats();
+    CHECK(stats.largest_free_block + 16 >= stats.free_bytes);
+    CHECK(stats.minimum_free_bytes < 504);
+}
+
+// Samples ride on wakeups the light has anyway, at most one per period.
+static void test_sample_gap(void)
+{
+    void *ptr = alloc_here(STUB_HEAP_BYTES / 2);
+    heap_track_sample_if_due(); // sampled just before
+    CHECK(heap_track_get_stats().largest_free_block > STUB_HEAP_BYTES / 2);
+
+    stub_timer_advance(SAMPLE_US - 1);
+    heap_track_sample_if_due();
+    CHECK(heap_track_get_stats().largest_free_block > STUB_HEAP_BYTES / 2);
+
+    stub_timer_advance(1);
+    heap_track_sample_if_due();
+    CHECK(heap_track_get_stats().largest_free_block < STUB_HEAP_BYTES / 2);
+    heap_caps_free(ptr);
+}
+
+int main(void)
+{
+    stub_timer_set(1000000);
+    esp_log_set_vprintf(capture);
+
+    test_setup();
+    test_histogram();
+    test_callers();
+    test_fragmented();
+    test_sample_gap();
+
+    esp_log_set_vprintf(stub_log_stderr);
+    printf("heap_track: %d failed checks\n", check_failures);
+    return check_failures != 0;
+}
@@ -0,0 +1,215 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <vector>
+
+#include "esp_partition.h"
+
+#include "history.hpp"
+
+// Size and speed of the flash history on synthetic years, through the real
+// encoder and decoder in history.cpp on the stub partition. Workdays have
+// eight pomodoros, a few interruptions and a handful of tags. Prints bytes
+// per record, how many days the partition holds, and how fast appends, full
+// reads and a one week query run on this machine:
+//
+//   history_bench --years 1 --partition 0x10000
+
+#define YEAR_START 1704067200 // 2024-01-01
+#define WEEK (7 * 86400)
+#define REPEATS 20
+
+struct bench_options
+{
+    uint32_t seed;
+    int tags;
+    size_t partition;
+    int years;
+};
+
+static void usage(void)
+{
+    fprintf(stderr, "usage: history_bench [--seed N] [--tags N] [--partition BYTES] [--years N]\n");
+}
+
+static journal_record bench_record(uint32_t timestamp, journal_event event, uint16_t detail, uint8_t tag)
+{
+    journal_record record = {};
+    record.timestamp = timestamp;
+    record.event = event;
+    record.phase = PHASE_WORK;
+    record.detail = detail;
+    record.tag = tag;
+    return record;
+}
+
+static std::vector<journal_record> bench_workdays(const bench_options &options)
+{
+    std::mt19937 rng(options.seed);
+    auto below = [&rng](uint32_t count) { return (uint32_t)(rng() % count); };
+    static const int interruptions[] = {0, 0, 1, 1, 2, 3};
+
+    std::vector<journal_record> records;
+    uint32_t day = YEAR_START;
+    for (int i = 0; i < 365 * options.years; i++, day += 86400)
+    {
+        time_t t = day;
+        struct tm date;
+        gmtime_r(&t, &date);
+        if (date.tm_wday == 0 || date.tm_wday == 6)
+        {
+            continue;
+        }
+
+        uint32_t now = day + 9 * 3600 + below(1800);
+        uint8_t tag = below(options.tags + 1);
+        for (int pomodoro = 0; pomodoro < 8; pomodoro++)
+        {
+            for (int k = interruptions[below(6)]; k > 0; k--)
+            {
+                journal_event event = below(2) == 0 ? JOURNAL_INTERRUPTION_INTERNAL : JOURNAL_INTERRUPTION_EXTERNAL;
+                records.push_back(bench_record(now + below(2700), event, below(45), tag));
+            }
+            now += 2700 + below(120) - 60;
+            records.push_back(bench_record(now, JOURNAL_WORK_DONE, 45, tag));
+            now += 900 + below(360) - 60;
+            if (below(5) == 0)
+            {
+                tag = below(options.tags + 1);
+            }
+        }
+    }
+
+    // interruptions come in as they happen, before the period ends
+    std::stable_sort(records.begin(), records.end(),
+                     [](const journal_record &a, const journal_record &b) { return a.timestamp < b.timestamp; });
+    return records;
+}
+
+static double bench_seconds_since(std::chrono::steady_clock::time_point started)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+}
+
+static size_t bench_query(uint32_t from, uint32_t to, std::vector<journal_record> *out)
+{
+    history_cursor cursor;
+    journal_record record;
+    size_t count = 0;
+
+    history_query(&cursor, from, to);
+    while (history_next(&cursor, &record))
+    {
+        if (out != nullptr)
+        {
+            out->push_back(record);
+        }
+        count++;
+    }
+    return count;
+}
+
+static bool bench_same(const journal_record &a, const journal_record &b)
+{
+    return a.timestamp == b.timestamp && a.event == b.event && a.phase == b.phase && a.detail == b.detail && a.tag == b.tag;
+}
+
+int main(int argc, char **argv)
+{
+    bench_options options = {1, 4, 0x10000, 1};
+    for (int i = 1; i < argc; i++)
+    {
+        if (i + 1 >= argc)
+        {
+            usage();
+            return 2;
+        }
+        const char *option = argv[i];
+        unsigned long value = strtoul(argv[++i], nullptr, 0);
+
+        if (strcmp(option, "--seed") == 0)
+        {
+            options.seed = value;
+        }
+        else if (strcmp(option, "--tags") == 0)
+        {
+            options.tags = value;
+        }
+        else if (strcmp(option, "--partition") == 0)
+        {
+            options.partition = value;
+        }
+        else if (strcmp(option, "--years") == 0)
+        {
+            options.years = value;
+        }
+        else
+        {
+            usage();
+            return 2;
+        }
+    }
+
+    stub_partition_create("history", options.partition);
+    if (options.years <= 0 || options.tags < 0 || history_setup() != ESP_OK)
+    {
+        usage();
+        return 2;
+    }
+
+    std::vector<journal_record> records = bench_workdays(options);
+    auto started = std::chrono::steady_clock::now();
+    for (const journal_record &record : records)
+    {
+        history_append(record);
+    }
+    double append_seconds = bench_seconds_since(started);
+
+    history_stats stats = history_get_stats();
+    size_t header_bytes = stats.blocks_used * sizeof(history_block_header);
+    double records_per_day = (double)records.size() / (365 * options.years);
+    printf("%u records, %u kept in %u of %u blocks, %.2f bytes/record (%.2f with headers)\n", (unsigned)records.size(), (unsigned)stats.records,
+           (unsigned)stats.blocks_used, (unsigned)stats.blocks, (double)(stats.bytes - header_bytes) / stats.records,
+           (double)stats.bytes / stats.records);
+    printf("%u KB partition: about %.0f days of history, the ring keeps one block fewer after a wrap\n", (unsigned)(options.partition / 1024),
+           stats.blocks * (double)stats.records / stats.blocks_used / records_per_day);
+
+    // what the partition kept is the newest records, unchanged
+    std::vector<journal_record> read;
+    bench_query(0, UINT32_MAX, &read);
+    size_t skip = records.size() - std::min(records.size(), read.size());
+    bool is_same = read.size() == stats.records && read.size() <= records.size();
+    for (size_t i = 0; is_same && i < read.size(); i++)
+    {
+        is_same = bench_same(read[i], records[skip + i]);
+    }
+    if (!is_same)
+    {
+        fprintf(stderr, "round trip mismatch\n");
+        return 1;
+    }
+
+    started = std::chrono::steady_clock::now();
+    for (int i = 0; i < REPEATS; i++)
+    {
+        bench_query(0, UINT32_MAX, nullptr);
+    }
+    double read_seconds = bench_seconds_since(started) / REPEATS;
+
+    uint32_t week = read[read.size() / 2].timestamp;
+    size_t week_records = 0;
+    started = std::chrono::steady_clock::now();
+    for (int i = 0; i < REPEATS * 10; i++)
+    {
+        week_records = bench_query(week, week + WEEK, nullptr);
+    }
+    double week_seconds = bench_seconds_since(started) / (REPEATS * 10);
+
+    printf("append %.0f records/s, read %.0f records/s, one week query %.3f ms (%u records)\n", records.size() / append_seconds,
+           read.size() / read_seconds, week_seconds * 1000, (unsigned)week_records);
+    return 0;
+}
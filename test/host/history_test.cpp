@@ -0,0 +1,217 @@
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+#include "esp_partition.h"
+
+#include "history.hpp"
+#include "check.hpp"
+
+#define BLOCK_SIZE 4096
+#define BLOCKS 3
+#define START 1700000000
+
+static std::vector<journal_record> appended;
+
+// Work periods and breaks of a few lengths with the odd interruption, so the
+// deltas of deltas take every varint length.
+static journal_record make_record(size_t i)
+{
+    static uint32_t timestamp = START;
+    static const uint32_t steps[] = {1500, 300, 1500, 300, 1500, 900, 17, 1500, 86400, 1499};
+
+    timestamp += steps[i % (sizeof(steps) / sizeof(steps[0]))];
+
+    journal_record record = {};
+    record.timestamp = timestamp;
+    record.event = (journal_event)(i % 4);
+    record.phase = i % 6;
+    record.detail = i % 7 == 0 ? 65535 : i % 120;
+    record.tag = i % 5 == 0 ? 0 : i % 16;
+    return record;
+}
+
+static void append(size_t i)
+{
+    journal_record record = make_record(i);
+    history_append(record);
+    appended.push_back(record);
+}
+
+static std::vector<journal_record> query(uint32_t from, uint32_t to)
+{
+    std::vector<journal_record> records;
+    history_cursor cursor;
+    journal_record record;
+
+    history_query(&cursor, from, to);
+    while (history_next(&cursor, &record))
+    {
+        records.push_back(record);
+    }
+    return records;
+}
+
+static bool same(const journal_record &a, const journal_record &b)
+{
+    return a.timestamp == b.timestamp && a.event == b.event && a.phase == b.phase && a.detail == b.detail && a.tag == b.tag;
+}
+
+// The records read back are the newest ones appended, in order.
+static bool is_suffix(const std::vector<journal_record> &read)
+{
+    if (read.size() > appended.size())
+    {
+        return false;
+    }
+    size_t skip = appended.size() - read.size();
+    for (size_t i = 0; i < read.size(); i++)
+    {
+        if (!same(read[i], appended[skip + i]))
+        {
+            fprintf(stderr, "record %u differs\n", (unsigned)i);
+            return false;
+        }
+    }
+    return true;
+}
+
+static void fresh_partition(void)
+{
+    stub_partition_create("history", BLOCKS * BLOCK_SIZE);
+    appended.clear();
+    CHECK(history_setup() == ESP_OK);
+}
+
+static void test_round_trip(void)
+{
+    fresh_partition();
+    for (size_t i = 0; i < 200; i++)
+    {
+        append(i);
+    }
+
+    std::vector<journal_record> all = query(0, UINT32_MAX);
+    CHECK(all.size() == 200);
+    CHECK(is_suffix(all));
+
+    std::vector<journal_record> some = query(appended[50].timestamp, appended[119].timestamp);
+    CHECK(some.size() == 70);
+    CHECK(!some.empty() && same(some.front(), appended[50]) && same(some.back(), appended[119]));
+
+    CHECK(query(appended[199].timestamp + 1, UINT32_MAX).empty());
+
+    history_stats stats = history_get_stats();
+    CHECK(stats.blocks == BLOCKS);
+    CHECK(stats.blocks_used == 1);
+    CHECK(stats.records == 200);
+
+    // records from before the first SNTP sync are not kept
+    journal_record early = {};
+    early.timestamp = 3600;
+    history_append(early);
+    CHECK(history_get_stats().records == 200);
+}
+
+static void test_ring_and_reboot(void)
+{
+    fresh_partition();
+    for (size_t i = 0; i < 6000; i++)
+    {
+        append(i);
+    }
+
+    std::vector<journal_record> all = query(0, UINT32_MAX);
+    history_stats stats = history_get_stats();
+    CHECK(stats.blocks_used == BLOCKS);
+    CHECK(all.size() == stats.records);
+    CHECK(all.size() > 2 * BLOCK_SIZE / 5);
+    CHECK(is_suffix(all));
+
+    // the index is rebuilt from flash alone
+    CHECK(history_setup() == ESP_OK);
+    std::vector<journal_record> again = query(0, UINT32_MAX);
+    CHECK(again.size() == all.size());
+    CHECK(is_suffix(again));
+
+    append(6000);
+    CHECK(is_suffix(query(0, UINT32_MAX)));
+}
+
+// Appends one record but leaves only its first byte in flash, as a reset in
+// the middle of the write would.
+static void append_cut_short(size_t i)
+{
+    std::vector<uint8_t> before(stub_partition_data(), stub_partition_data() + BLOCKS * BLOCK_SIZE);
+    journal_record record = make_record(i);
+    history_append(record);
+
+    uint8_t *data = stub_partition_data();
+    size_t first = 0;
+    while (first < before.size() && data[first] == before[first])
+    {
+        first++;
+    }
+    CHECK(first < before.size());
+    for (size_t j = first + 1; j < before.size(); j++)
+    {
+        data[j] = before[j];
+    }
+}
+
+static void test_partial_record(void)
+{
+    fresh_partition();
+    for (size_t i = 0; i < 20; i++)
+    {
+        append(i);
+    }
+    append_cut_short(20);
+
+    CHECK(history_setup() == ESP_OK);
+    CHECK(is_suffix(query(0, UINT32_MAX)));
+    CHECK(history_get_stats().blocks_used == 2);
+
+    append(21);
+    std::vector<journal_record> all = query(0, UINT32_MAX);
+    CHECK(all.size() == 21);
+    CHECK(is_suffix(all));
+}
+
+static void test_failed_erase(void)
+{
+    fresh_partition();
+    for (size_t i = 0; i < 20; i++)
+    {
+        append(i);
+    }
+    append_cut_short(20);
+
+    // neither the boot nor the first record can start a fresh block, that
+    // record is lost but nothing lands after the partial one
+    stub_partition_fail_erases(2);
+    CHECK(history_setup() == ESP_OK);
+    history_append(make_record(21));
+    CHECK(is_suffix(query(0, UINT32_MAX)));
+
+    append(22);
+    std::vector<journal_record> all = query(0, UINT32_MAX);
+    CHECK(all.size() == 21);
+    CHECK(is_suffix(all));
+
+    // and it all reads back the same after the next boot
+    CHECK(history_setup() == ESP_OK);
+    CHECK(query(0, UINT32_MAX).size() == 21);
+    CHECK(is_suffix(query(0, UINT32_MAX)));
+}
+
+int main(void)
+{
+    test_round_trip();
+    test_ring_and_reboot();
+    test_partial_record();
+    test_failed_erase();
+
+    printf("history: %d failed checks\n", check_failures);
+    return check_failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,266 @@
+#include <stdio.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "pomodoro_fsm.hpp"
+#include "check.hpp"
+
+// Machines are objects: transitions replace the state in place and carry
+// the context, each machine answers for its own state, and many Pomodoro
+// machines run on threads side by side without sharing anything.
+
+#define THREADS 8
+#define MACHINES 2000 // spread over the threads
+#define STEPS 240     // minutes
+
+static std::atomic<int> work_done(0);
+
+void journal_add(journal_event event, pomodoro_phase phase, uint16_t detail)
+{
+    (void)phase;
+    (void)detail;
+    if (event == JOURNAL_WORK_DONE)
+    {
+        work_done++;
+    }
+}
+
+bool pomodoro_post_input(uint32_t input)
+{
+    (void)input;
+    return true;
+}
+
+static int quiet_vprintf(const char *format, va_list args)
+{
+    (void)format;
+    (void)args;
+    return 0;
+}
+
+// A machine of two states flipping on every step.
+
+struct Step : instance_fsm::Event
+{
+};
+
+struct flip_context
+{
+    int id;
+    int entries;
+    int exits;
+    int steps;
+};
+
+struct Flip : instance_fsm::Fsm<Flip, flip_context>
+{
+    using Fsm::Fsm;
+
+    virtual void react(Step const &) = 0;
+    virtual void entry(void) { this->context.entries++; };
+    void exit(void) { this->context.exits++; };
+};
+
+struct Up;
+
+struct Down : Flip
+{
+    using Flip::Flip;
+    void react(Step const &) override;
+};
+
+struct Up : Flip
+{
+    using Flip::Flip;
+    void react(Step const &) override
+    {
+        this->context.steps++;
+        transit<Down>();
+    };
+};
+
+void Down::react(Step const &)
+{
+    this->context.steps++;
+    transit<Up>();
+}
+
+static void test_transit(void)
+{
+    static_assert(sizeof(instance_fsm::Machine<Flip>) == sizeof(Flip), "a machine is as big as one state");
+    static_assert(sizeof(instance_fsm::Machine<Pomodoro>) == sizeof(Pomodoro), "a machine is as big as one state");
+
+    instance_fsm::Machine<Flip> a;
+    instance_fsm::Machine<Flip> b;
+    a.start<Down>({1, 0, 0, 0});
+    b.start<Up>({2, 0, 0, 0});
+    CHECK(a.is_in_state<Down>() && !a.is_in_state<Up>());
+    CHECK(b.is_in_state<Up>() && !b.is_in_state<Down>());
+    CHECK(a.state()->context.entries == 1);
+
+    Flip *before = a.state();
+    a.dispatch(Step());
+    CHECK(a.is_in_state<Up>());
+    CHECK(b.is_in_state<Up>());
+    CHECK(a.state() == before); // replaced in place
+
+    // the context travels with the machine through every transition
+    for (int i = 0; i < 5; i++)
+    {
+        a.dispatch(Step());
+    }
+    const flip_context &context = a.state()->context;
+    CHECK(context.id == 1);
+    CHECK(context.steps == 6);
+    CHECK(context.entries == 7);
+    CHECK(context.exits == 6);
+    CHECK(a.is_in_state<Down>());
+    CHECK(b.state()->context.id == 2);
+    CHECK(b.state()->context.steps == 0);
+
+    // machines are values, a copy goes its own way
+    instance_fsm::Machine<Flip> c = a;
+    c.dispatch(Step());
+    CHECK(c.is_in_state<Up>());
+    CHECK(a.is_in_state<Down>());
+    CHECK(c.state()->context.steps == 7);
+    CHECK(a.state()->context.steps == 6);
+}
+
+// Every machine gets its own script from its index: periods of different
+// lengths, presses at different minutes, the odd busy spell.
+static void step(instance_fsm::Machine<Pomodoro> &fsm, size_t index, int minute)
+{
+    const TimerAction timer_action = {};
+    const CheckTimer check_timer = {};
+
+    if (minute == 0)
+    {
+        AdjustPeriod adjust;
+        adjust.delta = minutes(-(int64_t)(index % 40));
+        fsm.dispatch(adjust);
+    }
+    if (!fsm.state()->is_started() && (minute + index) % 3 == 0)
+    {
+        fsm.dispatch(timer_action);
+    }
+    if (index % 7 == 0 && minute % 50 == 10)
+    {
+        BusyChanged busy;
+        busy.is_busy = minute % 100 == 10;
+        fsm.dispatch(busy);
+    }
+    if (index % 11 == 0 && minute % 30 == 5)
+    {
+        MarkInterruption mark;
+        mark.is_external = minute % 60 == 5;
+        fsm.dispatch(mark);
+    }
+    fsm.dispatch(check_timer);
+}
+
+struct outcome
+{
+    pomodoro_phase phase;
+    bool is_started;
+    size_t short_breaks;
+    size_t long_breaks;
+    uint16_t interruptions;
+    seconds work_period;
+};
+
+static outcome outcome_of(instance_fsm::Machine<Pomodoro> &fsm)
+{
+    pomodoro_status status = pomodoro_fsm_status(fsm);
+    const pomodoro_context &context = fsm.state()->context;
+    return {status.phase, status.is_started, context.short_breaks, context.long_breaks, status.interruptions, context.work_period_seconds};
+}
+
+static bool operator==(const outcome &a, const outcome &b)
+{
+    return a.phase == b.phase && a.is_started == b.is_started && a.short_breaks == b.short_breaks && a.long_breaks == b.long_breaks &&
+           a.interruptions == b.interruptions && a.work_period == b.work_period;
+}
+
+// The minutes run in lock step, every thread takes its share of machines
+// through one minute, then the clock moves on.
+static std::vector<outcome> run(int threads)
+{
+    std::vector<instance_fsm::Machine<Pomodoro>> machines(MACHINES);
+    stub_timer_set(1000000);
+    for (auto &fsm : machines)
+    {
+        fsm.start<Idle>(initial_context);
+    }
+
+    for (int minute = 0; minute < STEPS; minute++)
+    {
+        std::vector<std::thread> workers;
+        for (int t = 0; t < threads; t++)
+        {
+            workers.emplace_back([&machines, threads, t, minute]() {
+                for (size_t i = t; i < machines.size(); i += threads)
+                {
+                    step(machines[i], i, minute);
+                }
+            });
+        }
+        for (auto &worker : workers)
+        {
+            worker.join();
+        }
+        stub_timer_advance(60 * 1000000LL);
+    }
+
+    std::vector<outcome> outcomes;
+    for (auto &fsm : machines)
+    {
+        outcomes.push_back(outcome_of(fsm));
+    }
+    return outcomes;
+}
+
+static void test_threads(void)
+{
+    std::vector<outcome> serial = run(1);
+    int serial_work_done = work_done.exchange(0);
+
+    std::vector<outcome> parallel = run(THREADS);
+    CHECK(work_done == serial_work_done);
+
+    size_t differing = 0;
+    for (size_t i = 0; i < MACHINES; i++)
+    {
+        differing += !(serial[i] == parallel[i]);
+    }
+    CHECK(differing == 0);
+
+    // the scripts do lead the machines apart
+    size_t phases[PHASE_LONG_BREAK_LAST_MINUTES + 1] = {};
+    size_t most_breaks = 0;
+    for (const outcome &o : parallel)
+    {
+        phases[o.phase]++;
+        most_breaks = o.short_breaks > most_breaks ? o.short_breaks : most_breaks;
+    }
+    CHECK(phases[PHASE_WORK] > 0);
+    CHECK(phases[PHASE_SHORT_BREAK] > 0);
+    CHECK(most_breaks > parallel[0].short_breaks);
+    CHECK(serial_work_done > MACHINES);
+    CHECK(parallel[0].work_period == minutes(45));
+    CHECK(parallel[39].work_period == minutes(6));
+}
+
+int main(void)
+{
+    esp_log_set_vprintf(quiet_vprintf);
+
+    test_transit();
+    test_threads();
+
+    printf("instance_fsm: %d failed checks\n", check_failures);
+    return check_failures != 0;
+}
@@ -0,0 +1,193 @@
+#include <stdio.h>
+#include <time.h>
+#include <vector>
+
+#include "esp_timer.h"
+#include "pomodoro_fsm.hpp"
+#include "journal.hpp"
+#include "provision.hpp"
+#include "check.hpp"
+
+// Interruption marks and finished periods from the FSM into the journal,
+// with the wall clock running on the stub timer.
+
+#define MIDNIGHT 1709596800 // 2024-03-05 00:00 UTC
+
+static int64_t wall_offset = 0; // unix time at boot, 0 until SNTP has synced
+static std::vector<journal_record> history;
+static int work_counted_day = -1;
+
+time_t time(time_t *out) noexcept
+{
+    time_t now = wall_offset + esp_timer_get_time() / 1000000;
+    if (out != nullptr)
+    {
+        *out = now;
+    }
+    return now;
+}
+
+// the zone from sdkconfig.h
+const provision_config &provision_get(void)
+{
+    static provision_config config = {};
+    return config;
+}
+
+uint8_t tags_get_active(void)
+{
+    return 0;
+}
+
+void tags_count_work(uint8_t tag, uint16_t minutes, int day)
+{
+    (void)tag;
+    (void)minutes;
+    work_counted_day = day;
+}
+
+void history_append(const journal_record &record)
+{
+    history.push_back(record);
+}
+
+bool pomodoro_post_input(uint32_t input)
+{
+    (void)input;
+    return true;
+}
+
+static const TimerAction timer_action = {};
+static const CheckTimer check_timer = {};
+
+static MarkInterruption mark(bool is_external)
+{
+    MarkInterruption event;
+    event.is_external = is_external;
+    return event;
+}
+
+static void advance_minutes(int64_t count)
+{
+    stub_timer_advance(count * 60 * 1000000);
+}
+
+// Sets the wall clock as SNTP would, to the given unix time now.
+static void sync_to(int64_t now)
+{
+    wall_offset = now - esp_timer_get_time() / 1000000;
+}
+
+static void test_before_sync(instance_fsm::Machine<Pomodoro> &fsm)
+{
+    fsm.start<Work>(initial_context);
+    fsm.dispatch(mark(false)); // not started yet, nothing to mark
+    fsm.dispatch(timer_action);
+
+    advance_minutes(10);
+    fsm.dispatch(mark(false));
+    advance_minutes(10);
+    fsm.dispatch(mark(true));
+
+    // marks leave the clock running
+    CHECK(fsm.state()->is_timer_active());
+    CHECK(!fsm.state()->is_paused());
+    CHECK(pomodoro_fsm_status(fsm).interruptions == 2);
+
+    advance_minutes(25);
+    fsm.dispatch(check_timer);
+    CHECK(fsm.is_in_state<ShortBreak>());
+
+    // uptime seconds until SNTP has synced, all of it day 0
+    CHECK(journal_today() == 0);
+    journal_record records[4];
+    CHECK(journal_read(records, 4) == 3);
+    CHECK(records[0].event == JOURNAL_INTERRUPTION_INTERNAL && records[0].detail == 10 && records[0].timestamp == 1 + 10 * 60);
+    CHECK(records[1].event == JOURNAL_INTERRUPTION_EXTERNAL && records[1].detail == 20 && records[1].timestamp == 1 + 20 * 60);
+    CHECK(records[2].event == JOURNAL_WORK_DONE && records[2].detail == 45 && records[2].timestamp == 1 + 45 * 60);
+    CHECK(work_counted_day == 0);
+
+    journal_daily_counts counts = journal_get_daily_counts();
+    CHECK(counts.work_done == 1);
+    CHECK(counts.work_minutes == 45);
+    CHECK(counts.interruptions_internal == 1);
+    CHECK(counts.interruptions_external == 1);
+    CHECK(history.size() == 3);
+}
+
+static void test_across_midnight(instance_fsm::Machine<Pomodoro> &fsm)
+{
+    // the day before sync is not today once the clock is set
+    sync_to(MIDNIGHT - 30 * 60);
+    CHECK(journal_get_daily_counts().work_done == 0);
+
+    // the break started and skipped, the next period started
+    fsm.dispatch(timer_action);
+    fsm.dispatch(timer_action);
+    CHECK(fsm.is_in_state<Work>());
+    fsm.dispatch(timer_action);
+    CHECK(pomodoro_fsm_status(fsm).interruptions == 0);
+
+    advance_minutes(5);
+    fsm.dispatch(mark(true));
+    journal_daily_counts counts = journal_get_daily_counts();
+    CHECK(counts.interruptions_external == 1);
+    CHECK(counts.work_done == 0);
+    CHECK(history.back().timestamp == MIDNIGHT - 25 * 60);
+
+    // after midnight the counts are read as empty before any new record
+    advance_minutes(30);
+    counts = journal_get_daily_counts();
+    CHECK(counts.interruptions_external == 0);
+    CHECK(counts.work_done == 0);
+
+    // the session count runs on across it
+    fsm.dispatch(mark(false));
+    CHECK(pomodoro_fsm_status(fsm).interruptions == 2);
+    counts = journal_get_daily_counts();
+    CHECK(counts.interruptions_internal == 1);
+    CHECK(counts.interruptions_external == 0);
+
+    advance_minutes(10);
+    fsm.dispatch(check_timer);
+    CHECK(fsm.is_in_state<ShortBreak>());
+    counts = journal_get_daily_counts();
+    CHECK(counts.work_done == 1);
+    CHECK(counts.work_minutes == 45);
+    CHECK(work_counted_day == journal_today());
+    CHECK(work_counted_day > 0);
+
+    // and the next day starts from nothing again
+    advance_minutes(24 * 60);
+    CHECK(journal_get_daily_counts().work_done == 0);
+    CHECK(journal_today() == work_counted_day + 1);
+}
+
+static void test_ring(void)
+{
+    for (int i = 0; i < CONFIG_POMODORO_JOURNAL_RECORDS + 5; i++)
+    {
+        advance_minutes(1);
+        journal_add(JOURNAL_ABSENCE, PHASE_IDLE, i);
+    }
+
+    journal_record records[CONFIG_POMODORO_JOURNAL_RECORDS];
+    CHECK(journal_read(records, CONFIG_POMODORO_JOURNAL_RECORDS) == CONFIG_POMODORO_JOURNAL_RECORDS);
+    CHECK(records[0].detail == 5);
+    CHECK(records[CONFIG_POMODORO_JOURNAL_RECORDS - 1].detail == CONFIG_POMODORO_JOURNAL_RECORDS + 4);
+    CHECK(journal_read(records, 2) == 2 && records[0].detail == 5);
+    CHECK(journal_get_daily_counts().absences == CONFIG_POMODORO_JOURNAL_RECORDS + 5);
+}
+
+int main(void)
+{
+    stub_timer_set(1000000);
+    instance_fsm::Machine<Pomodoro> fsm;
+
+    test_before_sync(fsm);
+    test_across_midnight(fsm);
+    test_ring();
+
+    printf("journal: %d failed checks\n", check_failures);
+    return check_failures != 0;
+}
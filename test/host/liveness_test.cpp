@@ -0,0 +1,284 @@
+#include <stdio.h>
+#include <string.h>
+#include <atomic>
+#include <mutex>
+#include <string>
+
+#include "sdkconfig.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_system.h"
+#include "esp_timer.h"
+#include "nvs.h"
+
+#include "liveness.hpp"
+#include "check.hpp"
+
+// Hung tasks injected into the supervisor: an input task that stops
+// checking in with an event pending, an esp_timer task that never runs the
+// armed deadline, and the healthy cases next to them. The supervisor runs
+// on a thread of its own; a test moves the clock, kicks it as a queued
+// input would and waits for it to block again before looking.
+
+#define SECOND 1000000LL
+#define TIMEOUT (CONFIG_POMODORO_LIVENESS_TIMEOUT_SECONDS * SECOND)
+#define FREE_HEAP 23456
+
+struct diagnostic
+{
+    uint32_t task;
+    uint32_t stalled_seconds;
+    uint32_t uptime_seconds;
+    uint32_t free_heap;
+};
+
+static std::atomic<int64_t> input_since(0);
+static std::atomic<int64_t> timer_since(0);
+static std::atomic<int> restarts(0);
+
+static std::mutex log_mutex;
+static std::string logged;
+
+static TaskHandle_t supervisor = nullptr;
+
+uint32_t esp_get_free_heap_size(void)
+{
+    return FREE_HEAP;
+}
+
+static int capture(const char *format, va_list args)
+{
+    char line[256];
+    int length = vsnprintf(line, sizeof(line), format, args);
+
+    std::lock_guard<std::mutex> lock(log_mutex);
+    logged += line;
+    return length;
+}
+
+static bool was_logged(const char *text)
+{
+    std::lock_guard<std::mutex> lock(log_mutex);
+    bool is_found = logged.find(text) != std::string::npos;
+    logged.clear();
+    return is_found;
+}
+
+// The light would be gone, here the hung work goes away with it.
+static void restart(void)
+{
+    restarts++;
+    input_since = 0;
+    timer_since = 0;
+}
+
+static int64_t input_pending_since(void)
+{
+    return input_since;
+}
+
+static int64_t timer_pending_since(void)
+{
+    return timer_since;
+}
+
+static int64_t now(void)
+{
+    return esp_timer_get_time();
+}
+
+// Returns the milliseconds the supervisor goes back to sleep for.
+static TickType_t settle(void)
+{
+    return stub_task_wait_idle(supervisor);
+}
+
+static TickType_t kick(void)
+{
+    liveness_kick();
+    return settle();
+}
+
+static bool read_diagnostic(diagnostic *out)
+{
+    nvs_handle handle;
+    nvs_open("liveness", NVS_READWRITE, &handle);
+    size_t len = sizeof(*out);
+    bool is_found = nvs_get_blob(handle, "last_hang", out, &len) == ESP_OK && len == sizeof(*out);
+    nvs_close(handle);
+    return is_found;
+}
+
+// The diagnostic of the restart before is logged once, the hardware
+// watchdog reset with it.
+static void test_boot(void)
+{
+    diagnostic left = {LIVENESS_TIMER, 31, 86400, 12000};
+    nvs_handle handle;
+    nvs_open("liveness", NVS_READWRITE, &handle);
+    nvs_set_blob(handle, "last_hang", &left, sizeof(left));
+    nvs_close(handle);
+    stub_reset_reason() = ESP_RST_TASK_WDT;
+
+    CHECK(liveness_setup() == ESP_OK);
+
+    std::string line;
+    {
+        std::lock_guard<std::mutex> lock(log_mutex);
+        line = logged;
+        logged.clear();
+    }
+    CHECK(line.find("restarted after the esp_timer task hung for 31 sec, uptime was 86400 sec, free heap 12000") != std::string::npos);
+    CHECK(line.find("restarted by the hardware watchdog") != std::string::npos);
+
+    diagnostic read;
+    CHECK(!read_diagnostic(&read));
+}
+
+// Nothing pending, nothing to time: the supervisor sleeps until kicked and
+// kicks cost one wakeup each.
+static void test_idle(void)
+{
+    CHECK(supervisor != nullptr);
+    CHECK(settle() == portMAX_DELAY);
+
+    liveness_watch(LIVENESS_INPUT, input_pending_since);
+    liveness_watch(LIVENESS_TIMER, timer_pending_since);
+    CHECK(kick() == portMAX_DELAY);
+
+    uint32_t wakeups = stub_task_wakeups(supervisor);
+    stub_timer_advance(3600 * SECOND);
+    CHECK(settle() == portMAX_DELAY);
+    CHECK(stub_task_wakeups(supervisor) == wakeups);
+    CHECK(restarts == 0);
+}
+
+// An input task that gets through its events: work pending for longer than
+// the timeout, with a check-in for every event.
+static void test_busy_input(void)
+{
+    input_since = now();
+    CHECK(kick() == TIMEOUT / 1000 + 1);
+
+    for (int i = 0; i < 12; i++)
+    {
+        stub_timer_advance(10 * SECOND);
+        liveness_checkin(LIVENESS_INPUT);
+        CHECK(settle() == TIMEOUT / 1000 + 1);
+    }
+    CHECK(now() - input_since > TIMEOUT);
+    CHECK(restarts == 0);
+
+    input_since = 0;
+    liveness_checkin(LIVENESS_INPUT);
+    CHECK(settle() == portMAX_DELAY);
+}
+
+// gpio_handle_evt_from_isr blocked with an event in its queue.
+static void test_hung_input(void)
+{
+    stub_timer_advance(5 * SECOND);
+    input_since = now();
+    kick();
+
+    stub_timer_advance(TIMEOUT - SECOND);
+    CHECK(kick() == 1000 + 1);
+    CHECK(restarts == 0);
+
+    // more events queue up behind it, the first one still times it
+    stub_timer_advance(SECOND / 2);
+    kick();
+    CHECK(restarts == 0);
+
+    stub_timer_advance(SECOND / 2);
+    kick();
+    CHECK(restarts == 1);
+    CHECK(was_logged("input task hung for 30 sec, restarting"));
+
+    diagnostic left;
+    CHECK(read_diagnostic(&left));
+    CHECK(left.task == LIVENESS_INPUT);
+    CHECK(left.stalled_seconds == 30);
+    CHECK(left.uptime_seconds == now() / SECOND);
+    CHECK(left.free_heap == FREE_HEAP);
+}
+
+// The deadline armed for later is no work yet; once due it is, until the
+// esp_timer task runs the callback and checks in.
+static void test_timer(void)
+{
+    liveness_checkin(LIVENESS_TIMER);
+    settle();
+
+    timer_since = now() + 25 * 60 * SECOND;
+    CHECK(kick() == (25 * 60 * SECOND + TIMEOUT) / 1000 + 1);
+
+    // on time, a little late even
+    stub_timer_advance(25 * 60 * SECOND + 2 * SECOND);
+    timer_since = 0;
+    liveness_checkin(LIVENESS_TIMER);
+    CHECK(settle() == portMAX_DELAY);
+
+    // the next one never runs
+    timer_since = now() + 5 * 60 * SECOND;
+    kick();
+    stub_timer_advance(5 * 60 * SECOND + TIMEOUT - SECOND);
+    kick();
+    CHECK(restarts == 1);
+
+    // a check-in from before it was due does not count
+    stub_timer_advance(SECOND);
+    kick();
+    CHECK(restarts == 2);
+    CHECK(was_logged("esp_timer task hung for 30 sec, restarting"));
+
+    diagnostic left;
+    CHECK(read_diagnostic(&left));
+    CHECK(left.task == LIVENESS_TIMER);
+    CHECK(left.stalled_seconds == 30);
+}
+
+// One task hung does not hide behind the other one being fine.
+static void test_one_of_two(void)
+{
+    input_since = now();
+    timer_since = now() + 60 * SECOND;
+    kick();
+
+    for (int i = 0; i < 3; i++)
+    {
+        stub_timer_advance(10 * SECOND);
+        liveness_checkin(LIVENESS_INPUT);
+        settle();
+    }
+    CHECK(restarts == 2);
+
+    // the input task is still fine, the timer is due and hangs
+    stub_timer_advance(30 * SECOND + TIMEOUT);
+    liveness_checkin(LIVENESS_INPUT);
+    settle();
+    CHECK(restarts == 3);
+    CHECK(was_logged("esp_timer task hung"));
+}
+
+int main(void)
+{
+    stub_timer_set(SECOND);
+    esp_log_set_vprintf(capture);
+    stub_restart() = restart;
+
+    // the supervisor is the one task liveness_setup() creates
+    test_boot();
+    supervisor = stub_task_last_created();
+
+    test_idle();
+    test_busy_input();
+    test_hung_input();
+    test_timer();
+    test_one_of_two();
+
+    esp_log_set_vprintf(stub_log_stderr);
+    printf("liveness: %d failed checks\n", check_failures);
+    return check_failures != 0;
+}
@@ -0,0 +1,146 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "sdkconfig.h"
+#include "nvs.h"
+#include "provision.hpp"
+#include "check.hpp"
+
+#include "provision_vectors.inc"
+
+static const uint8_t device_mac[6] = {0xa4, 0xcf, 0x12, 0x34, 0x56, 0x78};
+
+static const char *verify(const uint8_t *bundle, size_t len, const uint8_t *key = vector_public_key)
+{
+    provision_config config;
+    const char *reason;
+    bool is_valid = provision_verify(bundle, len, key, device_mac, &config, &reason);
+    CHECK(is_valid == (strcmp(reason, "ok") == 0));
+    return reason;
+}
+
+// As provision commit leaves it, sequence 0 for a unit that never had one.
+static void store(const uint8_t *bundle, size_t len, uint32_t sequence)
+{
+    nvs_handle handle;
+    nvs_open("provision", NVS_READWRITE, &handle);
+    stub_nvs_erase_all();
+    if (sequence != 0)
+    {
+        nvs_set_u32(handle, "sequence", sequence);
+    }
+    nvs_set_blob(handle, "bundle", bundle, len);
+    nvs_close(handle);
+}
+
+static void test_public_key(void)
+{
+    char hex[2 * sizeof(vector_public_key) + 1];
+    for (size_t i = 0; i < sizeof(vector_public_key); i++)
+    {
+        sprintf(hex + 2 * i, "%02x", vector_public_key[i]);
+    }
+    CHECK(strcmp(hex, CONFIG_POMODORO_PROVISION_PUBLIC_KEY) == 0);
+}
+
+static void test_valid(void)
+{
+    provision_config config;
+    const char *reason;
+    CHECK(provision_verify(vector_bound, sizeof(vector_bound), vector_public_key, device_mac, &config, &reason));
+    CHECK(config.sequence == 100);
+    CHECK(strcmp(config.wifi_ssid, "office") == 0);
+    CHECK(strcmp(config.wifi_password, "secret") == 0);
+    CHECK(strcmp(config.timezone, "Europe/Berlin") == 0);
+    CHECK(config.hint_key[0] == '\0');
+    CHECK(config.work_minutes == 50);
+    CHECK(config.short_break_minutes == 0);
+
+    CHECK(provision_verify(vector_unbound, sizeof(vector_unbound), vector_public_key, device_mac, &config, &reason));
+    CHECK(config.sequence == 101);
+    CHECK(strcmp(config.hint_key, "abc") == 0);
+    CHECK(config.wifi_ssid[0] == '\0');
+    CHECK(config.long_break_minutes == 20);
+}
+
+static void test_rejected(void)
+{
+    CHECK(strcmp(verify(vector_other_device, sizeof(vector_other_device)), "device") == 0);
+    CHECK(strcmp(verify(vector_other_key, sizeof(vector_other_key)), "signature") == 0);
+    CHECK(strcmp(verify(vector_bad_minutes, sizeof(vector_bad_minutes)), "field") == 0);
+    CHECK(strcmp(verify(vector_unknown_field, sizeof(vector_unknown_field)), "field") == 0);
+    CHECK(strcmp(verify(vector_long_timezone, sizeof(vector_long_timezone)), "field") == 0);
+
+    CHECK(strcmp(verify(vector_bound, sizeof(vector_bound) - 1), "malformed") == 0);
+    CHECK(strcmp(verify(vector_bound, PROVISION_HEADER_SIZE), "malformed") == 0);
+
+    uint8_t bundle[sizeof(vector_bound)];
+    memcpy(bundle, vector_bound, sizeof(bundle));
+    bundle[2] = 1;
+    CHECK(strcmp(verify(bundle, sizeof(bundle)), "malformed") == 0);
+
+    // any changed bit, in the fields, the sequence or the signature
+    const size_t positions[] = {4, PROVISION_HEADER_SIZE + 8, sizeof(bundle) - PROVISION_SIGNATURE_SIZE, sizeof(bundle) - 1};
+    for (size_t position : positions)
+    {
+        memcpy(bundle, vector_bound, sizeof(bundle));
+        bundle[position] ^= 0x01;
+        CHECK(strcmp(verify(bundle, sizeof(bundle)), "signature") == 0);
+    }
+
+    // a key off the curve verifies nothing
+    uint8_t key[sizeof(vector_public_key)];
+    memcpy(key, vector_public_key, sizeof(key));
+    key[sizeof(key) - 1] ^= 0x01;
+    CHECK(strcmp(verify(vector_bound, sizeof(vector_bound), key), "signature") == 0);
+}
+
+static void test_load(void)
+{
+    stub_nvs_erase_all();
+    CHECK(provision_load() == ESP_OK);
+    CHECK(provision_get().sequence == 0);
+
+    store(vector_bound, sizeof(vector_bound), 100);
+    CHECK(provision_load() == ESP_OK);
+    CHECK(provision_get().sequence == 100);
+    CHECK(strcmp(provision_get().wifi_ssid, "office") == 0);
+
+    // a restart between the writes of a commit, the stored sequence is ahead
+    store(vector_bound, sizeof(vector_bound), 101);
+    CHECK(provision_load() == ESP_OK);
+    CHECK(provision_get().sequence == 101);
+    CHECK(strcmp(provision_get().wifi_ssid, "office") == 0);
+
+    // settings of a rejected bundle are dropped, the verified sequence stays
+    store(vector_other_device, sizeof(vector_other_device), 100);
+    CHECK(provision_load() == ESP_OK);
+    CHECK(provision_get().sequence == 100);
+    CHECK(provision_get().wifi_ssid[0] == '\0');
+    CHECK(provision_get().work_minutes == 0);
+
+    // nor can a corrupt blob claim a sequence that locks out every later one
+    uint8_t bundle[sizeof(vector_bound)];
+    memcpy(bundle, vector_bound, sizeof(bundle));
+    memset(bundle + 4, 0xFF, 4);
+    store(bundle, sizeof(bundle), 100);
+    CHECK(provision_load() == ESP_OK);
+    CHECK(provision_get().sequence == 100);
+    CHECK(provision_get().timezone[0] == '\0');
+
+    const uint8_t garbage[] = {'X', 'X', 2, 0, 1, 0, 0, 0, 0, 0};
+    store(garbage, sizeof(garbage), 0);
+    CHECK(provision_load() == ESP_OK);
+    CHECK(provision_get().sequence == 0);
+}
+
+int main(void)
+{
+    test_public_key();
+    test_valid();
+    test_rejected();
+    test_load();
+
+    printf("provision: %d failed checks\n", check_failures);
+    return check_failures != 0;
+}
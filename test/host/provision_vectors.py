@@ -0,0 +1,53 @@
+#!/usr/bin/env python3
+"""Writes provision_vectors.inc, bundles signed by tools/provision.py.
+
+The keys are fixed and the signatures deterministic, so running it again
+gives the same file unless the bundle format changes.
+
+    test/host/provision_vectors.py > test/host/provision_vectors.inc
+"""
+
+import hashlib
+import os
+import sys
+
+sys.path.insert(0, os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "..", "tools"))
+import provision  # noqa: E402
+
+KEY = int(hashlib.sha256(b"esp-pomodoro-light host test").hexdigest(), 16) % provision.N
+OTHER_KEY = int(hashlib.sha256(b"esp-pomodoro-light other key").hexdigest(), 16) % provision.N
+MAC = "a4:cf:12:34:56:78"  # esp_read_mac() in stubs/esp_system.h
+OTHER_MAC = "a4:cf:12:34:56:79"
+
+
+def array(name, data):
+    lines = ["static const uint8_t %s[] = {" % name]
+    for offset in range(0, len(data), 12):
+        lines.append("    " + " ".join("0x%02x," % b for b in data[offset:offset + 12]))
+    lines.append("};")
+    return "\n".join(lines)
+
+
+def main():
+    settings = {"wifi_ssid": "office", "wifi_password": "secret", "timezone": "Europe/Berlin", "work_minutes": 50}
+    vectors = [
+        ("vector_public_key", provision.public_key(KEY)),
+        ("vector_bound", provision.build_bundle(KEY, 100, settings, MAC)),
+        ("vector_unbound", provision.build_bundle(KEY, 101, {"hint_key": "abc", "long_break_minutes": 20})),
+        ("vector_other_device", provision.build_bundle(KEY, 102, settings, OTHER_MAC)),
+        ("vector_other_key", provision.build_bundle(OTHER_KEY, 103, settings, MAC)),
+        # the tool refuses these settings, so the fields are put together by hand
+        ("vector_bad_minutes", provision.sign_bundle(KEY, 104, bytes([6, 1, 0]))),
+        ("vector_unknown_field", provision.sign_bundle(KEY, 105, bytes([9, 1, 1]))),
+        ("vector_long_timezone", provision.sign_bundle(KEY, 106, bytes([5, 48]) + b"x" * 48)),
+    ]
+
+    print("// Generated by test/host/provision_vectors.py, do not edit.")
+    for name, data in vectors:
+        print()
+        print(array(name, data))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
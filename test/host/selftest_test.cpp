@@ -0,0 +1,147 @@
+#include <stdio.h>
+#include <vector>
+
+#include "sdkconfig.h"
+#include "selftest.hpp"
+#include "check.hpp"
+
+// Presses and bounces measured from recorded edges, and a light started
+// without the button held.
+
+#define MS 1000
+
+static std::vector<selftest_edge> edges;
+
+// A press or a release bouncing that many times, 1 ms apart, from the
+// given time on. Ends at the level it settles to.
+static void burst(int64_t at, uint8_t level, int bounces)
+{
+    for (int i = 0; i < bounces; i++)
+    {
+        edges.push_back({at + i * MS, (uint8_t)(i % 2 == 0 ? level : !level)});
+    }
+    edges.push_back({at + bounces * MS, level});
+}
+
+static selftest_result analyze(int64_t now, bool is_final)
+{
+    return selftest_analyze(edges.data(), edges.size(), now, is_final);
+}
+
+static void test_clean_presses(void)
+{
+    edges.clear();
+    CHECK(analyze(0, true).presses == 0);
+    CHECK(analyze(0, true).press_min_ms == 0);
+
+    // three presses of 100, 200 and 300 ms, none bouncing
+    for (int i = 0; i < 3; i++)
+    {
+        burst(i * 1000 * MS, 0, 0);
+        burst(i * 1000 * MS + (i + 1) * 100 * MS, 1, 0);
+    }
+
+    selftest_result result = analyze(10000 * MS, true);
+    CHECK(result.presses == 3);
+    CHECK(result.edges_max == 1);
+    CHECK(result.bounce_max_us == 0);
+    CHECK(result.bounce_avg_us == 0);
+    CHECK(result.press_min_ms == 100);
+    CHECK(result.press_max_ms == 300);
+    CHECK(!result.has_run);
+}
+
+static void test_bounces(void)
+{
+    edges.clear();
+    burst(0, 0, 4);           // 5 edges over 4 ms
+    burst(150 * MS, 1, 2);    // 3 edges over 2 ms
+    burst(1000 * MS, 0, 0);   // 1 edge
+    burst(1250 * MS, 1, 10);  // 11 edges over 10 ms
+
+    selftest_result result = analyze(5000 * MS, true);
+    CHECK(result.presses == 2);
+    CHECK(result.edges_max == 11);
+    CHECK(result.bounce_max_us == 10 * MS);
+    CHECK(result.bounce_avg_us == (4 + 2 + 0 + 10) * MS / 4);
+    // from the first edge of the press to the first of its release
+    CHECK(result.press_min_ms == 150);
+    CHECK(result.press_max_ms == 250);
+
+    // edges just under the quiet time apart are one burst
+    edges.clear();
+    for (int i = 0; i < 6; i++)
+    {
+        edges.push_back({i * (SELFTEST_QUIET_US - 1), (uint8_t)(i % 2)});
+    }
+    result = analyze(5000 * MS, true);
+    CHECK(result.presses == 0);
+    CHECK(result.edges_max == 6);
+    CHECK(result.bounce_max_us == 5 * (SELFTEST_QUIET_US - 1));
+
+    // and the quiet time itself splits them
+    edges.clear();
+    burst(0, 0, 0);
+    burst(SELFTEST_QUIET_US, 1, 0);
+    result = analyze(5000 * MS, true);
+    CHECK(result.presses == 1);
+    CHECK(result.edges_max == 1);
+    CHECK(result.press_max_ms == SELFTEST_QUIET_US / MS);
+}
+
+static void test_unfinished_burst(void)
+{
+    edges.clear();
+    burst(0, 0, 2);
+    burst(200 * MS, 1, 2);
+    burst(1000 * MS, 0, 3); // the newest press, still bouncing at 1010 ms
+
+    int64_t last = edges.back().at;
+    selftest_result result = analyze(last + SELFTEST_QUIET_US - 1, false);
+    CHECK(result.presses == 1);
+    CHECK(result.edges_max == 3);
+    CHECK(result.bounce_max_us == 2 * MS);
+
+    // quiet long enough, or the test is over, and it counts
+    result = analyze(last + SELFTEST_QUIET_US, false);
+    CHECK(result.presses == 2);
+    CHECK(result.edges_max == 4);
+    result = analyze(last + 1, true);
+    CHECK(result.presses == 2);
+    CHECK(result.edges_max == 4);
+
+    // a press never released has no duration
+    CHECK(result.press_min_ms == 200);
+    CHECK(result.press_max_ms == 200);
+
+    // a release without a press before it, edges recording from the middle
+    edges.clear();
+    burst(0, 1, 1);
+    burst(500 * MS, 0, 0);
+    burst(800 * MS, 1, 0);
+    result = analyze(5000 * MS, true);
+    CHECK(result.presses == 1);
+    CHECK(result.press_min_ms == 300);
+    CHECK(result.press_max_ms == 300);
+}
+
+static void test_not_held(void)
+{
+    selftest_pins pins = {GPIO_NUM_0, {GPIO_NUM_12, GPIO_NUM_13, GPIO_NUM_14}};
+    CHECK(!selftest_run_if_held(pins));
+    CHECK(!selftest_get_result().has_run);
+
+    char json[256];
+    CHECK(selftest_format(json, sizeof(json)) == 0);
+}
+
+int main(void)
+{
+    test_clean_presses();
+    test_bounces();
+    test_unfinished_burst();
+    test_not_held();
+
+    printf("selftest: %d failed checks\n", check_failures);
+    return check_failures != 0;
+}
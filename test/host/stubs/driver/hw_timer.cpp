@@ -0,0 +1,79 @@
+#include "esp_timer.h"
+#include "driver/hw_timer.h"
+
+// the 23 bit counter at 80 MHz / 16 wraps after this long
+#define HW_TIMER_MAX_US 1677721
+
+static hw_timer_callback_t user_callback = nullptr;
+static void *user_arg = nullptr;
+static esp_timer_handle_t alarm_timer = nullptr;
+static uint32_t alarm_us = 0;
+static bool alarm_reload = false;
+static uint32_t interrupts = 0;
+
+static void alarm_callback(void *arg)
+{
+    (void)arg;
+
+    interrupts++;
+    if (alarm_reload)
+    {
+        esp_timer_start_once(alarm_timer, alarm_us);
+    }
+    user_callback(user_arg);
+}
+
+esp_err_t hw_timer_init(hw_timer_callback_t callback, void *arg)
+{
+    if (callback == nullptr || alarm_timer != nullptr)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+    user_callback = callback;
+    user_arg = arg;
+
+    esp_timer_create_args_t alarm_timer_args = {};
+
+    alarm_timer_args.callback = &alarm_callback;
+    alarm_timer_args.name = "frc1";
+
+    return esp_timer_create(&alarm_timer_args, &alarm_timer);
+}
+
+esp_err_t hw_timer_alarm_us(uint32_t value, bool reload)
+{
+    if (alarm_timer == nullptr)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (value < 10 || value > HW_TIMER_MAX_US)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    alarm_us = value;
+    alarm_reload = reload;
+
+    esp_timer_stop(alarm_timer);
+    return esp_timer_start_once(alarm_timer, value);
+}
+
+esp_err_t hw_timer_disarm(void)
+{
+    if (alarm_timer == nullptr)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+    alarm_reload = false;
+    esp_timer_stop(alarm_timer);
+    return ESP_OK;
+}
+
+uint32_t stub_hw_timer_interrupts(void)
+{
+    return interrupts;
+}
+
+bool stub_hw_timer_armed(void)
+{
+    return alarm_timer != nullptr && stub_timer_armed(alarm_timer);
+}
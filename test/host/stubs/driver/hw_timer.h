@@ -0,0 +1,21 @@
+#ifndef HW_TIMER_H_INCLUDED
+#define HW_TIMER_H_INCLUDED
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+
+// FRC1 as a one or reloading alarm on the stub timer: the callback runs
+// from stub_timer_advance() like the interrupt would, and every run is
+// counted as the CPU wakeup it costs on the chip.
+typedef void (*hw_timer_callback_t)(void *arg);
+
+esp_err_t hw_timer_init(hw_timer_callback_t callback, void *arg);
+esp_err_t hw_timer_alarm_us(uint32_t value, bool reload);
+esp_err_t hw_timer_disarm(void);
+
+uint32_t stub_hw_timer_interrupts(void);
+bool stub_hw_timer_armed(void);
+
+#endif /* HW_TIMER_H_INCLUDED */
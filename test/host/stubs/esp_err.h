@@ -0,0 +1,29 @@
+#ifndef ESP_ERR_H_INCLUDED
+#define ESP_ERR_H_INCLUDED
+
+typedef int esp_err_t;
+
+#define ESP_OK 0
+#define ESP_FAIL -1
+#define ESP_ERR_NO_MEM 0x101
+#define ESP_ERR_INVALID_ARG 0x102
+#define ESP_ERR_INVALID_STATE 0x103
+#define ESP_ERR_INVALID_SIZE 0x104
+#define ESP_ERR_NOT_FOUND 0x105
+#define ESP_ERR_TIMEOUT 0x107
+
+static inline const char *esp_err_to_name(esp_err_t err)
+{
+    return err == ESP_OK ? "ESP_OK" : "ESP_ERR";
+}
+
+#define ESP_ERROR_CHECK(x)         \
+    do                             \
+    {                              \
+        if ((x) != ESP_OK)         \
+        {                          \
+            __builtin_trap();      \
+        }                          \
+    } while (0)
+
+#endif /* ESP_ERR_H_INCLUDED */
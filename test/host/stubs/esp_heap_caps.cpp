@@ -0,0 +1,163 @@
+#include <string.h>
+
+#include "esp_system.h"
+#include "esp_heap_caps.h"
+
+// Blocks are a header and the bytes handed out, aligned to 8 like the
+// SDK's heap. Frees merge with free neighbours, allocations take the first
+// block large enough and split off what is left if it is worth a block.
+
+#define ALIGN 8
+#define MIN_SPLIT 16
+
+struct block
+{
+    uint32_t size; // bytes after the header
+    uint32_t is_free;
+};
+
+static_assert(sizeof(block) % ALIGN == 0, "header keeps the alignment");
+
+alignas(ALIGN) static uint8_t arena[STUB_HEAP_BYTES];
+static bool is_ready = false;
+static size_t free_bytes = 0;
+static size_t minimum_free_bytes = 0;
+
+static block *first(void)
+{
+    return (block *)arena;
+}
+
+static block *next(block *b)
+{
+    uint8_t *after = (uint8_t *)(b + 1) + b->size;
+    return after < arena + sizeof(arena) ? (block *)after : nullptr;
+}
+
+static void heap_ready(void)
+{
+    if (is_ready)
+    {
+        return;
+    }
+    first()->size = sizeof(arena) - sizeof(block);
+    first()->is_free = 1;
+    free_bytes = first()->size;
+    minimum_free_bytes = free_bytes;
+    is_ready = true;
+}
+
+void *_heap_caps_malloc(size_t size, uint32_t caps, const char *file, size_t line)
+{
+    (void)caps;
+    (void)file;
+    (void)line;
+    heap_ready();
+
+    if (size == 0 || size > sizeof(arena))
+    {
+        return nullptr;
+    }
+    size = (size + ALIGN - 1) / ALIGN * ALIGN;
+
+    for (block *b = first(); b != nullptr; b = next(b))
+    {
+        if (!b->is_free || b->size < size)
+        {
+            continue;
+        }
+        if (b->size >= size + sizeof(block) + MIN_SPLIT)
+        {
+            block *rest = (block *)((uint8_t *)(b + 1) + size);
+            rest->size = b->size - size - sizeof(block);
+            rest->is_free = 1;
+            b->size = size;
+            free_bytes -= sizeof(block);
+        }
+        b->is_free = 0;
+        free_bytes -= b->size;
+        if (free_bytes < minimum_free_bytes)
+        {
+            minimum_free_bytes = free_bytes;
+        }
+        return b + 1;
+    }
+    return nullptr;
+}
+
+void *_heap_caps_zalloc(size_t size, uint32_t caps, const char *file, size_t line)
+{
+    void *ptr = _heap_caps_malloc(size, caps, file, line);
+    if (ptr != nullptr)
+    {
+        memset(ptr, 0, size);
+    }
+    return ptr;
+}
+
+void *_heap_caps_calloc(size_t count, size_t size, uint32_t caps, const char *file, size_t line)
+{
+    if (size != 0 && count > sizeof(arena) / size)
+    {
+        return nullptr;
+    }
+    return _heap_caps_zalloc(count * size, caps, file, line);
+}
+
+void _heap_caps_free(void *ptr, const char *file, size_t line)
+{
+    (void)file;
+    (void)line;
+    if (ptr == nullptr)
+    {
+        return;
+    }
+
+    block *freed = (block *)ptr - 1;
+    freed->is_free = 1;
+    free_bytes += freed->size;
+
+    // one pass merges every run of free blocks
+    for (block *b = first(); b != nullptr; b = next(b))
+    {
+        block *after = next(b);
+        while (b->is_free && after != nullptr && after->is_free)
+        {
+            b->size += sizeof(block) + after->size;
+            free_bytes += sizeof(block);
+            after = next(b);
+        }
+    }
+}
+
+// Moves the block every time, as the SDK's heap does when it cannot grow it
+// in place. A failed move leaves the old block alone.
+void *_heap_caps_realloc(void *ptr, size_t size, uint32_t caps, const char *file, size_t line)
+{
+    if (size == 0)
+    {
+        _heap_caps_free(ptr, file, line);
+        return nullptr;
+    }
+
+    void *moved = _heap_caps_malloc(size, caps, file, line);
+    if (moved != nullptr && ptr != nullptr)
+    {
+        size_t old_size = ((block *)ptr - 1)->size;
+        memcpy(moved, ptr, old_size < size ? old_size : size);
+        _heap_caps_free(ptr, file, line);
+    }
+    return moved;
+}
+
+uint32_t esp_get_free_heap_size(void)
+{
+    heap_ready();
+    return free_bytes;
+}
+
+uint32_t esp_get_minimum_free_heap_size(void)
+{
+    heap_ready();
+    return minimum_free_bytes;
+}
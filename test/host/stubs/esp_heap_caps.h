@@ -0,0 +1,36 @@
+#ifndef ESP_HEAP_CAPS_H_INCLUDED
+#define ESP_HEAP_CAPS_H_INCLUDED
+
+#include <stddef.h>
+#include <stdint.h>
+
+// The heap_caps layer of the SDK over a heap of its own, see
+// esp_heap_caps.cpp: first fit with coalescing in STUB_HEAP_BYTES, so it
+// fragments as a small heap does. Linked with the same --wrap options as
+// the firmware, heap_track.cpp sees every call of a test.
+#define MALLOC_CAP_32BIT (1 << 1)
+#define MALLOC_CAP_8BIT (1 << 2)
+
+#define STUB_HEAP_BYTES 40960
+
+extern "C"
+{
+    void *_heap_caps_malloc(size_t size, uint32_t caps, const char *file, size_t line);
+    void *_heap_caps_zalloc(size_t size, uint32_t caps, const char *file, size_t line);
+    void *_heap_caps_calloc(size_t count, size_t size, uint32_t caps, const char *file, size_t line);
+    void *_heap_caps_realloc(void *ptr, size_t size, uint32_t caps, const char *file, size_t line);
+    void _heap_caps_free(void *ptr, const char *file, size_t line);
+}
+
+#define heap_caps_malloc(size, caps) _heap_caps_malloc(size, caps, __FILE__, __LINE__)
+#define heap_caps_zalloc(size, caps) _heap_caps_zalloc(size, caps, __FILE__, __LINE__)
+#define heap_caps_calloc(count, size, caps) _heap_caps_calloc(count, size, caps, __FILE__, __LINE__)
+#define heap_caps_realloc(ptr, size, caps) _heap_caps_realloc(ptr, size, caps, __FILE__, __LINE__)
+#define heap_caps_free(ptr) _heap_caps_free(ptr, __FILE__, __LINE__)
+
+// What the newlib shims do for malloc and free: the caller's return address
+// goes down as the file, with line 0.
+#define stub_heap_malloc(size) _heap_caps_malloc(size, MALLOC_CAP_32BIT, (const char *)__builtin_return_address(0), 0)
+#define stub_heap_free(ptr) _heap_caps_free(ptr, (const char *)__builtin_return_address(0), 0)
+
+#endif /* ESP_HEAP_CAPS_H_INCLUDED */
@@ -0,0 +1,60 @@
+#ifndef ESP_HTTP_CLIENT_H_INCLUDED
+#define ESP_HTTP_CLIENT_H_INCLUDED
+
+#include "esp_err.h"
+
+// Never connects, the tests feed the parsers directly.
+typedef struct esp_http_client *esp_http_client_handle_t;
+
+typedef struct
+{
+    const char *url;
+    int timeout_ms;
+} esp_http_client_config_t;
+
+static inline esp_http_client_handle_t esp_http_client_init(const esp_http_client_config_t *config)
+{
+    (void)config;
+    return nullptr;
+}
+
+static inline esp_err_t esp_http_client_open(esp_http_client_handle_t client, int write_len)
+{
+    (void)client;
+    (void)write_len;
+    return ESP_FAIL;
+}
+
+static inline int esp_http_client_fetch_headers(esp_http_client_handle_t client)
+{
+    (void)client;
+    return -1;
+}
+
+static inline int esp_http_client_get_status_code(esp_http_client_handle_t client)
+{
+    (void)client;
+    return 0;
+}
+
+static inline int esp_http_client_read(esp_http_client_handle_t client, char *buffer, int len)
+{
+    (void)client;
+    (void)buffer;
+    (void)len;
+    return -1;
+}
+
+static inline esp_err_t esp_http_client_close(esp_http_client_handle_t client)
+{
+    (void)client;
+    return ESP_OK;
+}
+
+static inline esp_err_t esp_http_client_cleanup(esp_http_client_handle_t client)
+{
+    (void)client;
+    return ESP_OK;
+}
+
+#endif /* ESP_HTTP_CLIENT_H_INCLUDED */
@@ -0,0 +1,132 @@
+#include <string.h>
+#include <vector>
+
+#include "esp_http_server.h"
+
+static std::vector<httpd_uri_t> handlers;
+
+esp_err_t httpd_start(httpd_handle_t *handle, const httpd_config_t *config)
+{
+    (void)config;
+    handlers.clear();
+    *handle = &handlers;
+    return ESP_OK;
+}
+
+esp_err_t httpd_register_uri_handler(httpd_handle_t handle, const httpd_uri_t *uri)
+{
+    (void)handle;
+    handlers.push_back(*uri);
+    return ESP_OK;
+}
+
+size_t httpd_req_get_url_query_len(httpd_req_t *req)
+{
+    return req->query == nullptr ? 0 : strlen(req->query);
+}
+
+// Copies as much as fits, like the server does.
+static esp_err_t copy_truncated(const char *src, size_t len, char *buf, size_t buf_len)
+{
+    size_t copied = len < buf_len - 1 ? len : buf_len - 1;
+    memcpy(buf, src, copied);
+    buf[copied] = '\0';
+    return copied < len ? ESP_ERR_HTTPD_RESULT_TRUNC : ESP_OK;
+}
+
+esp_err_t httpd_req_get_url_query_str(httpd_req_t *req, char *buf, size_t buf_len)
+{
+    if (req->query == nullptr)
+    {
+        return ESP_ERR_NOT_FOUND;
+    }
+    return copy_truncated(req->query, strlen(req->query), buf, buf_len);
+}
+
+esp_err_t httpd_query_key_value(const char *query, const char *key, char *val, size_t val_size)
+{
+    size_t key_len = strlen(key);
+    const char *pair = query;
+    while (*pair != '\0')
+    {
+        const char *end = strchr(pair, '&');
+        size_t len = end == nullptr ? strlen(pair) : (size_t)(end - pair);
+        if (len > key_len && strncmp(pair, key, key_len) == 0 && pair[key_len] == '=')
+        {
+            return copy_truncated(pair + key_len + 1, len - key_len - 1, val, val_size);
+        }
+        pair += end == nullptr ? len : len + 1;
+    }
+    return ESP_ERR_NOT_FOUND;
+}
+
+esp_err_t httpd_resp_set_status(httpd_req_t *req, const char *status)
+{
+    req->status = status;
+    return ESP_OK;
+}
+
+esp_err_t httpd_resp_set_type(httpd_req_t *req, const char *type)
+{
+    req->type = type;
+    return ESP_OK;
+}
+
+esp_err_t httpd_resp_set_hdr(httpd_req_t *req, const char *field, const char *value)
+{
+    (void)req;
+    (void)field;
+    (void)value;
+    return ESP_OK;
+}
+
+esp_err_t httpd_resp_send(httpd_req_t *req, const char *buf, ssize_t buf_len)
+{
+    if (buf != nullptr)
+    {
+        req->body.append(buf, buf_len == HTTPD_RESP_USE_STRLEN ? strlen(buf) : (size_t)buf_len);
+    }
+    req->is_finished = true;
+    return ESP_OK;
+}
+
+esp_err_t httpd_resp_send_chunk(httpd_req_t *req, const char *buf, ssize_t buf_len)
+{
+    if (req->fail_chunks_after >= 0 && req->chunks >= req->fail_chunks_after)
+    {
+        return ESP_FAIL;
+    }
+    req->chunks++;
+    if (buf == nullptr)
+    {
+        req->is_finished = true;
+        return ESP_OK;
+    }
+    req->body.append(buf, buf_len == HTTPD_RESP_USE_STRLEN ? strlen(buf) : (size_t)buf_len);
+    return ESP_OK;
+}
+
+esp_err_t httpd_resp_send_err(httpd_req_t *req, httpd_err_code_t error, const char *message)
+{
+    static const char *const statuses[] = {"400 Bad Request", "404 Not Found", "414 URI Too Long", "500 Internal Server Error"};
+    req->status = statuses[error];
+    return httpd_resp_send(req, message, HTTPD_RESP_USE_STRLEN);
+}
+
+httpd_req_t stub_httpd_request(const char *uri, httpd_method_t method, const char *query, int fail_chunks_after)
+{
+    httpd_req_t req = {};
+    req.query = query;
+    req.fail_chunks_after = fail_chunks_after;
+    req.status = "200 OK";
+    for (const httpd_uri_t &handler : handlers)
+    {
+        if (strcmp(handler.uri, uri) == 0 && handler.method == method)
+        {
+            handler.handler(&req);
+            return req;
+        }
+    }
+    req.status = "404 Not Found";
+    return req;
+}
@@ -0,0 +1,73 @@
+#ifndef ESP_HTTP_SERVER_H_INCLUDED
+#define ESP_HTTP_SERVER_H_INCLUDED
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+#include <string>
+
+#include "esp_err.h"
+
+#define ESP_ERR_HTTPD_RESULT_TRUNC 0xb006
+#define HTTPD_RESP_USE_STRLEN -1
+
+typedef void *httpd_handle_t;
+
+typedef enum
+{
+    HTTP_GET,
+    HTTP_POST,
+} httpd_method_t;
+
+typedef enum
+{
+    HTTPD_400_BAD_REQUEST,
+    HTTPD_404_NOT_FOUND,
+    HTTPD_414_URI_TOO_LONG,
+    HTTPD_500_INTERNAL_SERVER_ERROR,
+} httpd_err_code_t;
+
+// One request and everything answered to it. A response is finished by
+// httpd_resp_send(), httpd_resp_send_err() or the empty chunk.
+typedef struct httpd_req
+{
+    const char *query; // nullptr for a URI without one
+    int fail_chunks_after; // chunks the client takes before it goes away, -1 for all
+    std::string status;
+    std::string type;
+    std::string body;
+    int chunks;
+    bool is_finished;
+} httpd_req_t;
+
+typedef struct
+{
+    const char *uri;
+    httpd_method_t method;
+    esp_err_t (*handler)(httpd_req_t *req);
+    void *user_ctx;
+} httpd_uri_t;
+
+typedef struct
+{
+    uint16_t server_port;
+} httpd_config_t;
+
+#define HTTPD_DEFAULT_CONFIG() {80}
+
+esp_err_t httpd_start(httpd_handle_t *handle, const httpd_config_t *config);
+esp_err_t httpd_register_uri_handler(httpd_handle_t handle, const httpd_uri_t *uri);
+size_t httpd_req_get_url_query_len(httpd_req_t *req);
+esp_err_t httpd_req_get_url_query_str(httpd_req_t *req, char *buf, size_t buf_len);
+esp_err_t httpd_query_key_value(const char *query, const char *key, char *val, size_t val_size);
+esp_err_t httpd_resp_set_status(httpd_req_t *req, const char *status);
+esp_err_t httpd_resp_set_type(httpd_req_t *req, const char *type);
+esp_err_t httpd_resp_set_hdr(httpd_req_t *req, const char *field, const char *value);
+esp_err_t httpd_resp_send(httpd_req_t *req, const char *buf, ssize_t buf_len);
+esp_err_t httpd_resp_send_chunk(httpd_req_t *req, const char *buf, ssize_t buf_len);
+esp_err_t httpd_resp_send_err(httpd_req_t *req, httpd_err_code_t error, const char *message);
+
+// A request to a registered handler, answered into the request.
+httpd_req_t stub_httpd_request(const char *uri, httpd_method_t method, const char *query, int fail_chunks_after = -1);
+
+#endif /* ESP_HTTP_SERVER_H_INCLUDED */
@@ -0,0 +1,58 @@
+#ifndef ESP_LOG_H_INCLUDED
+#define ESP_LOG_H_INCLUDED
+
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+
+// Lines are formatted as the SDK does and go through the vprintf hook, to
+// stderr unless a module under test takes it over.
+typedef int (*vprintf_like_t)(const char *format, va_list args);
+
+static inline int stub_log_stderr(const char *format, va_list args)
+{
+    return vfprintf(stderr, format, args);
+}
+
+inline vprintf_like_t &stub_log_vprintf(void)
+{
+    static vprintf_like_t vprintf_hook = stub_log_stderr;
+    return vprintf_hook;
+}
+
+// Milliseconds since boot as the lines show them, only moved by the tests.
+inline uint32_t &stub_log_ms(void)
+{
+    static uint32_t ms = 0;
+    return ms;
+}
+
+static inline uint32_t esp_log_timestamp(void)
+{
+    return stub_log_ms();
+}
+
+static inline vprintf_like_t esp_log_set_vprintf(vprintf_like_t func)
+{
+    vprintf_like_t previous = stub_log_vprintf();
+    stub_log_vprintf() = func;
+    return previous;
+}
+
+static inline void stub_log(const char *format, ...) __attribute__((format(printf, 1, 2)));
+static inline void stub_log(const char *format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    stub_log_vprintf()(format, args);
+    va_end(args);
+}
+
+#define ESP_LOG_STUB(level, tag, format, ...) stub_log(level " (%u) %s: " format "\n", (unsigned)esp_log_timestamp(), tag, ##__VA_ARGS__)
+
+#define ESP_LOGE(tag, format, ...) ESP_LOG_STUB("E", tag, format, ##__VA_ARGS__)
+#define ESP_LOGW(tag, format, ...) ESP_LOG_STUB("W", tag, format, ##__VA_ARGS__)
+#define ESP_LOGI(tag, format, ...) ESP_LOG_STUB("I", tag, format, ##__VA_ARGS__)
+#define ESP_LOGD(tag, format, ...) ((void)(tag))
+
+#endif /* ESP_LOG_H_INCLUDED */
@@ -0,0 +1,82 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "esp_partition.h"
+
+#define SECTOR_SIZE 4096
+
+static esp_partition_t partition;
+static uint8_t *data = nullptr;
+static int erases_to_fail = 0;
+
+esp_partition_t *stub_partition_create(const char *label, size_t size)
+{
+    free(data);
+    data = (uint8_t *)malloc(size);
+    memset(data, 0xFF, size);
+
+    partition = {};
+    partition.type = ESP_PARTITION_TYPE_DATA;
+    partition.size = size;
+    strncpy(partition.label, label, sizeof(partition.label) - 1);
+    return &partition;
+}
+
+uint8_t *stub_partition_data(void)
+{
+    return data;
+}
+
+void stub_partition_fail_erases(int count)
+{
+    erases_to_fail = count;
+}
+
+const esp_partition_t *esp_partition_find_first(esp_partition_type_t type, esp_partition_subtype_t subtype, const char *label)
+{
+    (void)subtype;
+    if (data == nullptr || type != partition.type || strcmp(label, partition.label) != 0)
+    {
+        return nullptr;
+    }
+    return &partition;
+}
+
+esp_err_t esp_partition_read(const esp_partition_t *p, size_t src_offset, void *dst, size_t size)
+{
+    if (src_offset + size > p->size)
+    {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    memcpy(dst, data + src_offset, size);
+    return ESP_OK;
+}
+
+esp_err_t esp_partition_write(const esp_partition_t *p, size_t dst_offset, const void *src, size_t size)
+{
+    if (dst_offset + size > p->size)
+    {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    for (size_t i = 0; i < size; i++)
+    {
+        data[dst_offset + i] &= ((const uint8_t *)src)[i];
+    }
+    return ESP_OK;
+}
+
+esp_err_t esp_partition_erase_range(const esp_partition_t *p, size_t start_addr, size_t size)
+{
+    if (start_addr % SECTOR_SIZE != 0 || size % SECTOR_SIZE != 0 || start_addr + size > p->size)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (erases_to_fail > 0)
+    {
+        erases_to_fail--;
+        memset(data + start_addr, 0xFF, size / 2);
+        return ESP_FAIL;
+    }
+    memset(data + start_addr, 0xFF, size);
+    return ESP_OK;
+}
@@ -0,0 +1,41 @@
+#ifndef ESP_PARTITION_H_INCLUDED
+#define ESP_PARTITION_H_INCLUDED
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+
+typedef enum
+{
+    ESP_PARTITION_TYPE_APP = 0x00,
+    ESP_PARTITION_TYPE_DATA = 0x01,
+} esp_partition_type_t;
+
+typedef enum
+{
+    ESP_PARTITION_SUBTYPE_ANY = 0xff,
+} esp_partition_subtype_t;
+
+typedef struct
+{
+    esp_partition_type_t type;
+    esp_partition_subtype_t subtype;
+    uint32_t address;
+    uint32_t size;
+    char label[17];
+} esp_partition_t;
+
+const esp_partition_t *esp_partition_find_first(esp_partition_type_t type, esp_partition_subtype_t subtype, const char *label);
+esp_err_t esp_partition_read(const esp_partition_t *partition, size_t src_offset, void *dst, size_t size);
+esp_err_t esp_partition_write(const esp_partition_t *partition, size_t dst_offset, const void *src, size_t size);
+esp_err_t esp_partition_erase_range(const esp_partition_t *partition, size_t start_addr, size_t size);
+
+// A single partition in RAM that behaves like NOR flash: erasing sets whole
+// 4 KB sectors to 0xFF and writing can only clear bits.
+esp_partition_t *stub_partition_create(const char *label, size_t size);
+uint8_t *stub_partition_data(void);
+// The next that many erases fail after clearing half of their range.
+void stub_partition_fail_erases(int count);
+
+#endif /* ESP_PARTITION_H_INCLUDED */
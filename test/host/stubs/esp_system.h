@@ -0,0 +1,76 @@
+#ifndef ESP_SYSTEM_H_INCLUDED
+#define ESP_SYSTEM_H_INCLUDED
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "esp_err.h"
+
+typedef enum
+{
+    ESP_MAC_WIFI_STA,
+    ESP_MAC_WIFI_SOFTAP,
+} esp_mac_type_t;
+
+// Every host unit has the same MAC, the one provision_vectors.py binds to.
+static inline esp_err_t esp_read_mac(uint8_t *mac, esp_mac_type_t type)
+{
+    (void)type;
+    static const uint8_t station[6] = {0xa4, 0xcf, 0x12, 0x34, 0x56, 0x78};
+    memcpy(mac, station, sizeof(station));
+    return ESP_OK;
+}
+
+typedef enum
+{
+    ESP_RST_UNKNOWN,
+    ESP_RST_POWERON,
+    ESP_RST_EXT,
+    ESP_RST_SW,
+    ESP_RST_PANIC,
+    ESP_RST_INT_WDT,
+    ESP_RST_TASK_WDT,
+    ESP_RST_WDT,
+    ESP_RST_DEEPSLEEP,
+    ESP_RST_BROWNOUT,
+    ESP_RST_SDIO,
+} esp_reset_reason_t;
+
+// Only there with the heap of esp_heap_caps.cpp linked in.
+uint32_t esp_get_free_heap_size(void);
+uint32_t esp_get_minimum_free_heap_size(void);
+
+// The reason of the boot under test, set by the test.
+inline esp_reset_reason_t &stub_reset_reason(void)
+{
+    static esp_reset_reason_t reason = ESP_RST_POWERON;
+    return reason;
+}
+
+static inline esp_reset_reason_t esp_reset_reason(void)
+{
+    return stub_reset_reason();
+}
+
+// A test that expects a restart takes it over, esp_restart() returns to the
+// caller then. Otherwise the test ends there.
+typedef void (*stub_restart_fn)(void);
+
+inline stub_restart_fn &stub_restart(void)
+{
+    static stub_restart_fn hook = nullptr;
+    return hook;
+}
+
+static inline void esp_restart(void)
+{
+    if (stub_restart() != nullptr)
+    {
+        stub_restart()();
+        return;
+    }
+    exit(0);
+}
+
+#endif /* ESP_SYSTEM_H_INCLUDED */
@@ -0,0 +1,105 @@
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+#include "esp_timer.h"
+
+struct esp_timer
+{
+    esp_timer_cb_t callback;
+    void *arg;
+    bool is_armed;
+    int64_t deadline;
+};
+
+// atomic, machines on other threads read it while a test moves it
+static std::atomic<int64_t> now_us(0);
+
+// never destroyed, like the timers in the firmware
+static std::mutex &timers_mutex = *new std::mutex;
+static std::vector<esp_timer *> &timers = *new std::vector<esp_timer *>;
+
+int64_t esp_timer_get_time(void)
+{
+    return now_us;
+}
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t *args, esp_timer_handle_t *out)
+{
+    esp_timer *timer = new esp_timer{args->callback, args->arg, false, 0};
+
+    std::lock_guard<std::mutex> lock(timers_mutex);
+    timers.push_back(timer);
+    *out = timer;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout_us)
+{
+    std::lock_guard<std::mutex> lock(timers_mutex);
+    if (timer->is_armed)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+    timer->is_armed = true;
+    timer->deadline = now_us + (int64_t)timeout_us;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t timer)
+{
+    std::lock_guard<std::mutex> lock(timers_mutex);
+    if (!timer->is_armed)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+    timer->is_armed = false;
+    return ESP_OK;
+}
+
+bool stub_timer_armed(esp_timer_handle_t timer, int64_t *remaining)
+{
+    std::lock_guard<std::mutex> lock(timers_mutex);
+    if (remaining != nullptr)
+    {
+        *remaining = timer->is_armed ? timer->deadline - now_us : 0;
+    }
+    return timer->is_armed;
+}
+
+void stub_timer_set(int64_t now)
+{
+    now_us = now;
+}
+
+void stub_timer_advance(int64_t delta)
+{
+    int64_t until = now_us + delta;
+
+    for (;;)
+    {
+        esp_timer *next = nullptr;
+        {
+            std::lock_guard<std::mutex> lock(timers_mutex);
+            for (esp_timer *timer : timers)
+            {
+                if (timer->is_armed && timer->deadline <= until && (next == nullptr || timer->deadline < next->deadline))
+                {
+                    next = timer;
+                }
+            }
+            if (next == nullptr)
+            {
+                break;
+            }
+            next->is_armed = false;
+            if (next->deadline > now_us)
+            {
+                now_us = next->deadline;
+            }
+        }
+        // unlocked, the callback may start the timer again
+        next->callback(next->arg);
+    }
+    now_us = until;
+}
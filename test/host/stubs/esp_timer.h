@@ -0,0 +1,34 @@
+#ifndef ESP_TIMER_H_INCLUDED
+#define ESP_TIMER_H_INCLUDED
+
+#include <stdint.h>
+
+#include "esp_err.h"
+
+typedef void (*esp_timer_cb_t)(void *arg);
+
+typedef struct esp_timer *esp_timer_handle_t;
+
+typedef struct
+{
+    esp_timer_cb_t callback;
+    void *arg;
+    const char *name;
+} esp_timer_create_args_t;
+
+int64_t esp_timer_get_time(void);
+
+// One shot timers run their callback from stub_timer_advance(), at their
+// deadline and in deadline order, on the thread moving the time.
+esp_err_t esp_timer_create(const esp_timer_create_args_t *args, esp_timer_handle_t *out);
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout_us);
+esp_err_t esp_timer_stop(esp_timer_handle_t timer);
+
+// Microseconds since boot only move when a test moves them.
+void stub_timer_set(int64_t now);
+void stub_timer_advance(int64_t delta);
+
+// Whether the timer is armed, and how long until it fires.
+bool stub_timer_armed(esp_timer_handle_t timer, int64_t *remaining = nullptr);
+
+#endif /* ESP_TIMER_H_INCLUDED */
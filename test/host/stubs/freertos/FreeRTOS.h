@@ -0,0 +1,34 @@
+#ifndef FREERTOS_H_INCLUDED
+#define FREERTOS_H_INCLUDED
+
+#include <stdint.h>
+#include <mutex>
+
+// Tasks run on threads of their own, see task.cpp, and critical sections
+// all take the one lock. Mutexes are no-ops, no test shares them.
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+
+#define pdTRUE 1
+#define pdFALSE 0
+#define portMAX_DELAY ((TickType_t)0xFFFFFFFF)
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+#define portTICK_PERIOD_MS 1
+
+#define IRAM_ATTR
+
+inline std::recursive_mutex &stub_critical(void)
+{
+    static std::recursive_mutex mutex;
+    return mutex;
+}
+
+#define portENTER_CRITICAL() stub_critical().lock()
+#define portEXIT_CRITICAL() stub_critical().unlock()
+
+static inline BaseType_t xPortInIsrContext(void)
+{
+    return pdFALSE;
+}
+
+#endif /* FREERTOS_H_INCLUDED */
@@ -0,0 +1,106 @@
+#include <string.h>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <vector>
+
+#include "freertos/queue.h"
+
+struct stub_queue
+{
+    size_t length;
+    size_t item_size;
+    std::deque<std::vector<uint8_t>> items;
+    int receivers; // tasks waiting in xQueueReceive
+};
+
+// One lock for all of them, the idle wait looks at every queue. Never
+// destroyed, a task may still wait on them while the test exits.
+static std::mutex &queues_mutex = *new std::mutex();
+static std::condition_variable &queues_changed = *new std::condition_variable();
+static std::vector<stub_queue *> &queues = *new std::vector<stub_queue *>();
+
+// Never freed, as the tasks that use them never end.
+QueueHandle_t xQueueCreate(uint32_t length, uint32_t item_size)
+{
+    std::lock_guard<std::mutex> lock(queues_mutex);
+    stub_queue *queue = new stub_queue();
+    queue->length = length;
+    queue->item_size = item_size;
+    queue->receivers = 0;
+    queues.push_back(queue);
+    return queue;
+}
+
+BaseType_t xQueueSend(QueueHandle_t queue, const void *item, TickType_t ticks)
+{
+    std::unique_lock<std::mutex> lock(queues_mutex);
+    auto has_room = [queue] { return queue->items.size() < queue->length; };
+    if (ticks == portMAX_DELAY)
+    {
+        queues_changed.wait(lock, has_room);
+    }
+    else if (!queues_changed.wait_for(lock, std::chrono::milliseconds(ticks), has_room))
+    {
+        return pdFALSE;
+    }
+
+    const uint8_t *bytes = (const uint8_t *)item;
+    queue->items.emplace_back(bytes, bytes + queue->item_size);
+    queues_changed.notify_all();
+    return pdTRUE;
+}
+
+// Only for queues of length 1, as in FreeRTOS.
+BaseType_t xQueueOverwrite(QueueHandle_t queue, const void *item)
+{
+    std::lock_guard<std::mutex> lock(queues_mutex);
+    const uint8_t *bytes = (const uint8_t *)item;
+    queue->items.clear();
+    queue->items.emplace_back(bytes, bytes + queue->item_size);
+    queues_changed.notify_all();
+    return pdTRUE;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t queue, void *item, TickType_t ticks)
+{
+    std::unique_lock<std::mutex> lock(queues_mutex);
+    auto has_item = [queue] { return !queue->items.empty(); };
+
+    queue->receivers++;
+    queues_changed.notify_all();
+    bool is_received = true;
+    if (ticks == portMAX_DELAY)
+    {
+        queues_changed.wait(lock, has_item);
+    }
+    else
+    {
+        is_received = queues_changed.wait_for(lock, std::chrono::milliseconds(ticks), has_item);
+    }
+    queue->receivers--;
+
+    if (!is_received)
+    {
+        return pdFALSE;
+    }
+    memcpy(item, queue->items.front().data(), queue->item_size);
+    queue->items.pop_front();
+    queues_changed.notify_all();
+    return pdTRUE;
+}
+
+void stub_queue_wait_idle(void)
+{
+    std::unique_lock<std::mutex> lock(queues_mutex);
+    queues_changed.wait(lock, [] {
+        for (stub_queue *queue : queues)
+        {
+            if (!queue->items.empty() || queue->receivers == 0)
+            {
+                return false;
+            }
+        }
+        return true;
+    });
+}
@@ -0,0 +1,21 @@
+#ifndef QUEUE_H_INCLUDED
+#define QUEUE_H_INCLUDED
+
+#include <stddef.h>
+
+#include "freertos/FreeRTOS.h"
+
+// Queues of copied items as FreeRTOS keeps them, waits are milliseconds of
+// real time like the task ticks.
+typedef struct stub_queue *QueueHandle_t;
+
+QueueHandle_t xQueueCreate(uint32_t length, uint32_t item_size);
+BaseType_t xQueueSend(QueueHandle_t queue, const void *item, TickType_t ticks);
+BaseType_t xQueueOverwrite(QueueHandle_t queue, const void *item);
+BaseType_t xQueueReceive(QueueHandle_t queue, void *item, TickType_t ticks);
+
+// Until every queue is empty with a task waiting on it, so a test knows the
+// task has dealt with all it was sent.
+void stub_queue_wait_idle(void);
+
+#endif /* QUEUE_H_INCLUDED */
@@ -0,0 +1,116 @@
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <thread>
+
+#include "freertos/task.h"
+
+struct stub_task
+{
+    std::mutex mutex;
+    std::condition_variable notified;
+    std::condition_variable idle;
+    uint32_t notifications;
+    bool is_waiting;
+    TickType_t waiting_ticks;
+    uint32_t wakeups;
+};
+
+static thread_local stub_task *current = nullptr;
+static std::atomic<stub_task *> last_created(nullptr);
+
+// Never freed, a thread may still wait on it while the test exits.
+BaseType_t xTaskCreate(TaskFunction_t task, const char *name, uint32_t stack, void *arg, int priority, TaskHandle_t *handle)
+{
+    (void)name;
+    (void)stack;
+    (void)priority;
+
+    stub_task *created = new stub_task();
+    created->notifications = 0;
+    created->is_waiting = false;
+    created->wakeups = 0;
+    if (handle != nullptr)
+    {
+        *handle = created;
+    }
+    last_created = created;
+
+    std::thread([task, arg, created]() {
+        current = created;
+        task(arg);
+    }).detach();
+    return pdPASS;
+}
+
+TaskHandle_t stub_task_last_created(void)
+{
+    return last_created;
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void)
+{
+    return current;
+}
+
+// The task function returns right after, which ends the thread.
+void vTaskDelete(TaskHandle_t task)
+{
+    (void)task;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clear, TickType_t ticks)
+{
+    std::unique_lock<std::mutex> lock(current->mutex);
+    current->is_waiting = true;
+    current->waiting_ticks = ticks;
+    current->idle.notify_all();
+    if (ticks == portMAX_DELAY)
+    {
+        current->notified.wait(lock, [] { return current->notifications > 0; });
+    }
+    else
+    {
+        current->notified.wait_for(lock, std::chrono::milliseconds(ticks), [] { return current->notifications > 0; });
+    }
+
+    current->is_waiting = false;
+    current->wakeups++;
+
+    uint32_t count = current->notifications;
+    if (count > 0)
+    {
+        current->notifications = clear ? 0 : count - 1;
+    }
+    return count;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task)
+{
+    std::lock_guard<std::mutex> lock(task->mutex);
+    task->notifications++;
+    task->notified.notify_one();
+    return pdPASS;
+}
+
+void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t *woken)
+{
+    xTaskNotifyGive(task);
+    if (woken != nullptr)
+    {
+        *woken = pdTRUE;
+    }
+}
+
+TickType_t stub_task_wait_idle(TaskHandle_t task)
+{
+    std::unique_lock<std::mutex> lock(task->mutex);
+    task->idle.wait(lock, [task] { return task->is_waiting && task->notifications == 0; });
+    return task->waiting_ticks;
+}
+
+uint32_t stub_task_wakeups(TaskHandle_t task)
+{
+    std::lock_guard<std::mutex> lock(task->mutex);
+    return task->wakeups;
+}
@@ -0,0 +1,46 @@
+#ifndef TASK_H_INCLUDED
+#define TASK_H_INCLUDED
+
+#include "freertos/FreeRTOS.h"
+
+typedef struct stub_task *TaskHandle_t;
+typedef void (*TaskFunction_t)(void *);
+
+#define pdPASS pdTRUE
+
+// Every task gets a detached thread that lives until the test exits, ticks
+// are milliseconds of real time.
+BaseType_t xTaskCreate(TaskFunction_t task, const char *name, uint32_t stack, void *arg, int priority, TaskHandle_t *handle);
+TaskHandle_t xTaskGetCurrentTaskHandle(void);
+void vTaskDelete(TaskHandle_t task);
+uint32_t ulTaskNotifyTake(BaseType_t clear, TickType_t ticks);
+BaseType_t xTaskNotifyGive(TaskHandle_t task);
+void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t *woken);
+
+// The task created last, for tasks a module keeps to itself.
+TaskHandle_t stub_task_last_created(void);
+
+// Waits until the task blocks in ulTaskNotifyTake() with nothing left to
+// take, returns the ticks it blocks for. Counts how often it came back.
+TickType_t stub_task_wait_idle(TaskHandle_t task);
+uint32_t stub_task_wakeups(TaskHandle_t task);
+
+// No other task runs until the scheduler is resumed, critical sections
+// give just that.
+static inline void vTaskSuspendAll(void)
+{
+    portENTER_CRITICAL();
+}
+
+static inline BaseType_t xTaskResumeAll(void)
+{
+    portEXIT_CRITICAL();
+    return pdFALSE;
+}
+
+static inline void vTaskDelay(TickType_t ticks)
+{
+    (void)ticks;
+}
+
+#endif /* TASK_H_INCLUDED */
@@ -0,0 +1,136 @@
+#ifndef GPIO_H_INCLUDED
+#define GPIO_H_INCLUDED
+
+#include <stdint.h>
+
+#include "esp_err.h"
+
+// Pins that are never driven, every input reads high: nobody holds a button.
+// A test stands in for what is wired to them through stub_gpio(): the level
+// hooks see every write and answer every read, and stub_gpio_interrupt()
+// calls the handler added for a pin as its edge would.
+#define IRAM_ATTR
+#define STUB_GPIO_PINS 17
+
+typedef enum
+{
+    GPIO_NUM_0 = 0,
+    GPIO_NUM_2 = 2,
+    GPIO_NUM_4 = 4,
+    GPIO_NUM_5 = 5,
+    GPIO_NUM_12 = 12,
+    GPIO_NUM_13 = 13,
+    GPIO_NUM_14 = 14,
+} gpio_num_t;
+
+typedef enum
+{
+    GPIO_INTR_DISABLE,
+    GPIO_INTR_POSEDGE,
+    GPIO_INTR_NEGEDGE,
+    GPIO_INTR_ANYEDGE,
+} gpio_int_type_t;
+
+typedef enum
+{
+    GPIO_MODE_DISABLE,
+    GPIO_MODE_INPUT,
+    GPIO_MODE_OUTPUT,
+} gpio_mode_t;
+
+typedef enum
+{
+    GPIO_PULLUP_DISABLE,
+    GPIO_PULLUP_ENABLE,
+} gpio_pullup_t;
+
+typedef enum
+{
+    GPIO_PULLDOWN_DISABLE,
+    GPIO_PULLDOWN_ENABLE,
+} gpio_pulldown_t;
+
+typedef struct
+{
+    uint32_t pin_bit_mask;
+    gpio_mode_t mode;
+    gpio_pullup_t pull_up_en;
+    gpio_pulldown_t pull_down_en;
+    gpio_int_type_t intr_type;
+} gpio_config_t;
+
+typedef void (*gpio_isr_t)(void *arg);
+
+struct stub_gpio_state
+{
+    void (*set_level)(gpio_num_t pin, uint32_t level);
+    int (*get_level)(gpio_num_t pin);
+    gpio_isr_t handlers[STUB_GPIO_PINS];
+    void *args[STUB_GPIO_PINS];
+};
+
+inline stub_gpio_state &stub_gpio(void)
+{
+    static stub_gpio_state state = {};
+    return state;
+}
+
+static inline void stub_gpio_interrupt(gpio_num_t pin)
+{
+    if (stub_gpio().handlers[pin] != nullptr)
+    {
+        stub_gpio().handlers[pin](stub_gpio().args[pin]);
+    }
+}
+
+static inline esp_err_t gpio_config(const gpio_config_t *config)
+{
+    (void)config;
+    return ESP_OK;
+}
+
+static inline int gpio_get_level(gpio_num_t pin)
+{
+    return stub_gpio().get_level != nullptr ? stub_gpio().get_level(pin) : 1;
+}
+
+static inline esp_err_t gpio_set_level(gpio_num_t pin, uint32_t level)
+{
+    if (stub_gpio().set_level != nullptr)
+    {
+        stub_gpio().set_level(pin, level);
+    }
+    return ESP_OK;
+}
+
+static inline esp_err_t gpio_set_intr_type(gpio_num_t pin, gpio_int_type_t type)
+{
+    (void)pin;
+    (void)type;
+    return ESP_OK;
+}
+
+static inline esp_err_t gpio_install_isr_service(int flags)
+{
+    (void)flags;
+    return ESP_OK;
+}
+
+static inline void gpio_uninstall_isr_service(void)
+{
+}
+
+static inline esp_err_t gpio_isr_handler_add(gpio_num_t pin, gpio_isr_t handler, void *arg)
+{
+    stub_gpio().handlers[pin] = handler;
+    stub_gpio().args[pin] = arg;
+    return ESP_OK;
+}
+
+static inline esp_err_t gpio_isr_handler_remove(gpio_num_t pin)
+{
+    stub_gpio().handlers[pin] = nullptr;
+    return ESP_OK;
+}
+
+#endif /* GPIO_H_INCLUDED */
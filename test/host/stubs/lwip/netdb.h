@@ -0,0 +1,6 @@
+#ifndef LWIP_NETDB_H_INCLUDED
+#define LWIP_NETDB_H_INCLUDED
+
+#include <netdb.h>
+
+#endif /* LWIP_NETDB_H_INCLUDED */
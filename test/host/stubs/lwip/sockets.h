@@ -0,0 +1,11 @@
+#ifndef LWIP_SOCKETS_H_INCLUDED
+#define LWIP_SOCKETS_H_INCLUDED
+
+// The host's own sockets, lwIP keeps to the same calls.
+#include <errno.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+#endif /* LWIP_SOCKETS_H_INCLUDED */
@@ -0,0 +1,154 @@
+// The few mbedtls calls provision.cpp and hint.cpp make, done with OpenSSL
+// so the host tests check real signatures.
+#define OPENSSL_SUPPRESS_DEPRECATED
+
+#include <string.h>
+
+#include <openssl/bn.h>
+#include <openssl/ec.h>
+#include <openssl/ecdsa.h>
+#include <openssl/evp.h>
+#include <openssl/hmac.h>
+#include <openssl/obj_mac.h>
+#include <openssl/sha.h>
+
+#include "mbedtls/ecdsa.h"
+#include "mbedtls/md.h"
+#include "mbedtls/sha256.h"
+
+int mbedtls_sha256_ret(const unsigned char *input, size_t ilen, unsigned char output[32], int is224)
+{
+    if (is224)
+    {
+        return MBEDTLS_ERR_ECP_BAD_INPUT_DATA;
+    }
+    SHA256(input, ilen, output);
+    return 0;
+}
+
+void mbedtls_mpi_init(mbedtls_mpi *X)
+{
+    memset(X, 0, sizeof(*X));
+}
+
+void mbedtls_mpi_free(mbedtls_mpi *X)
+{
+    memset(X, 0, sizeof(*X));
+}
+
+int mbedtls_mpi_read_binary(mbedtls_mpi *X, const unsigned char *buf, size_t buflen)
+{
+    if (buflen > sizeof(X->data))
+    {
+        return MBEDTLS_ERR_ECP_BAD_INPUT_DATA;
+    }
+    memcpy(X->data, buf, buflen);
+    X->len = buflen;
+    return 0;
+}
+
+void mbedtls_ecp_group_init(mbedtls_ecp_group *grp)
+{
+    grp->id = MBEDTLS_ECP_DP_NONE;
+}
+
+void mbedtls_ecp_group_free(mbedtls_ecp_group *grp)
+{
+    grp->id = MBEDTLS_ECP_DP_NONE;
+}
+
+int mbedtls_ecp_group_load(mbedtls_ecp_group *grp, mbedtls_ecp_group_id id)
+{
+    if (id != MBEDTLS_ECP_DP_SECP256R1)
+    {
+        return MBEDTLS_ERR_ECP_BAD_INPUT_DATA;
+    }
+    grp->id = id;
+    return 0;
+}
+
+void mbedtls_ecp_point_init(mbedtls_ecp_point *pt)
+{
+    memset(pt, 0, sizeof(*pt));
+}
+
+void mbedtls_ecp_point_free(mbedtls_ecp_point *pt)
+{
+    memset(pt, 0, sizeof(*pt));
+}
+
+int mbedtls_ecp_point_read_binary(const mbedtls_ecp_group *grp, mbedtls_ecp_point *P, const unsigned char *buf, size_t ilen)
+{
+    if (grp->id != MBEDTLS_ECP_DP_SECP256R1 || ilen != sizeof(P->data) || buf[0] != 0x04)
+    {
+        return MBEDTLS_ERR_ECP_BAD_INPUT_DATA;
+    }
+    memcpy(P->data, buf, ilen);
+    P->len = ilen;
+    return 0;
+}
+
+static EC_KEY *stub_key(const mbedtls_ecp_point *pt)
+{
+    EC_KEY *key = EC_KEY_new_by_curve_name(NID_X9_62_prime256v1);
+    EC_POINT *point = EC_POINT_new(EC_KEY_get0_group(key));
+    bool is_valid = EC_POINT_oct2point(EC_KEY_get0_group(key), point, pt->data, pt->len, nullptr) == 1 &&
+                    EC_KEY_set_public_key(key, point) == 1 && EC_KEY_check_key(key) == 1;
+    EC_POINT_free(point);
+    if (!is_valid)
+    {
+        EC_KEY_free(key);
+        return nullptr;
+    }
+    return key;
+}
+
+int mbedtls_ecp_check_pubkey(const mbedtls_ecp_group *grp, const mbedtls_ecp_point *pt)
+{
+    EC_KEY *key = grp->id == MBEDTLS_ECP_DP_SECP256R1 ? stub_key(pt) : nullptr;
+    if (key == nullptr)
+    {
+        return MBEDTLS_ERR_ECP_INVALID_KEY;
+    }
+    EC_KEY_free(key);
+    return 0;
+}
+
+int mbedtls_ecdsa_verify(mbedtls_ecp_group *grp, const unsigned char *buf, size_t blen, const mbedtls_ecp_point *Q, const mbedtls_mpi *r,
+                         const mbedtls_mpi *s)
+{
+    EC_KEY *key = grp->id == MBEDTLS_ECP_DP_SECP256R1 ? stub_key(Q) : nullptr;
+    if (key == nullptr)
+    {
+        return MBEDTLS_ERR_ECP_BAD_INPUT_DATA;
+    }
+
+#ifdef FUZZING_BUILD_MODE_UNSAFE_FOR_PRODUCTION
+    // the fuzzer cannot sign, let it past to the fields
+    EC_KEY_free(key);
+    return 0;
+#endif
+
+    ECDSA_SIG *signature = ECDSA_SIG_new();
+    ECDSA_SIG_set0(signature, BN_bin2bn(r->data, r->len, nullptr), BN_bin2bn(s->data, s->len, nullptr));
+    int verified = ECDSA_do_verify(buf, blen, signature, key);
+    ECDSA_SIG_free(signature);
+    EC_KEY_free(key);
+    return verified == 1 ? 0 : MBEDTLS_ERR_ECP_VERIFY_FAILED;
+}
+
+const mbedtls_md_info_t *mbedtls_md_info_from_type(mbedtls_md_type_t md_type)
+{
+    static const mbedtls_md_info_t sha256 = {MBEDTLS_MD_SHA256};
+    return md_type == MBEDTLS_MD_SHA256 ? &sha256 : nullptr;
+}
+
+int mbedtls_md_hmac(const mbedtls_md_info_t *md_info, const unsigned char *key, size_t keylen, const unsigned char *input, size_t ilen,
+                    unsigned char *output)
+{
+    if (md_info == nullptr || md_info->type != MBEDTLS_MD_SHA256)
+    {
+        return MBEDTLS_ERR_MD_BAD_INPUT_DATA;
+    }
+    return HMAC(EVP_sha256(), key, keylen, input, ilen, output, nullptr) != nullptr ? 0 : MBEDTLS_ERR_MD_BAD_INPUT_DATA;
+}
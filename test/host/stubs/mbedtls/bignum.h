@@ -0,0 +1,17 @@
+#ifndef MBEDTLS_BIGNUM_H
+#define MBEDTLS_BIGNUM_H
+
+#include <stddef.h>
+
+// Big endian bytes as read, the arithmetic is left to OpenSSL.
+typedef struct
+{
+    unsigned char data[66];
+    size_t len;
+} mbedtls_mpi;
+
+void mbedtls_mpi_init(mbedtls_mpi *X);
+void mbedtls_mpi_free(mbedtls_mpi *X);
+int mbedtls_mpi_read_binary(mbedtls_mpi *X, const unsigned char *buf, size_t buflen);
+
+#endif /* MBEDTLS_BIGNUM_H */
@@ -0,0 +1,11 @@
+#ifndef MBEDTLS_ECDSA_H
+#define MBEDTLS_ECDSA_H
+
+#include "mbedtls/ecp.h"
+
+#define MBEDTLS_ERR_ECP_VERIFY_FAILED -0x4E00
+
+int mbedtls_ecdsa_verify(mbedtls_ecp_group *grp, const unsigned char *buf, size_t blen, const mbedtls_ecp_point *Q, const mbedtls_mpi *r,
+                         const mbedtls_mpi *s);
+
+#endif /* MBEDTLS_ECDSA_H */
@@ -0,0 +1,37 @@
+#ifndef MBEDTLS_ECP_H
+#define MBEDTLS_ECP_H
+
+#include <stddef.h>
+
+#include "mbedtls/bignum.h"
+
+#define MBEDTLS_ERR_ECP_BAD_INPUT_DATA -0x4F80
+#define MBEDTLS_ERR_ECP_INVALID_KEY -0x4C80
+
+typedef enum
+{
+    MBEDTLS_ECP_DP_NONE = 0,
+    MBEDTLS_ECP_DP_SECP256R1 = 3,
+} mbedtls_ecp_group_id;
+
+typedef struct
+{
+    mbedtls_ecp_group_id id;
+} mbedtls_ecp_group;
+
+// Uncompressed point as read.
+typedef struct
+{
+    unsigned char data[65];
+    size_t len;
+} mbedtls_ecp_point;
+
+void mbedtls_ecp_group_init(mbedtls_ecp_group *grp);
+void mbedtls_ecp_group_free(mbedtls_ecp_group *grp);
+int mbedtls_ecp_group_load(mbedtls_ecp_group *grp, mbedtls_ecp_group_id id);
+void mbedtls_ecp_point_init(mbedtls_ecp_point *pt);
+void mbedtls_ecp_point_free(mbedtls_ecp_point *pt);
+int mbedtls_ecp_point_read_binary(const mbedtls_ecp_group *grp, mbedtls_ecp_point *P, const unsigned char *buf, size_t ilen);
+int mbedtls_ecp_check_pubkey(const mbedtls_ecp_group *grp, const mbedtls_ecp_point *pt);
+
+#endif /* MBEDTLS_ECP_H */
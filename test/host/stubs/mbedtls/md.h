@@ -0,0 +1,25 @@
+#ifndef MBEDTLS_MD_H
+#define MBEDTLS_MD_H
+
+#include <stddef.h>
+
+// Only SHA-256 HMAC, as hint.cpp uses it.
+typedef enum
+{
+    MBEDTLS_MD_NONE = 0,
+    MBEDTLS_MD_SHA256 = 6,
+} mbedtls_md_type_t;
+
+struct mbedtls_md_info_t
+{
+    mbedtls_md_type_t type;
+};
+
+#define MBEDTLS_ERR_MD_BAD_INPUT_DATA -0x5100
+
+const mbedtls_md_info_t *mbedtls_md_info_from_type(mbedtls_md_type_t md_type);
+
+int mbedtls_md_hmac(const mbedtls_md_info_t *md_info, const unsigned char *key, size_t keylen, const unsigned char *input, size_t ilen,
+                    unsigned char *output);
+
+#endif /* MBEDTLS_MD_H */
@@ -0,0 +1,79 @@
+#include <string.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "nvs.h"
+
+static std::vector<std::string> namespaces;
+static std::map<std::string, std::vector<uint8_t>> blobs;
+
+void stub_nvs_erase_all(void)
+{
+    blobs.clear();
+}
+
+esp_err_t nvs_open(const char *name, nvs_open_mode open_mode, nvs_handle *out_handle)
+{
+    (void)open_mode;
+    namespaces.push_back(name);
+    *out_handle = namespaces.size() - 1;
+    return ESP_OK;
+}
+
+esp_err_t nvs_get_blob(nvs_handle handle, const char *key, void *out_value, size_t *length)
+{
+    auto found = blobs.find(namespaces[handle] + "/" + key);
+    if (found == blobs.end())
+    {
+        return ESP_ERR_NVS_NOT_FOUND;
+    }
+    if (out_value == nullptr)
+    {
+        *length = found->second.size();
+        return ESP_OK;
+    }
+    if (*length < found->second.size())
+    {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    *length = found->second.size();
+    memcpy(out_value, found->second.data(), *length);
+    return ESP_OK;
+}
+
+esp_err_t nvs_set_blob(nvs_handle handle, const char *key, const void *value, size_t length)
+{
+    const uint8_t *bytes = (const uint8_t *)value;
+    blobs[namespaces[handle] + "/" + key] = std::vector<uint8_t>(bytes, bytes + length);
+    return ESP_OK;
+}
+
+// Integers are kept as blobs of their bytes, only read back as the same type.
+esp_err_t nvs_get_u32(nvs_handle handle, const char *key, uint32_t *out_value)
+{
+    size_t length = sizeof(*out_value);
+    return nvs_get_blob(handle, key, out_value, &length);
+}
+
+esp_err_t nvs_set_u32(nvs_handle handle, const char *key, uint32_t value)
+{
+    return nvs_set_blob(handle, key, &value, sizeof(value));
+}
+
+esp_err_t nvs_erase_key(nvs_handle handle, const char *key)
+{
+    return blobs.erase(namespaces[handle] + "/" + key) != 0 ? ESP_OK : ESP_ERR_NVS_NOT_FOUND;
+}
+
+esp_err_t nvs_commit(nvs_handle handle)
+{
+    (void)handle;
+    return ESP_OK;
+}
+
+void nvs_close(nvs_handle handle)
+{
+    (void)handle;
+}
@@ -0,0 +1,45 @@
+// Only the settings the modules under test read, console commands left out.
+#define CONFIG_POMODORO_HISTORY_ENABLE 1
+#define CONFIG_POMODORO_TIMEZONE "UTC"
+#define CONFIG_POMODORO_CALENDAR_ENABLE 1
+#define CONFIG_POMODORO_CALENDAR_URL ""
+#define CONFIG_POMODORO_CALENDAR_FETCH_MINUTES 30
+#define CONFIG_POMODORO_CALENDAR_EVENTS 32
+// The public key of the test key in provision_vectors.py.
+#define CONFIG_POMODORO_PROVISION_PUBLIC_KEY                                     \
+    "04691c036b5707f3b2725dac5659834cc28966f9291c03296f268c95e52742ec3fa07d4365" \
+    "065257cf1d5b711c4a6900f75f4b1eb9215f515eb15bbced31d8af6b"
+#define CONFIG_POMODORO_TIME_SCALE 1
+#define CONFIG_POMODORO_JOURNAL_RECORDS 32
+// the pause policy unless a target picks the other one
+#ifndef CONFIG_POMODORO_BUSY_KEEPS_RUNNING
+#define CONFIG_POMODORO_BUSY_PAUSES 1
+#endif
+#define CONFIG_POMODORO_HTTP_PORT 80
+// syslog to a listener the test binds to any free port
+extern int stub_syslog_port;
+#define CONFIG_POMODORO_SYSLOG_HOST "127.0.0.1"
+#define CONFIG_POMODORO_SYSLOG_PORT stub_syslog_port
+#define CONFIG_POMODORO_SYSLOG_HOSTNAME "pomodoro"
+#define CONFIG_POMODORO_SYSLOG_BUFFER 16
+#define CONFIG_POMODORO_SYSLOG_TAG_RATE 7
+#define CONFIG_POMODORO_SYSLOG_FLUSH_SECONDS 1
+#define CONFIG_POMODORO_ENV_ENABLE 1
+#define CONFIG_POMODORO_ENV_SAMPLE_SECONDS 300
+#define CONFIG_POMODORO_ENV_VENTILATE_PPM 1200
+#define CONFIG_POMODORO_SELFTEST_PRESSES 5
+#define CONFIG_POMODORO_HINT_PORT 4810
+#define CONFIG_POMODORO_HINT_KEY "fuzz"
+#define CONFIG_POMODORO_EPAPER_CLK_GPIO 15
+#define CONFIG_POMODORO_EPAPER_MOSI_GPIO 0
+#define CONFIG_POMODORO_EPAPER_DC_GPIO 16
+#define CONFIG_POMODORO_EPAPER_RST_GPIO 4
+#define CONFIG_POMODORO_EPAPER_BUSY_GPIO 5
+#define CONFIG_POMODORO_ENCODER_A_GPIO 4
+#define CONFIG_POMODORO_ENCODER_B_GPIO 5
+#define CONFIG_POMODORO_EXPANDER_ADDRESS 0x20
+#define CONFIG_POMODORO_EXPANDER_INT_GPIO 12
+#define CONFIG_POMODORO_HEAP_TRACK_SAMPLE_SECONDS 60
+#define CONFIG_POMODORO_HEAP_TRACK_LOW_BYTES 8192
+#define CONFIG_POMODORO_HEAP_TRACK_LOW_BLOCK_BYTES 4096
+#define CONFIG_POMODORO_LIVENESS_TIMEOUT_SECONDS 30
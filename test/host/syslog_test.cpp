@@ -0,0 +1,173 @@
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <sys/time.h>
+
+#include "sdkconfig.h"
+#include "esp_log.h"
+#include "lwip/sockets.h"
+
+#include "syslog.hpp"
+#include "check.hpp"
+
+// The forwarder on its own task, sending to a UDP listener on the loopback.
+
+int stub_syslog_port = 0;
+
+static int listener = -1;
+
+static int listen_any_port(void)
+{
+    int sock = socket(AF_INET, SOCK_DGRAM, 0);
+    struct sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (sock < 0 || bind(sock, (struct sockaddr *)&addr, sizeof(addr)) != 0)
+    {
+        return -1;
+    }
+
+    socklen_t len = sizeof(addr);
+    getsockname(sock, (struct sockaddr *)&addr, &len);
+    stub_syslog_port = ntohs(addr.sin_port);
+
+    struct timeval timeout = {};
+    timeout.tv_sec = 3;
+    setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    return sock;
+}
+
+// The next datagram, empty when none came within the timeout.
+static std::string receive(void)
+{
+    char packet[512];
+    ssize_t len = recv(listener, packet, sizeof(packet), 0);
+    return len > 0 ? std::string(packet, len) : std::string();
+}
+
+// "<PRI>1 TIMESTAMP" then the fields that do not change.
+static bool is_line(const std::string &packet, int priority, const char *rest)
+{
+    char head[8];
+    snprintf(head, sizeof(head), "<%d>1 ", priority);
+    size_t timestamp_end = packet.find(' ', strlen(head));
+    if (packet.compare(0, strlen(head), head) != 0 || timestamp_end == std::string::npos)
+    {
+        fprintf(stderr, "unexpected packet: %s\n", packet.c_str());
+        return false;
+    }
+
+    // 2024-03-04T05:06:07.089Z
+    std::string timestamp = packet.substr(strlen(head), timestamp_end - strlen(head));
+    bool is_timestamp = timestamp.size() == 24 && timestamp[10] == 'T' && timestamp[19] == '.' && timestamp[23] == 'Z';
+    if (!is_timestamp || packet.compare(timestamp_end + 1, std::string::npos, rest) != 0)
+    {
+        fprintf(stderr, "unexpected packet: %s\n", packet.c_str());
+        return false;
+    }
+    return true;
+}
+
+static void set_uptime(uint32_t seconds)
+{
+    stub_log_ms() = seconds * 1000;
+}
+
+static void test_batch(void)
+{
+    // info lines wait for the burst, a warning sends them right away
+    ESP_LOGI("app", "first %d", 1);
+    ESP_LOGI("other", "second");
+    ESP_LOGW("app", "third");
+    ESP_LOGE("app", "fourth\r\n");
+
+    CHECK(is_line(receive(), 16 * 8 + 6, "pomodoro app - - - first 1"));
+    CHECK(is_line(receive(), 16 * 8 + 6, "pomodoro other - - - second"));
+    CHECK(is_line(receive(), 16 * 8 + 4, "pomodoro app - - - third"));
+    CHECK(is_line(receive(), 16 * 8 + 3, "pomodoro app - - - fourth"));
+
+    // and the flush interval sends a lone one
+    ESP_LOGI("app", "fifth");
+    CHECK(is_line(receive(), 16 * 8 + 6, "pomodoro app - - - fifth"));
+
+    // lines that are not ESP_LOG output stay on the UART
+    stub_log("plain printf\n");
+    ESP_LOGW("app", "sixth");
+    CHECK(is_line(receive(), 16 * 8 + 4, "pomodoro app - - - sixth"));
+}
+
+static void test_rate_limit(void)
+{
+    set_uptime(1000);
+    for (int i = 0; i < 10; i++)
+    {
+        ESP_LOGW("noisy", "line %d", i);
+    }
+    for (int i = 0; i < CONFIG_POMODORO_SYSLOG_TAG_RATE; i++)
+    {
+        char text[32];
+        snprintf(text, sizeof(text), "pomodoro noisy - - - line %d", i);
+        CHECK(is_line(receive(), 16 * 8 + 4, text));
+    }
+    CHECK(syslog_get_stats().rate_limited == 10 - CONFIG_POMODORO_SYSLOG_TAG_RATE);
+
+    // one line back after 60 s / rate, with the count of the dropped ones
+    set_uptime(1000 + 60 / CONFIG_POMODORO_SYSLOG_TAG_RATE + 1);
+    ESP_LOGW("noisy", "back");
+    CHECK(is_line(receive(), 16 * 8 + 4, "pomodoro noisy - - - (3 earlier lines suppressed) back"));
+
+    // other tags have buckets of their own
+    ESP_LOGW("quiet", "untouched");
+    CHECK(is_line(receive(), 16 * 8 + 4, "pomodoro quiet - - - untouched"));
+}
+
+// A line every few seconds, none of them a whole line's worth: the
+// fractions add up to the configured rate all the same.
+static void test_refill_fractions(void)
+{
+    uint32_t now = 5000;
+    set_uptime(now);
+    for (int i = 0; i < CONFIG_POMODORO_SYSLOG_TAG_RATE; i++)
+    {
+        ESP_LOGI("steady", "drain");
+    }
+
+    uint32_t limited = syslog_get_stats().rate_limited;
+    int lines = 0;
+    for (uint32_t seconds = 0; seconds < 600; seconds += 5)
+    {
+        now += 5;
+        set_uptime(now);
+        ESP_LOGI("steady", "tick");
+        lines++;
+    }
+    uint32_t passed = lines - (syslog_get_stats().rate_limited - limited);
+    CHECK(passed == 10 * CONFIG_POMODORO_SYSLOG_TAG_RATE);
+
+    // a long silence fills the bucket, no more
+    set_uptime(now + 100000);
+    limited = syslog_get_stats().rate_limited;
+    for (int i = 0; i < 2 * CONFIG_POMODORO_SYSLOG_TAG_RATE; i++)
+    {
+        ESP_LOGI("steady", "burst");
+    }
+    CHECK(syslog_get_stats().rate_limited - limited == CONFIG_POMODORO_SYSLOG_TAG_RATE);
+}
+
+int main(void)
+{
+    listener = listen_any_port();
+    CHECK(listener >= 0);
+    CHECK(syslog_setup() == ESP_OK);
+
+    test_batch();
+    test_rate_limit();
+    test_refill_fractions();
+
+    syslog_stats stats = syslog_get_stats();
+    CHECK(stats.send_failed == 0);
+    CHECK(stats.bursts > 0);
+
+    printf("syslog: %d failed checks\n", check_failures);
+    return check_failures != 0;
+}
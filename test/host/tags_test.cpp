@@ -0,0 +1,117 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "tags.hpp"
+#include "check.hpp"
+
+// The tag table on its own, with the day set by the test.
+
+#define DAY 738950
+
+static int today = DAY;
+
+int journal_today(void)
+{
+    return today;
+}
+
+static uint8_t set(const char *name)
+{
+    CHECK(tags_set_active(name) == ESP_OK);
+    return tags_get_active();
+}
+
+static void test_names(void)
+{
+    CHECK(tags_get_active() == TAGS_NONE);
+    CHECK(strcmp(tags_name(TAGS_NONE), "") == 0);
+
+    uint8_t first = set("thesis");
+    uint8_t second = set("ops.on-call_2");
+    CHECK(first == 1);
+    CHECK(second == 2);
+    CHECK(strcmp(tags_name(first), "thesis") == 0);
+
+    // a name seen before gets its old index
+    CHECK(set("thesis") == first);
+    CHECK(set("ops.on-call_2") == second);
+    CHECK(set("") == TAGS_NONE);
+
+    // a rejected name leaves the active tag alone
+    set("thesis");
+    CHECK(tags_set_active("with space") == ESP_ERR_INVALID_ARG);
+    CHECK(tags_set_active("a,b") == ESP_ERR_INVALID_ARG);
+    CHECK(tags_set_active("quote\"") == ESP_ERR_INVALID_ARG);
+    CHECK(tags_set_active("0123456789abcdef") == ESP_ERR_INVALID_SIZE);
+    CHECK(tags_get_active() == first);
+
+    CHECK(set("0123456789abcde") == 3);
+    CHECK(strcmp(tags_name(TAGS_MAX), "") == 0);
+}
+
+static void test_full(void)
+{
+    char name[8];
+    for (int i = 4; i < TAGS_MAX; i++)
+    {
+        snprintf(name, sizeof(name), "tag%d", i);
+        CHECK(set(name) == i);
+    }
+
+    // no room for another, the ones there are still work
+    CHECK(tags_set_active("one-more") == ESP_ERR_NO_MEM);
+    CHECK(tags_get_active() == TAGS_MAX - 1);
+    CHECK(strcmp(tags_name(TAGS_MAX - 1), name) == 0);
+    CHECK(set("thesis") == 1);
+    CHECK(set("") == TAGS_NONE);
+    CHECK(tags_set_active("one-more") == ESP_ERR_NO_MEM);
+}
+
+static void test_totals(void)
+{
+    tags_count_work(1, 50, DAY - 8);
+    tags_count_work(1, 25, DAY - 6);
+    tags_count_work(1, 25, DAY);
+    tags_count_work(2, 45, DAY);
+    tags_count_work(TAGS_NONE, 10, DAY);
+    tags_count_work(TAGS_MAX, 99, DAY); // out of the table, dropped
+
+    tag_totals totals = tags_get_totals(1);
+    CHECK(totals.pomodoros == 3);
+    CHECK(totals.minutes == 100);
+    CHECK(totals.rolling_minutes == 50);
+
+    totals = tags_get_totals(2);
+    CHECK(totals.pomodoros == 1);
+    CHECK(totals.minutes == 45);
+    CHECK(totals.rolling_minutes == 45);
+
+    CHECK(tags_get_totals(TAGS_NONE).rolling_minutes == 10);
+    CHECK(tags_get_totals(3).pomodoros == 0);
+    CHECK(tags_get_totals(TAGS_MAX).pomodoros == 0);
+
+    // the window moves with the day, a day's bucket is reused a week later
+    today = DAY + 1;
+    CHECK(tags_get_totals(1).rolling_minutes == 25);
+    tags_count_work(2, 30, DAY + 1);
+    CHECK(tags_get_totals(1).rolling_minutes == 25);
+    CHECK(tags_get_totals(2).rolling_minutes == 75);
+
+    today = DAY + 7;
+    CHECK(tags_get_totals(1).rolling_minutes == 0);
+    CHECK(tags_get_totals(2).rolling_minutes == 30);
+    tags_count_work(1, 20, DAY + 7);
+    CHECK(tags_get_totals(1).rolling_minutes == 20);
+    CHECK(tags_get_totals(1).minutes == 120);
+    CHECK(tags_get_totals(2).rolling_minutes == 30);
+}
+
+int main(void)
+{
+    test_names();
+    test_full();
+    test_totals();
+
+    printf("tags: %d failed checks\n", check_failures);
+    return check_failures != 0;
+}
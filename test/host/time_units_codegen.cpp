@@ -0,0 +1,65 @@
+#include <stdint.h>
+
+#include "time_units.hpp"
+
+// Pairs of the same Pomodoro arithmetic on raw microsecond counts and on
+// the time types, written the way pomodoro.cpp had them before and does
+// now, compiled for size like a release build: compare_codegen.cmake fails
+// unless each pair comes out the same size.
+
+using namespace time_units;
+
+extern "C"
+{
+    // resuming: the pause is added to the start of counting
+    int64_t raw_resume(int64_t started_at, int64_t paused_at, int64_t now)
+    {
+        if (paused_at > 0)
+        {
+            started_at += now - paused_at;
+        }
+        return started_at;
+    }
+
+    time_point typed_resume(time_point started_at, time_point paused_at, time_point now)
+    {
+        if (paused_at.is_set())
+        {
+            started_at += now - paused_at;
+        }
+        return started_at;
+    }
+
+    // seconds left of a period, from whole seconds counted
+    int64_t raw_seconds_left(int64_t period_seconds, int64_t started_at, int64_t now)
+    {
+        int64_t elapsed_seconds = (now - started_at) / 1000000;
+        return period_seconds - elapsed_seconds;
+    }
+
+    int64_t typed_seconds_left(seconds period, time_point started_at, time_point now)
+    {
+        return (period - duration_cast<seconds>(now - started_at)).count();
+    }
+
+    // the deadline timer is armed in microseconds
+    int64_t raw_deadline_us(int64_t seconds_left, int64_t short_break_seconds)
+    {
+        int64_t to_check = seconds_left - short_break_seconds;
+        if (to_check < 1)
+        {
+            to_check = 1;
+        }
+        return to_check * 1000000;
+    }
+
+    int64_t typed_deadline_us(seconds left, seconds short_break)
+    {
+        seconds to_check = left - short_break;
+        if (to_check < seconds(1))
+        {
+            to_check = seconds(1);
+        }
+        return microseconds(to_check).count();
+    }
+}
@@ -0,0 +1,81 @@
+#include <stdio.h>
+#include <type_traits>
+
+#include "time_units.hpp"
+#include "check.hpp"
+
+// The time types on their own: what converts implicitly and what needs a
+// cast, truncation of negative values, and that everything folds at
+// compile time. time_units_codegen.cpp checks the generated code.
+
+using namespace time_units;
+
+// only lossless conversions are implicit
+static_assert(std::is_convertible<minutes, seconds>::value, "minutes to seconds");
+static_assert(std::is_convertible<seconds, microseconds>::value, "seconds to microseconds");
+static_assert(std::is_convertible<milliseconds, microseconds>::value, "milliseconds to microseconds");
+static_assert(!std::is_convertible<microseconds, seconds>::value, "microseconds truncate to seconds");
+static_assert(!std::is_convertible<seconds, minutes>::value, "seconds truncate to minutes");
+static_assert(!std::is_convertible<int64_t, seconds>::value, "a raw count needs a unit");
+static_assert(!std::is_convertible<seconds, int64_t>::value, "a duration is not a raw count");
+static_assert(!std::is_convertible<microseconds, time_point>::value, "a time point is not a duration");
+
+// free to pass around as the raw count is
+static_assert(std::is_trivially_copyable<seconds>::value, "duration copies as an int64_t");
+static_assert(std::is_trivially_copyable<time_point>::value, "time_point copies as an int64_t");
+static_assert(alignof(time_point) == alignof(int64_t), "time_point aligns as an int64_t");
+
+// conversions and arithmetic as constant expressions
+static_assert(microseconds(minutes(25)).count() == 1500000000LL, "minutes in microseconds");
+static_assert(milliseconds(seconds(3)).count() == 3000, "seconds in milliseconds");
+static_assert(duration_cast<minutes>(seconds(119)).count() == 1, "truncates down");
+static_assert(duration_cast<minutes>(seconds(-119)).count() == -1, "truncates towards zero");
+static_assert(duration_cast<milliseconds>(microseconds(-1999)).count() == -1, "truncates towards zero");
+static_assert(duration_cast<microseconds>(minutes(-2)).count() == -120000000LL, "scales up exactly");
+static_assert((minutes(1) + seconds(30)).count() == 90, "mixed units add in the finer one");
+static_assert((seconds(1) - milliseconds(1)).count() == 999, "mixed units subtract in the finer one");
+static_assert((seconds(10) * 3 / 4).count() == 7, "scaling truncates the count");
+static_assert(minutes(1) == seconds(60), "equal across units");
+static_assert(seconds(59) < minutes(1), "ordered across units");
+
+static_assert(!time_point().is_set(), "boot is not set");
+static_assert(time_point(seconds(5)).is_set(), "after boot is set");
+static_assert(time_point(seconds(5)) - time_point(seconds(2)) == seconds(3), "difference of points");
+static_assert(time_point(seconds(5)) + minutes(1) == time_point(seconds(65)), "point plus duration");
+
+static void test_compound(void)
+{
+    seconds left = minutes(45);
+    left -= seconds(50);
+    left += seconds(20);
+    CHECK(left.count() == 45 * 60 - 30);
+
+    time_point at(seconds(10));
+    at += minutes(2);
+    CHECK(at.time_since_boot() == seconds(130));
+    CHECK(at - seconds(30) == time_point(seconds(100)));
+    CHECK(at > time_point(seconds(129)));
+    CHECK(time_point(seconds(129)) < at);
+    CHECK(at != time_point());
+}
+
+// Counts near the int64_t range that the firmware could see: microseconds
+// since boot run out after 292000 years, a cast must not overflow on the way.
+static void test_range(void)
+{
+    microseconds far(INT64_MAX - 1);
+    CHECK(duration_cast<seconds>(far).count() == (INT64_MAX - 1) / 1000000);
+    CHECK(duration_cast<minutes>(microseconds(INT64_MIN + 1)).count() == (INT64_MIN + 1) / 60000000);
+
+    volatile int64_t raw = -2999999;
+    CHECK(duration_cast<seconds>(microseconds(raw)).count() == -2);
+}
+
+int main(void)
+{
+    test_compound();
+    test_range();
+
+    printf("time_units: %d failed checks\n", check_failures);
+    return check_failures != 0;
+}
@@ -0,0 +1,140 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "esp_timer.h"
+#include "pomodoro_fsm.hpp"
+#include "check.hpp"
+
+// The deadline loop of pomodoro.cpp on the stub timer: the same transitions
+// at the same clock times, whatever the time scale.
+
+#define TRANSITIONS 12
+
+void journal_add(journal_event event, pomodoro_phase phase, uint16_t detail)
+{
+    (void)event;
+    (void)phase;
+    (void)detail;
+}
+
+bool pomodoro_post_input(uint32_t input)
+{
+    (void)input;
+    return true;
+}
+
+struct transition
+{
+    pomodoro_phase phase;
+    int64_t at; // clock seconds since the run started
+};
+
+struct run_result
+{
+    transition transitions[TRANSITIONS];
+    int checks;
+    int64_t real_us;
+};
+
+// Periods of odd lengths, so no scale divides them evenly.
+static void adjust(instance_fsm::Machine<Pomodoro> &fsm, int64_t delta)
+{
+    AdjustPeriod event;
+    event.delta = minutes(delta);
+    fsm.dispatch(event);
+}
+
+// Starts in the long break to pass every state. Periods are started by a
+// press as soon as they are entered, the scale changes after the first one.
+static run_result run(uint32_t scale, uint32_t later_scale)
+{
+    run_result result = {};
+    const TimerAction timer_action = {};
+    const CheckTimer check_timer = {};
+
+    clock_set_scale(scale);
+    int64_t real_started = esp_timer_get_time();
+    time_point started = clock_now();
+
+    instance_fsm::Machine<Pomodoro> fsm;
+    fsm.start<LongBreak>(initial_context);
+    adjust(fsm, -13);
+    fsm.state()->context.work_period_seconds = minutes(7) + seconds(13);
+    fsm.state()->context.short_break_period_seconds = minutes(3) + seconds(1);
+
+    size_t count = 0;
+    while (count < TRANSITIONS)
+    {
+        pomodoro_status status = pomodoro_fsm_status(fsm);
+        if (!status.is_started)
+        {
+            fsm.dispatch(timer_action);
+            continue;
+        }
+
+        stub_timer_advance(clock_to_real(pomodoro_next_check(status, fsm.state()->context)).count());
+        result.checks++;
+        fsm.dispatch(check_timer);
+
+        pomodoro_phase phase = pomodoro_fsm_status(fsm).phase;
+        if (phase != status.phase)
+        {
+            result.transitions[count].phase = phase;
+            result.transitions[count].at = duration_cast<seconds>(clock_now() - started).count();
+            count++;
+            if (count == 1)
+            {
+                clock_set_scale(later_scale);
+            }
+        }
+    }
+
+    result.real_us = esp_timer_get_time() - real_started;
+    return result;
+}
+
+static bool is_same(const run_result &a, const run_result &b)
+{
+    for (size_t i = 0; i < TRANSITIONS; i++)
+    {
+        if (a.transitions[i].phase != b.transitions[i].phase || a.transitions[i].at != b.transitions[i].at)
+        {
+            fprintf(stderr, "transition %u: phase %d at %lld s against phase %d at %lld s\n", (unsigned)i, a.transitions[i].phase,
+                    (long long)a.transitions[i].at, b.transitions[i].phase, (long long)b.transitions[i].at);
+            return false;
+        }
+    }
+    return a.checks == b.checks;
+}
+
+int main(void)
+{
+    stub_timer_set(12345678);
+
+    run_result real = run(1, 1);
+
+    // every deadline ends a period, none fires early
+    CHECK(real.checks == TRANSITIONS);
+    CHECK(real.transitions[0].phase == PHASE_LONG_BREAK_LAST_MINUTES);
+    CHECK(real.transitions[0].at == 17 * 60 - (3 * 60 + 1));
+    CHECK(real.transitions[1].phase == PHASE_WORK);
+    CHECK(real.transitions[1].at == 17 * 60);
+    CHECK(real.transitions[2].phase == PHASE_SHORT_BREAK);
+    CHECK(real.transitions[2].at == 17 * 60 + 7 * 60 + 13);
+
+    const uint32_t scales[][2] = {{60, 60}, {7, 7}, {1, 60}, {60, 1}, {3600, 13}};
+    for (const uint32_t *scale : scales)
+    {
+        run_result fast = run(scale[0], scale[1]);
+        CHECK(is_same(real, fast));
+        if (scale[0] == scale[1])
+        {
+            // rounded up once per deadline
+            CHECK(fast.real_us >= real.real_us / scale[0]);
+            CHECK(fast.real_us <= real.real_us / scale[0] + TRANSITIONS);
+        }
+    }
+
+    printf("timescale: %d failed checks\n", check_failures);
+    return check_failures != 0;
+}
@@ -0,0 +1,137 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "provision.hpp"
+#include "tz.hpp"
+#include "check.hpp"
+
+struct zone
+{
+    const char *name;
+    const char *rule;
+};
+
+static const zone zones[] = {
+#include "tz_table.inc"
+};
+
+static provision_config config = {};
+
+const provision_config &provision_get(void)
+{
+    return config;
+}
+
+static const int64_t FROM = 946684800; // 2000-01-01
+static const int64_t UNTIL = 2145916800; // 2038-01-01
+static const int64_t RULES_HOLD_FROM = 1735689600; // 2025-01-01
+
+static int failures_of_zone = 0;
+
+// Compares against the C library, which has to be set to the same zone.
+static void check_instant(const char *name, int64_t utc)
+{
+    time_t t = utc;
+    struct tm expected;
+    localtime_r(&t, &expected);
+
+    bool is_dst;
+    int32_t offset = tz_offset(utc, &is_dst, nullptr);
+
+    struct tm local;
+    tz_localtime(utc, &local);
+
+    bool is_same = offset == expected.tm_gmtoff && is_dst == (expected.tm_isdst > 0) && local.tm_year == expected.tm_year &&
+                   local.tm_mon == expected.tm_mon && local.tm_mday == expected.tm_mday && local.tm_hour == expected.tm_hour &&
+                   local.tm_min == expected.tm_min && local.tm_sec == expected.tm_sec && local.tm_wday == expected.tm_wday;
+
+    // a repeated local time maps back to the first of the two instants
+    int64_t back = tz_to_utc(&local);
+    struct tm again;
+    tz_localtime(back, &again);
+    bool is_round_trip = back == utc || (back < utc && again.tm_hour == local.tm_hour && again.tm_min == local.tm_min && again.tm_mday == local.tm_mday);
+
+    if ((!is_same || !is_round_trip) && failures_of_zone++ < 3)
+    {
+        fprintf(stderr, "%s at %lld: offset %d dst %d, the C library says %ld dst %d, back %lld\n", name, (long long)utc, (int)offset, is_dst,
+                expected.tm_gmtoff, expected.tm_isdst, (long long)back);
+    }
+    CHECK(is_same);
+    CHECK(is_round_trip);
+}
+
+// Every change the rule reports, either side of it, and every six hours.
+static void check_zone(const char *name, int64_t from, int64_t until)
+{
+    failures_of_zone = 0;
+
+    for (int64_t utc = from; utc < until; utc += 6 * 3600)
+    {
+        check_instant(name, utc);
+    }
+
+    int64_t utc = from;
+    while (utc < until)
+    {
+        int64_t next;
+        tz_offset(utc, nullptr, &next);
+        if (next >= until)
+        {
+            break;
+        }
+        check_instant(name, next - 1);
+        check_instant(name, next);
+        utc = next;
+    }
+}
+
+int main(void)
+{
+    size_t compared_with_zoneinfo = 0;
+
+    for (size_t i = 0; i < sizeof(zones) / sizeof(zones[0]); i++)
+    {
+        // tz_setup() hands the same rule to the C library
+        snprintf(config.timezone, sizeof(config.timezone), "%s", zones[i].name);
+        tz_setup();
+        CHECK(tz_find_zone(zones[i].name) != nullptr && strcmp(tz_find_zone(zones[i].name), zones[i].rule) == 0);
+        CHECK(strcmp(getenv("TZ"), zones[i].rule) == 0);
+        check_zone(zones[i].name, FROM, UNTIL);
+
+        // and the table has to agree with the tz database the rules hold for
+        char path[96];
+        snprintf(path, sizeof(path), "/usr/share/zoneinfo/%s", zones[i].name);
+        if (access(path, R_OK) == 0)
+        {
+            setenv("TZ", zones[i].name, 1);
+            tzset();
+            check_zone(zones[i].name, RULES_HOLD_FROM, UNTIL);
+            compared_with_zoneinfo++;
+        }
+    }
+
+    // a rule of its own and a name nobody knows
+    strcpy(config.timezone, "<+0545>-5:45");
+    tz_setup();
+    check_zone(config.timezone, FROM, UNTIL);
+
+    strcpy(config.timezone, "Mars/Olympus_Mons");
+    tz_setup();
+    CHECK(tz_offset(FROM, nullptr, nullptr) == 0);
+    CHECK(tz_find_zone(config.timezone) == nullptr);
+
+    // signed minutes and seconds are not a time, found by fuzz_tz
+    tz_rule rule;
+    CHECK(tz_parse("ABC-3:45", &rule) && rule.std_offset == 3 * 3600 + 45 * 60);
+    CHECK(!tz_parse("ABC-3:-32330", &rule));
+    CHECK(!tz_parse("ABC3:+5", &rule));
+    CHECK(!tz_parse("ABC3:05: 7", &rule));
+    CHECK(!tz_parse("ABC3DEF,M3.5.0/2:-1,M10.5.0", &rule));
+
+    printf("tz: %u zones, %u also against zoneinfo, %d failed checks\n", (unsigned)(sizeof(zones) / sizeof(zones[0])),
+           (unsigned)compared_with_zoneinfo, check_failures);
+    return check_failures == 0 ? 0 : 1;
+}
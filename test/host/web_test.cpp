@@ -0,0 +1,201 @@
+#include <stdio.h>
+#include <string.h>
+#include <string>
+
+#include "esp_http_server.h"
+#include "esp_partition.h"
+
+#include "history.hpp"
+#include "pomodoro.hpp"
+#include "tags.hpp"
+#include "web.hpp"
+#include "check.hpp"
+
+// The http api over the history in a RAM flash partition, the tag table and
+// the input queue stood in for below.
+
+#define START 1700000000
+
+static const char *const tag_names[] = {"", "plain", "a,b\"c", "line\nend\x01", "back\\slash"};
+static bool is_queue_full = false;
+static uint32_t last_input = 0;
+
+const char *tags_name(uint8_t tag)
+{
+    return tag < sizeof(tag_names) / sizeof(tag_names[0]) ? tag_names[tag] : "";
+}
+
+uint8_t tags_get_active(void)
+{
+    return 1;
+}
+
+esp_err_t tags_set_active(const char *name)
+{
+    (void)name;
+    return ESP_OK;
+}
+
+pomodoro_status pomodoro_get_status(void)
+{
+    pomodoro_status status = {};
+    status.is_busy = last_input == INPUT_BUSY_ON;
+    return status;
+}
+
+bool pomodoro_post_input(uint32_t input)
+{
+    if (is_queue_full)
+    {
+        return false;
+    }
+    last_input = input;
+    return true;
+}
+
+static void append(uint32_t timestamp, journal_event event, pomodoro_phase phase, uint16_t detail, uint8_t tag)
+{
+    journal_record record = {};
+    record.timestamp = timestamp;
+    record.event = event;
+    record.phase = phase;
+    record.detail = detail;
+    record.tag = tag;
+    history_append(record);
+}
+
+static httpd_req_t get_history(const char *query, int fail_chunks_after = -1)
+{
+    return stub_httpd_request("/history", HTTP_GET, query, fail_chunks_after);
+}
+
+static void test_csv(void)
+{
+    httpd_req_t req = get_history(nullptr);
+    CHECK(req.status == "200 OK");
+    CHECK(req.type == "text/csv");
+    CHECK(req.is_finished);
+    CHECK(req.body == "timestamp,event,phase,detail,tag\n"
+                      "1700001500,work,2,25,plain\n"
+                      "1700001800,internal,2,7,\"a,b\"\"c\"\n"
+                      "1700003300,external,3,0,\"line\nend\x01\"\n"
+                      "1700003600,absence,1,65535,back\\slash\n"
+                      "1700090000,work,2,50,\n");
+}
+
+static void test_ndjson(void)
+{
+    httpd_req_t req = get_history("format=ndjson&from=1700001800&to=1700003300");
+    CHECK(req.status == "200 OK");
+    CHECK(req.type == "application/x-ndjson");
+    CHECK(req.body == "{\"timestamp\":1700001800,\"event\":\"internal\",\"phase\":2,\"detail\":7,\"tag\":\"a,b\\\"c\"}\n"
+                      "{\"timestamp\":1700003300,\"event\":\"external\",\"phase\":3,\"detail\":0,\"tag\":\"line\\u000aend\\u0001\"}\n");
+
+    req = get_history("format=ndjson&from=1700003600&to=1700003600");
+    CHECK(req.body == "{\"timestamp\":1700003600,\"event\":\"absence\",\"phase\":1,\"detail\":65535,\"tag\":\"back\\\\slash\"}\n");
+}
+
+static void test_range(void)
+{
+    // both ends included, either one may be left out
+    CHECK(get_history("from=1700001800&to=1700003600").body.find("1700001500") == std::string::npos);
+    CHECK(get_history("from=1700001800&to=1700003600").body.find("1700003600") != std::string::npos);
+    CHECK(get_history("from=1700003601").body == "timestamp,event,phase,detail,tag\n1700090000,work,2,50,\n");
+    CHECK(get_history("to=1700001500").body == "timestamp,event,phase,detail,tag\n1700001500,work,2,25,plain\n");
+    CHECK(get_history("from=1700090001").body == "timestamp,event,phase,detail,tag\n");
+    CHECK(get_history("format=csv&from=0&to=4294967295").body.find("1700090000") != std::string::npos);
+}
+
+static void test_bad_queries(void)
+{
+    const char *const queries[] = {
+        "format=xml",
+        "format=ndjsonxx", // longer than the buffer, not cut down to ndjson
+        "from=abc",
+        "from=-1",
+        "from=12x",
+        "to=4294967296",
+        "from=000000000001700003601", // longer than the buffer, not read as 17000
+        "from=1700003600&to=1700001800",
+    };
+    for (const char *query : queries)
+    {
+        httpd_req_t req = get_history(query);
+        CHECK(req.status == "400 Bad Request");
+        CHECK(req.type.empty());
+    }
+
+    // a query cut at the buffer would lose the end of the range
+    std::string query = "format=csv&from=1700003601&to=4294967295&xxxxxxxxxxxxxxxxxxxxxx";
+    CHECK(query.size() == 63);
+    CHECK(get_history(query.c_str()).status == "200 OK");
+    query += "x";
+    CHECK(get_history(query.c_str()).status == "414 URI Too Long");
+}
+
+static void test_chunks(void)
+{
+    for (uint32_t i = 0; i < 200; i++)
+    {
+        append(START + 100000 + i * 300, JOURNAL_WORK_DONE, PHASE_WORK, i, 2);
+    }
+
+    httpd_req_t req = get_history("format=ndjson");
+    CHECK(req.chunks > 2);
+    CHECK(req.is_finished);
+    size_t lines = 0;
+    for (char c : req.body)
+    {
+        lines += c == '\n';
+    }
+    CHECK(lines == 205);
+    CHECK(req.body.compare(req.body.size() - 1, 1, "\n") == 0);
+
+    // a client gone mid-export ends it
+    req = get_history("format=ndjson", 1);
+    CHECK(req.chunks == 1);
+    CHECK(!req.is_finished);
+}
+
+static void test_busy(void)
+{
+    httpd_req_t req = stub_httpd_request("/busy", HTTP_POST, "state=on");
+    CHECK(req.status == "202 Accepted");
+    CHECK(last_input == INPUT_BUSY_ON);
+    CHECK(stub_httpd_request("/busy", HTTP_GET, nullptr).body == "{\"busy\":true}\n");
+
+    CHECK(stub_httpd_request("/busy", HTTP_POST, "state=maybe").status == "400 Bad Request");
+    CHECK(stub_httpd_request("/busy", HTTP_POST, nullptr).status == "400 Bad Request");
+
+    // a dropped input is not reported as accepted
+    is_queue_full = true;
+    req = stub_httpd_request("/busy", HTTP_POST, "state=off");
+    CHECK(req.status == "503 Service Unavailable");
+    CHECK(last_input == INPUT_BUSY_ON);
+    is_queue_full = false;
+    CHECK(stub_httpd_request("/busy", HTTP_POST, "state=off").status == "202 Accepted");
+    CHECK(last_input == INPUT_BUSY_OFF);
+}
+
+int main(void)
+{
+    stub_partition_create("history", 4 * 4096);
+    CHECK(history_setup() == ESP_OK);
+    CHECK(web_setup() == ESP_OK);
+
+    append(START + 1500, JOURNAL_WORK_DONE, PHASE_WORK, 25, 1);
+    append(START + 1800, JOURNAL_INTERRUPTION_INTERNAL, PHASE_WORK, 7, 2);
+    append(START + 3300, JOURNAL_INTERRUPTION_EXTERNAL, PHASE_SHORT_BREAK, 0, 3);
+    append(START + 3600, JOURNAL_ABSENCE, PHASE_IDLE, 65535, 4);
+    append(START + 90000, JOURNAL_WORK_DONE, PHASE_WORK, 50, 0);
+
+    test_csv();
+    test_ndjson();
+    test_range();
+    test_bad_queries();
+    test_chunks();
+    test_busy();
+
+    printf("web: %d failed checks\n", check_failures);
+    return check_failures != 0;
+}
@@ -0,0 +1,88 @@
+#!/usr/bin/env python3
+"""Desktop activity agent for the pomodoro light.
+
+Watches the desktop idle time and sends signed UDP hints to the light:
+ACTIVE as a heartbeat while somebody works, IDLE once the desktop has been
+untouched for a while and BREAK after a long stretch of uninterrupted work.
+The light only reacts to changes, so repeating the same hint is harmless.
+
+Idle time is read from xprintidle on X11 and from IOHIDSystem on macOS.
+Each hint carries a signed agent id, by default derived from the host name,
+which the light keeps the sequence and idle state of that agent under.
+"""
+
+import argparse
+import hashlib
+import hmac
+import re
+import socket
+import struct
+import subprocess
+import sys
+import time
+import zlib
+
+HINT_VERSION = 2
+HINT_MAC_SIZE = 8
+
+HINT_ACTIVE = 1
+HINT_IDLE = 2
+HINT_BREAK = 3
+
+
+def encode_hint(key, kind, agent, sequence):
+    header = b"PH" + struct.pack(">BBII", HINT_VERSION, kind, agent, sequence)
+    mac = hmac.new(key, header, hashlib.sha256).digest()[:HINT_MAC_SIZE]
+    return header + mac
+
+
+def idle_seconds():
+    if sys.platform == "darwin":
+        out = subprocess.check_output(["ioreg", "-c", "IOHIDSystem"]).decode()
+        match = re.search(r'"HIDIdleTime" = (\d+)', out)
+        return int(match.group(1)) / 1e9 if match else 0.0
+    out = subprocess.check_output(["xprintidle"]).decode()
+    return int(out.strip()) / 1000.0
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("host", help="address of the light")
+    parser.add_argument("--port", type=int, default=4810)
+    parser.add_argument("--key", required=True, help="shared secret, CONFIG_POMODORO_HINT_KEY")
+    parser.add_argument("--idle-after", type=int, default=300, help="seconds without input to report idle")
+    parser.add_argument("--break-after", type=int, default=0, help="seconds of continuous activity to suggest a break, 0 disables")
+    parser.add_argument("--interval", type=int, default=30, help="heartbeat interval in seconds")
+    parser.add_argument("--agent-id", type=lambda text: int(text, 0), default=None, help="32 bit agent id, from the host name by default")
+    args = parser.parse_args()
+
+    agent = args.agent_id if args.agent_id is not None else zlib.crc32(socket.gethostname().encode())
+
+    key = args.key.encode()
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    active_since = time.time()
+    break_sent = False
+
+    while True:
+        now = time.time()
+        is_idle = idle_seconds() >= args.idle_after
+
+        if is_idle:
+            kind = HINT_IDLE
+            active_since = now
+            break_sent = False
+        elif args.break_after and not break_sent and now - active_since >= args.break_after:
+            kind = HINT_BREAK
+            break_sent = True
+        else:
+            kind = HINT_ACTIVE
+
+        # tenths of a second, strictly increasing across agent restarts
+        sequence = int(now * 10) & 0xFFFFFFFF
+        sock.sendto(encode_hint(key, kind, agent & 0xFFFFFFFF, sequence), (args.host, args.port))
+
+        time.sleep(args.interval)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,128 @@
+#!/usr/bin/env python3
+"""Daily energy budget of the pomodoro light.
+
+Estimates the average current and mAh/day either from a synthetic day of
+pomodoro cycles or from the counters printed by the `energy` console command:
+
+    energy_model.py --day --wifi-ps max_modem
+    energy_model.py --counters "energy uptime_s=86400 task_wakeups=410 ..."
+
+Coefficients are rough ESP8266 datasheet figures and can be overridden with
+--coef name=value, so compare changes against each other rather than
+trusting the absolute numbers.
+"""
+
+import argparse
+import sys
+
+# currents in mA, durations in ms
+COEFFICIENTS = {
+    # baseline while the CPU waits, per power save mode (esp_wifi ps type)
+    "base_none": 70.0,
+    "base_min_modem": 15.0,
+    "base_max_modem": 3.0,
+    # automatic light sleep between DTIM beacons with CONFIG_PM_ENABLE
+    "base_light_sleep": 1.2,
+    "cpu_active": 20.0,
+    "task_wakeup_ms": 2.0,
+    "blink_wakeup_ms": 0.05,
+    "led_on": 5.0,
+}
+
+WIFI_PS_MODES = ["none", "min_modem", "max_modem"]
+
+SECONDS_PER_DAY = 24 * 60 * 60
+
+
+def synthetic_day(work_minutes=45, break_minutes=15, cycles=8, long_break_minutes=30):
+    """Counters of one day: a run of work/break cycles, the rest idle.
+
+    Follows led_visualize(): one steady LED while counting, the yellow LED
+    blinks while idle. Every period costs a deadline wakeup and a button
+    press, the e-paper and presence inputs are left out.
+    """
+    counting = cycles * (work_minutes + break_minutes) * 60 + long_break_minutes * 60
+    idle = max(SECONDS_PER_DAY - counting, 0)
+    periods = 2 * cycles + 1
+
+    return {
+        "uptime_s": SECONDS_PER_DAY,
+        "task_wakeups": 2 * periods,
+        "blink_wakeups": idle,
+        "led_s": counting + idle // 2,
+    }
+
+
+def parse_counters(line):
+    counters = {}
+    for field in line.split():
+        if "=" in field:
+            name, value = field.split("=", 1)
+            counters[name] = int(value)
+    for name in ("uptime_s", "task_wakeups", "blink_wakeups", "led_s"):
+        if name not in counters:
+            raise ValueError("missing counter %s" % name)
+    if counters["uptime_s"] <= 0:
+        raise ValueError("uptime_s must be positive")
+    return counters
+
+
+def average_current(counters, wifi_ps, light_sleep, coef):
+    uptime = counters["uptime_s"]
+
+    base = coef["base_light_sleep"] if light_sleep and wifi_ps != "none" else coef["base_" + wifi_ps]
+    active_s = (counters["task_wakeups"] * coef["task_wakeup_ms"] + counters["blink_wakeups"] * coef["blink_wakeup_ms"]) / 1000.0
+
+    breakdown = {
+        "base": base,
+        "cpu": coef["cpu_active"] * active_s / uptime,
+        "leds": coef["led_on"] * counters["led_s"] / uptime,
+    }
+    return breakdown
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    source = parser.add_mutually_exclusive_group(required=True)
+    source.add_argument("--day", action="store_true", help="model a synthetic day of pomodoro cycles")
+    source.add_argument("--counters", help="output line of the energy console command, - reads stdin")
+    parser.add_argument("--cycles", type=int, default=8, help="work periods per synthetic day")
+    parser.add_argument("--wifi-ps", choices=WIFI_PS_MODES, help="power save mode, defaults to the one in the counters")
+    parser.add_argument("--light-sleep", action="store_true", help="automatic light sleep, CONFIG_PM_ENABLE")
+    parser.add_argument("--budget", type=float, help="mAh/day budget, exit 1 when exceeded")
+    parser.add_argument("--coef", action="append", default=[], metavar="NAME=VALUE")
+    args = parser.parse_args()
+
+    coef = dict(COEFFICIENTS)
+    for item in args.coef:
+        name, value = item.split("=", 1)
+        if name not in coef:
+            parser.error("unknown coefficient %s" % name)
+        coef[name] = float(value)
+
+    wifi_ps = args.wifi_ps or "none"
+    if args.day:
+        counters = synthetic_day(cycles=args.cycles)
+    else:
+        line = sys.stdin.read() if args.counters == "-" else args.counters
+        counters = parse_counters(line)
+        if args.wifi_ps is None and "wifi_ps" in counters:
+            wifi_ps = WIFI_PS_MODES[counters["wifi_ps"]]
+
+    breakdown = average_current(counters, wifi_ps, args.light_sleep, coef)
+    total = sum(breakdown.values())
+    mah_per_day = total * 24
+
+    print("wifi power save: %s%s" % (wifi_ps, ", light sleep" if args.light_sleep else ""))
+    for name, current in breakdown.items():
+        print("  %-5s %8.3f mA" % (name, current))
+    print("average %8.3f mA, %.1f mAh/day" % (total, mah_per_day))
+
+    if args.budget is not None and mah_per_day > args.budget:
+        print("over budget by %.1f mAh/day" % (mah_per_day - args.budget))
+        return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,124 @@
+#!/usr/bin/env python3
+"""Throws malformed input at a running pomodoro light.
+
+hint:    mutated activity hints over UDP. Mutations start from correctly
+         signed packets (the seed corpus) of several agents and flip bits,
+         truncate, extend, replay sequences or forge the mac.
+console: random lines written to the serial console, e.g. /dev/ttyUSB0
+         set up beforehand with `stty -F /dev/ttyUSB0 115200 raw`. Mixes
+         known commands with garbage arguments, overlong lines and
+         binary noise.
+
+The same --seed replays the same stream. Watch the device log: every
+packet has to be dropped or applied, and the unit must neither reset nor
+stop responding.
+"""
+
+import argparse
+import random
+import socket
+import sys
+import time
+
+from activity_agent import HINT_ACTIVE, HINT_BREAK, HINT_IDLE, encode_hint
+
+CONSOLE_LINE_MAX = 128
+# the fuzz command is left out, it would only flood the FSM
+COMMANDS = ["help", "timescale", "energy", "heap"]
+
+
+# more agents than the light has room for
+AGENTS = 6
+
+
+def hint_seeds(key, agent, sequence):
+    return [encode_hint(key, kind, agent, sequence + i) for i, kind in enumerate((HINT_ACTIVE, HINT_IDLE, HINT_BREAK))]
+
+
+def mutate_hint(rng, packet):
+    data = bytearray(packet)
+    choice = rng.randrange(6)
+    if choice == 0:
+        pos = rng.randrange(len(data))
+        data[pos] ^= 1 << rng.randrange(8)
+    elif choice == 1:
+        del data[rng.randrange(len(data)):]
+    elif choice == 2:
+        data += bytes(rng.randrange(256) for _ in range(rng.randrange(1, 64)))
+    elif choice == 3:
+        data[3] = rng.randrange(256)
+    elif choice == 4:
+        data[12:] = bytes(rng.randrange(256) for _ in range(8))
+    else:
+        return bytes(rng.randrange(256) for _ in range(rng.randrange(0, 32)))
+    return bytes(data)
+
+
+def fuzz_hint(args, rng):
+    key = args.key.encode()
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    sequence = int(time.time() * 10) & 0xFFFFFFFF
+
+    for i in range(args.count):
+        seeds = hint_seeds(key, rng.randrange(AGENTS), sequence)
+        if rng.random() < 0.1:
+            # valid and replayed packets keep the edge handling busy too
+            packet = rng.choice(seeds)
+            sequence += rng.choice((0, 3))
+        else:
+            packet = mutate_hint(rng, rng.choice(seeds))
+        sock.sendto(packet, (args.host, args.port))
+        time.sleep(args.delay)
+
+
+def random_line(rng):
+    choice = rng.randrange(5)
+    if choice == 0:
+        return rng.choice(COMMANDS) + " " + " ".join(str(rng.randint(-2**33, 2**33)) for _ in range(rng.randrange(4)))
+    if choice == 1:
+        return rng.choice(COMMANDS) + " " + "".join(chr(rng.randrange(32, 127)) for _ in range(rng.randrange(1, 40)))
+    if choice == 2:
+        return "x" * rng.randrange(CONSOLE_LINE_MAX - 2, CONSOLE_LINE_MAX * 3)
+    if choice == 3:
+        return '"' + rng.choice(COMMANDS) + " \\"
+    return "".join(chr(rng.randrange(256)) for _ in range(rng.randrange(1, 80)))
+
+
+def fuzz_console(args, rng):
+    with open(args.device, "wb", buffering=0) as tty:
+        for i in range(args.count):
+            line = random_line(rng)
+            tty.write(line.encode("latin-1") + b"\r\n")
+            time.sleep(args.delay)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--seed", type=int, default=None)
+    parser.add_argument("--count", type=int, default=10000)
+    parser.add_argument("--delay", type=float, default=0.01, help="seconds between inputs")
+    sub = parser.add_subparsers(dest="target", required=True)
+
+    hint = sub.add_parser("hint", help="UDP activity hints")
+    hint.add_argument("host")
+    hint.add_argument("--port", type=int, default=4810)
+    hint.add_argument("--key", required=True, help="shared secret, CONFIG_POMODORO_HINT_KEY")
+
+    console = sub.add_parser("console", help="serial console lines")
+    console.add_argument("device")
+
+    args = parser.parse_args()
+
+    seed = args.seed if args.seed is not None else random.randrange(2**32)
+    print("seed %d" % seed)
+    rng = random.Random(seed)
+
+    if args.target == "hint":
+        fuzz_hint(args, rng)
+    else:
+        fuzz_console(args, rng)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,289 @@
+#!/usr/bin/env python3
+"""Provisions pomodoro lights over their serial consoles, many at once.
+
+Each port gets its own thread: it asks the unit for its MAC, builds the
+bundle for that unit from the settings file, signs it with the private
+provisioning key and sends it in hex chunks that the unit acknowledges one by
+one. The unit verifies the whole bundle against the public key it was built
+with (CONFIG_POMODORO_PROVISION_PUBLIC_KEY), stores it in one NVS write and
+restarts with the new settings.
+
+Signatures are ECDSA P-256 over SHA-256 with RFC 6979 nonces, so the same
+bundle always gets the same signature. The key file holds the private key as
+64 hex digits and never leaves the provisioning host.
+
+The settings file is JSON, "default" applies to every unit and an entry
+named by MAC adds to it or overrides it:
+
+    {"default": {"wifi_ssid": "office", "wifi_password": "...",
+                 "timezone": "Europe/Berlin", "work_minutes": 50},
+     "a4:cf:12:34:56:78": {"hint_key": "..."}}
+
+Bundles are bound to the unit's MAC unless --unbound is given.
+
+    tools/provision.py --new-key provision.key
+    tools/provision.py --key provision.key --public-key
+    tools/provision.py --key provision.key --settings units.json /dev/ttyUSB0 /dev/ttyUSB1
+    tools/provision.py --key provision.key --settings units.json --dump a4:cf:12:34:56:78
+"""
+
+import argparse
+import hashlib
+import hmac
+import json
+import os
+import secrets
+import select
+import struct
+import sys
+import termios
+import threading
+import time
+
+VERSION = 2
+BUNDLE_MAX = 512
+CHUNK = 48  # bytes per data line, the console takes 127 characters
+
+FIELDS = {
+    "device_mac": 1,
+    "wifi_ssid": 2,
+    "wifi_password": 3,
+    "hint_key": 4,
+    "timezone": 5,
+    "work_minutes": 6,
+    "short_break_minutes": 7,
+    "long_break_minutes": 8,
+}
+MINUTES = ("work_minutes", "short_break_minutes", "long_break_minutes")
+LIMITS = {"wifi_ssid": 32, "wifi_password": 63, "hint_key": 32, "timezone": 47}
+
+# NIST P-256
+P = 0xffffffff00000001000000000000000000000000ffffffffffffffffffffffff
+A = P - 3
+N = 0xffffffff00000000ffffffffffffffffbce6faada7179e84f3b9cac2fc632551
+G = (0x6b17d1f2e12c4247f8bce6e563a440f277037d812deb33a0f4a13945d898c296,
+     0x4fe342e2fe1a7f9b8ee7eb4a7c0f9e162bce33576b315ececbb6406837bf51f5)
+
+
+def point_add(p1, p2):
+    if p1 is None:
+        return p2
+    if p2 is None:
+        return p1
+    if p1[0] == p2[0]:
+        if (p1[1] + p2[1]) % P == 0:
+            return None
+        slope = (3 * p1[0] * p1[0] + A) * pow(2 * p1[1], P - 2, P) % P
+    else:
+        slope = (p2[1] - p1[1]) * pow(p2[0] - p1[0], P - 2, P) % P
+    x = (slope * slope - p1[0] - p2[0]) % P
+    return (x, (slope * (p1[0] - x) - p1[1]) % P)
+
+
+def point_multiply(k, point):
+    # not constant time, the private key only ever sits on the provisioning host
+    result = None
+    while k:
+        if k & 1:
+            result = point_add(result, point)
+        point = point_add(point, point)
+        k >>= 1
+    return result
+
+
+def public_key(private):
+    """Uncompressed point, the form CONFIG_POMODORO_PROVISION_PUBLIC_KEY takes."""
+    x, y = point_multiply(private, G)
+    return b"\x04" + x.to_bytes(32, "big") + y.to_bytes(32, "big")
+
+
+def sign(private, message):
+    """ECDSA over SHA-256 as r || s, with the nonce from RFC 6979."""
+    digest = hashlib.sha256(message).digest()
+    e = int.from_bytes(digest, "big")
+    seed = private.to_bytes(32, "big") + (e % N).to_bytes(32, "big")
+    k_mac = b"\0" * 32
+    v = b"\1" * 32
+    k_mac = hmac.new(k_mac, v + b"\0" + seed, hashlib.sha256).digest()
+    v = hmac.new(k_mac, v, hashlib.sha256).digest()
+    k_mac = hmac.new(k_mac, v + b"\1" + seed, hashlib.sha256).digest()
+    v = hmac.new(k_mac, v, hashlib.sha256).digest()
+    while True:
+        v = hmac.new(k_mac, v, hashlib.sha256).digest()
+        k = int.from_bytes(v, "big")
+        if 1 <= k < N:
+            r = point_multiply(k, G)[0] % N
+            s = pow(k, N - 2, N) * (e + r * private) % N
+            if r != 0 and s != 0:
+                return r.to_bytes(32, "big") + s.to_bytes(32, "big")
+        k_mac = hmac.new(k_mac, v + b"\0", hashlib.sha256).digest()
+        v = hmac.new(k_mac, v, hashlib.sha256).digest()
+
+
+def read_key(path):
+    with open(path) as f:
+        private = int(f.read().strip(), 16)
+    if not 1 <= private < N:
+        raise ValueError("%s holds no P-256 private key" % path)
+    return private
+
+
+def sign_bundle(private, sequence, fields):
+    signed = b"PV" + struct.pack("<BBIH", VERSION, 0, sequence, len(fields)) + bytes(fields)
+    bundle = signed + sign(private, signed)
+    if len(bundle) > BUNDLE_MAX:
+        raise ValueError("bundle of %d bytes, at most %d" % (len(bundle), BUNDLE_MAX))
+    return bundle
+
+
+def build_bundle(private, sequence, settings, mac=None):
+    fields = bytearray()
+    if mac is not None:
+        fields += bytes([FIELDS["device_mac"], 6]) + bytes.fromhex(mac.replace(":", ""))
+    for name, value in sorted(settings.items()):
+        if name not in FIELDS or name == "device_mac":
+            raise ValueError("unknown setting %s" % name)
+        if name in MINUTES:
+            if not 1 <= int(value) <= 120:
+                raise ValueError("%s out of 1-120" % name)
+            data = bytes([int(value)])
+        else:
+            data = str(value).encode()
+            if len(data) > LIMITS[name] or b"\0" in data:
+                raise ValueError("%s too long" % name)
+        fields += bytes([FIELDS[name], len(data)]) + data
+
+    return sign_bundle(private, sequence, fields)
+
+
+def settings_for(table, mac):
+    settings = dict(table.get("default", {}))
+    settings.update(table.get(mac, {}))
+    return settings
+
+
+class Console:
+    """Raw 115200 baud serial port, line based, standard library only."""
+
+    def __init__(self, path):
+        self.fd = os.open(path, os.O_RDWR | os.O_NOCTTY)
+        attrs = termios.tcgetattr(self.fd)
+        attrs[0] = 0                                            # iflag
+        attrs[1] = 0                                            # oflag
+        attrs[2] = termios.CS8 | termios.CREAD | termios.CLOCAL  # cflag
+        attrs[3] = 0                                            # lflag
+        attrs[4] = attrs[5] = termios.B115200
+        attrs[6][termios.VMIN] = 0
+        attrs[6][termios.VTIME] = 0
+        termios.tcsetattr(self.fd, termios.TCSANOW, attrs)
+        termios.tcflush(self.fd, termios.TCIOFLUSH)
+        self.pending = b""
+
+    def close(self):
+        os.close(self.fd)
+
+    def send(self, line):
+        os.write(self.fd, line.encode() + b"\r\n")
+
+    def reply(self, timeout):
+        """Next PROVISION line split into words, log lines are skipped."""
+        deadline = time.monotonic() + timeout
+        while True:
+            while b"\n" in self.pending:
+                line, self.pending = self.pending.split(b"\n", 1)
+                words = line.decode("latin-1").strip().split()
+                if words[:1] == ["PROVISION"]:
+                    return words[1:]
+            left = deadline - time.monotonic()
+            if left <= 0:
+                raise TimeoutError("no answer")
+            if select.select([self.fd], [], [], left)[0]:
+                self.pending += os.read(self.fd, 256)
+
+
+def request(console, line, expected, timeout=2.0):
+    console.send(line)
+    words = console.reply(timeout)
+    if words[:1] != [expected]:
+        raise RuntimeError(" ".join(words) or "empty answer")
+    return words[1:]
+
+
+def provision(port, args, table, results):
+    console = None
+    try:
+        console = Console(port)
+        console.send("")
+        mac, stored = request(console, "provision id", "id")
+        sequence = args.sequence if args.sequence is not None else int(time.time())
+        if sequence <= int(stored):
+            raise RuntimeError("unit already has bundle %s" % stored)
+
+        bundle = build_bundle(args.private, sequence, settings_for(table, mac), None if args.unbound else mac)
+        request(console, "provision begin %d" % len(bundle), "ready")
+        for offset in range(0, len(bundle), CHUNK):
+            acked = request(console, "provision data %d %s" % (offset, bundle[offset:offset + CHUNK].hex()), "ack")
+            if int(acked[0]) != min(offset + CHUNK, len(bundle)):
+                raise RuntimeError("acknowledged %s" % acked[0])
+        request(console, "provision commit", "ok", timeout=5.0)
+        results[port] = (mac, "ok %d" % sequence)
+    except Exception as e:  # one bad unit must not stop the batch
+        results[port] = (None, "failed: %s" % e)
+    finally:
+        if console is not None:
+            console.close()
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--key", help="private key file, 64 hex digits")
+    parser.add_argument("--new-key", metavar="FILE", help="write a new private key to FILE, print its public key and exit")
+    parser.add_argument("--public-key", action="store_true", help="print the public key for CONFIG_POMODORO_PROVISION_PUBLIC_KEY and exit")
+    parser.add_argument("--settings", help="JSON settings file")
+    parser.add_argument("--sequence", type=int, default=None, help="bundle sequence, unix time by default")
+    parser.add_argument("--unbound", action="store_true", help="bundles fit any unit")
+    parser.add_argument("--dump", metavar="MAC", help="print the bundle for MAC in hex and exit")
+    parser.add_argument("ports", nargs="*")
+    args = parser.parse_args()
+
+    if args.new_key:
+        private = 1 + secrets.randbelow(N - 1)
+        fd = os.open(args.new_key, os.O_WRONLY | os.O_CREAT | os.O_EXCL, 0o600)
+        with os.fdopen(fd, "w") as f:
+            f.write("%064x\n" % private)
+        print(public_key(private).hex())
+        return 0
+    if not args.key:
+        parser.error("--key is required")
+    args.private = read_key(args.key)
+    if args.public_key:
+        print(public_key(args.private).hex())
+        return 0
+    if not args.settings:
+        parser.error("--settings is required")
+
+    with open(args.settings) as f:
+        table = json.load(f)
+
+    if args.dump:
+        sequence = args.sequence if args.sequence is not None else int(time.time())
+        print(build_bundle(args.private, sequence, settings_for(table, args.dump), None if args.unbound else args.dump).hex())
+        return 0
+
+    results = {}
+    threads = [threading.Thread(target=provision, args=(port, args, table, results)) for port in args.ports]
+    for thread in threads:
+        thread.start()
+    for thread in threads:
+        thread.join()
+
+    failed = 0
+    for port in args.ports:
+        mac, status = results[port]
+        print("%-16s %-17s %s" % (port, mac or "-", status))
+        failed += not status.startswith("ok")
+    return 1 if failed else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,71 @@
+#!/usr/bin/env python3
+"""Generates main/tz_table.inc, zone names with their POSIX TZ rule.
+
+The rule is the footer of the compiled TZif file, the string the tz database
+itself uses for every time after its last listed transition, so it holds for
+today and the years ahead. Zones whose footer is missing or empty are
+reported and left out. Rerun after a tz database update or to change the
+list of zones shipped with the firmware:
+
+    tools/tz_table.py > main/tz_table.inc
+    tools/tz_table.py --zoneinfo /usr/share/zoneinfo Europe/Berlin Asia/Tokyo
+"""
+
+import argparse
+import os
+import sys
+
+ZONES = [
+    "UTC",
+    "Europe/London", "Europe/Dublin", "Europe/Lisbon", "Europe/Berlin", "Europe/Paris",
+    "Europe/Amsterdam", "Europe/Madrid", "Europe/Rome", "Europe/Stockholm", "Europe/Warsaw",
+    "Europe/Prague", "Europe/Vienna", "Europe/Zurich", "Europe/Helsinki", "Europe/Athens",
+    "Europe/Kyiv", "Europe/Istanbul", "Europe/Moscow",
+    "America/New_York", "America/Chicago", "America/Denver", "America/Phoenix",
+    "America/Los_Angeles", "America/Anchorage", "America/Toronto", "America/Vancouver",
+    "America/Mexico_City", "America/Sao_Paulo", "America/Argentina/Buenos_Aires", "America/Santiago",
+    "Pacific/Honolulu", "Pacific/Auckland",
+    "Africa/Cairo", "Africa/Johannesburg", "Africa/Lagos", "Africa/Nairobi",
+    "Asia/Dubai", "Asia/Kolkata", "Asia/Bangkok", "Asia/Singapore", "Asia/Shanghai",
+    "Asia/Hong_Kong", "Asia/Tokyo", "Asia/Seoul", "Asia/Jerusalem", "Asia/Tehran",
+    "Australia/Perth", "Australia/Adelaide", "Australia/Brisbane", "Australia/Sydney",
+]
+
+
+def posix_rule(path):
+    """Returns the footer of a version 2+ TZif file, None without one."""
+    with open(path, "rb") as f:
+        data = f.read()
+    if not data.startswith(b"TZif") or data[4:5] < b"2":
+        return None
+    # the footer is the last line, enclosed in newlines
+    end = data.rstrip(b"\n").rfind(b"\n")
+    footer = data[end + 1:].strip()
+    return footer.decode("ascii") or None
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--zoneinfo", default="/usr/share/zoneinfo")
+    parser.add_argument("zones", nargs="*", default=ZONES)
+    args = parser.parse_args()
+
+    print("// Generated by tools/tz_table.py, do not edit.")
+    print("// { zone name, POSIX TZ rule }")
+    failed = 0
+    for zone in args.zones:
+        try:
+            rule = posix_rule(os.path.join(args.zoneinfo, zone))
+        except OSError as e:
+            rule = None
+            print("%s: %s" % (zone, e), file=sys.stderr)
+        if rule is None:
+            print("%s: no POSIX rule, left out" % zone, file=sys.stderr)
+            failed += 1
+            continue
+        print('{"%s", "%s"},' % (zone, rule))
+    return 1 if failed else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())